@@ -67,14 +67,43 @@ namespace Mapper
 
     public class List
     {
+        [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
+        private static extern IntPtr mpr_list_materialize(IntPtr list);
+        [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
+        private static extern int mpr_list_get_size(IntPtr list);
+        [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
+        private static extern IntPtr mpr_list_get_idx(IntPtr list, uint index);
+        [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
+        private static extern void mpr_list_free(IntPtr list);
+
         public List() {}
-        ~List() {}
+
+        // the list is materialized so that Count and indexed access run in constant time
+        internal List(IntPtr list)
+            { _list = mpr_list_materialize(list); }
+
+        ~List()
+        {
+            if (_list != IntPtr.Zero)
+                mpr_list_free(_list);
+        }
+
+        public int Count
+            { get { return mpr_list_get_size(_list); } }
+
+        internal IntPtr GetItem(int index)
+        {
+            if (index < 0 || index >= Count)
+                throw new IndexOutOfRangeException();
+            return mpr_list_get_idx(_list, (uint)index);
+        }
+
+        internal IntPtr _list = IntPtr.Zero;
 
         // cast to vector
 
         // Iterator functions
 
-        // public getSize();
         // public join();
         // public intersect();
         // public filter();
@@ -119,7 +148,10 @@ namespace Mapper
         Type                = 0x2400,
         Unit                = 0x2500,
         UseInstances        = 0x2600,
-        Version             = 0x2700
+        Version             = 0x2700,
+        Packed              = 0x2900,
+        Alias               = 0x2A00,
+        HostId              = 0x2B00
     }
 
     public abstract class Object
@@ -527,7 +559,8 @@ namespace Mapper
 
         public enum Protocol {
             UDP,              //!< Map updates are sent using UDP.
-            TCP               //!< Map updates are sent using TCP.
+            TCP,              //!< Map updates are sent using TCP.
+            SHM               //!< Map updates are sent using shared memory if on the same host.
         }
 
         [DllImport("mapper", CharSet = CharSet.Ansi, CallingConvention = CallingConvention.StdCall)]
@@ -185,7 +185,8 @@ void mpr_obj_print(mpr_obj object, int staged);
  *  \param name         A short descriptive string to identify the device. Must not contain spaces
  *                      or the slash character '/'.
  *  \param graph        A previously allocated graph structure to use. If 0, one will be allocated
- *                      for use with this device.
+ *                      for use with this device. A graph cannot be shared with a device polled by
+ *                      an I/O thread, see mpr_dev_start_polling().
  *  \return             A newly allocated device.  Should be freed using mpr_dev_free(). */
 mpr_dev mpr_dev_new(const char *name, mpr_graph graph);
 
@@ -220,6 +221,89 @@ mpr_list mpr_dev_get_maps(mpr_dev device, mpr_dir direction);
  *  \return             The number of handled messages. May be zero if there was nothing to do. */
 int mpr_dev_poll(mpr_dev device, int block_ms);
 
+/*! Limit the work done by mpr_dev_poll() draining queued signal updates after it has finished
+ *  blocking. Messages remaining when the budget is exhausted are handled by the next poll.
+ *  \param device       The device to use.
+ *  \param max_msgs     Maximum number of data messages to handle per poll, or 0 for no limit.
+ *                      The default is 256.
+ *  \param max_usec     Maximum number of microseconds to spend draining per poll, or 0 for no
+ *                      limit. The default is 1000. */
+void mpr_dev_set_poll_budget(mpr_dev device, int max_msgs, int max_usec);
+
+/*! Enable or disable real-time mode for a device. In real-time mode the memory used to update
+ *  signals and send the resulting map messages over UDP is preallocated whenever signals, instances
+ *  or maps are added, so that mpr_sig_set_value(), mpr_sig_release_inst() and
+ *  mpr_dev_update_maps() do not allocate once every instance has been used. Messages for TCP maps
+ *  and maps between signals of the same device are still built using the heap.
+ *  \param device       The device to use.
+ *  \param enable       Non-zero to enable real-time mode, zero to disable it. */
+void mpr_dev_set_realtime(mpr_dev device, int enable);
+
+/*! Get the number of times the signal update path of a device in real-time mode had to allocate
+ *  memory because a preallocated pool was exhausted or unsuitable.
+ *  \param device       The device to query.
+ *  \return             The number of pool misses since real-time mode was enabled. */
+int mpr_dev_get_num_pool_misses(mpr_dev device);
+
+/*! Get the time remaining until a device next needs servicing when it is driven by an external
+ *  event loop instead of mpr_dev_poll(). Wait on the descriptors returned by mpr_graph_get_fds()
+ *  for at most this long, then call mpr_dev_process_ready().
+ *  \param device       The device to query.
+ *  \return             The timeout in milliseconds, or -1 if the device is not local. */
+int mpr_dev_get_poll_timeout(mpr_dev device);
+
+/*! Handle messages waiting on ready sockets and perform any due housekeeping without blocking.
+ *  Signal updates made since the last call are also sent; call mpr_dev_update_maps() to send
+ *  them sooner.
+ *  \param device       The device to service.
+ *  \param fds          The ready descriptors reported by the event loop, or NULL on timeout.
+ *  \param num_fds      The number of entries in fds.
+ *  \return             The number of handled messages. */
+int mpr_dev_process_ready(mpr_dev device, const int *fds, int num_fds);
+
+/*! Start a thread owned by libmapper that polls this device continuously, handling all network
+ *  and administrative traffic. While it runs, other threads may call mpr_sig_set_value() and
+ *  mpr_sig_release_inst() for this device's signals: updates are passed to the I/O thread
+ *  through a lock-free queue without blocking or making system calls, and are dropped if the
+ *  queue is full. Signal and map handlers are called on the I/O thread. Other functions must not
+ *  be called for this device until mpr_dev_stop_polling() returns. The device must be the only
+ *  local device using its graph.
+ *  \param device       The device to poll.
+ *  \param block_ms     The number of milliseconds the thread blocks per poll; this bounds the
+ *                      latency of queued updates.
+ *  \return             Zero if the thread is running, non-zero on error. */
+int mpr_dev_start_polling(mpr_dev device, int block_ms);
+
+/*! Stop the thread started by mpr_dev_start_polling() after sending any queued updates. If
+ *  called from a handler on the I/O thread, the thread exits once the current poll returns, and
+ *  later calls from other threads wait until it has exited. Other threads keep passing their
+ *  updates through the queue until the thread has exited.
+ *  \param device       The device to stop polling.
+ *  \return             Zero on success, non-zero on error. */
+int mpr_dev_stop_polling(mpr_dev device);
+
+/*! Evaluate the expressions of outgoing maps using a pool of threads. When many maps are
+ *  updated at once, each worker thread and the thread polling the device evaluate a share of
+ *  them concurrently; the results are then sent by the polling thread in the same order as
+ *  without workers. Map expressions must not be modified while the device is being polled.
+ *  \param device       The device to use.
+ *  \param num_workers  The number of threads to start in addition to the polling thread, or 0
+ *                      to evaluate all maps on the polling thread. The default is 0.
+ *  \return             Zero on success, non-zero on error. */
+int mpr_dev_set_num_workers(mpr_dev device, int num_workers);
+
+/*! Shorten the allocation of a unique name for a device that is not yet registered. The device
+ *  locks its name after a tenth of the usual probing time without collisions, and moves on to
+ *  the next free ordinal as soon as a collision is reported. Peers that poll less often than
+ *  every 100 milliseconds may not object to a name in time, so this is best suited to hosts and
+ *  networks where devices are polled frequently.
+ *  \param device       The device to use.
+ *  \param ordinal      The ordinal to probe first, e.g. the one used by a previous instance of
+ *                      this device, or 0 to keep the default.
+ *  \return             Zero on success, or non-zero if the device is not local or is already
+ *                      registered. */
+int mpr_dev_set_fast_registration(mpr_dev device, int ordinal);
+
 /*! Detect whether a device is completely initialized.
  *  \param device       The device to query.
  *  \return             Non-zero if device is completely initialized, i.e., has an allocated
@@ -293,7 +377,10 @@ mpr_sig mpr_sig_new(mpr_dev parent, mpr_dir direction, const char *name, int len
 void mpr_sig_free(mpr_sig signal);
 
 /*! Update the value of a signal instance.  The signal will be routed according
- *  to external requests.
+ *  to external requests.  This function may be called from a POSIX signal handler or interrupt
+ *  that interrupted mpr_dev_poll() or another signal update on the same device; in that case the
+ *  update is queued without locking or allocating memory and sent when the interrupted call
+ *  returns.
  *  \param signal       The signal to operate on.
  *  \param instance     A pointer to the identifier of the instance to update,
  *                      or 0 for the default instance.
@@ -525,7 +612,9 @@ void mpr_map_remove_scope(mpr_map map, mpr_dev device);
  *  \param type         The value type.
  *  \param value        The value.
  *  \param op           The comparison operator.
- *  \return             A list of results.  Use mpr_list_get_next() to iterate. */
+ *  \return             A list of results.  Use mpr_list_get_next() to iterate.  Filters on
+ *                      the objects of a graph use its property indexes when they are cheaper
+ *                      than walking the list, see mpr_graph_add_index(). */
 mpr_list mpr_list_filter(mpr_list list, mpr_prop property, const char *key, int length,
                          mpr_type type, const void *value, mpr_op op);
 
@@ -574,6 +663,16 @@ void mpr_list_free(mpr_list list);
  *  \return             The number of objects in the list. */
 int mpr_list_get_size(mpr_list list);
 
+/*! Take a snapshot of the remaining items of a list, so that its size and any indexed item can
+ *  be retrieved in constant time using mpr_list_get_size() and mpr_list_get_idx(). The original
+ *  list is consumed and must not be used afterwards. The snapshot can still be iterated, copied
+ *  and combined with other lists, but it will not reflect later changes to the graph, and any
+ *  objects removed from the graph since must not be accessed through it.
+ *  \param list         The list to materialize.
+ *  \return             A snapshot of the list, or zero if it is empty.  Indexed access does
+ *                      not change the position of the list. */
+mpr_list mpr_list_materialize(mpr_list list);
+
 /** @} */ /* end of group Lists */
 
 /***** Graph *****/
@@ -614,12 +713,45 @@ void mpr_graph_set_address(mpr_graph graph, const char *group, int port);
  *                      distributed graph. */
 const char *mpr_graph_get_address(mpr_graph graph);
 
+/*! Set the maximum size of UDP datagrams used for sending signal updates. Updates queued
+ *  during a single poll are split into multiple bundles if necessary to avoid IP fragmentation.
+ *  \param graph        The graph structure to use.
+ *  \param mtu          The maximum datagram payload in bytes, or 0 to restore the default
+ *                      of 1472 bytes (suitable for a 1500 byte Ethernet MTU). */
+void mpr_graph_set_mtu(mpr_graph graph, int mtu);
+
+/*! Retrieve the maximum size of UDP datagrams used for sending signal updates.
+ *  \param graph        The graph structure to query.
+ *  \return             The maximum datagram payload in bytes. */
+int mpr_graph_get_mtu(mpr_graph graph);
+
 /*! Synchonize a local graph copy with the distributed graph.
  *  \param graph        The graph to update.
  *  \param block_ms     The number of milliseconds to block, or 0 for non-blocking behaviour.
  *  \return             The number of handled messages. */
 int mpr_graph_poll(mpr_graph graph, int block_ms);
 
+/*! Get the socket descriptors used by a graph and its local devices, for watching with an
+ *  external event loop such as epoll.
+ *  \param graph        The graph to query.
+ *  \param fds          An array to receive the descriptors, may be NULL.
+ *  \param num_fds      The size of the fds array.
+ *  \return             The total number of descriptors, which may exceed num_fds. */
+int mpr_graph_get_fds(mpr_graph graph, int *fds, int num_fds);
+
+/*! Get the time remaining until the next graph housekeeping task, such as pinging the bus or
+ *  renewing subscriptions, is due.
+ *  \param graph        The graph to query.
+ *  \return             The timeout in milliseconds. */
+int mpr_graph_get_poll_timeout(mpr_graph graph);
+
+/*! Handle messages waiting on ready sockets and perform any due housekeeping without blocking.
+ *  \param graph        The graph to update.
+ *  \param fds          The ready descriptors reported by the event loop, or NULL on timeout.
+ *  \param num_fds      The number of entries in fds.
+ *  \return             The number of handled messages. */
+int mpr_graph_process_ready(mpr_graph graph, const int *fds, int num_fds);
+
 /*! Free a graph.
  *  \param graph        The graph to free. */
 void mpr_graph_free(mpr_graph graph);
@@ -672,6 +804,40 @@ int mpr_graph_add_cb(mpr_graph graph, mpr_graph_handler *handler, int types, con
  *  \return             User data pointer associated with this callback (if any). */
 void *mpr_graph_remove_cb(mpr_graph graph, mpr_graph_handler *handler, const void *data);
 
+/*! A callback function prototype for receiving the changes to a graph in batches. Such a function
+ *  is passed in to mpr_graph_add_batch_cb().
+ *  \param graph        The graph that registered this callback.
+ *  \param num          The number of changed object records.
+ *  \param objects      The changed object records, each listed once.
+ *  \param events       The coalesced event for each object record.
+ *  \param data         The user context pointer registered with this callback. */
+typedef void mpr_graph_batch_handler(mpr_graph graph, int num, const mpr_obj *objects,
+                                     const mpr_graph_evt *events, const void *data);
+
+/*! Register a callback receiving the object records added, updated or removed in the graph as
+ *  a single batch at the end of each call to mpr_graph_poll() or mpr_dev_poll(). Repeated events
+ *  for the same object record are coalesced: an added record that is then modified is reported
+ *  once as MPR_OBJ_NEW, and a record added and removed within the same batch is not reported.
+ *  Removed records remain valid until the callback returns. The batch is delivered early when a
+ *  local signal is removed.
+ *  \param graph        The graph to query.
+ *  \param handler      Callback function.
+ *  \param types        Bitflags setting the type of information of interest.
+ *                      Can be a combination of mpr_type values.
+ *  \param data         A user-defined pointer to be passed to the callback for context.
+ *  \return             One if a callback was added, otherwise zero. */
+int mpr_graph_add_batch_cb(mpr_graph graph, mpr_graph_batch_handler *handler, int types,
+                           const void *data);
+
+/*! Remove a batched callback from the graph service.
+ *  \param graph        The graph to query.
+ *  \param handler      Callback function.
+ *  \param data         The user context pointer that was originally specified
+ *                      when adding the callback.
+ *  \return             User data pointer associated with this callback (if any). */
+void *mpr_graph_remove_batch_cb(mpr_graph graph, mpr_graph_batch_handler *handler,
+                                const void *data);
+
 /*! Return a list of objects.
  *  \param graph        The graph to query.
  *  \param types        Bitflags setting the type of information of interest.
@@ -679,6 +845,39 @@ void *mpr_graph_remove_cb(mpr_graph graph, mpr_graph_handler *handler, const voi
  *  \return             A list of results.  Use mpr_list_get_next() to iterate. */
 mpr_list mpr_graph_get_objs(mpr_graph graph, int types);
 
+/*! Get the counters of the memory pool backing the objects of a graph and the queries on them,
+ *  for diagnostics.
+ *  \param graph        The graph to query.
+ *  \param num_in_use   Set to the number of pooled blocks currently allocated, or NULL.
+ *  \param num_reserved Set to the number of blocks reserved by the pool, or NULL.
+ *  \param num_misses   Set to the number of blocks too large for the pool, or NULL.
+ *  \return             The number of blocks allocated since the graph was created. */
+int mpr_graph_get_pool_stats(mpr_graph graph, int *num_in_use, int *num_reserved,
+                             int *num_misses);
+
+/*! Index objects of the graph by the value of a property, so that mpr_list_filter() can find
+ *  matching objects without testing every object of the list.  Indexes are built the first time
+ *  they are used; afterwards only the entries of objects that have been added, removed or
+ *  modified are updated the next time they are used.
+ *  \param graph        The graph to index.
+ *  \param type         The type of objects to index: MPR_DEV, MPR_SIG, or MPR_MAP.
+ *  \param property     Symbolic identifier of the property to index.
+ *  \param key          The name of the property to index, or NULL.
+ *  \param ordered      1 to sort values so that filters using MPR_OP_GT, MPR_OP_GTE, MPR_OP_LT,
+ *                      and MPR_OP_LTE can use the index, or 0 to hash values for filters using
+ *                      MPR_OP_EQ only.
+ *  \return             Zero if the index was added, nonzero otherwise. */
+int mpr_graph_add_index(mpr_graph graph, mpr_type type, mpr_prop property, const char *key,
+                        int ordered);
+
+/*! Remove a property index from the graph.
+ *  \param graph        The graph.
+ *  \param type         The type of indexed objects.
+ *  \param property     Symbolic identifier of the indexed property.
+ *  \param key          The name of the indexed property, or NULL.
+ *  \return             Zero if the index was removed, nonzero if it was not found. */
+int mpr_graph_remove_index(mpr_graph graph, mpr_type type, mpr_prop property, const char *key);
+
 /** @} */ /* end of group Graphs */
 
 /***** Time *****/
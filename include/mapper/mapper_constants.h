@@ -80,7 +80,11 @@ typedef enum {
     MPR_PROP_UNIT           = 0x2500,
     MPR_PROP_USE_INST       = 0x2600,
     MPR_PROP_VERSION        = 0x2700,
-    MPR_PROP_EXTRA          = 0x2800
+    MPR_PROP_EXTRA          = 0x2800,
+    /* properties added since are numbered after MPR_PROP_EXTRA to keep the values above */
+    MPR_PROP_PACKED         = 0x2900,
+    MPR_PROP_ALIAS          = 0x2A00,
+    MPR_PROP_HOST_ID        = 0x2B00
 } mpr_prop;
 
 /*! This data structure must be large enough to hold a system pointer or a uin64_t */
@@ -117,6 +121,8 @@ typedef enum {
     MPR_PROTO_UNDEFINED,        /*!< Not yet defined */
     MPR_PROTO_UDP,              /*!< Map updates are sent using UDP. */
     MPR_PROTO_TCP,              /*!< Map updates are sent using TCP. */
+    MPR_PROTO_SHM,              /*!< Map updates are sent using shared memory if the devices are
+                                 *   on the same host, otherwise using UDP. */
     MPR_NUM_PROTO
 } mpr_proto;
 
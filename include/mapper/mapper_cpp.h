@@ -103,6 +103,7 @@ namespace mapper {
         DIRECTION           = MPR_PROP_DIR,
         EXPRESSION          = MPR_PROP_EXPR,
         HOST                = MPR_PROP_HOST,
+        HOST_ID             = MPR_PROP_HOST_ID,
         ID                  = MPR_PROP_ID,
         IS_LOCAL            = MPR_PROP_IS_LOCAL,
         JITTER              = MPR_PROP_JITTER,
@@ -120,6 +121,7 @@ namespace mapper {
         NUM_SIGNALS_IN      = MPR_PROP_NUM_SIGS_IN,
         NUM_SIGNALS_OUT     = MPR_PROP_NUM_SIGS_OUT,
         ORDINAL             = MPR_PROP_ORDINAL,
+        PACKED              = MPR_PROP_PACKED,
         PERIOD              = MPR_PROP_PERIOD,
         PORT                = MPR_PROP_PORT,
         PROCESS_LOCATION    = MPR_PROP_PROCESS_LOC,
@@ -252,8 +254,16 @@ namespace mapper {
         List end()
             { return List(0); }
 
+        /*! Get the number of items in the List. The List is materialized first so that later
+         *  calls to size() and indexed access run in constant time.
+         *  \return             The number of items. */
         int size()
-            { return mpr_list_get_size(_list); }
+            { materialize(); return mpr_list_get_size(_list); }
+
+        /*! Take a snapshot of the remaining items in the List, see mpr_list_materialize().
+         *  \return             Self. */
+        List& materialize()
+            { _list = mpr_list_materialize(_list); RETURN_SELF }
 
         /* Combination functions */
         /*! Add items found in List rhs to this List (without duplication).
@@ -357,7 +367,7 @@ namespace mapper {
          *  \param idx           The index of the element to retrieve.
          *  \return              The retrieved Object. */
         T operator [] (int idx)
-            { return T(mpr_list_get_idx(_list, idx)); }
+            { materialize(); return T(mpr_list_get_idx(_list, idx)); }
 
         /*! Convert this List to a std::vector of CLASS_NAME.
          *  \return              The converted List results. */
@@ -498,7 +508,8 @@ namespace mapper {
         enum class Protocol
         {
             UDP         = MPR_PROTO_UDP,    /*!< Map updates are sent using UDP. */
-            TCP         = MPR_PROTO_TCP     /*!< Map updates are sent using TCP. */
+            TCP         = MPR_PROTO_TCP,    /*!< Map updates are sent using TCP. */
+            SHM         = MPR_PROTO_SHM     /*!< Map updates are sent using shared memory. */
         };
 
         /*! the set of possible voice-stealing modes for instances. */
@@ -1104,6 +1115,24 @@ namespace mapper {
 
         int poll(int block_ms=0) const
             { return mpr_dev_poll(_obj, block_ms); }
+        Device& start_polling(int block_ms=1)
+            { mpr_dev_start_polling(_obj, block_ms); RETURN_SELF }
+        Device& stop_polling()
+            { mpr_dev_stop_polling(_obj); RETURN_SELF }
+        Device& set_num_workers(int num_workers)
+            { mpr_dev_set_num_workers(_obj, num_workers); RETURN_SELF }
+        Device& set_fast_registration(int ordinal=0)
+            { mpr_dev_set_fast_registration(_obj, ordinal); RETURN_SELF }
+        Device& set_poll_budget(int max_msgs, int max_usec)
+            { mpr_dev_set_poll_budget(_obj, max_msgs, max_usec); RETURN_SELF }
+        Device& set_realtime(bool enable=true)
+            { mpr_dev_set_realtime(_obj, enable); RETURN_SELF }
+        int num_pool_misses() const
+            { return mpr_dev_get_num_pool_misses(_obj); }
+        int poll_timeout() const
+            { return mpr_dev_get_poll_timeout(_obj); }
+        int process_ready(const std::vector<int>& fds) const
+            { return mpr_dev_process_ready(_obj, fds.data(), fds.size()); }
 
         bool ready() const
             { return mpr_dev_get_is_ready(_obj); }
@@ -1275,12 +1304,44 @@ namespace mapper {
         std::string address() const
             { return std::string(mpr_graph_get_address(_obj)); }
 
+        /*! Set the maximum size of UDP datagrams used for sending signal updates.
+         *  \param mtu      The maximum datagram payload in bytes, or 0 for the default.
+         *  \return         Self. */
+        Graph& set_mtu(int mtu)
+            { mpr_graph_set_mtu(_obj, mtu); RETURN_SELF }
+
+        /*! Retrieve the maximum size of UDP datagrams used for sending signal updates.
+         *  \return     The maximum datagram payload in bytes. */
+        int mtu() const
+            { return mpr_graph_get_mtu(_obj); }
+
         /*! Update a Graph.
          *  \param block_ms     The number of milliseconds to block, or 0 for non-blocking behavior.
          *  \return             The number of handled messages. */
         int poll(int block_ms=0) const
             { return mpr_graph_poll(_obj, block_ms); }
 
+        /*! Retrieve the socket descriptors used by this Graph for an external event loop.
+         *  \return             The socket descriptors. */
+        std::vector<int> fds() const
+        {
+            std::vector<int> fds(mpr_graph_get_fds(_obj, NULL, 0));
+            if (fds.size())
+                mpr_graph_get_fds(_obj, fds.data(), fds.size());
+            return fds;
+        }
+
+        /*! Get the time until housekeeping is next due.
+         *  \return             The timeout in milliseconds. */
+        int poll_timeout() const
+            { return mpr_graph_get_poll_timeout(_obj); }
+
+        /*! Handle messages on ready sockets without blocking.
+         *  \param fds          The ready socket descriptors.
+         *  \return             The number of handled messages. */
+        int process_ready(const std::vector<int>& fds) const
+            { return mpr_graph_process_ready(_obj, fds.data(), fds.size()); }
+
         // subscriptions
         /*! Subscribe to information about a specific Device.
          *  \param dev      The Device of interest.
@@ -1355,6 +1416,59 @@ namespace mapper {
         List<Map> maps() const
             { return List<Map>(mpr_graph_get_objs(_obj, MPR_MAP)); }
 
+        /*! Get the counters of the memory pool backing the objects and queries of the graph.
+         *  \param in_use   Set to the number of pooled blocks currently allocated, or NULL.
+         *  \param reserved Set to the number of blocks reserved by the pool, or NULL.
+         *  \param misses   Set to the number of blocks too large for the pool, or NULL.
+         *  \return         The number of blocks allocated since the graph was created. */
+        int pool_stats(int *in_use = NULL, int *reserved = NULL, int *misses = NULL) const
+            { return mpr_graph_get_pool_stats(_obj, in_use, reserved, misses); }
+
+        /*! Index objects of the graph by a property so that List filters can use the index.
+         *  \param type     The type of objects to index.
+         *  \param prop     The Property to index.
+         *  \param ordered  True to also support range filters, false for equality only.
+         *  \return         Self. */
+        const Graph& add_index(Type type, Property prop, bool ordered = false) const
+        {
+            mpr_graph_add_index(_obj, static_cast<mpr_type>(type), static_cast<mpr_prop>(prop),
+                                NULL, ordered);
+            RETURN_SELF
+        }
+
+        /*! Index objects of the graph by a named property.
+         *  \param type     The type of objects to index.
+         *  \param key      Name of the Property to index.
+         *  \param ordered  True to also support range filters, false for equality only.
+         *  \return         Self. */
+        const Graph& add_index(Type type, const str_type &key, bool ordered = false) const
+        {
+            mpr_graph_add_index(_obj, static_cast<mpr_type>(type), MPR_PROP_UNKNOWN, key,
+                                ordered);
+            RETURN_SELF
+        }
+
+        /*! Remove a property index from the graph.
+         *  \param type     The type of indexed objects.
+         *  \param prop     The indexed Property.
+         *  \return         Self. */
+        const Graph& remove_index(Type type, Property prop) const
+        {
+            mpr_graph_remove_index(_obj, static_cast<mpr_type>(type),
+                                   static_cast<mpr_prop>(prop), NULL);
+            RETURN_SELF
+        }
+
+        /*! Remove a property index from the graph.
+         *  \param type     The type of indexed objects.
+         *  \param key      Name of the indexed Property.
+         *  \return         Self. */
+        const Graph& remove_index(Type type, const str_type &key) const
+        {
+            mpr_graph_remove_index(_obj, static_cast<mpr_type>(type), MPR_PROP_UNKNOWN, key);
+            RETURN_SELF
+        }
+
         OBJ_METHODS(Graph);
     };
 
@@ -13,6 +13,7 @@ public class List<T extends AbstractObject> implements Iterable<T> {
     private native long _next(long list);
     private native long _get(long list, int index);
     private native int _size(long list);
+    private native long _materialize(long list);
 
     private native long _diff(long lhs, long rhs);
     private native long _isect(long lhs, long rhs);
@@ -26,11 +27,14 @@ public class List<T extends AbstractObject> implements Iterable<T> {
         _list = listptr;
     }
 
+    /* snapshot the list so that repeated size and index lookups are cheap */
     public T get(int index) {
+        _list = _materialize(_list);
         return _newObject(_get(_list, index));
     }
 
     public int size() {
+        _list = _materialize(_list);
         return _size(_list);
     }
 
@@ -44,7 +44,10 @@ public enum Property
     UNIT                (0x2500),
     USE_INST            (0x2600),
     VERSION             (0x2700),
-    EXTRA               (0x2800);
+    EXTRA               (0x2800),
+    PACKED              (0x2900),
+    ALIAS               (0x2A00),
+    HOST_ID             (0x2B00);
 
     Property(int value) {
         this._value = value;
@@ -1506,6 +1506,20 @@ JNIEXPORT jint JNICALL Java_mapper_List__1size
     return objs ? mpr_list_get_size(objs) : 0;
 }
 
+JNIEXPORT jlong JNICALL Java_mapper_List__1get
+  (JNIEnv *env, jobject obj, jlong list, jint idx)
+{
+    mpr_obj *objs = (mpr_obj*) ptr_jlong(list);
+    return objs && idx >= 0 ? jlong_ptr(mpr_list_get_idx(objs, idx)) : 0;
+}
+
+JNIEXPORT jlong JNICALL Java_mapper_List__1materialize
+  (JNIEnv *env, jobject obj, jlong list)
+{
+    mpr_obj *objs = (mpr_obj*) ptr_jlong(list);
+    return objs ? jlong_ptr(mpr_list_materialize(objs)) : 0;
+}
+
 JNIEXPORT jlong JNICALL Java_mapper_List__1next
   (JNIEnv *env, jobject obj, jlong list)
 {
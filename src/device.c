@@ -7,6 +7,8 @@
 #include <assert.h>
 #include <sys/time.h>
 #include <stddef.h>
+#include <math.h>
+#include <zlib.h>
 
 #include "mapper_internal.h"
 #include "types_internal.h"
@@ -19,6 +21,35 @@
 
 extern const char* net_msg_strings[NUM_MSG_STRINGS];
 
+/* default limits for draining data messages at the end of each poll */
+#define DEFAULT_POLL_BUDGET_MSGS    256
+#define DEFAULT_POLL_BUDGET_USEC    1000
+
+#define UPDATE_QUEUE_LEN            1024
+
+/* initial number of buckets in the signal name index of a device */
+#define SIG_IDX_MIN_SIZE            8
+
+#ifdef HAVE_PTHREAD
+/*! State of the I/O thread started by mpr_dev_start_polling(). */
+typedef struct _mpr_dev_thread {
+    pthread_t tid;
+    mpr_local_dev dev;
+    int block_ms;
+    int running;
+    int detached;                       /*!< 1 if the thread unpublishes itself when it exits. */
+} mpr_dev_thread_t, *mpr_dev_thread;
+#endif
+
+/*! A signal update queued for the I/O thread or deferred by an interrupt. */
+typedef struct {
+    mpr_local_sig sig;
+    mpr_id id;
+    int len;                            /*!< Value length, or 0 to release the instance. */
+    double val[];                       /*!< Value, already coerced to the signal type. Declared
+                                         *   as double to keep it aligned for any type. */
+} mpr_queued_update_t, *mpr_queued_update;
+
 /* prototypes */
 void mpr_dev_start_servers(mpr_local_dev dev);
 static void mpr_dev_remove_idmap(mpr_local_dev dev, int group, mpr_id_map rem);
@@ -39,9 +70,14 @@ static int cmp_qry_linked(const void *ctx, mpr_dev dev)
 
 static int cmp_qry_dev_sigs(const void *context_data, mpr_sig sig)
 {
-    mpr_id dev_id = *(mpr_id*)context_data;
-    int dir = *(int*)((char*)context_data + sizeof(mpr_id));
-    return ((dir & sig->dir) && (dev_id == sig->dev->obj.id));
+    mpr_dev dev = *(mpr_dev*)context_data;
+    int dir = *(int*)((char*)context_data + sizeof(mpr_dev));
+    return ((dir & sig->dir) && (dev == sig->dev));
+}
+
+static mpr_sig next_dev_sig(const void *context_data, mpr_sig sig)
+{
+    return sig ? sig->dev_next : (*(mpr_dev*)context_data)->sigs;
 }
 
 void init_dev_prop_tbl(mpr_dev dev)
@@ -50,9 +86,9 @@ void init_dev_prop_tbl(mpr_dev dev)
     mpr_tbl tbl;
     mpr_list qry;
 
-    dev->obj.props.synced = mpr_tbl_new();
+    dev->obj.props.synced = mpr_tbl_new(dev->obj.graph->strings);
     if (!dev->is_local)
-        dev->obj.props.staged = mpr_tbl_new();
+        dev->obj.props.staged = mpr_tbl_new(dev->obj.graph->strings);
     tbl = dev->obj.props.synced;
 
     /* these properties need to be added in alphabetical order */
@@ -68,8 +104,8 @@ void init_dev_prop_tbl(mpr_dev dev)
     mpr_tbl_link(tbl, PROP(NUM_SIGS_OUT), 1, MPR_INT32, &dev->num_outputs, mod);
     mpr_tbl_link(tbl, PROP(ORDINAL), 1, MPR_INT32, &dev->ordinal, mod);
     if (!dev->is_local) {
-        qry = mpr_list_new_query((const void**)&dev->obj.graph->sigs, (void*)cmp_qry_dev_sigs,
-                                 "hi", dev->obj.id, MPR_DIR_ANY);
+        qry = mpr_list_new_chained_query((const void**)&dev->obj.graph->sigs, (void*)next_dev_sig,
+                                         (void*)cmp_qry_dev_sigs, "vi", &dev, MPR_DIR_ANY);
         mpr_tbl_link(tbl, PROP(SIG), 1, MPR_LIST, qry, NON_MODIFIABLE | PROP_OWNED);
     }
     mpr_tbl_link(tbl, PROP(STATUS), 1, MPR_INT32, &dev->status, mod | LOCAL_ACCESS_ONLY);
@@ -96,8 +132,17 @@ mpr_dev mpr_dev_new(const char *name_prefix, mpr_graph g)
         g = mpr_graph_new(0);
         g->own = 0;
     }
+    else {
+        /* the I/O thread of a device owns the admin sockets and router of its graph */
+        int i;
+        for (i = 0; i < g->net.num_devs; i++) {
+            TRACE_RETURN_UNLESS(!g->net.devs[i]->thread, NULL, "error: cannot share a graph "
+                                "with a device polled by an I/O thread.\n");
+        }
+    }
 
-    dev = (mpr_local_dev)mpr_list_add_item((void**)&g->devs, sizeof(mpr_local_dev_t));
+    dev = (mpr_local_dev)mpr_list_add_item((void**)&g->devs, sizeof(mpr_local_dev_t),
+                                           g->slab);
     dev->obj.type = MPR_DEV;
     dev->obj.graph = g;
     dev->is_local = 1;
@@ -107,13 +152,14 @@ mpr_dev mpr_dev_new(const char *name_prefix, mpr_graph g)
     dev->prefix = strdup(name_prefix);
     mpr_dev_start_servers(dev);
 
-    if (!g->net.servers[SERVER_UDP] || !g->net.servers[SERVER_TCP]) {
+    if (!dev->servers[SERVER_UDP] || !dev->servers[SERVER_TCP]) {
         mpr_dev_free((mpr_dev)dev);
         return NULL;
     }
 
-    g->net.rtr = (mpr_rtr)calloc(1, sizeof(mpr_rtr_t));
-    g->net.rtr->dev = dev;
+    /* the router is shared by all local devices of the graph */
+    if (!g->net.rtr)
+        g->net.rtr = (mpr_rtr)calloc(1, sizeof(mpr_rtr_t));
 
     dev->expr_stack = mpr_expr_stack_new();
 
@@ -121,6 +167,8 @@ mpr_dev mpr_dev_new(const char *name_prefix, mpr_graph g)
     dev->idmaps.active = (mpr_id_map*) malloc(sizeof(mpr_id_map));
     dev->idmaps.active[0] = 0;
     dev->num_sig_groups = 1;
+    dev->poll_budget.msgs = DEFAULT_POLL_BUDGET_MSGS;
+    dev->poll_budget.usec = DEFAULT_POLL_BUDGET_USEC;
 
     mpr_net_add_dev(&g->net, dev);
 
@@ -135,7 +183,7 @@ void mpr_dev_free(mpr_dev dev)
     mpr_net net;
     mpr_local_dev ldev;
     mpr_list list;
-    int i;
+    int i, num_devs;
     RETURN_UNLESS(dev && dev->is_local);
     if (!dev->obj.graph) {
         free(dev);
@@ -145,25 +193,32 @@ void mpr_dev_free(mpr_dev dev)
     gph = dev->obj.graph;
     net = &gph->net;
 
+    mpr_dev_stop_polling(dev);
+
     /* free any queued graph messages without sending */
     mpr_net_free_msgs(net);
 
     /* remove OSC handlers associated with this device */
     mpr_net_remove_dev_methods(net, ldev);
+    num_devs = mpr_net_remove_dev(net, ldev);
 
     /* also remove any graph handlers registered locally */
-    while (gph->callbacks) {
+    while (!num_devs && gph->callbacks) {
         fptr_list cb = gph->callbacks;
         gph->callbacks = gph->callbacks->next;
         free(cb);
     }
+    while (!num_devs && gph->batch_callbacks) {
+        fptr_list cb = gph->batch_callbacks;
+        gph->batch_callbacks = gph->batch_callbacks->next;
+        free(cb);
+    }
 
     /* remove subscribers */
     while (ldev->subscribers) {
         mpr_subscriber sub = ldev->subscribers;
-        FUNC_IF(lo_address_free, sub->addr);
         ldev->subscribers = sub->next;
-        free(sub);
+        mpr_net_free_subscriber(sub);
     }
 
     list = mpr_dev_get_sigs(dev, MPR_DIR_ANY);
@@ -191,6 +246,14 @@ void mpr_dev_free(mpr_dev dev)
         }
     }
 
+    /* remove tombstones, including those of the signals removed above */
+    while (ldev->tombstones.head) {
+        mpr_tombstone t = ldev->tombstones.head;
+        ldev->tombstones.head = t->next;
+        lo_message_free(t->msg);
+        free(t);
+    }
+
     /* Release links to other devices */
     list = mpr_dev_get_links(dev, MPR_DIR_ANY);
     while (list) {
@@ -216,23 +279,28 @@ void mpr_dev_free(mpr_dev dev)
         free(map);
     }
 
-    if (net->rtr) {
+    if (net->rtr && !num_devs) {
         while (net->rtr->sigs) {
             mpr_rtr_sig rs = net->rtr->sigs;
             net->rtr->sigs = net->rtr->sigs->next;
             free(rs);
         }
         free(net->rtr);
+        net->rtr = 0;
     }
 
-    FUNC_IF(lo_server_free, net->servers[SERVER_UDP]);
-    FUNC_IF(lo_server_free, net->servers[SERVER_TCP]);
+    FUNC_IF(lo_server_free, ldev->servers[SERVER_UDP]);
+    FUNC_IF(lo_server_free, ldev->servers[SERVER_TCP]);
     FUNC_IF(free, dev->prefix);
+    FUNC_IF(free, ldev->sig_aliases);
 
+    mpr_workers_free(ldev->workers);
     mpr_expr_stack_free(ldev->expr_stack);
+    FUNC_IF(mpr_ring_free, ldev->updates.queue);
+    FUNC_IF(free, ldev->thread_mem);
 
     mpr_graph_remove_dev(gph, dev, MPR_OBJ_REM, 1);
-    if (!gph->own)
+    if (!gph->own && !num_devs)
         mpr_graph_free(gph);
 }
 
@@ -251,9 +319,10 @@ void mpr_dev_on_registered(mpr_local_dev dev)
                 idmap->GID |= dev->obj.id;
         }
         sig->obj.id |= dev->obj.id;
+        mpr_graph_index_obj(dev->obj.graph, (mpr_obj)sig);
     }
-    qry = mpr_list_new_query((const void**)&dev->obj.graph->sigs, (void*)cmp_qry_dev_sigs,
-                             "hi", dev->obj.id, MPR_DIR_ANY);
+    qry = mpr_list_new_chained_query((const void**)&dev->obj.graph->sigs, (void*)next_dev_sig,
+                                     (void*)cmp_qry_dev_sigs, "vi", &dev, MPR_DIR_ANY);
     mpr_tbl_set(dev->obj.props.synced, PROP(SIG), NULL, 1, MPR_LIST, qry,
                 NON_MODIFIABLE | PROP_OWNED);
     dev->registered = 1;
@@ -274,6 +343,45 @@ MPR_INLINE static int check_types(const mpr_type *types, int len, mpr_type type,
     return vals;
 }
 
+/* Expand a packed vector update (see mpr_map_build_msg()) into the equivalent per-element
+ * arguments so that the remainder of the handler can treat both encodings identically. */
+static int unpack_vec(lo_arg **argv, const char *types, int val_len, mpr_type type, int len,
+                      char *data, mpr_type *vtypes, lo_arg **vargv)
+{
+    int i, size = mpr_type_get_size(type);
+    char *mask = 0, *src;
+    RETURN_ARG_UNLESS(val_len <= 2 && lo_blob_datasize((lo_blob)argv[0]) == len * size, -1);
+    if (2 == val_len) {
+        RETURN_ARG_UNLESS(LO_BLOB == types[1], -1);
+        RETURN_ARG_UNLESS(lo_blob_datasize((lo_blob)argv[1]) >= len / 8 + 1, -1);
+        mask = (char*)lo_blob_dataptr((lo_blob)argv[1]);
+    }
+    src = (char*)lo_blob_dataptr((lo_blob)argv[0]);
+    for (i = 0; i < len; i++) {
+        char *dst = data + i * size;
+        vargv[i] = (lo_arg*)dst;
+        if (mask && !get_bitflag(mask, i)) {
+            memset(dst, 0, size);
+            vtypes[i] = MPR_NULL;
+            continue;
+        }
+        vtypes[i] = type;
+        if (MPR_DBL == type) {
+            uint64_t u;
+            memcpy(&u, src + i * size, sizeof(uint64_t));
+            u = lo_otoh64(u);
+            memcpy(dst, &u, sizeof(uint64_t));
+        }
+        else {
+            uint32_t u;
+            memcpy(&u, src + i * size, sizeof(uint32_t));
+            u = lo_otoh32(u);
+            memcpy(dst, &u, sizeof(uint32_t));
+        }
+    }
+    return 0;
+}
+
 int mpr_dev_bundle_start(lo_timetag t, void *data)
 {
     mpr_time_set(&ts, t);
@@ -292,6 +400,11 @@ int mpr_dev_bundle_start(lo_timetag t, void *data)
  *   instance within the network of libmapper devices
  * - Updates to specific "slots" of a convergent (i.e. multi-source) mapping
  *   are indicated using the label "@slot" followed by a single integer slot #
+ * - Messages may be addressed to "/@<alias>" instead of the signal path if the
+ *   destination advertised an "@alias" property during map setup.
+ * - Maps with the "packed" property set send vectors as a single blob in
+ *   network byte order, optionally followed by a second blob containing a
+ *   bitmask of the elements that have values.
  * - Instance creation and release may also be triggered by expression
  *   evaluation. Refer to the document "Using Instanced Signals with Libmapper"
  *   for more information.
@@ -302,6 +415,7 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
     mpr_local_sig sig = (mpr_local_sig)data;
     mpr_local_dev dev;
     mpr_sig_inst si;
+    mpr_sig vsig;
     mpr_rtr rtr = sig->obj.graph->net.rtr;
     int i, val_len = 0, vals, size, all;
     int idmap_idx, inst_idx, slot_idx = -1, map_manages_inst = 0;
@@ -353,17 +467,31 @@ int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc
         TRACE_DEV_RETURN_UNLESS(map->status >= MPR_STATUS_READY, 0, "error in mpr_dev_handler: "
                                 "mapping not yet ready.\n");
         if (map->expr && !map->is_local_only) {
-            vals = check_types(types, val_len, slot->sig->type, slot->sig->len);
+            vsig = slot->sig;
             map_manages_inst = mpr_expr_get_manages_inst(map->expr);
         }
         else {
             /* value has already been processed at source device */
             map = 0;
-            vals = check_types(types, val_len, sig->type, sig->len);
+            vsig = (mpr_sig)sig;
         }
     }
     else
-        vals = check_types(types, val_len, sig->type, sig->len);
+        vsig = (mpr_sig)sig;
+
+    if (val_len && LO_BLOB == types[0]) {
+        /* packed vector update */
+        char *data = alloca(vsig->len * mpr_type_get_size(vsig->type));
+        mpr_type *vtypes = alloca(vsig->len * sizeof(mpr_type));
+        lo_arg **vargv = alloca(vsig->len * sizeof(lo_arg*));
+        TRACE_DEV_RETURN_UNLESS(!unpack_vec(argv, types, val_len, vsig->type, vsig->len,
+                                            data, vtypes, vargv), 0,
+                                "error in mpr_dev_handler: bad packed vector.\n");
+        types = vtypes;
+        argv = vargv;
+        val_len = vsig->len;
+    }
+    vals = check_types(types, val_len, vsig->type, vsig->len);
     RETURN_ARG_UNLESS(vals >= 0, 0);
 
     /* TODO: optionally discard out-of-order messages
@@ -548,83 +676,232 @@ mpr_id mpr_dev_get_unused_sig_id(mpr_local_dev dev)
     return id;
 }
 
+/* Assign a new integer alias to a local signal. Aliases are advertised to peers during map setup
+ * and let data messages be addressed using a short path "/@<alias>". They are never reused during
+ * the lifetime of the device, since peers may still send messages to the alias of a removed
+ * signal. */
+void mpr_dev_add_sig_alias(mpr_local_dev dev, mpr_local_sig sig)
+{
+    int i = dev->num_sig_aliases;
+    RETURN_UNLESS(sig && sig->is_local && !sig->alias);
+    if (!(i & (i - 1))) {
+        /* grow the table whenever its size reaches a power of two */
+        mpr_local_sig *aliases = realloc(dev->sig_aliases, (i ? i * 2 : 1) * sizeof(mpr_local_sig));
+        RETURN_UNLESS(aliases);
+        dev->sig_aliases = aliases;
+    }
+    dev->sig_aliases[i] = sig;
+    ++dev->num_sig_aliases;
+    sig->alias = i + 1;
+}
+
+void mpr_dev_remove_sig_alias(mpr_local_dev dev, mpr_local_sig sig)
+{
+    RETURN_UNLESS(sig && sig->alias > 0 && sig->alias <= dev->num_sig_aliases);
+    if (dev->sig_aliases[sig->alias - 1] == sig)
+        dev->sig_aliases[sig->alias - 1] = 0;
+    sig->alias = 0;
+}
+
+/* Look up a local signal from an aliased path of the form "/@<alias>". Returns zero if the alias
+ * is out of range or belonged to a signal that has been removed. */
+mpr_local_sig mpr_dev_get_sig_by_alias(mpr_local_dev dev, const char *path)
+{
+    int alias = 0;
+    RETURN_ARG_UNLESS(path && '/' == path[0] && '@' == path[1] && path[2], 0);
+    for (path += 2; *path >= '0' && *path <= '9'; path++) {
+        alias = alias * 10 + (*path - '0');
+        /* stop before the value can overflow */
+        RETURN_ARG_UNLESS(alias <= dev->num_sig_aliases, 0);
+    }
+    RETURN_ARG_UNLESS(!*path && alias > 0 && alias <= dev->num_sig_aliases, 0);
+    return dev->sig_aliases[alias - 1];
+}
+
+/* Generic liblo method for aliased data messages. Returns non-zero for other paths so that
+ * liblo continues matching against the full signal paths. */
+static int handler_alias(const char *path, const char *types, lo_arg **argv, int argc,
+                         lo_message msg, void *data)
+{
+    mpr_local_sig sig = mpr_dev_get_sig_by_alias((mpr_local_dev)data, path);
+    RETURN_ARG_UNLESS(sig, 1);
+    mpr_dev_handler(sig->path, types, argv, argc, msg, (void*)sig);
+    return 0;
+}
+
 void mpr_dev_add_sig_methods(mpr_local_dev dev, mpr_local_sig sig)
 {
-    mpr_net net;
     RETURN_UNLESS(sig && sig->is_local);
-    net = &dev->obj.graph->net;
-    lo_server_add_method(net->servers[SERVER_UDP], sig->path, NULL, mpr_dev_handler, (void*)sig);
-    lo_server_add_method(net->servers[SERVER_TCP], sig->path, NULL, mpr_dev_handler, (void*)sig);
+    lo_server_add_method(dev->servers[SERVER_UDP], sig->path, NULL, mpr_dev_handler, (void*)sig);
+    lo_server_add_method(dev->servers[SERVER_TCP], sig->path, NULL, mpr_dev_handler, (void*)sig);
     ++dev->n_output_callbacks;
 }
 
 void mpr_dev_remove_sig_methods(mpr_local_dev dev, mpr_local_sig sig)
 {
-    mpr_net net;
     char *path = 0;
     int len;
     RETURN_UNLESS(sig && sig->is_local);
-    net = &dev->obj.graph->net;
     len = (int)strlen(sig->path) + 5;
     path = (char*)realloc(path, len);
     snprintf(path, len, "%s%s", sig->path, "/get");
-    lo_server_del_method(net->servers[SERVER_UDP], path, NULL);
-    lo_server_del_method(net->servers[SERVER_TCP], path, NULL);
+    lo_server_del_method(dev->servers[SERVER_UDP], path, NULL);
+    lo_server_del_method(dev->servers[SERVER_TCP], path, NULL);
     free(path);
-    lo_server_del_method(net->servers[SERVER_UDP], sig->path, NULL);
-    lo_server_del_method(net->servers[SERVER_TCP], sig->path, NULL);
+    lo_server_del_method(dev->servers[SERVER_UDP], sig->path, NULL);
+    lo_server_del_method(dev->servers[SERVER_TCP], sig->path, NULL);
     --dev->n_output_callbacks;
 }
 
 mpr_list mpr_dev_get_sigs(mpr_dev dev, mpr_dir dir)
 {
     mpr_list qry;
-    RETURN_ARG_UNLESS(dev && dev->obj.graph->sigs, 0);
-    qry = mpr_list_new_query((const void**)&dev->obj.graph->sigs,
-                             (void*)cmp_qry_dev_sigs, "hi", dev->obj.id, dir);
+    RETURN_ARG_UNLESS(dev && dev->sigs, 0);
+    qry = mpr_list_new_chained_query((const void**)&dev->obj.graph->sigs, (void*)next_dev_sig,
+                                     (void*)cmp_qry_dev_sigs, "vi", &dev, dir);
     return mpr_list_start(qry);
 }
 
+static uint32_t _hash_sig_name(const char *name)
+{
+    return crc32(0L, (const Bytef *)name, strlen(name));
+}
+
+static int _sig_idx_resize(mpr_obj_idx idx, int size)
+{
+    int i;
+    mpr_obj *buckets = (mpr_obj*)calloc(size, sizeof(mpr_obj));
+    RETURN_ARG_UNLESS(buckets, 1);
+    for (i = 0; i < idx->size; i++) {
+        mpr_sig sig = (mpr_sig)idx->buckets[i];
+        while (sig) {
+            mpr_sig next = sig->name_next;
+            mpr_sig *b = (mpr_sig*)&buckets[sig->name_hash & (size - 1)];
+            sig->name_next = *b;
+            *b = sig;
+            sig = next;
+        }
+    }
+    FUNC_IF(free, idx->buckets);
+    idx->buckets = buckets;
+    idx->size = size;
+    return 0;
+}
+
+void mpr_dev_add_sig(mpr_dev dev, mpr_sig sig)
+{
+    mpr_sig *b;
+    mpr_obj_idx idx = &dev->sig_names;
+    sig->dev_next = dev->sigs;
+    dev->sigs = sig;
+
+    /* keep at most one signal per bucket on average */
+    if (idx->count >= idx->size
+        && _sig_idx_resize(idx, idx->size ? idx->size * 2 : SIG_IDX_MIN_SIZE))
+        return;
+    sig->name_hash = _hash_sig_name(sig->name);
+    b = (mpr_sig*)&idx->buckets[sig->name_hash & (idx->size - 1)];
+    sig->name_next = *b;
+    *b = sig;
+    ++idx->count;
+}
+
+void mpr_dev_remove_sig(mpr_dev dev, mpr_sig sig)
+{
+    mpr_obj_idx idx = &dev->sig_names;
+    mpr_sig *p = &dev->sigs;
+    while (*p && *p != sig)
+        p = &(*p)->dev_next;
+    if (*p)
+        *p = sig->dev_next;
+    sig->dev_next = 0;
+
+    RETURN_UNLESS(idx->size);
+    p = (mpr_sig*)&idx->buckets[sig->name_hash & (idx->size - 1)];
+    while (*p && *p != sig)
+        p = &(*p)->name_next;
+    if (*p) {
+        *p = sig->name_next;
+        --idx->count;
+    }
+    sig->name_next = 0;
+}
+
 mpr_sig mpr_dev_get_sig_by_name(mpr_dev dev, const char *sig_name)
 {
-    mpr_list sigs;
-    RETURN_ARG_UNLESS(dev && sig_name, 0);
-    sigs = mpr_list_from_data(dev->obj.graph->sigs);
-    while (sigs) {
-        mpr_sig sig = (mpr_sig)*sigs;
-        if ((sig->dev == dev) && strcmp(sig->name, skip_slash(sig_name))==0)
+    mpr_sig sig;
+    RETURN_ARG_UNLESS(dev && sig_name && dev->sig_names.size, 0);
+    sig_name = skip_slash(sig_name);
+    sig = (mpr_sig)dev->sig_names.buckets[_hash_sig_name(sig_name) & (dev->sig_names.size - 1)];
+    for (; sig; sig = sig->name_next) {
+        if (0 == strcmp(sig->name, sig_name))
             return sig;
-        sigs = mpr_list_get_next(sigs);
     }
     return 0;
 }
 
 static int cmp_qry_dev_maps(const void *context_data, mpr_map map)
 {
-    mpr_id dev_id = *(mpr_id*)context_data;
-    mpr_dir dir = *(int*)((char*)context_data + sizeof(mpr_id));
+    mpr_dev dev = *(mpr_dev*)context_data;
+    mpr_dir dir = *(int*)((char*)context_data + sizeof(mpr_dev));
     int i;
     if (dir == MPR_DIR_BOTH) {
-        RETURN_ARG_UNLESS(map->dst->sig->dev->obj.id == dev_id, 0);
+        RETURN_ARG_UNLESS(map->dst->sig->dev == dev, 0);
         for (i = 0; i < map->num_src; i++)
-            RETURN_ARG_UNLESS(map->src[i]->sig->dev->obj.id == dev_id, 0);
+            RETURN_ARG_UNLESS(map->src[i]->sig->dev == dev, 0);
         return 1;
     }
     if (dir & MPR_DIR_OUT) {
         for (i = 0; i < map->num_src; i++)
-            RETURN_ARG_UNLESS(map->src[i]->sig->dev->obj.id != dev_id, 1);
+            RETURN_ARG_UNLESS(map->src[i]->sig->dev != dev, 1);
     }
     if (dir & MPR_DIR_IN)
-        RETURN_ARG_UNLESS(map->dst->sig->dev->obj.id != dev_id, 1);
+        RETURN_ARG_UNLESS(map->dst->sig->dev != dev, 1);
     return 0;
 }
 
+/* Maps may refer to several signals of a device, so they are only returned at the first of their
+ * slots that does. */
+static mpr_slot _get_dev_slot(mpr_map map, mpr_dev dev)
+{
+    int i;
+    for (i = 0; i < map->num_src; i++) {
+        if (map->src[i] && map->src[i]->sig->dev == dev)
+            return map->src[i];
+    }
+    return map->dst;
+}
+
+static mpr_map next_dev_map(const void *context_data, mpr_map map)
+{
+    mpr_dev dev = *(mpr_dev*)context_data;
+    mpr_sig sig;
+    mpr_slot slot;
+    if (map) {
+        slot = _get_dev_slot(map, dev);
+        sig = slot->sig;
+        slot = slot->sig_next;
+    }
+    else {
+        RETURN_ARG_UNLESS(sig = dev->sigs, 0);
+        slot = sig->slots;
+    }
+    while (1) {
+        for (; slot; slot = slot->sig_next) {
+            if (slot == _get_dev_slot(slot->map, dev))
+                return slot->map;
+        }
+        RETURN_ARG_UNLESS(sig = sig->dev_next, 0);
+        slot = sig->slots;
+    }
+}
+
 mpr_list mpr_dev_get_maps(mpr_dev dev, mpr_dir dir)
 {
     mpr_list qry;
     RETURN_ARG_UNLESS(dev && dev->obj.graph->maps, 0);
-    qry = mpr_list_new_query((const void**)&dev->obj.graph->maps,
-                             (void*)cmp_qry_dev_maps, "hi", dev->obj.id, dir);
+    qry = mpr_list_new_chained_query((const void**)&dev->obj.graph->maps, (void*)next_dev_map,
+                                     (void*)cmp_qry_dev_maps, "vi", &dev, dir);
     return mpr_list_start(qry);
 }
 
@@ -690,7 +967,7 @@ MPR_INLINE static void _process_incoming_maps(mpr_local_dev dev)
     while (maps) {
         mpr_local_map map = *(mpr_local_map*)maps;
         maps = mpr_list_get_next(maps);
-        if (map->is_local && map->updated && map->expr && !map->muted)
+        if (map->is_local && map->dev == dev && map->updated && map->expr && !map->muted)
             mpr_map_receive(map, dev->time);
     }
 }
@@ -698,47 +975,399 @@ MPR_INLINE static void _process_incoming_maps(mpr_local_dev dev)
 /* TODO: handle interrupt-driven updates that omit call to this function */
 MPR_INLINE static int _process_outgoing_maps(mpr_local_dev dev)
 {
-    int msgs = 0;
+    int i, idx, msgs = 0;
     mpr_list list;
     mpr_graph graph;
     RETURN_ARG_UNLESS(dev->sending, 0);
 
     graph = dev->obj.graph;
-    /* process and send updated maps */
-    /* TODO: speed this up! */
-    list = mpr_list_from_data(graph->maps);
+    /* Updates made while the bundles are being sent, e.g. by handlers of local maps, are added to
+     * the next bundle, which is sent before returning. */
+    for (i = 0; i < NUM_BUNDLES && dev->sending; i++) {
+        /* process and send updated maps */
+        /* TODO: speed this up! */
+        if (dev->workers) {
+            /* evaluate maps concurrently first, then send them in order below */
+            list = mpr_list_from_data(graph->maps);
+            while (list) {
+                mpr_local_map map = *(mpr_local_map*)list;
+                list = mpr_list_get_next(list);
+                if (   map->is_local && map->dev == dev && map->updated && map->expr
+                    && !map->muted && MPR_DIR_OUT == map->src[0]->dir
+                    && mpr_workers_add_map(dev->workers, map) > 0)
+                    mpr_dev_rt_miss(dev);
+            }
+            mpr_workers_eval(dev->workers, dev->expr_stack, dev->time);
+        }
+        list = mpr_list_from_data(graph->maps);
+        while (list) {
+            mpr_local_map map = *(mpr_local_map*)list;
+            list = mpr_list_get_next(list);
+            if (   map->is_local && map->dev == dev && (map->updated || map->eval.done)
+                && map->expr && !map->muted)
+                mpr_map_send(map, dev->time);
+        }
+        dev->sending = 0;
+        idx = dev->bundle_idx++ % NUM_BUNDLES;
+        list = mpr_list_from_data(graph->links);
+        while (list) {
+            mpr_link link = (mpr_link)*list;
+            list = mpr_list_get_next(list);
+            /* other local devices send their own bundles */
+            if (link->devs[LOCAL_DEV] == (mpr_dev)dev || link->devs[REMOTE_DEV] == (mpr_dev)dev)
+                msgs += mpr_link_process_bundles(link, dev->time, idx);
+        }
+        /* send serialized bundles for all links together */
+        mpr_link_send_dgrams(&graph->net, dev);
+    }
+    return msgs ? 1 : 0;
+}
+
+/* Returns non-zero if the device has an I/O thread and the caller is a different thread. */
+static int _is_other_thread(mpr_local_dev dev)
+{
+#ifdef HAVE_PTHREAD
+    mpr_dev_thread th = __atomic_load_n(&dev->thread, __ATOMIC_ACQUIRE);
+    return th && !pthread_equal(pthread_self(), th->tid);
+#else
+    return 0;
+#endif
+}
+
+/* Allocate the queue of deferred updates, moving any updates from the previous queue. Only called
+ * while no other thread can be using the queue. */
+static int _alloc_update_queue(mpr_local_dev dev, size_t val_size)
+{
+    mpr_ring queue;
+    mpr_queued_update u, cpy;
+    if (val_size < sizeof(double))
+        val_size = sizeof(double);
+    queue = mpr_ring_new(UPDATE_QUEUE_LEN, sizeof(mpr_queued_update_t) + val_size);
+    RETURN_ARG_UNLESS(queue, 1);
+    if (dev->updates.queue) {
+        while ((u = (mpr_queued_update)mpr_ring_peek(dev->updates.queue))) {
+            if ((cpy = (mpr_queued_update)mpr_ring_reserve(queue))) {
+                memcpy(cpy, u, sizeof(mpr_queued_update_t) + dev->updates.val_size);
+                mpr_ring_commit(queue, cpy);
+            }
+            mpr_ring_release(dev->updates.queue);
+        }
+        mpr_ring_free(dev->updates.queue);
+    }
+    dev->updates.queue = queue;
+    dev->updates.val_size = val_size;
+    return 0;
+}
+
+/* Allocate the queue of deferred updates, or grow it for signals added since. Producers only use
+ * the queue while the device is busy or, once the I/O thread runs, from other threads, so it is
+ * safe to replace on the thread owning the device while it is idle. This allocates memory, so it
+ * must never be called from mpr_dev_queue_update(), which may run in an interrupt. */
+static void _prepare_update_queue(mpr_local_dev dev)
+{
+    RETURN_UNLESS(!dev->busy && !dev->thread);
+    if (!dev->updates.queue || dev->updates.max_val_size > dev->updates.val_size)
+        _alloc_update_queue(dev, dev->updates.max_val_size);
+}
+
+int mpr_dev_queue_update(mpr_local_sig sig, mpr_id id, int len, mpr_type type, const void *val)
+{
+    mpr_local_dev dev = sig->dev;
+    mpr_queued_update u;
+    size_t size;
+    RETURN_ARG_UNLESS(dev->busy || _is_other_thread(dev), 0);
+    size = len ? mpr_sig_get_vector_bytes((mpr_sig)sig) : 0;
+    if (!dev->updates.queue || size > dev->updates.val_size) {
+        /* the queue is allocated or grown by the next poll, never here */
+        __atomic_add_fetch(&dev->updates.num_dropped, 1, __ATOMIC_RELAXED);
+        trace_dev(dev, "error: no queue for updates of signal '%s', dropping update.\n",
+                  sig->name);
+        return 1;
+    }
+    /* drop the update if the queue is full */
+    RETURN_ARG_UNLESS(u = (mpr_queued_update)mpr_ring_reserve(dev->updates.queue), 1);
+    u->sig = sig;
+    u->id = id;
+    u->len = len;
+    if (len && type == sig->type)
+        memcpy(u->val, val, size);
+    else if (len)
+        set_coerced_val(len, type, val, sig->len, sig->type, u->val);
+    mpr_ring_commit(dev->updates.queue, u);
+    return 1;
+}
+
+/* Apply queued signal updates. Called at safe points on the thread polling the device. */
+static int _apply_queued_updates(mpr_local_dev dev)
+{
+    int count = 0;
+    mpr_queued_update u;
+    RETURN_ARG_UNLESS(dev->updates.queue && !dev->busy, 0);
+    while ((u = (mpr_queued_update)mpr_ring_peek(dev->updates.queue))) {
+        if (u->len)
+            mpr_sig_set_value((mpr_sig)u->sig, u->id, u->len, u->sig->type, u->val);
+        else
+            mpr_sig_release_inst((mpr_sig)u->sig, u->id);
+        mpr_ring_release(dev->updates.queue);
+        ++count;
+    }
+    return count;
+}
+
+void mpr_dev_reserve_update_queue(mpr_local_dev dev, size_t val_size)
+{
+    /* keep the size a multiple of the value alignment */
+    val_size = (val_size + sizeof(double) - 1) & ~(sizeof(double) - 1);
+    RETURN_UNLESS(val_size > dev->updates.max_val_size);
+    dev->updates.max_val_size = val_size;
+    /* an existing queue cannot grow while the I/O thread runs or interrupts may be pushing */
+    if (dev->updates.queue)
+        _prepare_update_queue(dev);
+}
+
+#ifdef HAVE_PTHREAD
+static void *_poll_thread(void *data)
+{
+    mpr_dev_thread th = (mpr_dev_thread)data;
+    mpr_local_dev dev = th->dev;
+    while (__atomic_load_n(&th->running, __ATOMIC_ACQUIRE))
+        mpr_dev_poll((mpr_dev)dev, th->block_ms);
+    /* send any remaining updates */
+    mpr_dev_poll((mpr_dev)dev, 0);
+    /* other threads may use the device directly from now on */
+    if (__atomic_load_n(&th->detached, __ATOMIC_ACQUIRE))
+        __atomic_store_n(&dev->thread, 0, __ATOMIC_RELEASE);
+    return 0;
+}
+#endif
+
+int mpr_dev_start_polling(mpr_dev dev, int block_ms)
+{
+#ifdef HAVE_PTHREAD
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    mpr_dev_thread th;
+    RETURN_ARG_UNLESS(dev && dev->is_local && block_ms >= 0, 1);
+    RETURN_ARG_UNLESS(!ldev->thread, 0);
+    /* Other local devices would poll the same admin sockets and change the same graph and router
+     * from another thread, and in-process maps call their handlers on the sending thread. */
+    TRACE_DEV_RETURN_UNLESS(1 == dev->obj.graph->net.num_devs, 1, "error: cannot start I/O "
+                            "thread for a device sharing its graph with other local devices.\n");
+    _prepare_update_queue(ldev);
+
+    if (!ldev->thread_mem)
+        ldev->thread_mem = (mpr_dev_thread)calloc(1, sizeof(mpr_dev_thread_t));
+    RETURN_ARG_UNLESS(th = ldev->thread_mem, 1);
+    th->dev = ldev;
+    th->block_ms = block_ms;
+    th->running = 1;
+    th->detached = 0;
+    if (!ldev->updates.queue || pthread_create(&th->tid, 0, _poll_thread, th)) {
+        trace_dev(ldev, "error: could not start I/O thread.\n");
+        return 1;
+    }
+    /* publish the thread once its id is set for _is_other_thread() */
+    __atomic_store_n(&ldev->thread, th, __ATOMIC_RELEASE);
+    return 0;
+#else
+    trace("error: threads are not supported on this platform.\n");
+    return 1;
+#endif
+}
+
+int mpr_dev_stop_polling(mpr_dev dev)
+{
+#ifdef HAVE_PTHREAD
+    mpr_dev_thread th;
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    RETURN_ARG_UNLESS(dev && dev->is_local, 1);
+    RETURN_ARG_UNLESS(th = __atomic_load_n(&ldev->thread, __ATOMIC_ACQUIRE), 0);
+    /* The thread stays published until it has exited, so that other threads keep queueing their
+     * updates instead of using the router concurrently with its last polls. */
+    __atomic_store_n(&th->running, 0, __ATOMIC_RELEASE);
+    if (pthread_equal(pthread_self(), th->tid)) {
+        /* called from a handler on the I/O thread, which cannot join itself: it will exit and
+         * unpublish itself once the current poll returns */
+        if (!__atomic_load_n(&th->detached, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&th->detached, 1, __ATOMIC_RELEASE);
+            pthread_detach(th->tid);
+        }
+        return 0;
+    }
+    if (__atomic_load_n(&th->detached, __ATOMIC_ACQUIRE)) {
+        /* already stopping itself, so it cannot be joined */
+        while (__atomic_load_n(&ldev->thread, __ATOMIC_ACQUIRE))
+            usleep(1000);
+        return 0;
+    }
+    pthread_join(th->tid, 0);
+    __atomic_store_n(&ldev->thread, 0, __ATOMIC_RELEASE);
+    trace_dev(dev, "stopped I/O thread, %d queued updates dropped.\n",
+              mpr_ring_get_num_dropped(((mpr_local_dev)dev)->updates.queue)
+              + ((mpr_local_dev)dev)->updates.num_dropped);
+#endif
+    return 0;
+}
+
+int mpr_dev_set_num_workers(mpr_dev dev, int num_workers)
+{
+    mpr_local_dev ldev = (mpr_local_dev)dev;
+    mpr_workers workers = 0;
+    RETURN_ARG_UNLESS(dev && dev->is_local && num_workers >= 0, 1);
+#ifndef HAVE_PTHREAD
+    TRACE_RETURN_UNLESS(!num_workers, 1, "error: threads are not supported on this platform.\n");
+#endif
+    if (num_workers && !(workers = mpr_workers_new(num_workers))) {
+        trace_dev(ldev, "error: could not start map evaluation threads.\n");
+        return 1;
+    }
+    mpr_workers_free(ldev->workers);
+    ldev->workers = workers;
+    return 0;
+}
+
+void mpr_dev_set_poll_budget(mpr_dev dev, int max_msgs, int max_usec)
+{
+    RETURN_UNLESS(dev && dev->is_local && max_msgs >= 0 && max_usec >= 0);
+    ((mpr_local_dev)dev)->poll_budget.msgs = max_msgs;
+    ((mpr_local_dev)dev)->poll_budget.usec = max_usec;
+}
+
+void mpr_dev_set_realtime(mpr_dev dev, int enable)
+{
+    RETURN_UNLESS(dev && dev->is_local);
+    ((mpr_local_dev)dev)->rt.enabled = enable != 0;
+    mpr_dev_rt_prealloc((mpr_local_dev)dev);
+}
+
+int mpr_dev_get_num_pool_misses(mpr_dev dev)
+{
+    RETURN_ARG_UNLESS(dev && dev->is_local, 0);
+    return ((mpr_local_dev)dev)->rt.num_misses;
+}
+
+void mpr_dev_rt_miss(mpr_local_dev dev)
+{
+    if (dev->rt.enabled)
+        ++dev->rt.num_misses;
+}
+
+void mpr_dev_rt_prealloc(mpr_local_dev dev)
+{
+    int i, n, num_idmaps = 0, num_dgrams = 0;
+    mpr_list list;
+    mpr_rtr_sig rs, sigs;
+    RETURN_UNLESS(dev->rt.enabled && dev->obj.graph->net.rtr);
+    sigs = dev->obj.graph->net.rtr->sigs;
+
+    /* updates deferred by interrupts */
+    _prepare_update_queue(dev);
+
+    /* id maps for every signal instance and for instances managed by maps */
+    list = mpr_dev_get_sigs((mpr_dev)dev, MPR_DIR_ANY);
     while (list) {
-        mpr_local_map map = *(mpr_local_map*)list;
+        mpr_local_sig sig = (mpr_local_sig)*list;
         list = mpr_list_get_next(list);
-        if (map->is_local && map->updated && map->expr && !map->muted)
-            mpr_map_send(map, dev->time);
+        mpr_sig_reserve_idmaps(sig);
+        num_idmaps += sig->num_inst;
+    }
+    for (rs = sigs; rs; rs = rs->next) {
+        if (rs->sig->dev != dev)
+            continue;
+        for (i = 0; i < rs->num_slots; i++) {
+            if (!rs->slots[i])
+                continue;
+            mpr_map_build_tmpls(rs->slots[i]->map);
+            ++num_idmaps;
+        }
     }
-    dev->sending = 0;
-    list = mpr_list_from_data(graph->links);
+    while (dev->idmaps.num < num_idmaps)
+        mpr_dev_reserve_idmap(dev);
+
+    /* bundle buffers with room for an update and a release of every mapped instance */
+    list = mpr_list_from_data(dev->obj.graph->links);
     while (list) {
-        msgs += mpr_link_process_bundles((mpr_link)*list, dev->time, 0);
+        mpr_link link = (mpr_link)*list;
+        size_t size = 0;
+        int num_msgs = 0;
         list = mpr_list_get_next(list);
+        if (link->devs[LOCAL_DEV] != (mpr_dev)dev)
+            continue;
+        for (rs = sigs; rs; rs = rs->next) {
+            if (rs->sig->dev != dev)
+                continue;
+            for (i = 0; i < rs->num_slots; i++) {
+                mpr_local_slot slot = rs->slots[i];
+                mpr_local_map map;
+                if (!slot || (slot->link != link && slot->map->dst->link != link))
+                    continue;
+                map = slot->map;
+                n = map->num_inst > rs->sig->num_inst ? map->num_inst : rs->sig->num_inst;
+                n = n > 0 ? n * 2 : 2;
+                size += n * mpr_map_get_max_msg_len(map);
+                num_msgs += n;
+            }
+        }
+        if (num_msgs)
+            mpr_link_reserve_bufs(link, size, num_msgs);
+        num_dgrams += num_msgs + 1;
     }
-    return msgs ? 1 : 0;
+    mpr_link_reserve_dgrams(&dev->obj.graph->net, num_dgrams);
 }
 
 void mpr_dev_update_maps(mpr_dev dev) {
+    int busy;
     RETURN_UNLESS(dev && dev->is_local);
+    /* the I/O thread sends queued updates each time it polls */
+    RETURN_UNLESS(!_is_other_thread((mpr_local_dev)dev));
     ((mpr_local_dev)dev)->time_is_stale = 1;
+    /* if this call interrupted the device, the queued updates are sent when it is done */
+    RETURN_UNLESS(!((mpr_local_dev)dev)->busy);
+    _apply_queued_updates((mpr_local_dev)dev);
+    busy = mpr_dev_set_busy((mpr_local_dev)dev, 1);
     if (!((mpr_local_dev)dev)->polling)
         _process_outgoing_maps((mpr_local_dev)dev);
+    mpr_dev_set_busy((mpr_local_dev)dev, busy);
 }
 
-int mpr_dev_poll(mpr_dev dev, int block_ms)
+/* Process incoming maps and inform subscribers of changes after receiving messages. */
+static int _finish_poll(mpr_local_dev dev, int admin_count, int device_count)
 {
-    int admin_count = 0, device_count = 0, status[4];
-    mpr_net net;
-    RETURN_ARG_UNLESS(dev && dev->is_local, 0);
-    net = &dev->obj.graph->net;
+    mpr_net net = &dev->obj.graph->net;
+
+    /* process incoming maps */
+    dev->polling = 1;
+    _process_incoming_maps(dev);
+    dev->polling = 0;
+
+    if (dev->obj.props.synced->dirty && mpr_dev_get_is_ready((mpr_dev)dev) && dev->subscribers) {
+        /* inform device subscribers of changed properties */
+        mpr_net_use_subscribers(net, dev, MPR_DEV);
+        mpr_dev_send_state((mpr_dev)dev, MSG_DEV);
+    }
+
+    net->msgs_recvd |= admin_count;
+    return admin_count + device_count;
+}
+
+/* Apply and send signal updates that were queued while the device was busy. */
+static void _flush_queued_updates(mpr_local_dev dev)
+{
+    int busy;
+    RETURN_UNLESS(_apply_queued_updates(dev));
+    busy = mpr_dev_set_busy(dev, 1);
+    _process_outgoing_maps(dev);
+    mpr_dev_set_busy(dev, busy);
+}
+
+static int _poll(mpr_dev dev, int block_ms)
+{
+    int admin_count = 0, device_count = 0, status[4], data_ready;
+    mpr_net net = &dev->obj.graph->net;
+    lo_server *servers = ((mpr_local_dev)dev)->servers;
     mpr_net_poll(net);
 
     if (!((mpr_local_dev)dev)->registered) {
-        if (lo_servers_recv_noblock(&net->servers[SERVER_ADMIN], status, 2, block_ms)) {
+        if (lo_servers_recv_noblock(&servers[SERVER_ADMIN], status, 2, block_ms)) {
             admin_count = (status[0] > 0) + (status[1] > 0);
             net->msgs_recvd |= admin_count;
         }
@@ -753,60 +1382,129 @@ int mpr_dev_poll(mpr_dev dev, int block_ms)
     ((mpr_local_dev)dev)->polling = 0;
 
     if (!block_ms) {
-        if (lo_servers_recv_noblock(net->servers, status, 4, 0)) {
+        if (lo_servers_recv_noblock(servers, status, 4, 0)) {
             admin_count = (status[0] > 0) + (status[1] > 0);
             device_count = (status[2] > 0) + (status[3] > 0);
             net->msgs_recvd |= admin_count;
         }
     }
     else {
-        double then = mpr_get_current_time();
-        int left_ms = block_ms, elapsed, checked_admin = 0;
-        while (left_ms > 0) {
-            /* set timeout to a maximum of 100ms */
-            if (left_ms > 100)
-                left_ms = 100;
+        /* Block until a message arrives, housekeeping is due or block_ms has elapsed. */
+        double now = mpr_get_current_time(), end = now + block_ms * 0.001;
+        double timer = now + mpr_net_get_next_timer(net);
+        int wait_ms, admin;
+        while (1) {
+            wait_ms = (int)ceil(((timer < end ? timer : end) - now) * 1000);
             ((mpr_local_dev)dev)->polling = 1;
-            if (lo_servers_recv_noblock(net->servers, status, 4, left_ms)) {
-                admin_count += (status[0] > 0) + (status[1] > 0);
+            /* don't block if datagrams are waiting in shared memory */
+            data_ready = mpr_net_set_shm_waiting(net, (mpr_local_dev)dev, 1);
+            admin = 0;
+            if (lo_servers_recv_noblock(servers, status, 4,
+                                        data_ready || wait_ms < 0 ? 0 : wait_ms)) {
+                admin = (status[0] > 0) + (status[1] > 0);
                 device_count += (status[2] > 0) + (status[3] > 0);
+                data_ready |= status[2] > 0 || status[3] > 0;
             }
+            mpr_net_set_shm_waiting(net, (mpr_local_dev)dev, 0);
+            /* drain any burst of data messages before processing maps */
+            if (data_ready)
+                device_count += mpr_net_recv_data(net, (mpr_local_dev)dev,
+                                                  ((mpr_local_dev)dev)->poll_budget.msgs,
+                                                  ((mpr_local_dev)dev)->poll_budget.usec);
             /* check if any signal update bundles need to be sent */
             _process_incoming_maps((mpr_local_dev)dev);
             _process_outgoing_maps((mpr_local_dev)dev);
             ((mpr_local_dev)dev)->polling = 0;
 
-            elapsed = (mpr_get_current_time() - then) * 1000;
-            if ((elapsed - checked_admin) > 100) {
+            now = mpr_get_current_time();
+            /* admin messages may have queued replies or moved the allocation deadlines */
+            if (admin || now >= timer || mpr_net_has_queued_msgs(net)) {
                 mpr_net_poll(net);
-                checked_admin = elapsed;
+                timer = now + mpr_net_get_next_timer(net);
             }
-            left_ms = block_ms - elapsed;
+            admin_count += admin;
+            if (now >= end)
+                break;
         }
     }
 
-    /* When done, or if non-blocking, check for remaining messages up to a
-     * proportion of the number of input signals. Arbitrarily choosing 1 for
-     * now, but perhaps could be a heuristic based on a recent number of
-     * messages per channel per poll. */
-    while (device_count < (dev->num_inputs + ((mpr_local_dev)dev)->n_output_callbacks)*1
-           && (lo_servers_recv_noblock(&net->servers[SERVER_DEVICE], &status[2], 2, 0)))
-        device_count += (status[2] > 0) + (status[3] > 0);
+    /* When done, or if non-blocking, drain remaining data messages within the poll budget. */
+    device_count += mpr_net_recv_data(net, (mpr_local_dev)dev,
+                                      ((mpr_local_dev)dev)->poll_budget.msgs,
+                                      ((mpr_local_dev)dev)->poll_budget.usec);
+
+    return _finish_poll((mpr_local_dev)dev, admin_count, device_count);
+}
+
+int mpr_dev_poll(mpr_dev dev, int block_ms)
+{
+    int count, busy;
+    RETURN_ARG_UNLESS(dev && dev->is_local, 0);
+    TRACE_RETURN_UNLESS(!_is_other_thread((mpr_local_dev)dev), 0, "error: device is being "
+                        "polled by its I/O thread.\n");
+    _prepare_update_queue((mpr_local_dev)dev);
+    _flush_queued_updates((mpr_local_dev)dev);
+    busy = mpr_dev_set_busy((mpr_local_dev)dev, 1);
+    count = _poll(dev, block_ms);
+    mpr_dev_set_busy((mpr_local_dev)dev, busy);
+    /* send updates made by interrupts during the poll */
+    _flush_queued_updates((mpr_local_dev)dev);
+    mpr_graph_call_batch_cbs(dev->obj.graph);
+    return count;
+}
+
+int mpr_dev_get_poll_timeout(mpr_dev dev)
+{
+    double wait;
+    RETURN_ARG_UNLESS(dev && dev->is_local, -1);
+    /* the caller is about to block, so devices on this host must wake it up when they write to
+     * shared memory */
+    RETURN_ARG_UNLESS(!mpr_net_set_shm_waiting(&dev->obj.graph->net, 0, 1), 0);
+    wait = mpr_net_get_next_wait(&dev->obj.graph->net);
+    return (int)ceil(wait * 1000);
+}
+
+static int _process_ready(mpr_dev dev, const int *fds, int num)
+{
+    int admin_count, device_count = 0, ready;
+    mpr_net net = &dev->obj.graph->net;
+    ready = fds ? mpr_net_get_ready_servers(net, (mpr_local_dev)dev, fds, num) : 0;
+    admin_count = mpr_net_recv_admin(net, ready);
+    mpr_net_poll(net);
+
+    if (!((mpr_local_dev)dev)->registered) {
+        net->msgs_recvd |= admin_count;
+        ((mpr_local_dev)dev)->bundle_idx = 1;
+        return admin_count;
+    }
 
-    /* process incoming maps */
     ((mpr_local_dev)dev)->polling = 1;
-    _process_incoming_maps((mpr_local_dev)dev);
+    ((mpr_local_dev)dev)->time_is_stale = 1;
+    mpr_dev_get_time(dev);
+    _process_outgoing_maps((mpr_local_dev)dev);
     ((mpr_local_dev)dev)->polling = 0;
 
-    if (dev->obj.props.synced->dirty && mpr_dev_get_is_ready(dev)
-        && ((mpr_local_dev)dev)->subscribers) {
-        /* inform device subscribers of changed properties */
-        mpr_net_use_subscribers(net, (mpr_local_dev)dev, MPR_DEV);
-        mpr_dev_send_state(dev, MSG_DEV);
-    }
+    /* Also drain on timeouts since data may arrive on TCP sockets that are not exposed. */
+    if (!num || ready & ((1 << SERVER_UDP) | (1 << SERVER_TCP)))
+        device_count = mpr_net_recv_data(net, (mpr_local_dev)dev,
+                                         ((mpr_local_dev)dev)->poll_budget.msgs,
+                                         ((mpr_local_dev)dev)->poll_budget.usec);
 
-    net->msgs_recvd |= admin_count;
-    return admin_count + device_count;
+    return _finish_poll((mpr_local_dev)dev, admin_count, device_count);
+}
+
+int mpr_dev_process_ready(mpr_dev dev, const int *fds, int num)
+{
+    int count, busy;
+    RETURN_ARG_UNLESS(dev && dev->is_local, 0);
+    RETURN_ARG_UNLESS(!_is_other_thread((mpr_local_dev)dev), 0);
+    _flush_queued_updates((mpr_local_dev)dev);
+    busy = mpr_dev_set_busy((mpr_local_dev)dev, 1);
+    count = _process_ready(dev, fds, num);
+    mpr_dev_set_busy((mpr_local_dev)dev, busy);
+    _flush_queued_updates((mpr_local_dev)dev);
+    mpr_graph_call_batch_cbs(dev->obj.graph);
+    return count;
 }
 
 mpr_time mpr_dev_get_time(mpr_dev dev)
@@ -833,13 +1531,16 @@ void mpr_dev_reserve_idmap(mpr_local_dev dev)
     map = (mpr_id_map)calloc(1, sizeof(mpr_id_map_t));
     map->next = dev->idmaps.reserve;
     dev->idmaps.reserve = map;
+    ++dev->idmaps.num;
 }
 
 mpr_id_map mpr_dev_add_idmap(mpr_local_dev dev, int group, mpr_id LID, mpr_id GID)
 {
     mpr_id_map map;
-    if (!dev->idmaps.reserve)
+    if (!dev->idmaps.reserve) {
+        mpr_dev_rt_miss(dev);
         mpr_dev_reserve_idmap(dev);
+    }
     map = dev->idmaps.reserve;
     map->LID = LID;
     map->GID = GID ? GID : mpr_dev_generate_unique_id((mpr_dev)dev);
@@ -923,44 +1624,52 @@ void mpr_dev_start_servers(mpr_local_dev dev)
 {
     int portnum;
     char port[16], *pport = 0, *url, *host;
-    mpr_net net = &dev->obj.graph->net;
     mpr_list sigs;
-    RETURN_UNLESS(!net->servers[SERVER_UDP] && !net->servers[SERVER_TCP]);
-    while (!(net->servers[SERVER_UDP] = lo_server_new(pport, handler_error)))
+    RETURN_UNLESS(!dev->servers[SERVER_UDP] && !dev->servers[SERVER_TCP]);
+    while (!(dev->servers[SERVER_UDP] = lo_server_new(pport, handler_error)))
         pport = 0;
-    snprintf(port, 16, "%d", lo_server_get_port(net->servers[SERVER_UDP]));
+    snprintf(port, 16, "%d", lo_server_get_port(dev->servers[SERVER_UDP]));
     pport = port;
-    while (!(net->servers[SERVER_TCP] = lo_server_new_with_proto(pport, LO_TCP, handler_error)))
+    while (!(dev->servers[SERVER_TCP] = lo_server_new_with_proto(pport, LO_TCP, handler_error)))
         pport = 0;
 
     /* Disable liblo message queueing */
-    lo_server_enable_queue(net->servers[SERVER_UDP], 0, 1);
-    lo_server_enable_queue(net->servers[SERVER_TCP], 0, 1);
+    lo_server_enable_queue(dev->servers[SERVER_UDP], 0, 1);
+    lo_server_enable_queue(dev->servers[SERVER_TCP], 0, 1);
 
     /* Add bundle handlers */
-    lo_server_add_bundle_handlers(net->servers[SERVER_UDP], mpr_dev_bundle_start, NULL, (void*)dev);
-    lo_server_add_bundle_handlers(net->servers[SERVER_TCP], mpr_dev_bundle_start, NULL, (void*)dev);
+    lo_server_add_bundle_handlers(dev->servers[SERVER_UDP], mpr_dev_bundle_start, NULL, (void*)dev);
+    lo_server_add_bundle_handlers(dev->servers[SERVER_TCP], mpr_dev_bundle_start, NULL, (void*)dev);
 
-    portnum = lo_server_get_port(net->servers[SERVER_UDP]);
+    /* Add generic method for aliased data messages; this must precede the signal methods */
+    lo_server_add_method(dev->servers[SERVER_UDP], NULL, NULL, handler_alias, (void*)dev);
+    lo_server_add_method(dev->servers[SERVER_TCP], NULL, NULL, handler_alias, (void*)dev);
+
+    portnum = lo_server_get_port(dev->servers[SERVER_UDP]);
     mpr_tbl_set(dev->obj.props.synced, PROP(PORT), NULL, 1, MPR_INT32, &portnum, NON_MODIFIABLE);
 
     trace_dev(dev, "bound to UDP port %i\n", portnum);
-    trace_dev(dev, "bound to TCP port %i\n", lo_server_get_port(net->servers[SERVER_TCP]));
+    trace_dev(dev, "bound to TCP port %i\n", lo_server_get_port(dev->servers[SERVER_TCP]));
 
-    url = lo_server_get_url(net->servers[SERVER_UDP]);
+    url = lo_server_get_url(dev->servers[SERVER_UDP]);
     host = lo_url_get_hostname(url);
     mpr_tbl_set(dev->obj.props.synced, PROP(HOST), NULL, 1, MPR_STR, host, NON_MODIFIABLE);
     free(host);
     free(url);
 
+    /* let peers on the same host send map updates through shared memory */
+    host = (char*)mpr_shm_get_host_id();
+    if (host)
+        mpr_tbl_set(dev->obj.props.synced, PROP(HOST_ID), NULL, 1, MPR_STR, host, NON_MODIFIABLE);
+
     /* add signal methods */
     sigs = mpr_dev_get_sigs((mpr_dev)dev, MPR_DIR_ANY);
     while (sigs) {
         mpr_local_sig sig = (mpr_local_sig)*sigs;
         sigs = mpr_list_get_next(sigs);
         if (sig->handler) {
-            lo_server_add_method(net->servers[SERVER_UDP], sig->path, NULL, mpr_dev_handler, (void*)sig);
-            lo_server_add_method(net->servers[SERVER_TCP], sig->path, NULL, mpr_dev_handler, (void*)sig);
+            lo_server_add_method(dev->servers[SERVER_UDP], sig->path, NULL, mpr_dev_handler, (void*)sig);
+            lo_server_add_method(dev->servers[SERVER_TCP], sig->path, NULL, mpr_dev_handler, (void*)sig);
         }
     }
 }
@@ -976,9 +1685,24 @@ const char *mpr_dev_get_name(mpr_dev dev)
     dev->name = (char*)malloc(len);
     dev->name[0] = 0;
     snprintf(dev->name, len, "%s.%d", dev->prefix, ((mpr_local_dev)dev)->ordinal_allocator.val);
+    mpr_graph_index_obj(dev->obj.graph, (mpr_obj)dev);
     return dev->name;
 }
 
+int mpr_dev_set_fast_registration(mpr_dev dev, int ordinal)
+{
+    mpr_allocated a;
+    RETURN_ARG_UNLESS(dev && dev->is_local, 1);
+    a = &((mpr_local_dev)dev)->ordinal_allocator;
+    RETURN_ARG_UNLESS(!((mpr_local_dev)dev)->registered && !a->locked, 1);
+    a->fast = 1;
+    if (ordinal > 0 && (unsigned int)ordinal != a->val) {
+        a->val = ordinal;
+        mpr_net_probe_dev_name(&dev->obj.graph->net, (mpr_local_dev)dev);
+    }
+    return 0;
+}
+
 int mpr_dev_get_is_ready(mpr_dev dev)
 {
     return dev ? dev->status >= MPR_STATUS_READY : MPR_STATUS_UNDEFINED;
@@ -1105,35 +1829,88 @@ int mpr_dev_set_from_msg(mpr_dev dev, mpr_msg m)
                 break;
         }
     }
+    /* the id may have been set by the message */
+    mpr_graph_index_obj(dev->obj.graph, (mpr_obj)dev);
+    if (updated)
+        mpr_graph_touch_obj(dev->obj.graph, (mpr_obj)dev);
     return updated;
 }
 
-static int mpr_dev_send_sigs(mpr_local_dev dev, mpr_dir dir)
+/* Send the signals announced after revision since, or all signals if since is -1. */
+static int mpr_dev_send_sigs(mpr_local_dev dev, mpr_dir dir, int since)
 {
     mpr_list l = mpr_dev_get_sigs((mpr_dev)dev, dir);
     while (l) {
-        mpr_sig_send_state((mpr_sig)*l, MSG_SIG);
+        if (((mpr_obj)*l)->rev > since)
+            mpr_sig_send_state((mpr_sig)*l, MSG_SIG);
         l = mpr_list_get_next(l);
     }
     return 0;
 }
 
-static int mpr_dev_send_maps(mpr_local_dev dev, mpr_dir dir)
+/* Send the maps announced after revision since, or all maps if since is -1. */
+static int mpr_dev_send_maps(mpr_local_dev dev, mpr_dir dir, int since)
 {
     mpr_list l = mpr_dev_get_maps((mpr_dev)dev, dir);
     while (l) {
-        mpr_map_send_state((mpr_map)*l, -1, MSG_MAPPED);
+        if (((mpr_obj)*l)->rev > since)
+            mpr_map_send_state((mpr_map)*l, -1, MSG_MAPPED);
         l = mpr_list_get_next(l);
     }
     return 0;
 }
 
+/* Replay the removals of objects matching flags announced after revision since. */
+static void mpr_dev_send_tombstones(mpr_local_dev dev, int flags, int since)
+{
+    mpr_tombstone t;
+    RETURN_UNLESS(since >= 0);
+    for (t = dev->tombstones.head; t; t = t->next) {
+        if (t->rev > since && (t->type & flags))
+            mpr_net_add_msg(&dev->obj.graph->net, 0, t->cmd, t->msg);
+    }
+}
+
+void mpr_dev_add_tombstone(mpr_local_dev dev, int type, net_msg_t cmd, lo_message msg)
+{
+    mpr_tombstone t;
+    RETURN_UNLESS(dev);
+    if (dev->tombstones.num >= MAX_TOMBSTONES) {
+        /* forget the oldest removal, subscribers that have not seen it need the full state */
+        t = dev->tombstones.head;
+        dev->tombstones.head = t->next;
+        if (!dev->tombstones.head)
+            dev->tombstones.tail = 0;
+        dev->tombstones.floor = t->rev;
+        --dev->tombstones.num;
+        lo_message_free(t->msg);
+    }
+    else
+        t = (mpr_tombstone)malloc(sizeof(struct _mpr_tombstone));
+    RETURN_UNLESS(t);
+
+    /* the message is shared with the bundle it was added to */
+    lo_message_incref(msg);
+    t->msg = msg;
+    t->rev = ++dev->obj.graph->net.revs.rev;
+    t->type = type;
+    t->cmd = cmd;
+    t->next = 0;
+    if (dev->tombstones.tail)
+        dev->tombstones.tail->next = t;
+    else
+        dev->tombstones.head = t;
+    dev->tombstones.tail = t;
+    ++dev->tombstones.num;
+}
+
 /* Add/renew/remove a subscription. */
 void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
-                               int timeout_sec, int revision)
+                               int timeout_sec, int revision, int epoch, const int *revs)
 {
     mpr_time t;
     mpr_net net;
+    int i, since[2];
     mpr_subscriber *s = &dev->subscribers;
     const char *ip = lo_address_get_hostname(addr);
     const char *port = lo_address_get_port(addr);
@@ -1151,8 +1928,7 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
                 int prev_flags = temp->flags;
                 trace_dev(dev, "removing subscription from %s:%s\n", s_ip, s_port);
                 *s = temp->next;
-                FUNC_IF(lo_address_free, temp->addr);
-                free(temp);
+                mpr_net_free_subscriber(temp);
                 RETURN_UNLESS(flags && (flags &= ~prev_flags));
             }
             else {
@@ -1180,8 +1956,8 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
         trace_dev(dev, "adding new subscription from %s:%s with flags ", ip, port);
         print_subscription_flags(flags);
 #endif
-        mpr_subscriber sub = malloc(sizeof(struct _mpr_subscriber));
-        sub->addr = lo_address_new(ip, port);
+        mpr_subscriber sub = mpr_net_new_subscriber(ip, port);
+        RETURN_UNLESS(sub);
         sub->lease_exp = t.sec + timeout_sec;
         sub->flags = flags;
         sub->next = dev->subscribers;
@@ -1194,6 +1970,23 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
     mpr_dev_send_state((mpr_dev)dev, MSG_DEV);
     mpr_net_send(net);
 
+    /* Objects announced up to the revisions recorded by the subscriber are already known, unless
+     * the revisions are from another clock or removals since then have been forgotten. */
+    for (i = 0; i < 2; i++) {
+        if (   revs && epoch == net->revs.epoch && revs[i] >= dev->tombstones.floor
+            && revs[i] <= net->revs.rev)
+            since[i] = revs[i];
+        else
+            since[i] = -1;
+    }
+#ifdef DEBUG
+    if (revs)
+        trace_dev(dev, "subscriber is up to date with revisions %d (signals), %d (maps)\n",
+                  since[0], since[1]);
+#endif
+
+    /* objects sent to catch up are not changed */
+    net->revs.paused = 1;
     if (flags & MPR_SIG) {
         mpr_dir dir = 0;
         if (flags & MPR_SIG_IN)
@@ -1201,7 +1994,8 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
         if (flags & MPR_SIG_OUT)
             dir |= MPR_DIR_OUT;
         mpr_net_use_mesh(net, addr);
-        mpr_dev_send_sigs(dev, dir);
+        mpr_dev_send_tombstones(dev, flags & MPR_SIG, since[0]);
+        mpr_dev_send_sigs(dev, dir, since[0]);
         mpr_net_send(net);
     }
     if (flags & MPR_MAP) {
@@ -1211,7 +2005,22 @@ void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address addr, int flags,
         if (flags & MPR_MAP_OUT)
             dir |= MPR_DIR_OUT;
         mpr_net_use_mesh(net, addr);
-        mpr_dev_send_maps(dev, dir);
+        mpr_dev_send_tombstones(dev, flags & MPR_MAP, since[1]);
+        mpr_dev_send_maps(dev, dir, since[1]);
+        mpr_net_send(net);
+    }
+    net->revs.paused = 0;
+
+    if (flags & (MPR_SIG | MPR_MAP)) {
+        /* tell the subscriber which revisions it is now up to date with */
+        NEW_LO_MSG(msg, return);
+        lo_message_add_string(msg, mpr_dev_get_name((mpr_dev)dev));
+        lo_message_add_int32(msg, dev->obj.version);
+        lo_message_add_int32(msg, net->revs.epoch);
+        lo_message_add_int32(msg, MPR_SIG == (flags & MPR_SIG) ? net->revs.rev : -1);
+        lo_message_add_int32(msg, MPR_MAP == (flags & MPR_MAP) ? net->revs.rev : -1);
+        mpr_net_use_mesh(net, addr);
+        mpr_net_add_msg(net, 0, MSG_SYNC, msg);
         mpr_net_send(net);
     }
 }
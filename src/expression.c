@@ -59,6 +59,10 @@ static void expr_stack_realloc(mpr_expr_stack stk, int num_samps) {
     }
 }
 
+void mpr_expr_stack_reserve(mpr_expr_stack stk, mpr_expr_stack ref) {
+    expr_stack_realloc(stk, ref->size);
+}
+
 void mpr_expr_stack_free(mpr_expr_stack stk) {
     if (stk->stk)
         free(stk->stk);
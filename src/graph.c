@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <zlib.h>
+#include <math.h>
 #include <sys/time.h>
 
 #include "mapper_internal.h"
@@ -88,6 +89,14 @@ static void send_subscribe_msg(mpr_graph g, mpr_dev d, int flags, int timeout)
     lo_message_add_string(msg, "@version");
     lo_message_add_int32(msg, d->obj.version);
 
+    if ((flags & (MPR_SIG | MPR_MAP)) && (d->sync_revs[0] >= 0 || d->sync_revs[1] >= 0)) {
+        /* only ask for the signals and maps changed since we were last brought up to date */
+        lo_message_add_string(msg, "@revisions");
+        lo_message_add_int32(msg, d->sync_epoch);
+        lo_message_add_int32(msg, d->sync_revs[0]);
+        lo_message_add_int32(msg, d->sync_revs[1]);
+    }
+
     mpr_net_add_msg(&g->net, cmd, 0, msg);
     mpr_net_send(&g->net);
 }
@@ -166,12 +175,14 @@ mpr_graph mpr_graph_new(int subscribe_flags)
     g->net.graph = g->obj.graph = g;
     g->obj.id = 0;
     g->own = 1;
+    g->slab = mpr_slab_new();
+    g->strings = mpr_strtab_new();
     mpr_net_init(&g->net, 0, 0, 0);
     if (subscribe_flags)
         _autosubscribe(g, subscribe_flags);
 
     /* TODO: consider whether graph objects should sync properties over the network. */
-    tbl = g->obj.props.synced = mpr_tbl_new();
+    tbl = g->obj.props.synced = mpr_tbl_new(g->strings);
     mpr_tbl_link(tbl, PROP(DATA), 1, MPR_PTR, &g->obj.data,
                  LOCAL_MODIFY | INDIRECT | LOCAL_ACCESS_ONLY);
     mpr_tbl_set(tbl, PROP(LIBVER), NULL, 1, MPR_STR, PACKAGE_VERSION, NON_MODIFIABLE);
@@ -182,6 +193,7 @@ mpr_graph mpr_graph_new(int subscribe_flags)
 
 void mpr_graph_free(mpr_graph g)
 {
+    int i;
     mpr_list list;
     RETURN_UNLESS(g);
 
@@ -191,6 +203,13 @@ void mpr_graph_free(mpr_graph g)
         g->callbacks = g->callbacks->next;
         free(cb);
     }
+    while (g->batch_callbacks) {
+        fptr_list cb = g->batch_callbacks;
+        g->batch_callbacks = g->batch_callbacks->next;
+        free(cb);
+    }
+    /* free any objects kept for a batch that will no longer be delivered */
+    mpr_graph_call_batch_cbs(g);
 
     /* unsubscribe from and remove any autorenewing subscriptions */
     while (g->subscriptions)
@@ -239,30 +258,214 @@ void mpr_graph_free(mpr_graph g)
 
     mpr_net_free(&g->net);
     FUNC_IF(mpr_tbl_free, g->obj.props.synced);
+    mpr_graph_free_indexes(g);
+    for (i = 0; i < 3; i++)
+        FUNC_IF(free, g->idx[i].buckets);
+    FUNC_IF(free, g->dev_names.buckets);
+    FUNC_IF(free, g->batch.evts);
+    FUNC_IF(free, g->batch.removed);
+    mpr_slab_free(g->slab);
+    mpr_strtab_free(g->strings);
     free(g);
 }
 
 /**** Generic records ****/
 
-static mpr_obj _obj_by_id(mpr_graph g, void *obj_list, mpr_id id)
+#define IDX_MIN_SIZE 64
+
+static mpr_obj_idx _get_idx(mpr_graph g, mpr_type type)
+{
+    switch (type) {
+        case MPR_DEV:   return &g->idx[0];
+        case MPR_SIG:   return &g->idx[1];
+        case MPR_MAP:   return &g->idx[2];
+        default:        return 0;
+    }
+}
+
+static unsigned int _hash_id(mpr_id id)
+{
+    /* device ids only differ in their upper half and signal ids mostly in their lower half */
+    id ^= id >> 33;
+    id *= 0xff51afd7ed558ccdULL;
+    id ^= id >> 33;
+    return (unsigned int)id;
+}
+
+static void _idx_unlink(mpr_obj_idx idx, mpr_obj o)
+{
+    mpr_obj *p = &idx->buckets[_hash_id(o->idx_id) & (idx->size - 1)];
+    while (*p && *p != o)
+        p = &(*p)->idx_next;
+    if (*p) {
+        *p = o->idx_next;
+        --idx->count;
+    }
+    o->idx_next = 0;
+    o->is_indexed = 0;
+}
+
+static int _idx_resize(mpr_obj_idx idx, int size)
+{
+    int i;
+    mpr_obj *buckets = (mpr_obj*)calloc(size, sizeof(mpr_obj));
+    RETURN_ARG_UNLESS(buckets, 1);
+    for (i = 0; i < idx->size; i++) {
+        mpr_obj o = idx->buckets[i];
+        while (o) {
+            mpr_obj next = o->idx_next;
+            mpr_obj *b = &buckets[_hash_id(o->idx_id) & (size - 1)];
+            o->idx_next = *b;
+            *b = o;
+            o = next;
+        }
+    }
+    FUNC_IF(free, idx->buckets);
+    idx->buckets = buckets;
+    idx->size = size;
+    return 0;
+}
+
+static void _idx_add(mpr_obj_idx idx, mpr_obj o)
+{
+    mpr_obj *b;
+    if (o->is_indexed)
+        _idx_unlink(idx, o);
+    /* keep at most one object per bucket on average */
+    if (idx->count >= idx->size && _idx_resize(idx, idx->size ? idx->size * 2 : IDX_MIN_SIZE))
+        return;
+    b = &idx->buckets[_hash_id(o->id) & (idx->size - 1)];
+    o->idx_next = *b;
+    *b = o;
+    o->idx_id = o->id;
+    o->is_indexed = 1;
+    ++idx->count;
+}
+
+static uint32_t _hash_name(const char *name)
+{
+    return crc32(0L, (const Bytef *)name, strlen(name));
+}
+
+static void _name_idx_unlink(mpr_obj_idx idx, mpr_dev d)
+{
+    mpr_dev *p = (mpr_dev*)&idx->buckets[d->name_hash & (idx->size - 1)];
+    while (*p && *p != d)
+        p = &(*p)->name_next;
+    if (*p) {
+        *p = d->name_next;
+        --idx->count;
+    }
+    d->name_next = 0;
+    d->is_name_indexed = 0;
+}
+
+static int _name_idx_resize(mpr_obj_idx idx, int size)
+{
+    int i;
+    mpr_obj *buckets = (mpr_obj*)calloc(size, sizeof(mpr_obj));
+    RETURN_ARG_UNLESS(buckets, 1);
+    for (i = 0; i < idx->size; i++) {
+        mpr_dev d = (mpr_dev)idx->buckets[i];
+        while (d) {
+            mpr_dev next = d->name_next;
+            mpr_dev *b = (mpr_dev*)&buckets[d->name_hash & (size - 1)];
+            d->name_next = *b;
+            *b = d;
+            d = next;
+        }
+    }
+    FUNC_IF(free, idx->buckets);
+    idx->buckets = buckets;
+    idx->size = size;
+    return 0;
+}
+
+static void _name_idx_add(mpr_obj_idx idx, mpr_dev d)
+{
+    mpr_dev *b;
+    uint32_t hash = _hash_name(d->name);
+    RETURN_UNLESS(!d->is_name_indexed || d->name_hash != hash);
+    if (d->is_name_indexed)
+        _name_idx_unlink(idx, d);
+    if (idx->count >= idx->size
+        && _name_idx_resize(idx, idx->size ? idx->size * 2 : IDX_MIN_SIZE))
+        return;
+    d->name_hash = hash;
+    b = (mpr_dev*)&idx->buckets[hash & (idx->size - 1)];
+    d->name_next = *b;
+    *b = d;
+    d->is_name_indexed = 1;
+    ++idx->count;
+}
+
+void mpr_graph_index_obj(mpr_graph g, mpr_obj o)
 {
-    mpr_list objs = mpr_list_from_data(obj_list);
-    while (objs) {
-        if (id == (*objs)->id)
-            return *objs;
-        objs = mpr_list_get_next(objs);
+    mpr_obj_idx idx = _get_idx(g, o->type);
+    RETURN_UNLESS(idx);
+    if (!o->is_indexed || o->idx_id != o->id) {
+        _idx_add(idx, o);
+        mpr_graph_touch_obj(g, o);
+    }
+    /* local devices are named once their ordinal is locked */
+    if (MPR_DEV == o->type && ((mpr_dev)o)->name)
+        _name_idx_add(&g->dev_names, (mpr_dev)o);
+}
+
+static void _unindex_obj(mpr_graph g, mpr_obj o)
+{
+    mpr_obj_idx idx = _get_idx(g, o->type);
+    RETURN_UNLESS(idx);
+    mpr_graph_touch_obj(g, o);
+    if (o->is_indexed)
+        _idx_unlink(idx, o);
+    if (MPR_DEV == o->type && ((mpr_dev)o)->is_name_indexed)
+        _name_idx_unlink(&g->dev_names, (mpr_dev)o);
+}
+
+static mpr_obj _obj_by_id(mpr_graph g, mpr_type type, mpr_id id)
+{
+    mpr_obj o;
+    mpr_obj_idx idx = _get_idx(g, type);
+    RETURN_ARG_UNLESS(idx && idx->size, NULL);
+    for (o = idx->buckets[_hash_id(id) & (idx->size - 1)]; o; o = o->idx_next) {
+        if (id == o->id)
+            return o;
     }
     return NULL;
 }
 
+int mpr_graph_has_obj(mpr_graph g, mpr_type type, mpr_obj o, mpr_id id)
+{
+    mpr_obj i;
+    mpr_obj_idx idx = _get_idx(g, type);
+    RETURN_ARG_UNLESS(idx && idx->size, 0);
+    /* compare pointers only, since o may already have been freed */
+    for (i = idx->buckets[_hash_id(id) & (idx->size - 1)]; i; i = i->idx_next) {
+        if (i == o)
+            return 1;
+    }
+    return 0;
+}
+
+void **mpr_graph_get_list_head(mpr_graph g, mpr_type type)
+{
+    switch (type) {
+        case MPR_DEV:   return (void**)&g->devs;
+        case MPR_SIG:   return (void**)&g->sigs;
+        case MPR_MAP:   return (void**)&g->maps;
+        default:        return 0;
+    }
+}
+
 mpr_obj mpr_graph_get_obj(mpr_graph g, mpr_type type, mpr_id id)
 {
     if (type & MPR_DEV)
-        return _obj_by_id(g, g->devs, id);
+        return _obj_by_id(g, MPR_DEV, id);
     if (type & MPR_SIG)
-        return _obj_by_id(g, g->sigs, id);
+        return _obj_by_id(g, MPR_SIG, id);
     if (type & MPR_MAP)
-        return _obj_by_id(g, g->maps, id);
+        return _obj_by_id(g, MPR_MAP, id);
     return 0;
 }
 
@@ -278,11 +481,23 @@ mpr_list mpr_graph_get_objs(mpr_graph g, int types)
     return 0;
 }
 
-int mpr_graph_add_cb(mpr_graph g, mpr_graph_handler *h, int types, const void *user)
+int mpr_graph_get_pool_stats(mpr_graph g, int *num_in_use, int *num_reserved, int *num_misses)
+{
+    RETURN_ARG_UNLESS(g && g->slab, 0);
+    if (num_in_use)
+        *num_in_use = g->slab->num_in_use;
+    if (num_reserved)
+        *num_reserved = g->slab->num_reserved;
+    if (num_misses)
+        *num_misses = g->slab->num_misses;
+    return g->slab->num_allocs;
+}
+
+static int _add_cb(fptr_list *head, void *h, int types, const void *user)
 {
-    fptr_list cb = g->callbacks;
+    fptr_list cb = *head;
     while (cb) {
-        if (cb->f == (void*)h && cb->ctx == user) {
+        if (cb->f == h && cb->ctx == user) {
             cb->types |= types;
             return 0;
         }
@@ -290,14 +505,66 @@ int mpr_graph_add_cb(mpr_graph g, mpr_graph_handler *h, int types, const void *u
     }
 
     cb = (fptr_list)malloc(sizeof(struct _fptr_list));
-    cb->f = (void*)h;
+    cb->f = h;
     cb->types = types;
     cb->ctx = (void*)user;
-    cb->next = g->callbacks;
-    g->callbacks = cb;
+    cb->next = *head;
+    *head = cb;
     return 1;
 }
 
+int mpr_graph_add_cb(mpr_graph g, mpr_graph_handler *h, int types, const void *user)
+{
+    return _add_cb(&g->callbacks, (void*)h, types, user);
+}
+
+int mpr_graph_add_batch_cb(mpr_graph g, mpr_graph_batch_handler *h, int types, const void *user)
+{
+    RETURN_ARG_UNLESS(g && h, 0);
+    return _add_cb(&g->batch_callbacks, (void*)h, types, user);
+}
+
+/* Queue an event for the batched callbacks, coalescing it with the event already pending for
+ * the same object if there is one. */
+static void _queue_evt(mpr_graph g, mpr_obj o, mpr_type t, mpr_graph_evt e)
+{
+    mpr_graph_batch b = &g->batch;
+    mpr_graph_batch_evt evt;
+    if (o->batch_pos) {
+        evt = &b->evts[o->batch_pos - 1];
+        if (MPR_OBJ_MOD == e)
+            return;
+        if (MPR_OBJ_NEW == evt->evt && (MPR_OBJ_REM == e || MPR_OBJ_EXP == e)) {
+            /* the object came and went within the same batch */
+            evt->obj = 0;
+            o->batch_pos = 0;
+        }
+        else
+            evt->evt = e;
+        return;
+    }
+    if (b->num_evts >= b->size_evts) {
+        int size = b->size_evts ? b->size_evts * 2 : 16;
+        evt = (mpr_graph_batch_evt)realloc(b->evts, size * sizeof(mpr_graph_batch_evt_t));
+        RETURN_UNLESS(evt);
+        b->evts = evt;
+        b->size_evts = size;
+    }
+    evt = &b->evts[b->num_evts++];
+    evt->obj = o;
+    evt->type = t;
+    evt->evt = e;
+    o->batch_pos = b->num_evts;
+}
+
+/* Remove the pending event of an object that is removed without notification. */
+static void _drop_evt(mpr_graph g, mpr_obj o)
+{
+    RETURN_UNLESS(o->batch_pos);
+    g->batch.evts[o->batch_pos - 1].obj = 0;
+    o->batch_pos = 0;
+}
+
 void mpr_graph_call_cbs(mpr_graph g, mpr_obj o, mpr_type t, mpr_graph_evt e)
 {
     fptr_list cb = g->callbacks, temp;
@@ -307,15 +574,111 @@ void mpr_graph_call_cbs(mpr_graph g, mpr_obj o, mpr_type t, mpr_graph_evt e)
             ((mpr_graph_handler*)cb->f)(g, o, e, cb->ctx);
         cb = temp;
     }
+    if (g->batch_callbacks)
+        _queue_evt(g, o, t, e);
 }
 
-void *mpr_graph_remove_cb(mpr_graph g, mpr_graph_handler *h, const void *user)
+static void _free_obj(mpr_obj o)
 {
-    fptr_list cb = g->callbacks;
+    switch (o->type) {
+        case MPR_DEV: {
+            mpr_dev d = (mpr_dev)o;
+            FUNC_IF(mpr_tbl_free, d->obj.props.synced);
+            FUNC_IF(mpr_tbl_free, d->obj.props.staged);
+            FUNC_IF(free, d->name);
+            FUNC_IF(free, d->sig_names.buckets);
+            break;
+        }
+        case MPR_SIG:   mpr_sig_free_internal((mpr_sig)o);  break;
+        case MPR_MAP:   mpr_map_free((mpr_map)o);           break;
+        default:                                            break;
+    }
+    mpr_list_free_item(o);
+}
+
+/* Free an object that has been removed from the graph. While events are pending for the batched
+ * callbacks the object is kept until they have been delivered, since they may refer to it. */
+static void _release_obj(mpr_graph g, mpr_obj o)
+{
+    mpr_graph_batch b = &g->batch;
+    if (!b->num_evts) {
+        _free_obj(o);
+        return;
+    }
+    if (b->num_removed >= b->size_removed) {
+        int size = b->size_removed ? b->size_removed * 2 : 16;
+        mpr_obj *removed = (mpr_obj*)realloc(b->removed, size * sizeof(mpr_obj));
+        if (!removed) {
+            _drop_evt(g, o);
+            _free_obj(o);
+            return;
+        }
+        b->removed = removed;
+        b->size_removed = size;
+    }
+    b->removed[b->num_removed++] = o;
+}
+
+void mpr_graph_call_batch_cbs(mpr_graph g)
+{
+    mpr_graph_batch_t b = g->batch;
+    fptr_list cb = g->batch_callbacks, temp;
+    mpr_obj *objs = 0;
+    mpr_graph_evt *evts = 0;
+    int i, num;
+    RETURN_UNLESS(b.num_evts || b.num_removed);
+
+    /* start a new batch since the callbacks may cause further events */
+    memset(&g->batch, 0, sizeof(mpr_graph_batch_t));
+    for (i = 0; i < b.num_evts; i++) {
+        if (b.evts[i].obj)
+            b.evts[i].obj->batch_pos = 0;
+    }
+    if (cb && b.num_evts) {
+        objs = (mpr_obj*)malloc(b.num_evts * sizeof(mpr_obj));
+        evts = (mpr_graph_evt*)malloc(b.num_evts * sizeof(mpr_graph_evt));
+    }
+    while (objs && evts && cb) {
+        temp = cb->next;
+        for (i = 0, num = 0; i < b.num_evts; i++) {
+            if (b.evts[i].obj && (cb->types & b.evts[i].type)) {
+                objs[num] = b.evts[i].obj;
+                evts[num++] = b.evts[i].evt;
+            }
+        }
+        if (num)
+            ((mpr_graph_batch_handler*)cb->f)(g, num, objs, evts, cb->ctx);
+        cb = temp;
+    }
+    FUNC_IF(free, objs);
+    FUNC_IF(free, evts);
+
+    /* removed objects are freed in the order they were removed */
+    for (i = 0; i < b.num_removed; i++)
+        _free_obj(b.removed[i]);
+
+    /* keep the buffers for the next batch unless the callbacks already started one */
+    if (!g->batch.evts) {
+        g->batch.evts = b.evts;
+        g->batch.size_evts = b.size_evts;
+    }
+    else
+        free(b.evts);
+    if (!g->batch.removed) {
+        g->batch.removed = b.removed;
+        g->batch.size_removed = b.size_removed;
+    }
+    else
+        free(b.removed);
+}
+
+static void *_remove_cb(fptr_list *head, void *h, const void *user)
+{
+    fptr_list cb = *head;
     fptr_list prevcb = 0;
     void *ctx;
     while (cb) {
-        if (cb->f == (void*)h && cb->ctx == user)
+        if (cb->f == h && cb->ctx == user)
             break;
         prevcb = cb;
         cb = cb->next;
@@ -324,12 +687,23 @@ void *mpr_graph_remove_cb(mpr_graph g, mpr_graph_handler *h, const void *user)
     if (prevcb)
         prevcb->next = cb->next;
     else
-        g->callbacks = cb->next;
+        *head = cb->next;
     ctx = cb->ctx;
     free(cb);
     return ctx;
 }
 
+void *mpr_graph_remove_cb(mpr_graph g, mpr_graph_handler *h, const void *user)
+{
+    return _remove_cb(&g->callbacks, (void*)h, user);
+}
+
+void *mpr_graph_remove_batch_cb(mpr_graph g, mpr_graph_batch_handler *h, const void *user)
+{
+    RETURN_ARG_UNLESS(g && h, 0);
+    return _remove_cb(&g->batch_callbacks, (void*)h, user);
+}
+
 static void _remove_by_qry(mpr_graph g, mpr_list l, mpr_graph_evt e)
 {
     mpr_obj o;
@@ -355,14 +729,16 @@ mpr_dev mpr_graph_add_dev(mpr_graph g, const char *name, mpr_msg msg)
 
     if (!dev) {
         trace_graph("adding device '%s'.\n", name);
-        dev = (mpr_dev)mpr_list_add_item((void**)&g->devs, sizeof(*dev));
+        dev = (mpr_dev)mpr_list_add_item((void**)&g->devs, sizeof(*dev), g->slab);
         dev->name = strdup(no_slash);
         dev->obj.id = crc32(0L, (const Bytef *)no_slash, strlen(no_slash));
         dev->obj.id <<= 32;
         dev->obj.type = MPR_DEV;
         dev->obj.graph = g;
         dev->is_local = 0;
+        dev->sync_revs[0] = dev->sync_revs[1] = -1;
         init_dev_prop_tbl(dev);
+        mpr_graph_index_obj(g, (mpr_obj)dev);
         rc = 1;
     }
 
@@ -396,23 +772,22 @@ void mpr_graph_remove_dev(mpr_graph g, mpr_dev d, mpr_graph_evt e, int quiet)
     _remove_by_qry(g, mpr_dev_get_sigs(d, MPR_DIR_ANY), e);
 
     mpr_list_remove_item((void**)&g->devs, d);
+    _unindex_obj(g, (mpr_obj)d);
 
     if (!quiet)
         mpr_graph_call_cbs(g, (mpr_obj)d, MPR_DEV, e);
-
-    FUNC_IF(mpr_tbl_free, d->obj.props.synced);
-    FUNC_IF(mpr_tbl_free, d->obj.props.staged);
-    FUNC_IF(free, d->name);
-    mpr_list_free_item(d);
+    else
+        _drop_evt(g, (mpr_obj)d);
+    _release_obj(g, (mpr_obj)d);
 }
 
 mpr_dev mpr_graph_get_dev_by_name(mpr_graph g, const char *name)
 {
     const char *no_slash = skip_slash(name);
-    mpr_list devs = mpr_list_from_data(g->devs);
-    while (devs) {
-        mpr_dev dev = (mpr_dev)*devs;
-        devs = mpr_list_get_next(devs);
+    mpr_dev dev;
+    RETURN_ARG_UNLESS(g->dev_names.size, 0);
+    dev = (mpr_dev)g->dev_names.buckets[_hash_name(no_slash) & (g->dev_names.size - 1)];
+    for (; dev; dev = dev->name_next) {
         if (dev->name && (0 == strcmp(dev->name, no_slash)))
             return dev;
     }
@@ -453,7 +828,7 @@ mpr_sig mpr_graph_add_sig(mpr_graph g, const char *name, const char *dev_name, m
 
     if (!sig) {
         trace_graph("adding signal '%s:%s'.\n", dev_name, name);
-        sig = (mpr_sig)mpr_list_add_item((void**)&g->sigs, sizeof(mpr_sig_t));
+        sig = (mpr_sig)mpr_list_add_item((void**)&g->sigs, sizeof(mpr_sig_t), g->slab);
 
         /* also add device record if necessary */
         sig->dev = dev;
@@ -461,6 +836,8 @@ mpr_sig mpr_graph_add_sig(mpr_graph g, const char *name, const char *dev_name, m
         sig->is_local = 0;
 
         mpr_sig_init(sig, MPR_DIR_UNDEFINED, name, 0, 0, 0, 0, 0, 0);
+        mpr_graph_index_obj(g, (mpr_obj)sig);
+        mpr_dev_add_sig(dev, sig);
         rc = 1;
     }
 
@@ -483,6 +860,8 @@ void mpr_graph_remove_sig(mpr_graph g, mpr_sig s, mpr_graph_evt e)
     _remove_by_qry(g, mpr_sig_get_maps(s, MPR_DIR_ANY), e);
 
     mpr_list_remove_item((void**)&g->sigs, s);
+    _unindex_obj(g, (mpr_obj)s);
+    mpr_dev_remove_sig(s->dev, s);
     mpr_graph_call_cbs(g, (mpr_obj)s, MPR_SIG, e);
 
     if (s->dir & MPR_DIR_IN)
@@ -490,8 +869,10 @@ void mpr_graph_remove_sig(mpr_graph g, mpr_sig s, mpr_graph_evt e)
     if (s->dir & MPR_DIR_OUT)
         --s->dev->num_outputs;
 
-    mpr_sig_free_internal(s);
-    mpr_list_free_item(s);
+    /* local signals share the resources of their device so they cannot outlive this call */
+    if (s->is_local)
+        mpr_graph_call_batch_cbs(g);
+    _release_obj(g, (mpr_obj)s);
 }
 
 /**** Link records ****/
@@ -504,7 +885,7 @@ mpr_link mpr_graph_add_link(mpr_graph g, mpr_dev dev1, mpr_dev dev2)
     if (link)
         return link;
 
-    link = (mpr_link)mpr_list_add_item((void**)&g->links, sizeof(mpr_link_t));
+    link = (mpr_link)mpr_list_add_item((void**)&g->links, sizeof(mpr_link_t), g->slab);
     if (dev2->is_local) {
         link->devs[LOCAL_DEV] = dev2;
         link->devs[REMOTE_DEV] = dev1;
@@ -590,8 +971,8 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
     /* We could be part of larger "convergent" mapping, so we will retrieve
      * record by mapping id instead of names. */
     if (id) {
-        map = (mpr_map)_obj_by_id(g, (mpr_obj)g->maps, id);
-        if (!map && _obj_by_id(g, (mpr_obj)g->maps, 0)) {
+        map = (mpr_map)_obj_by_id(g, MPR_MAP, id);
+        if (!map && _obj_by_id(g, MPR_MAP, 0)) {
             /* may have staged map stored locally */
             map = mpr_graph_get_map_by_names(g, num_src, src_names, dst_name);
         }
@@ -618,17 +999,19 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
         is_local += dst_sig->is_local;
 
         map = (mpr_map)mpr_list_add_item((void**)&g->maps,
-                                         is_local ? sizeof(mpr_local_map_t) : sizeof(mpr_map_t));
+                                         is_local ? sizeof(mpr_local_map_t) : sizeof(mpr_map_t),
+                                         g->slab);
         map->obj.type = MPR_MAP;
         map->obj.graph = g;
         map->obj.id = id;
         map->num_src = num_src;
         map->is_local = 0;
-        map->src = (mpr_slot*)malloc(sizeof(mpr_slot) * num_src);
+        map->src = (mpr_slot*)calloc(num_src, sizeof(mpr_slot));
         for (i = 0; i < num_src; i++)
             map->src[i] = mpr_slot_new(map, src_sigs[i], is_local, 1);
         map->dst = mpr_slot_new(map, dst_sig, is_local, 0);
         mpr_map_init(map);
+        mpr_graph_index_obj(g, (mpr_obj)map);
         ++g->staged_maps;
         rc = 1;
     }
@@ -700,11 +1083,17 @@ mpr_map mpr_graph_add_map(mpr_graph g, mpr_id id, int num_src, const char **src_
 
 void mpr_graph_remove_map(mpr_graph g, mpr_map m, mpr_graph_evt e)
 {
+    int i;
     RETURN_UNLESS(m);
     mpr_list_remove_item((void**)&g->maps, m);
+    _unindex_obj(g, (mpr_obj)m);
     mpr_graph_call_cbs(g, (mpr_obj)m, MPR_MAP, e);
-    mpr_map_free(m);
-    mpr_list_free_item(m);
+    /* detach the map from its signals now, even if it is freed after the pending batch */
+    for (i = 0; m->src && i < m->num_src; i++)
+        mpr_slot_unlink(m->src[i]);
+    if (m->dst)
+        mpr_slot_unlink(m->dst);
+    _release_obj(g, (mpr_obj)m);
 }
 
 void mpr_graph_print(mpr_graph g)
@@ -772,12 +1161,39 @@ static void renew_subscriptions(mpr_graph g, uint32_t time_sec)
     }
 }
 
+/* Returns the number of seconds until the graph next has to renew a subscription or expire a
+ * remote device, or wait if that is sooner. */
+static double _get_next_wait(mpr_graph g, double wait)
+{
+    double now;
+    mpr_time t;
+    mpr_list devs;
+    mpr_subscription s;
+    mpr_time_set(&t, MPR_NOW);
+    now = mpr_time_as_dbl(t);
+
+    /* subscription renewals */
+    for (s = g->subscriptions; s; s = s->next) {
+        if (s->lease_expiration_sec - now < wait)
+            wait = s->lease_expiration_sec - now;
+    }
+    /* expiry of remote devices that have stopped checking in */
+    devs = mpr_list_from_data(g->devs);
+    while (devs) {
+        mpr_dev dev = (mpr_dev)*devs;
+        devs = mpr_list_get_next(devs);
+        if (!dev->is_local && dev->synced.sec && dev->synced.sec + TIMEOUT_SEC + 1 - now < wait)
+            wait = dev->synced.sec + TIMEOUT_SEC + 1 - now;
+    }
+    return wait > 0 ? wait : 0;
+}
+
 int mpr_graph_poll(mpr_graph g, int block_ms)
 {
     mpr_net n = &g->net;
-    int count = 0, status[2], left_ms, elapsed, checked_admin = 0;
+    int count = 0, status[2], wait_ms, admin;
     mpr_time t;
-    double then;
+    double now, end, timer;
 
     mpr_net_poll(n);
     mpr_time_set(&t, MPR_NOW);
@@ -789,31 +1205,77 @@ int mpr_graph_poll(mpr_graph g, int block_ms)
             count = (status[0] > 0) + (status[1] > 0);
             n->msgs_recvd |= count;
         }
+        mpr_graph_call_batch_cbs(g);
         return count;
     }
 
-    then = mpr_get_current_time();
-    left_ms = block_ms;
-    while (left_ms > 0) {
-        if (left_ms > 100)
-            left_ms = 100;
-
-        if (lo_servers_recv_noblock(&n->servers[SERVER_ADMIN], status, 2, left_ms))
-            count += (status[0] > 0) + (status[1] > 0);
-
-        elapsed = (mpr_get_current_time() - then) * 1000;
-        if ((elapsed - checked_admin) > 100) {
+    /* Block until a message arrives, housekeeping is due or block_ms has elapsed. */
+    now = mpr_get_current_time();
+    end = now + block_ms * 0.001;
+    timer = now + _get_next_wait(g, mpr_net_get_next_timer(n));
+    while (1) {
+        wait_ms = (int)ceil(((timer < end ? timer : end) - now) * 1000);
+        if (wait_ms < 0)
+            wait_ms = 0;
+        admin = 0;
+        if (lo_servers_recv_noblock(&n->servers[SERVER_ADMIN], status, 2, wait_ms))
+            admin = (status[0] > 0) + (status[1] > 0);
+
+        now = mpr_get_current_time();
+        if (now >= timer) {
             mpr_time_set(&t, MPR_NOW);
             renew_subscriptions(g, t.sec);
             mpr_net_poll(n);
             _check_dev_status(g, t.sec);
-            checked_admin = elapsed;
         }
-
-        left_ms = block_ms - elapsed;
+        else if (mpr_net_has_queued_msgs(n))
+            mpr_net_send(n);
+        /* received messages may have added remote devices or moved the allocation deadlines */
+        if (admin || now >= timer)
+            timer = now + _get_next_wait(g, mpr_net_get_next_timer(n));
+        count += admin;
+        if (now >= end)
+            break;
     }
 
     n->msgs_recvd |= count;
+    mpr_graph_call_batch_cbs(g);
+    return count;
+}
+
+int mpr_graph_get_fds(mpr_graph g, int *fds, int num)
+{
+    RETURN_ARG_UNLESS(g && num >= 0, 0);
+    return mpr_net_get_fds(&g->net, fds, num);
+}
+
+int mpr_graph_get_poll_timeout(mpr_graph g)
+{
+    double wait;
+    RETURN_ARG_UNLESS(g, -1);
+    /* the caller is about to block, so devices on this host must wake it up when they write to
+     * shared memory */
+    RETURN_ARG_UNLESS(!mpr_net_set_shm_waiting(&g->net, 0, 1), 0);
+    wait = _get_next_wait(g, mpr_net_get_next_wait(&g->net));
+    return (int)ceil(wait * 1000);
+}
+
+int mpr_graph_process_ready(mpr_graph g, const int *fds, int num)
+{
+    mpr_net n;
+    mpr_time t;
+    int count;
+    RETURN_ARG_UNLESS(g, 0);
+    n = &g->net;
+    count = mpr_net_recv_admin(n, fds ? mpr_net_get_ready_servers(n, 0, fds, num) : 0);
+
+    mpr_net_poll(n);
+    mpr_time_set(&t, MPR_NOW);
+    renew_subscriptions(g, t.sec);
+    _check_dev_status(g, t.sec);
+
+    n->msgs_recvd |= count;
+    mpr_graph_call_batch_cbs(g);
     return count;
 }
 
@@ -955,3 +1417,14 @@ const char *mpr_graph_get_address(mpr_graph g)
         g->net.addr.url = lo_address_get_url(g->net.addr.bus);
     return g->net.addr.url;
 }
+
+void mpr_graph_set_mtu(mpr_graph g, int mtu)
+{
+    RETURN_UNLESS(g && mtu >= 0);
+    g->net.mtu = mtu < MAX_UDP_DGRAM_LEN ? mtu : MAX_UDP_DGRAM_LEN;
+}
+
+int mpr_graph_get_mtu(mpr_graph g)
+{
+    return g->net.mtu ? g->net.mtu : DEFAULT_MTU;
+}
@@ -0,0 +1,511 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <zlib.h>
+
+#include "mapper_internal.h"
+#include "types_internal.h"
+#include <mapper/mapper.h>
+
+/* Secondary indexes of graph objects by property value. Hash indexes group objects with equal
+ * values, while ordered indexes sort scalar values so that ranges can be found using a binary
+ * search. Indexes only propose candidates: lists still test each of them using the filter, so an
+ * index may safely return more objects than match.
+ *
+ * Indexes are built on first use. Afterwards the graph reports objects that are added, removed or
+ * modified, and only the entries of those objects are replaced on the next query. */
+
+#define IDX_MIN_BUCKETS 16
+
+typedef struct _mpr_prop_idx_entry {
+    mpr_obj obj;
+    mpr_id id;                      /*!< The id under which the object is indexed by the graph. */
+    union {
+        double num;
+        char *str;
+    } val;                          /*!< Value of ordered entries. */
+    uint32_t hash;                  /*!< Value hash of hashed entries. */
+    int next;                       /*!< Next entry in the same hash bucket, or -1. */
+    mpr_type type;
+    uint8_t has_nan;                /*!< 1 if the value contains NaN. */
+} mpr_prop_idx_entry_t, *mpr_prop_idx_entry;
+
+typedef struct _mpr_prop_idx_change {
+    mpr_obj obj;                    /*!< The changed object, which may since have been freed. */
+    mpr_id id;                      /*!< The id under which the object was indexed by the graph. */
+} mpr_prop_idx_change_t, *mpr_prop_idx_change;
+
+/* Properties may be named by key in filters, so use the symbolic identifier where possible. */
+static const char *_normalize_prop(mpr_prop *p, const char *key)
+{
+    if (key && key[0]) {
+        mpr_prop p2 = mpr_prop_from_str(key);
+        if (MPR_PROP_UNKNOWN == p2 || MPR_PROP_EXTRA == p2) {
+            *p = MPR_PROP_UNKNOWN;
+            return key;
+        }
+        *p = p2;
+    }
+    else
+        *p = MASK_PROP_BITFLAGS(*p);
+    return 0;
+}
+
+static mpr_prop_idx _find_idx(mpr_graph g, mpr_type type, mpr_prop p, const char *key)
+{
+    mpr_prop_idx idx = g->prop_idx;
+    key = _normalize_prop(&p, key);
+    while (idx) {
+        if (idx->type == type && (key ? (idx->key && !strcmp(idx->key, key)) : idx->prop == p))
+            return idx;
+        idx = idx->next;
+    }
+    return 0;
+}
+
+static int _is_indexable(mpr_type type)
+{
+    switch (type) {
+        case MPR_STR:
+        case MPR_INT32:
+        case MPR_FLT:
+        case MPR_DBL:
+        case MPR_TYPE:
+        case MPR_INT64:
+        case MPR_TIME:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* NaN values compare as equal to anything, so indexes cannot be used with them. */
+static int _has_nan(int len, mpr_type type, const void *val)
+{
+    int i;
+    for (i = 0; i < len; i++) {
+        if (MPR_FLT == type && isnan(((float*)val)[i]))
+            return 1;
+        if (MPR_DBL == type && isnan(((double*)val)[i]))
+            return 1;
+    }
+    return 0;
+}
+
+static uint32_t _hash_val(int len, mpr_type type, const void *val)
+{
+    int i;
+    uint32_t hash = crc32(0L, (const Bytef *)&type, sizeof(mpr_type));
+    hash = crc32(hash, (const Bytef *)&len, sizeof(int));
+    for (i = 0; i < len; i++) {
+        switch (type) {
+            case MPR_STR: {
+                const char *s = 1 == len ? (const char*)val : ((const char**)val)[i];
+                if (s)
+                    hash = crc32(hash, (const Bytef *)s, strlen(s) + 1);
+                break;
+            }
+            case MPR_FLT: {
+                /* -0 and 0 are equal */
+                float f = ((float*)val)[i];
+                f = f ? f : 0;
+                hash = crc32(hash, (const Bytef *)&f, sizeof(float));
+                break;
+            }
+            case MPR_DBL: {
+                double d = ((double*)val)[i];
+                d = d ? d : 0;
+                hash = crc32(hash, (const Bytef *)&d, sizeof(double));
+                break;
+            }
+            case MPR_INT32:
+                hash = crc32(hash, (const Bytef *)((int*)val + i), sizeof(int));
+                break;
+            case MPR_TYPE:
+                hash = crc32(hash, (const Bytef *)((mpr_type*)val + i), sizeof(mpr_type));
+                break;
+            default:
+                hash = crc32(hash, (const Bytef *)((uint64_t*)val + i), sizeof(uint64_t));
+                break;
+        }
+    }
+    return hash;
+}
+
+/* Convert a scalar value to a number ordered in the same way as by the list filters. */
+static double _get_num(mpr_type type, const void *val)
+{
+    switch (type) {
+        case MPR_INT32: return *(int*)val;
+        case MPR_FLT:   return *(float*)val;
+        case MPR_DBL:   return *(double*)val;
+        case MPR_TYPE:  return *(mpr_type*)val;
+        default:        return *(uint64_t*)val;
+    }
+}
+
+static int _compare_entries(const void *l, const void *r)
+{
+    mpr_prop_idx_entry a = (mpr_prop_idx_entry)l, b = (mpr_prop_idx_entry)r;
+    if (a->type != b->type)
+        return a->type < b->type ? -1 : 1;
+    if (MPR_STR == a->type)
+        return strcmp(a->val.str, b->val.str);
+    return (a->val.num > b->val.num) - (a->val.num < b->val.num);
+}
+
+static int _compare_changes(const void *l, const void *r)
+{
+    mpr_obj a = ((mpr_prop_idx_change)l)->obj, b = ((mpr_prop_idx_change)r)->obj;
+    return (a > b) - (a < b);
+}
+
+static void _clear_idx(mpr_prop_idx idx)
+{
+    int i;
+    if (idx->ordered) {
+        for (i = 0; i < idx->num_entries; i++) {
+            if (MPR_STR == idx->entries[i].type)
+                free(idx->entries[i].val.str);
+        }
+    }
+    FUNC_IF(free, idx->entries);
+    FUNC_IF(free, idx->buckets);
+    FUNC_IF(free, idx->changes);
+    idx->entries = 0;
+    idx->buckets = 0;
+    idx->changes = 0;
+    idx->num_entries = idx->num_buckets = idx->num_changes = idx->changes_size = 0;
+    idx->has_nan = idx->built = 0;
+}
+
+/* Set an entry from the value of the indexed property of an object. Returns 0 if the object has
+ * no value that can be indexed. */
+static int _set_entry(mpr_prop_idx idx, mpr_prop_idx_entry e, mpr_obj o)
+{
+    int len;
+    mpr_type type;
+    const void *val;
+    mpr_prop p;
+    if (idx->key)
+        p = mpr_obj_get_prop_by_key(o, idx->key, &len, &type, &val, 0);
+    else
+        p = mpr_obj_get_prop_by_idx(o, idx->prop, NULL, &len, &type, &val, 0);
+    if (MPR_PROP_UNKNOWN == p || !val || len < 1 || !_is_indexable(type))
+        return 0;
+    if (idx->ordered) {
+        /* ranges are only defined for scalar values */
+        if (len != 1)
+            return 0;
+        if (MPR_STR == type)
+            e->val.str = strdup((const char*)val);
+        else
+            e->val.num = _get_num(type, val);
+    }
+    else
+        e->hash = _hash_val(len, type, val);
+    e->has_nan = _has_nan(len, type, val);
+    idx->has_nan |= e->has_nan;
+    e->obj = o;
+    e->id = o->idx_id;
+    e->type = type;
+    return 1;
+}
+
+static int _link_buckets(mpr_prop_idx idx)
+{
+    int i, size = IDX_MIN_BUCKETS;
+    /* keep at most one entry per bucket on average */
+    while (size < idx->num_entries)
+        size *= 2;
+    if (size != idx->num_buckets) {
+        int *buckets = (int*)realloc(idx->buckets, size * sizeof(int));
+        RETURN_ARG_UNLESS(buckets, 1);
+        idx->buckets = buckets;
+        idx->num_buckets = size;
+    }
+    for (i = 0; i < idx->num_buckets; i++)
+        idx->buckets[i] = -1;
+    for (i = 0; i < idx->num_entries; i++) {
+        int *b = &idx->buckets[idx->entries[i].hash & (idx->num_buckets - 1)];
+        idx->entries[i].next = *b;
+        *b = i;
+    }
+    return 0;
+}
+
+/* Sort the entries from num_sorted onwards and merge them with the sorted entries before them. */
+static int _merge_entries(mpr_prop_idx idx, int num_sorted)
+{
+    int i = 0, j = num_sorted, k = 0, num = idx->num_entries;
+    mpr_prop_idx_entry e = idx->entries, merged;
+    qsort(e + num_sorted, num - num_sorted, sizeof(mpr_prop_idx_entry_t), _compare_entries);
+    RETURN_ARG_UNLESS(num_sorted && num > num_sorted, 0);
+    merged = (mpr_prop_idx_entry)malloc(num * sizeof(mpr_prop_idx_entry_t));
+    RETURN_ARG_UNLESS(merged, 1);
+    while (i < num_sorted && j < num)
+        merged[k++] = _compare_entries(&e[j], &e[i]) < 0 ? e[j++] : e[i++];
+    while (i < num_sorted)
+        merged[k++] = e[i++];
+    while (j < num)
+        merged[k++] = e[j++];
+    free(idx->entries);
+    idx->entries = merged;
+    return 0;
+}
+
+static int _build_idx(mpr_graph g, mpr_prop_idx idx)
+{
+    int size;
+    mpr_list l = mpr_graph_get_objs(g, idx->type);
+
+    _clear_idx(idx);
+    size = mpr_list_get_size(l);
+    if (size && !(idx->entries = (mpr_prop_idx_entry)malloc(size * sizeof(mpr_prop_idx_entry_t))))
+        return 1;
+    while (l) {
+        mpr_obj o = *l;
+        l = mpr_list_get_next(l);
+        if (!o->is_indexed) {
+            /* candidates could not be checked against the graph later */
+            mpr_list_free(l);
+            return 1;
+        }
+        if (_set_entry(idx, &idx->entries[idx->num_entries], o))
+            ++idx->num_entries;
+    }
+
+    if (idx->ordered)
+        qsort(idx->entries, idx->num_entries, sizeof(mpr_prop_idx_entry_t), _compare_entries);
+    else if (_link_buckets(idx))
+        return 1;
+    idx->built = 1;
+    trace_graph("built %s index of %d objects.\n", idx->ordered ? "ordered" : "hash",
+                idx->num_entries);
+    return 0;
+}
+
+/* Replace the entries of objects changed since the last query. */
+static int _update_idx(mpr_graph g, mpr_prop_idx idx)
+{
+    int i, j, num_kept, num_changes = idx->num_changes;
+    mpr_prop_idx_change_t key;
+    mpr_prop_idx_change c = idx->changes;
+    mpr_prop_idx_entry entries;
+    RETURN_ARG_UNLESS(num_changes, 0);
+
+    /* sort changes by object so that stale entries can be found using a binary search */
+    qsort(c, num_changes, sizeof(mpr_prop_idx_change_t), _compare_changes);
+    idx->has_nan = 0;
+    for (i = 0, j = 0; i < idx->num_entries; i++) {
+        mpr_prop_idx_entry e = &idx->entries[i];
+        key.obj = e->obj;
+        if (bsearch(&key, c, num_changes, sizeof(mpr_prop_idx_change_t), _compare_changes)) {
+            if (idx->ordered && MPR_STR == e->type)
+                free(e->val.str);
+            continue;
+        }
+        idx->has_nan |= e->has_nan;
+        if (i != j)
+            idx->entries[j] = *e;
+        ++j;
+    }
+    num_kept = idx->num_entries = j;
+
+    entries = (mpr_prop_idx_entry)realloc(idx->entries, (num_kept + num_changes)
+                                          * sizeof(mpr_prop_idx_entry_t));
+    RETURN_ARG_UNLESS(entries, 1);
+    idx->entries = entries;
+    for (i = 0; i < num_changes; i = j) {
+        /* an object may have been recorded more than once, possibly under different ids */
+        int found = 0;
+        for (j = i; j < num_changes && c[j].obj == c[i].obj; j++)
+            found |= mpr_graph_has_obj(g, idx->type, c[j].obj, c[j].id);
+        if (found && _set_entry(idx, &idx->entries[idx->num_entries], c[i].obj))
+            ++idx->num_entries;
+    }
+    idx->num_changes = 0;
+
+    if (idx->ordered ? _merge_entries(idx, num_kept) : _link_buckets(idx))
+        return 1;
+    trace_graph("updated %s index with %d changed objects.\n", idx->ordered ? "ordered" : "hash",
+                num_changes);
+    return 0;
+}
+
+void mpr_graph_touch_obj(mpr_graph g, mpr_obj o)
+{
+    mpr_prop_idx idx;
+    RETURN_UNLESS(o->is_indexed);
+    for (idx = g->prop_idx; idx; idx = idx->next) {
+        mpr_prop_idx_change c;
+        if (idx->type != o->type || !idx->built)
+            continue;
+        if (idx->num_changes >= idx->num_entries / 2 + IDX_MIN_BUCKETS) {
+            /* rebuilding is cheaper than replacing most entries */
+            _clear_idx(idx);
+            continue;
+        }
+        if (idx->num_changes == idx->changes_size) {
+            int size = idx->changes_size ? idx->changes_size * 2 : IDX_MIN_BUCKETS;
+            c = (mpr_prop_idx_change)realloc(idx->changes, size * sizeof(mpr_prop_idx_change_t));
+            if (!c) {
+                _clear_idx(idx);
+                continue;
+            }
+            idx->changes = c;
+            idx->changes_size = size;
+        }
+        c = &idx->changes[idx->num_changes++];
+        c->obj = o;
+        c->id = o->idx_id;
+    }
+}
+
+/* Find the first entry not ordered before the value, or after it if after is set. */
+static int _bound(mpr_prop_idx idx, mpr_type type, const void *val, int after)
+{
+    int lo = 0, hi = idx->num_entries;
+    mpr_prop_idx_entry_t e;
+    e.type = type;
+    if (MPR_STR == type)
+        e.val.str = (char*)val;
+    else
+        e.val.num = _get_num(type, val);
+    while (lo < hi) {
+        int mid = (lo + hi) / 2, cmp = _compare_entries(&idx->entries[mid], &e);
+        if (cmp < 0 || (after && !cmp))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+int mpr_graph_get_index_candidates(mpr_graph g, mpr_type type, mpr_prop p, const char *key,
+                                   int len, mpr_type val_type, const void *val, mpr_op op,
+                                   mpr_obj **objs, mpr_id **ids)
+{
+    int i, num = 0, beg, end;
+    mpr_prop_idx idx;
+    RETURN_ARG_UNLESS(g->prop_idx && (idx = _find_idx(g, type, p, key)), -1);
+    RETURN_ARG_UNLESS(val && len > 0 && _is_indexable(val_type), -1);
+    RETURN_ARG_UNLESS(!_has_nan(len, val_type, val), -1);
+    if (idx->ordered) {
+        RETURN_ARG_UNLESS(1 == len && op >= MPR_OP_EQ && op <= MPR_OP_LTE && MPR_OP_EX != op, -1);
+    }
+    else
+        RETURN_ARG_UNLESS(MPR_OP_EQ == op, -1);
+    if (MPR_STR == val_type) {
+        /* filters treat strings containing wildcards as patterns */
+        for (i = 0; i < len; i++) {
+            const char *s = 1 == len ? (const char*)val : ((const char**)val)[i];
+            RETURN_ARG_UNLESS(s && !strchr(s, '*'), -1);
+        }
+    }
+    if (idx->built ? _update_idx(g, idx) : _build_idx(g, idx)) {
+        _clear_idx(idx);
+        return -1;
+    }
+    if (idx->has_nan && (MPR_FLT == val_type || MPR_DBL == val_type))
+        return -1;
+
+    *objs = 0;
+    *ids = 0;
+    if (idx->ordered) {
+        /* bounds are inclusive since 64-bit integers may be rounded */
+        if (MPR_OP_LT == op || MPR_OP_LTE == op) {
+            /* entries are sorted by type first, so stop at the first entry of another type */
+            end = _bound(idx, val_type, val, 1);
+            for (beg = end; beg > 0 && idx->entries[beg - 1].type == val_type; beg--) ;
+        }
+        else {
+            beg = _bound(idx, val_type, val, 0);
+            if (MPR_OP_EQ == op)
+                end = _bound(idx, val_type, val, 1);
+            else {
+                for (end = beg; end < idx->num_entries && idx->entries[end].type == val_type;
+                     end++) ;
+            }
+        }
+        RETURN_ARG_UNLESS(end > beg, 0);
+        *objs = (mpr_obj*)malloc((end - beg) * sizeof(mpr_obj));
+        *ids = (mpr_id*)malloc((end - beg) * sizeof(mpr_id));
+        for (i = beg; i < end; i++, num++) {
+            (*objs)[num] = idx->entries[i].obj;
+            (*ids)[num] = idx->entries[i].id;
+        }
+    }
+    else {
+        uint32_t hash;
+        RETURN_ARG_UNLESS(idx->num_buckets, 0);
+        hash = _hash_val(len, val_type, val);
+        for (i = idx->buckets[hash & (idx->num_buckets - 1)]; i >= 0; i = idx->entries[i].next) {
+            if (idx->entries[i].hash != hash)
+                continue;
+            if (!(num & (num - 1))) {
+                /* grow arrays when num reaches a power of two */
+                int size = num ? num * 2 : 1;
+                *objs = (mpr_obj*)realloc(*objs, size * sizeof(mpr_obj));
+                *ids = (mpr_id*)realloc(*ids, size * sizeof(mpr_id));
+            }
+            (*objs)[num] = idx->entries[i].obj;
+            (*ids)[num] = idx->entries[i].id;
+            ++num;
+        }
+    }
+    return num;
+}
+
+int mpr_graph_add_index(mpr_graph g, mpr_type type, mpr_prop p, const char *key, int ordered)
+{
+    mpr_prop_idx idx;
+    RETURN_ARG_UNLESS(g && (MPR_DEV == type || MPR_SIG == type || MPR_MAP == type), 1);
+    key = _normalize_prop(&p, key);
+    RETURN_ARG_UNLESS(key || (p > MPR_PROP_UNKNOWN && p <= PROP_LAST && p != MPR_PROP_EXTRA), 1);
+    if ((idx = _find_idx(g, type, p, key))) {
+        if (idx->ordered != (ordered ? 1 : 0)) {
+            _clear_idx(idx);
+            idx->ordered = ordered ? 1 : 0;
+        }
+        return 0;
+    }
+    idx = (mpr_prop_idx)calloc(1, sizeof(mpr_prop_idx_t));
+    RETURN_ARG_UNLESS(idx, 1);
+    idx->type = type;
+    idx->prop = p;
+    idx->key = key ? strdup(key) : 0;
+    idx->ordered = ordered ? 1 : 0;
+    idx->next = g->prop_idx;
+    g->prop_idx = idx;
+    return 0;
+}
+
+int mpr_graph_remove_index(mpr_graph g, mpr_type type, mpr_prop p, const char *key)
+{
+    mpr_prop_idx *idx;
+    RETURN_ARG_UNLESS(g, 1);
+    key = _normalize_prop(&p, key);
+    for (idx = &g->prop_idx; *idx; idx = &(*idx)->next) {
+        mpr_prop_idx rem = *idx;
+        if (rem->type != type || (key ? (!rem->key || strcmp(rem->key, key)) : rem->prop != p))
+            continue;
+        *idx = rem->next;
+        _clear_idx(rem);
+        FUNC_IF(free, rem->key);
+        free(rem);
+        return 0;
+    }
+    return 1;
+}
+
+void mpr_graph_free_indexes(mpr_graph g)
+{
+    while (g->prop_idx) {
+        mpr_prop_idx idx = g->prop_idx;
+        g->prop_idx = idx->next;
+        _clear_idx(idx);
+        FUNC_IF(free, idx->key);
+        free(idx);
+    }
+}
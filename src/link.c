@@ -1,3 +1,5 @@
+#include "config.h"
+
 #include <string.h>
 #include <math.h>
 #include <stdlib.h>
@@ -5,6 +7,17 @@
 #include <stddef.h>
 #include <limits.h>
 
+#ifdef HAVE_ARPA_INET_H
+ #include <arpa/inet.h>
+ #include <sys/socket.h>
+ #include <netdb.h>
+#else
+ #ifdef HAVE_WINSOCK2_H
+  #include <winsock2.h>
+  #include <ws2tcpip.h>
+ #endif
+#endif
+
 #include "mapper_internal.h"
 #include "types_internal.h"
 #include <mapper/mapper.h>
@@ -14,6 +27,12 @@ mpr_link mpr_link_new(mpr_local_dev local_dev, mpr_dev remote_dev)
     return mpr_graph_add_link(local_dev->obj.graph, (mpr_dev)local_dev, remote_dev);
 }
 
+/* Returns the data server of the local device of the link at index idx. */
+static lo_server _get_server(mpr_link link, int idx)
+{
+    return ((mpr_local_dev)link->devs[LOCAL_DEV])->servers[idx];
+}
+
 void mpr_link_init(mpr_link link)
 {
     mpr_net net = &link->obj.graph->net;
@@ -23,13 +42,13 @@ void mpr_link_init(mpr_link link)
     if (!link->num_maps)
         link->num_maps = (int*)calloc(1, sizeof(int) * 2);
     if (!link->obj.props.synced) {
-        mpr_tbl t = link->obj.props.synced = mpr_tbl_new();
+        mpr_tbl t = link->obj.props.synced = mpr_tbl_new(link->obj.graph->strings);
         mpr_tbl_link(t, MPR_PROP_DEV, 2, MPR_DEV, &link->devs, NON_MODIFIABLE | LOCAL_ACCESS_ONLY);
         mpr_tbl_link(t, MPR_PROP_ID, 1, MPR_INT64, &link->obj.id, NON_MODIFIABLE);
         mpr_tbl_link(t, MPR_PROP_NUM_MAPS, 2, MPR_INT32, &link->num_maps, NON_MODIFIABLE | INDIRECT);
     }
     if (!link->obj.props.staged)
-        link->obj.props.staged = mpr_tbl_new();
+        link->obj.props.staged = mpr_tbl_new(link->obj.graph->strings);
 
     if (!link->obj.id && link->devs[LOCAL_DEV]->is_local)
         link->obj.id = mpr_dev_generate_unique_id(link->devs[LOCAL_DEV]);
@@ -55,22 +74,96 @@ void mpr_link_init(mpr_link link)
     mpr_net_send(net);
 }
 
-void mpr_link_connect(mpr_link link, const char *host, int admin_port,
+/* Resolve the remote data address once so that serialized bundles can be sent directly on the
+ * UDP server socket. */
+static void _resolve_udp_addr(mpr_link link, const char *host, const char *port)
+{
+    struct addrinfo hints, *res = 0;
+    FUNC_IF(free, link->addr.udp_sa);
+    link->addr.udp_sa = 0;
+    link->addr.udp_sa_len = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    if (getaddrinfo(host, port, &hints, &res) || !res) {
+        trace_net("couldn't resolve address %s:%s, using liblo bundles.\n", host, port);
+        return;
+    }
+    link->addr.udp_sa = malloc(res->ai_addrlen);
+    memcpy(link->addr.udp_sa, res->ai_addr, res->ai_addrlen);
+    link->addr.udp_sa_len = (int)res->ai_addrlen;
+    freeaddrinfo(res);
+}
+
+static void _free_shm(mpr_link link)
+{
+    FUNC_IF(mpr_shm_free, link->shm.rx);
+    FUNC_IF(mpr_shm_free, link->shm.tx);
+    link->shm.rx = link->shm.tx = 0;
+}
+
+/* Datagrams for shared memory maps are written to a ring created by the receiving device, so
+ * each end of a link between devices on the same host creates the ring for its incoming
+ * datagrams once it has a shared memory map, and opens the one created by its peer. */
+static void _init_shm(mpr_link link, const char *host_id)
+{
+    const char *local_host_id = mpr_shm_get_host_id();
+    _free_shm(link);
+    link->shm.same_host = (   local_host_id && host_id && !strcmp(local_host_id, host_id)
+                           && !mpr_link_get_is_in_process(link));
+}
+
+void mpr_link_use_shm(mpr_link link)
+{
+    RETURN_UNLESS(link && link->shm.same_host);
+    if (!link->shm.rx) {
+        link->shm.rx = mpr_shm_new(link->devs[LOCAL_DEV]->obj.id, link->devs[REMOTE_DEV]->obj.id,
+                                   SHM_RING_SIZE);
+        if (!link->shm.rx)
+            trace_dev(link->devs[LOCAL_DEV], "couldn't create shared memory ring.\n");
+    }
+    mpr_link_open_shm(link);
+}
+
+void mpr_link_open_shm(mpr_link link)
+{
+    RETURN_UNLESS(link->shm.same_host && !link->shm.tx);
+    link->shm.tx = mpr_shm_open(link->devs[REMOTE_DEV]->obj.id, link->devs[LOCAL_DEV]->obj.id);
+    if (link->shm.tx)
+        trace_dev(link->devs[LOCAL_DEV], "opened shared memory ring to device '%s'\n",
+                  link->devs[REMOTE_DEV]->name);
+}
+
+void mpr_link_connect(mpr_link link, const char *host, const char *host_id, int admin_port,
                       int data_port)
 {
+    int i;
     char str[16];
     mpr_tbl_set(link->devs[REMOTE_DEV]->obj.props.synced, MPR_PROP_HOST, NULL, 1,
                 MPR_STR, host, REMOTE_MODIFY);
+    if (host_id)
+        mpr_tbl_set(link->devs[REMOTE_DEV]->obj.props.synced, MPR_PROP_HOST_ID, NULL, 1,
+                    MPR_STR, host_id, REMOTE_MODIFY);
     mpr_tbl_set(link->devs[REMOTE_DEV]->obj.props.synced, MPR_PROP_PORT, NULL, 1,
                 MPR_INT32, &data_port, REMOTE_MODIFY);
     sprintf(str, "%d", data_port);
     link->addr.udp = lo_address_new(host, str);
     link->addr.tcp = lo_address_new_with_proto(LO_TCP, host, str);
+    if (!mpr_link_get_is_in_process(link))
+        _resolve_udp_addr(link, host, str);
     sprintf(str, "%d", admin_port);
     link->addr.admin = lo_address_new(host, str);
     trace_dev(link->devs[LOCAL_DEV], "activated router to device '%s' at %s:%d\n",
               link->devs[REMOTE_DEV]->name, host, data_port);
+    for (i = 0; i < NUM_BUNDLES; i++) {
+        FUNC_IF(free, link->bundles[i].buf.data);
+        FUNC_IF(free, link->bundles[i].buf.ends);
+        FUNC_IF(free, link->bundles[i].shm.data);
+        FUNC_IF(free, link->bundles[i].shm.ends);
+    }
     memset(link->bundles, 0, sizeof(mpr_bundle_t) * NUM_BUNDLES);
+    _init_shm(link, host_id);
     mpr_dev_add_link(link->devs[LOCAL_DEV], link->devs[REMOTE_DEV]);
 }
 
@@ -85,47 +178,334 @@ void mpr_link_free(mpr_link link)
     FUNC_IF(lo_address_free, link->addr.admin);
     FUNC_IF(lo_address_free, link->addr.udp);
     FUNC_IF(lo_address_free, link->addr.tcp);
+    FUNC_IF(free, link->addr.udp_sa);
+    _free_shm(link);
     for (i = 0; i < NUM_BUNDLES; i++) {
         FUNC_IF(lo_bundle_free_recursive, link->bundles[i].udp);
         FUNC_IF(lo_bundle_free_recursive, link->bundles[i].tcp);
+        FUNC_IF(free, link->bundles[i].buf.data);
+        FUNC_IF(free, link->bundles[i].buf.ends);
+        FUNC_IF(free, link->bundles[i].shm.data);
+        FUNC_IF(free, link->bundles[i].shm.ends);
     }
     mpr_dev_remove_link(link->devs[LOCAL_DEV], link->devs[REMOTE_DEV]);
 }
 
+/* Reserve space for a message in a serialized bundle buffer. A new bundle is started if the
+ * buffer is empty or if adding the message would exceed the mtu; each bundle will be sent as a
+ * separate datagram. The buffer is only grown, so steady-state use does not allocate. */
+static char *_buf_reserve(mpr_buffer b, size_t len, mpr_time t, size_t mtu)
+{
+    uint32_t u;
+    char *ptr;
+    size_t needed;
+    if (b->len > b->start && b->len - b->start + len + 4 > mtu) {
+        /* close the current bundle */
+        if (b->num_dgrams == b->max_dgrams) {
+            int max = b->max_dgrams ? b->max_dgrams * 2 : 4;
+            size_t *ends = (size_t*)realloc(b->ends, max * sizeof(size_t));
+            RETURN_ARG_UNLESS(ends, 0);
+            b->ends = ends;
+            b->max_dgrams = max;
+        }
+        b->ends[b->num_dgrams++] = b->len;
+        b->start = b->len;
+    }
+    needed = b->len + len + (b->len > b->start ? 4 : 20);
+    if (needed > b->size) {
+        size_t size = b->size ? b->size : 1024;
+        while (size < needed)
+            size *= 2;
+        ptr = (char*)realloc(b->data, size);
+        RETURN_ARG_UNLESS(ptr, 0);
+        b->data = ptr;
+        b->size = size;
+    }
+    if (b->len == b->start) {
+        ptr = b->data + b->start;
+        memcpy(ptr, "#bundle", 8);
+        u = lo_htoo32(t.sec);
+        memcpy(ptr + 8, &u, 4);
+        u = lo_htoo32(t.frac);
+        memcpy(ptr + 12, &u, 4);
+        b->len += 16;
+    }
+    u = lo_htoo32((uint32_t)len);
+    memcpy(b->data + b->len, &u, 4);
+    ptr = b->data + b->len + 4;
+    b->len += len + 4;
+    ++b->num_msgs;
+    return ptr;
+}
+
+static void _buf_reset(mpr_buffer b)
+{
+    b->len = b->start = 0;
+    b->num_dgrams = b->num_msgs = 0;
+}
+
+/* Queue each bundle in the buffer, starting with bundle first, as a separate datagram. The
+ * buffer is reset when the queue is sent by mpr_link_send_dgrams(). */
+static void _buf_queue(mpr_buffer b, mpr_net net, mpr_link link, int first)
+{
+    int i, num = b->num_dgrams + 1 - first;
+    size_t start = first ? b->ends[first - 1] : 0;
+    mpr_dgram d;
+    if (net->dgrams.num + num > net->dgrams.size) {
+        int size = net->dgrams.size ? net->dgrams.size : 16;
+        while (size < net->dgrams.num + num)
+            size *= 2;
+        d = (mpr_dgram)realloc(net->dgrams.queue, size * sizeof(mpr_dgram_t));
+        RETURN_UNLESS(d);
+        net->dgrams.queue = d;
+        net->dgrams.size = size;
+        mpr_dev_rt_miss((mpr_local_dev)link->devs[LOCAL_DEV]);
+    }
+    for (i = first; i <= b->num_dgrams; i++) {
+        size_t end = i < b->num_dgrams ? b->ends[i] : b->len;
+        d = &net->dgrams.queue[net->dgrams.num++];
+        d->data = b->data + start;
+        d->len = end - start;
+        d->addr = link->addr.udp_sa;
+        d->addr_len = link->addr.udp_sa_len;
+        d->buf = b;
+        start = end;
+    }
+}
+
+/* Send all datagrams queued by mpr_link_process_bundles() on the data socket of the device. */
+int mpr_link_send_dgrams(mpr_net net, mpr_local_dev dev)
+{
+    int i, num = net->dgrams.num;
+    mpr_dgram q = net->dgrams.queue;
+    RETURN_ARG_UNLESS(num, 0);
+    mpr_net_send_dgrams(&net->dgrams.stats, lo_server_get_socket_fd(dev->servers[SERVER_UDP]), q,
+                        num);
+
+    /* reset the link buffers for reuse */
+    for (i = 0; i < num; i++)
+        _buf_reset(q[i].buf);
+    net->dgrams.num = 0;
+    return num;
+}
+
+/* Wake up a remote device waiting for datagrams in its shared memory ring by sending it an empty
+ * bundle, since it may be blocked on its sockets. */
+static void _wake_shm(mpr_link link)
+{
+    static const char bundle[16] = {'#', 'b', 'u', 'n', 'd', 'l', 'e', 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    sendto(lo_server_get_socket_fd(_get_server(link, SERVER_UDP)), bundle, 16, 0,
+           (struct sockaddr*)link->addr.udp_sa, link->addr.udp_sa_len);
+}
+
+/* Write each bundle in the buffer to the remote device's shared memory ring. Bundles that do not
+ * fit, for example if the remote device has stopped reading, are queued as UDP datagrams. */
+static void _buf_write_shm(mpr_buffer b, mpr_net net, mpr_link link)
+{
+    int i, res = 0, wake = 0;
+    size_t start = 0;
+    for (i = 0; i <= b->num_dgrams && link->shm.tx; i++) {
+        size_t end = i < b->num_dgrams ? b->ends[i] : b->len;
+        if ((res = mpr_shm_write(link->shm.tx, b->data + start, end - start)) < 1)
+            break;
+        wake |= 2 == res;
+        start = end;
+    }
+    if (wake)
+        _wake_shm(link);
+    if (res < 0) {
+        /* the ring will be opened again if the remote device creates a new one */
+        trace_dev(link->devs[LOCAL_DEV], "shared memory ring to device '%s' was closed.\n",
+                  link->devs[REMOTE_DEV]->name);
+        mpr_shm_free(link->shm.tx);
+        link->shm.tx = 0;
+    }
+    if (i <= b->num_dgrams)
+        _buf_queue(b, net, link, i);
+    else
+        _buf_reset(b);
+}
+
+int mpr_link_recv_shm(mpr_link link)
+{
+    int count = 0;
+    size_t len;
+    const void *data;
+    lo_server server;
+    RETURN_ARG_UNLESS(link->shm.rx && (server = _get_server(link, SERVER_UDP)), 0);
+    while ((data = mpr_shm_peek(link->shm.rx, &len))) {
+        lo_server_dispatch_data(server, (void*)data, len);
+        mpr_shm_release(link->shm.rx);
+        ++count;
+    }
+    return count;
+}
+
+/* Returns a pointer to len bytes in the link's serialized UDP bundle, or 0 if messages for this
+ * link and protocol must be queued using mpr_link_add_msg() instead. Messages for shared memory
+ * maps are kept in a separate bundle, or sent using UDP until the remote ring has been opened. */
+char *mpr_link_reserve_msg(mpr_link link, mpr_proto proto, size_t len, mpr_time t, int idx)
+{
+    mpr_buffer b = &link->bundles[idx].buf;
+    size_t size, mtu = mpr_graph_get_mtu(link->obj.graph);
+    int max_dgrams;
+    char *ptr;
+    RETURN_ARG_UNLESS((MPR_PROTO_UDP == proto || MPR_PROTO_SHM == proto) && link->addr.udp_sa, 0);
+    RETURN_ARG_UNLESS(!mpr_link_get_is_in_process(link), 0);
+    if (MPR_PROTO_SHM == proto && link->shm.tx) {
+        b = &link->bundles[idx].shm;
+        mtu = SHM_MAX_DGRAM;
+    }
+    size = b->size;
+    max_dgrams = b->max_dgrams;
+    ptr = _buf_reserve(b, len, t, mtu);
+    if (b->size != size || b->max_dgrams != max_dgrams)
+        mpr_dev_rt_miss((mpr_local_dev)link->devs[LOCAL_DEV]);
+    return ptr;
+}
+
+static void _buf_grow(mpr_buffer b, size_t size, int num_msgs)
+{
+    if (size > b->size) {
+        char *data = (char*)realloc(b->data, size);
+        RETURN_UNLESS(data);
+        b->data = data;
+        b->size = size;
+    }
+    if (num_msgs > b->max_dgrams) {
+        size_t *ends = (size_t*)realloc(b->ends, num_msgs * sizeof(size_t));
+        RETURN_UNLESS(ends);
+        b->ends = ends;
+        b->max_dgrams = num_msgs;
+    }
+}
+
+void mpr_link_reserve_bufs(mpr_link link, size_t size, int num_msgs)
+{
+    int i;
+    for (i = 0; i < NUM_BUNDLES; i++) {
+        _buf_grow(&link->bundles[i].buf, size, num_msgs);
+        if (link->shm.same_host)
+            _buf_grow(&link->bundles[i].shm, size, num_msgs);
+    }
+}
+
+void mpr_link_reserve_dgrams(mpr_net net, int num)
+{
+    mpr_dgram d;
+    RETURN_UNLESS(num > net->dgrams.size);
+    d = (mpr_dgram)realloc(net->dgrams.queue, num * sizeof(mpr_dgram_t));
+    RETURN_UNLESS(d);
+    net->dgrams.queue = d;
+    net->dgrams.size = num;
+}
+
 /* note on memory handling of mpr_link_add_msg():
- * message: will be owned, will be freed when done */
-void mpr_link_add_msg(mpr_link link, mpr_sig dst, lo_message msg, mpr_time t, mpr_proto proto, int idx)
+ * message: will be owned, will be freed when done
+ * For in-process links no protocol is involved, so the udp and tcp bundles instead hold the
+ * messages for the LOCAL_DEV and REMOTE_DEV ends of the link respectively; they are delivered by
+ * calling the handlers of the destination device directly in mpr_link_process_bundles(). */
+void mpr_link_add_msg(mpr_link link, mpr_dev dst, const char *path, lo_message msg, mpr_time t,
+                      mpr_proto proto, int idx)
 {
     lo_bundle *b;
+    char *ptr;
+    size_t len;
     RETURN_UNLESS(msg);
-    if (link->devs[0] == link->devs[1])
-        proto = MPR_PROTO_UDP;
+    if (mpr_link_get_is_in_process(link)) {
+        b = dst == link->devs[LOCAL_DEV] ? &link->bundles[idx].udp : &link->bundles[idx].tcp;
+        if (!(*b))
+            *b = lo_bundle_new(t);
+        lo_bundle_add_message(*b, path, msg);
+        return;
+    }
+
+    /* serialize into the reusable bundle buffer if possible */
+    len = lo_message_length(msg, path);
+    if ((ptr = mpr_link_reserve_msg(link, proto, len, t, idx))) {
+        lo_message_serialise(msg, path, ptr, &len);
+        lo_message_free(msg);
+        return;
+    }
 
     /* add message to existing bundles */
+    if (MPR_PROTO_SHM == proto)
+        proto = MPR_PROTO_UDP;
     b = (proto == MPR_PROTO_UDP) ? &link->bundles[idx].udp : &link->bundles[idx].tcp;
+    if (   *b && MPR_PROTO_UDP == proto
+        && lo_bundle_length(*b) + len + 4 > mpr_graph_get_mtu(link->obj.graph)) {
+        /* send the full bundle now rather than exceeding the mtu */
+        lo_send_bundle_from(link->addr.udp, _get_server(link, SERVER_UDP), *b);
+        lo_bundle_free_recursive(*b);
+        *b = 0;
+    }
     if (!(*b))
         *b = lo_bundle_new(t);
-    lo_bundle_add_message(*b, dst->path, msg);
+    lo_bundle_add_message(*b, path, msg);
+}
+
+/* Deliver the messages in bundle lb to the signals of the local device dev by calling their
+ * handlers directly instead of sending them over the network. Returns the number of messages. */
+static int _dispatch_bundle(mpr_link link, mpr_local_dev dev, lo_bundle lb)
+{
+    int i, num = lo_bundle_count(lb);
+    const char *path;
+    /* set out-of-band timestamp */
+    mpr_dev_bundle_start(lo_bundle_get_timestamp(lb), NULL);
+    for (i = 0; i < num; i++) {
+        lo_message m = lo_bundle_get_message(lb, i, &path);
+        mpr_rtr_sig rs;
+        mpr_local_sig sig = mpr_dev_get_sig_by_alias(dev, path);
+        if (sig) {
+            mpr_dev_handler(NULL, lo_message_get_types(m), lo_message_get_argv(m),
+                            lo_message_get_argc(m), m, (void*)sig);
+            continue;
+        }
+        /* need to look up signal by path: paths are interned, so they can be compared by
+         * pointer and no signal can match a path that is not in the string table */
+        path = mpr_strtab_find(link->obj.graph->strings, path);
+        rs = path ? link->obj.graph->net.rtr->sigs : 0;
+        while (rs) {
+            if (rs->sig->dev == dev && path == rs->sig->path) {
+                mpr_dev_handler(NULL, lo_message_get_types(m), lo_message_get_argv(m),
+                                lo_message_get_argc(m), m, (void*)rs->sig);
+                break;
+            }
+            rs = rs->next;
+        }
+    }
+    lo_bundle_free_recursive(lb);
+    return num;
 }
 
-/* TODO: pass in bundle index as argument */
-/* TODO: interrupt driven signal updates may not be followed by mpr_dev_process_outputs(); in the
- * case where the interrupt has interrupted mpr_dev_poll() these messages will not be dispatched. */
+/* Send the bundle at index idx. Signal updates made by interrupts while the device is busy are
+ * deferred by mpr_dev_queue_update(), and updates made while this bundle is being sent are added
+ * to the next one, so neither can be left in a bundle that has already been dispatched. */
 int mpr_link_process_bundles(mpr_link link, mpr_time t, int idx)
 {
-    int i = 0, num = 0, tmp;
+    int num = 0, tmp;
     mpr_bundle b;
     lo_bundle lb;
     RETURN_ARG_UNLESS(link, 0);
 
     b = &link->bundles[idx];
 
-    if (link->devs[0] != link->devs[1]) {
+    if (!mpr_link_get_is_in_process(link)) {
         mpr_net n = &link->obj.graph->net;
+        if (b->buf.len) {
+            /* sent along with other links by mpr_link_send_dgrams() */
+            num = b->buf.num_msgs;
+            _buf_queue(&b->buf, n, link, 0);
+        }
+        if (b->shm.len) {
+            num += b->shm.num_msgs;
+            _buf_write_shm(&b->shm, n, link);
+        }
         if ((lb = b->udp)) {
             b->udp = 0;
-            if ((num = lo_bundle_count(lb))) {
-                lo_send_bundle_from(link->addr.udp, n->servers[SERVER_UDP], lb);
+            if ((tmp = lo_bundle_count(lb))) {
+                num += tmp;
+                lo_send_bundle_from(link->addr.udp, _get_server(link, SERVER_UDP), lb);
             }
             lo_bundle_free_recursive(lb);
         }
@@ -133,33 +513,20 @@ int mpr_link_process_bundles(mpr_link link, mpr_time t, int idx)
             b->tcp = 0;
             if ((tmp = lo_bundle_count(lb))) {
                 num += tmp;
-                lo_send_bundle_from(link->addr.tcp, n->servers[SERVER_TCP], lb);
+                lo_send_bundle_from(link->addr.tcp, _get_server(link, SERVER_TCP), lb);
             }
             lo_bundle_free_recursive(lb);
         }
+        return num;
     }
-    else if ((lb = b->udp)) {
-        const char *path;
+    /* bundles are detached first since the handlers may add messages to this link */
+    if ((lb = b->udp)) {
         b->udp = 0;
-        /* set out-of-band timestamp */
-        mpr_dev_bundle_start(lo_bundle_get_timestamp(lb), NULL);
-        /* call handler directly instead of sending over the network */
-        num = lo_bundle_count(lb);
-        while (i < num) {
-            lo_message m = lo_bundle_get_message(lb, i, &path);
-            /* need to look up signal by path */
-            mpr_rtr_sig rs = link->obj.graph->net.rtr->sigs;
-            while (rs) {
-                if (0 == strcmp(path, rs->sig->path)) {
-                    mpr_dev_handler(NULL, lo_message_get_types(m), lo_message_get_argv(m),
-                                    lo_message_get_argc(m), m, (void*)rs->sig);
-                    break;
-                }
-                rs = rs->next;
-            }
-            ++i;
-        }
-        lo_bundle_free_recursive(lb);
+        num = _dispatch_bundle(link, (mpr_local_dev)link->devs[LOCAL_DEV], lb);
+    }
+    if ((lb = b->tcp)) {
+        b->tcp = 0;
+        num += _dispatch_bundle(link, (mpr_local_dev)link->devs[REMOTE_DEV], lb);
     }
     return num;
 }
@@ -217,3 +584,8 @@ int mpr_link_get_is_local(mpr_link link)
 {
     return link->devs[0]->is_local || link->devs[1]->is_local;
 }
+
+int mpr_link_get_is_in_process(mpr_link link)
+{
+    return link->devs[0]->is_local && link->devs[1]->is_local;
+}
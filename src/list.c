@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stddef.h>
+#include <limits.h>
 
 #include "mapper_internal.h"
 
@@ -48,14 +49,22 @@ typedef int query_compare_func_t(const void *ctx_data, const void *item);
 /*! Function for freeing query context */
 typedef void query_free_func_t(mpr_list_header_t *lh);
 
+/*! Function for walking a narrower chain of candidates than the whole list, returning the first
+ *  candidate if item is null or else the candidate following item. */
+typedef void *query_next_func_t(const void *ctx_data, void *item);
+
 /*! Function for handling parallel queries. */
 static int cmp_parallel_query(const void *ctx_data, const void *dev);
 
+/*! Function for filtering objects by property. */
+static int filter_by_prop(const void *ctx, mpr_obj o);
+
 /*! Contains some function pointers and data for handling query context. */
 typedef struct _query_info {
     unsigned int size;
     query_compare_func_t *query_compare;
     query_free_func_t *query_free;
+    query_next_func_t *query_next;  /*!< Optional, the query walks the whole list if null. */
     int *data; /* stub */
 } query_info_t;
 
@@ -63,7 +72,7 @@ typedef struct _query_info {
 
 /*! Reserve memory for a list item.  Reserves an extra pointer at the
  *  beginning of the structure to allow for a list pointer. */
-static mpr_list_header_t* mpr_list_new_item(size_t size)
+static mpr_list_header_t* mpr_list_new_item(size_t size, mpr_slab slab)
 {
     mpr_list_header_t *lh=0;
 
@@ -75,7 +84,7 @@ static mpr_list_header_t* mpr_list_new_item(size_t size)
                "unexpected offset for data in mpr_list_header_t");
 
     size += LIST_HEADER_SIZE;
-    lh = calloc(1, size);
+    lh = mpr_slab_calloc(slab, size);
     RETURN_ARG_UNLESS(lh, 0);
     lh->self = &lh->data;
     lh->start = &lh->self;
@@ -126,9 +135,9 @@ static void *mpr_list_prepend_item(void *item, void **list)
     return item;
 }
 
-void *mpr_list_add_item(void **list, size_t size)
+void *mpr_list_add_item(void **list, size_t size, mpr_slab slab)
 {
-    mpr_list_header_t* lh = mpr_list_new_item(size);
+    mpr_list_header_t* lh = mpr_list_new_item(size, slab);
     mpr_list_prepend_item(lh, list);
     return lh;
 }
@@ -154,7 +163,13 @@ void mpr_list_remove_item(void **head, void *item)
 void mpr_list_free_item(void *item)
 {
     if (item)
-        free(mpr_list_header_by_data(item));
+        mpr_slab_release(mpr_list_header_by_data(item));
+}
+
+/*! Get the memory pool used by the items of a list. */
+static mpr_slab mpr_list_get_slab(const void **list)
+{
+    return *list ? mpr_slab_get_owner(mpr_list_header_by_data(*list)) : 0;
 }
 
 /** Structures and functions for performing dynamic queries **/
@@ -163,13 +178,29 @@ void mpr_list_free_item(void *item)
  * format and query continuation. Functions specific to particular
  * queries are defined further down with their compare operation. */
 
+/*! Get the candidate following item in a query. */
+static void *query_next_candidate(query_info_t *ctx, void *item)
+{
+    if (ctx->query_next)
+        return ctx->query_next(&ctx->data, item);
+    return mpr_list_get_next_internal(item);
+}
+
+/*! Get the first candidate of a query. */
+static void *query_first_candidate(mpr_list_header_t *lh)
+{
+    if (lh->query_ctx && lh->query_ctx->query_next)
+        return lh->query_ctx->query_next(&lh->query_ctx->data, 0);
+    return *lh->start;
+}
+
 void **mpr_list_query_continuation(mpr_list_header_t *lh)
 {
-    void *item = mpr_list_header_by_data(lh->self)->next;
+    void *item = query_next_candidate(lh->query_ctx, lh->self);
     while (item) {
         if (lh->query_ctx->query_compare(&lh->query_ctx->data, item))
             break;
-        item = mpr_list_get_next_internal(item);
+        item = query_next_candidate(lh->query_ctx, item);
     }
 
     if (item) {
@@ -193,15 +224,16 @@ static void free_query_single_ctx(mpr_list_header_t *lh)
         free_query_single_ctx(lh1);
         free_query_single_ctx(lh2);
     }
-    free(lh->query_ctx);
-    free(lh);
+    mpr_slab_release(lh->query_ctx);
+    mpr_slab_release(lh);
 }
 
 #define GET_TYPE_SIZE(TYPE)                 \
 if (types[i+1] && isdigit(types[i+1])) {    \
     num_args = atoi(types+i+1);             \
     va_arg(aq, TYPE*);                      \
-    ++i;                                    \
+    while (isdigit(types[i+1]))             \
+        ++i;                                \
 }                                           \
 else {                                      \
     num_args = 1;                           \
@@ -231,7 +263,8 @@ static int get_query_size(const char *types, va_list aq)
                     num_args = atoi(types+i+1);
                     for (j = 0; j < num_args; j++)
                         size += strlen(val[j]) + 1;
-                    ++i;
+                    while (isdigit(types[i+1]))
+                        ++i;
                 }
                 else {
                     const char *val = va_arg(aq, const char*);
@@ -251,7 +284,8 @@ if (types[i+1] && isdigit(types[i + 1])) {              \
     TYPE *val = (TYPE*)va_arg(aq, TYPE*);               \
     num_args = atoi(types + i + 1);                     \
     memcpy(data + offset, val, sizeof(TYPE) * num_args);\
-    ++i;                                                \
+    while (isdigit(types[i+1]))                         \
+        ++i;                                            \
 }                                                       \
 else {                                                  \
     TYPE val = (TYPE)va_arg(aq, TYPE);                  \
@@ -263,16 +297,18 @@ offset += sizeof(TYPE) * num_args;
 /* We need to be careful of memory alignment here - for now we will just ensure
  * that string arguments are always passed last. */
 static void **new_query_internal(const void **list, int size, const void *func,
-                                 const char *types, va_list aq)
+                                 const void *next, const char *types, va_list aq)
 {
     mpr_list_header_t *lh;
+    mpr_slab slab;
     int offset = 0, i = 0, j, num_args;
     char *data;
     RETURN_ARG_UNLESS(list && size && func && types, 0);
-    lh = (mpr_list_header_t*)malloc(LIST_HEADER_SIZE);
+    slab = mpr_list_get_slab(list);
+    lh = (mpr_list_header_t*)mpr_slab_alloc_ref(slab, LIST_HEADER_SIZE);
     lh->next = (void*)mpr_list_query_continuation;
     lh->query_type = QUERY_DYNAMIC;
-    lh->query_ctx = (query_info_t*)malloc(sizeof(query_info_t)+size);
+    lh->query_ctx = (query_info_t*)mpr_slab_alloc_ref(slab, sizeof(query_info_t) + size);
 
     data = (char*)&lh->query_ctx->data;
     while (types[i]) {
@@ -289,7 +325,8 @@ static void **new_query_internal(const void **list, int size, const void *func,
                 if (types[i+1] && isdigit(types[i + 1])) {
                     /* is array */
                     num_args = atoi(types + i + 1);
-                    ++i;
+                    while (isdigit(types[i+1]))
+                        ++i;
                 }
                 else
                     num_args = 1;
@@ -305,7 +342,8 @@ static void **new_query_internal(const void **list, int size, const void *func,
                     for (j = 0; j < num_args; j++)
                         snprintf(data + offset, size - offset, "%s", val[j]);
                     offset += strlen(val[j]) + 1;
-                    ++i;
+                    while (isdigit(types[i+1]))
+                        ++i;
                 }
                 else {
                     const char *val = (const char*)va_arg(aq, const char*);
@@ -314,8 +352,8 @@ static void **new_query_internal(const void **list, int size, const void *func,
                 }
                 break;
             default:
-                free(lh->query_ctx);
-                free(lh);
+                mpr_slab_release(lh->query_ctx);
+                mpr_slab_release(lh);
                 return 0;
         }
         ++i;
@@ -324,8 +362,9 @@ static void **new_query_internal(const void **list, int size, const void *func,
     lh->query_ctx->size = sizeof(query_info_t) + size;
     lh->query_ctx->query_compare = (query_compare_func_t*)func;
     lh->query_ctx->query_free = (query_free_func_t*)free_query_single_ctx;
+    lh->query_ctx->query_next = (query_next_func_t*)next;
     lh->start = (void**)list;
-    lh->self = *lh->start;
+    lh->self = query_first_candidate(lh);
     return &lh->self;
 }
 
@@ -340,7 +379,23 @@ mpr_list mpr_list_new_query(const void **list, const void *func,
     va_end(aq);
 
     va_start(aq, types);
-    qry = (mpr_list)new_query_internal(list, size, func, types, aq);
+    qry = (mpr_list)new_query_internal(list, size, func, 0, types, aq);
+    va_end(aq);
+    return qry;
+}
+
+mpr_list mpr_list_new_chained_query(const void **list, const void *next, const void *func,
+                                    const char *types, ...)
+{
+    int size;
+    va_list aq;
+    mpr_list qry;
+    va_start(aq, types);
+    size = get_query_size(types, aq);
+    va_end(aq);
+
+    va_start(aq, types);
+    qry = (mpr_list)new_query_internal(list, size, func, next, types, aq);
     va_end(aq);
     return qry;
 }
@@ -350,10 +405,14 @@ mpr_list mpr_list_start(mpr_list list)
     mpr_list_header_t *lh;
     RETURN_ARG_UNLESS(list, 0);
     lh = mpr_list_header_by_self(list);
-    lh->self = *lh->start;
+    lh->self = query_first_candidate(lh);
     if (QUERY_DYNAMIC == lh->query_type) {
-        if (!*list)
+        if (!*list) {
+            /* Clean up */
+            if (lh->query_ctx->query_free)
+                lh->query_ctx->query_free(lh);
             return 0;
+        }
         if (lh->query_ctx->query_compare(&lh->query_ctx->data, *list))
             return (mpr_list)&lh->self;
         return (mpr_list)mpr_list_query_continuation(lh);
@@ -399,12 +458,52 @@ void mpr_list_free(mpr_list list)
         lh->query_ctx->query_free(lh);
 }
 
+/* Snapshots of the items of a query, see mpr_list_materialize(). The items are kept in the order
+ * they were found, followed by a sorted copy used for testing membership. */
+typedef struct {
+    int cursor;
+    int num;
+    mpr_obj items[1]; /* stub */
+} snapshot_t;
+
+static int cmp_snapshot_ptr(const void *a, const void *b)
+{
+    const void *pa = *(const void**)a, *pb = *(const void**)b;
+    return (pa > pb) - (pa < pb);
+}
+
+static void *next_snapshot(const void *ctx_data, void *item)
+{
+    snapshot_t *s = (snapshot_t*)ctx_data;
+    s->cursor = item ? s->cursor + 1 : 0;
+    return s->cursor < s->num ? s->items[s->cursor] : 0;
+}
+
+static int cmp_snapshot(const void *ctx_data, const void *item)
+{
+    snapshot_t *s = (snapshot_t*)ctx_data;
+    return 0 != bsearch(&item, &s->items[s->num], s->num, sizeof(mpr_obj), cmp_snapshot_ptr);
+}
+
+/*! Get the snapshot held by a list, or null if the list is not a snapshot. */
+static snapshot_t *get_snapshot(mpr_list_header_t *lh)
+{
+    if (QUERY_DYNAMIC == lh->query_type && next_snapshot == lh->query_ctx->query_next)
+        return (snapshot_t*)&lh->query_ctx->data;
+    return 0;
+}
+
 mpr_obj mpr_list_get_idx(mpr_list list, unsigned int idx)
 {
     int i = 0;
     mpr_list_header_t *lh;
+    snapshot_t *snap;
     RETURN_ARG_UNLESS(list && idx >= 0, 0);
     lh = mpr_list_header_by_self(list);
+    if ((snap = get_snapshot(lh))) {
+        /* random access does not move the position of the list */
+        return idx < snap->num ? snap->items[idx] : 0;
+    }
 
     /* Reset to beginning of list */
     lh->self = *lh->start;
@@ -437,13 +536,129 @@ static int cmp_parallel_query(const void *ctx_data, const void *list)
     }
 }
 
+/*! Intersections and differences only contain items of their first operand, so they can walk its
+ *  chain of candidates if it has one. */
+static void *query_next_parallel(const void *ctx_data, void *item)
+{
+    mpr_list_header_t *lh1 = *(mpr_list_header_t**)ctx_data;
+    return lh1->query_ctx->query_next(&lh1->query_ctx->data, item);
+}
+
+/*! Unions of two chained queries walk the first chain, then the items of the second chain that
+ *  do not match the first query. */
+static void *query_next_union(const void *ctx_data, void *item)
+{
+    mpr_list_header_t *lh1 = *(mpr_list_header_t**)ctx_data;
+    mpr_list_header_t *lh2 = *(mpr_list_header_t**)((char*)ctx_data + sizeof(void*));
+    int *phase = (int*)((char*)ctx_data + sizeof(void*) * 2 + sizeof(int));
+    query_info_t *c1 = lh1->query_ctx, *c2 = lh2->query_ctx;
+
+    if (!item) {
+        *phase = 0;
+        item = c1->query_next(&c1->data, 0);
+    }
+    else if (0 == *phase)
+        item = c1->query_next(&c1->data, item);
+    else
+        item = c2->query_next(&c2->data, item);
+
+    if (0 == *phase) {
+        while (item && !c1->query_compare(&c1->data, item))
+            item = c1->query_next(&c1->data, item);
+        RETURN_ARG_UNLESS(!item, item);
+        *phase = 1;
+        item = c2->query_next(&c2->data, 0);
+    }
+    while (item && c1->query_compare(&c1->data, item))
+        item = c2->query_next(&c2->data, item);
+    return item;
+}
+
+/* Candidates proposed by a property index of the graph. The objects are followed by the ids they
+ * are indexed under and by the arguments of the property filter they were proposed for. */
+typedef struct {
+    int cursor;
+    int num;
+    int type;
+    int pad;
+    mpr_graph graph;
+    mpr_obj objs[1]; /* stub */
+} candidates_t;
+
+#define CANDIDATES_FILTER(C) \
+((char*)(C)->objs + (C)->num * (sizeof(mpr_obj) + sizeof(mpr_id)))
+
+/*! Walk the candidates, skipping any that have been removed from the graph since. */
+static void *next_candidate(const void *ctx_data, void *item)
+{
+    candidates_t *c = (candidates_t*)ctx_data;
+    mpr_id *ids = (mpr_id*)&c->objs[c->num];
+    c->cursor = item ? c->cursor + 1 : 0;
+    while (c->cursor < c->num) {
+        if (mpr_graph_has_obj(c->graph, c->type, c->objs[c->cursor], ids[c->cursor]))
+            return c->objs[c->cursor];
+        ++c->cursor;
+    }
+    return 0;
+}
+
+/*! Indexes may propose more candidates than match, so they are tested using the filter. */
+static int cmp_candidate(const void *ctx_data, const void *item)
+{
+    candidates_t *c = (candidates_t*)ctx_data;
+    return filter_by_prop(CANDIDATES_FILTER(c), (mpr_obj)item);
+}
+
+/* Estimated number of items walked by a query, used for ordering intersections. */
+#define CHAIN_COST 64
+
+static int query_cost(mpr_list_header_t *lh)
+{
+    query_info_t *ctx = lh->query_ctx;
+    RETURN_ARG_UNLESS(QUERY_DYNAMIC == lh->query_type && ctx->query_next, INT_MAX);
+    if (next_candidate == ctx->query_next)
+        return ((candidates_t*)&ctx->data)->num;
+    if (next_snapshot == ctx->query_next)
+        return ((snapshot_t*)&ctx->data)->num;
+    if (query_next_parallel == ctx->query_next)
+        return query_cost(*(mpr_list_header_t**)&ctx->data);
+    if (query_next_union == ctx->query_next) {
+        int cost1 = query_cost(*(mpr_list_header_t**)&ctx->data);
+        int cost2 = query_cost(*(mpr_list_header_t**)((char*)&ctx->data + sizeof(void*)));
+        return cost1 > INT_MAX - cost2 ? INT_MAX : cost1 + cost2;
+    }
+    return CHAIN_COST;
+}
+
+static mpr_list new_parallel_query(mpr_list_header_t *lh1, mpr_list_header_t *lh2,
+                                   binary_op_t op)
+{
+    void *next = 0;
+    if (OP_INTERSECTION == op && query_cost(lh2) < query_cost(lh1)) {
+        /* walk the cheaper operand */
+        mpr_list_header_t *tmp = lh1;
+        lh1 = lh2;
+        lh2 = tmp;
+    }
+    if (QUERY_DYNAMIC == lh1->query_type && lh1->query_ctx->query_next) {
+        if (OP_UNION != op)
+            next = (void*)query_next_parallel;
+        else if (QUERY_DYNAMIC == lh2->query_type && lh2->query_ctx->query_next)
+            next = (void*)query_next_union;
+    }
+    return mpr_list_new_chained_query((const void **)lh1->start, next,
+                                      (void*)cmp_parallel_query, "vvii", &lh1, &lh2, op, 0);
+}
+
 static mpr_list_header_t *mpr_list_header_cpy(mpr_list_header_t *lh)
 {
-    mpr_list_header_t *cpy = (mpr_list_header_t*)malloc(LIST_HEADER_SIZE);
+    mpr_list_header_t *cpy;
+    cpy = (mpr_list_header_t*)mpr_slab_alloc_ref(mpr_slab_get_owner(lh), LIST_HEADER_SIZE);
     memcpy(cpy, lh, LIST_HEADER_SIZE);
     RETURN_ARG_UNLESS(lh->query_ctx, cpy);
 
-    cpy->query_ctx = (query_info_t*)malloc(lh->query_ctx->size);
+    cpy->query_ctx = (query_info_t*)mpr_slab_alloc_ref(mpr_slab_get_owner(lh->query_ctx),
+                                                       lh->query_ctx->size);
     memcpy(cpy->query_ctx, lh->query_ctx, lh->query_ctx->size);
 
     if (cmp_parallel_query == cpy->query_ctx->query_compare) {
@@ -477,8 +692,7 @@ mpr_list mpr_list_get_union(mpr_list list1, mpr_list list2)
     RETURN_ARG_UNLESS(list2, list1);
     lh1 = mpr_list_header_by_self(list1);
     lh2 = mpr_list_header_by_self(list2);
-    return mpr_list_start(mpr_list_new_query((const void **)lh1->start, (void*)cmp_parallel_query,
-                                             "vvi", &lh1, &lh2, OP_UNION));
+    return mpr_list_start(new_parallel_query(lh1, lh2, OP_UNION));
 }
 
 mpr_list mpr_list_get_isect(mpr_list list1, mpr_list list2)
@@ -487,8 +701,7 @@ mpr_list mpr_list_get_isect(mpr_list list1, mpr_list list2)
     RETURN_ARG_UNLESS(list1 && list2, 0);
     lh1 = mpr_list_header_by_self(list1);
     lh2 = mpr_list_header_by_self(list2);
-    return mpr_list_start(mpr_list_new_query((const void **)lh1->start, (void*)cmp_parallel_query,
-                                             "vvi", &lh1, &lh2, OP_INTERSECTION));
+    return mpr_list_start(new_parallel_query(lh1, lh2, OP_INTERSECTION));
 }
 
 static mpr_list mpr_list_filter_internal(mpr_list list, const void *func, const char *types, ...)
@@ -507,7 +720,7 @@ static mpr_list mpr_list_filter_internal(mpr_list list, const void *func, const
     lh1 = mpr_list_header_by_self(list);
 
     va_start(aq, types);
-    filter = new_query_internal((const void **)lh1->start, size, func, types, aq);
+    filter = new_query_internal((const void **)lh1->start, size, func, 0, types, aq);
     va_end(aq);
 
     if (QUERY_STATIC == lh1->query_type)
@@ -515,8 +728,7 @@ static mpr_list mpr_list_filter_internal(mpr_list list, const void *func, const
 
     /* return intersection */
     lh2 = mpr_list_header_by_self(filter);
-    return mpr_list_new_query((const void **)lh1->start, (void*)cmp_parallel_query,
-                              "vvi", &lh1, &lh2, OP_INTERSECTION);
+    return new_parallel_query(lh1, lh2, OP_INTERSECTION);
 }
 
 #define COMPARE_TYPE(TYPE)                      \
@@ -625,12 +837,70 @@ static int filter_by_prop(const void *ctx, mpr_obj o)
     return compare_val(op, len, type, _val, val);
 }
 
+/*! Use a property index of the graph to find candidates for a filter if this is cheaper than
+ *  walking the list. Returns 1 and sets result if an index was used, or 0 otherwise. */
+static int plan_indexed_filter(mpr_list list, mpr_prop p, const char *key, int len,
+                               mpr_type type, const void *val, mpr_op op, mpr_list *result)
+{
+    mpr_list_header_t *lh = mpr_list_header_by_self(list);
+    mpr_obj o = (mpr_obj)*list, *objs;
+    mpr_type otype;
+    mpr_graph g;
+    mpr_id *ids;
+    void **head;
+    char types[32];
+    int num, cost;
+    mpr_list cand;
+
+    RETURN_ARG_UNLESS(o, 0);
+    otype = mpr_obj_get_type(o);
+    RETURN_ARG_UNLESS(MPR_DEV == otype || MPR_SIG == otype || MPR_MAP == otype, 0);
+    g = mpr_obj_get_graph(o);
+    RETURN_ARG_UNLESS(g && (head = mpr_graph_get_list_head(g, otype)), 0);
+    if (QUERY_STATIC == lh->query_type) {
+        /* other static lists may hold objects that do not match the graph */
+        RETURN_ARG_UNLESS(*head == lh->self, 0);
+    }
+    else
+        RETURN_ARG_UNLESS(lh->start == head, 0);
+
+    num = mpr_graph_get_index_candidates(g, otype, p, key, len, type, val, op, &objs, &ids);
+    RETURN_ARG_UNLESS(num >= 0, 0);
+    cost = query_cost(lh);
+    if (num >= cost) {
+        FUNC_IF(free, objs);
+        FUNC_IF(free, ids);
+        return 0;
+    }
+    trace("using property index with %d candidates\n", num);
+    if (!num) {
+        mpr_list_free(list);
+        *result = 0;
+        return 1;
+    }
+    snprintf(types, 32, "iiiivv%dh%diiicvs", num, num);
+    cand = mpr_list_new_chained_query((const void **)head, (void*)next_candidate,
+                                      (void*)cmp_candidate, types, 0, num, otype, 0, &g, objs,
+                                      ids, p, op, len, type, &val, key);
+    free(objs);
+    free(ids);
+    RETURN_ARG_UNLESS(cand, 0);
+    if (QUERY_STATIC == lh->query_type)
+        *result = cand;
+    else
+        *result = new_parallel_query(mpr_list_header_by_self(cand), lh, OP_INTERSECTION);
+    return 1;
+}
+
 mpr_list mpr_list_filter(mpr_list list, mpr_prop p, const char *key, int len,
                          mpr_type type, const void *val, mpr_op op)
 {
+    mpr_list result;
     int mask = MPR_OP_ALL | MPR_OP_ANY;
     if (!list || op <= MPR_OP_UNDEFINED || (op | mask) > (MPR_OP_NEQ | mask))
         return list;
+    if (plan_indexed_filter(list, p, key, len, type, val, op, &result))
+        return mpr_list_start(result);
     return mpr_list_start(mpr_list_filter_internal(list, (void*)filter_by_prop, "iiicvs", p, op,
                                                    len, type, &val, key));
 }
@@ -642,16 +912,18 @@ mpr_list mpr_list_get_diff(mpr_list list1, mpr_list list2)
     RETURN_ARG_UNLESS(list2, list1);
     lh1 = mpr_list_header_by_self(list1);
     lh2 = mpr_list_header_by_self(list2);
-    return mpr_list_start(mpr_list_new_query((const void **)lh1->start, (void*)cmp_parallel_query,
-                                             "vvi", &lh1, &lh2, OP_DIFFERENCE));
+    return mpr_list_start(new_parallel_query(lh1, lh2, OP_DIFFERENCE));
 }
 
 int mpr_list_get_size(mpr_list list)
 {
     int count = 1;
     mpr_list_header_t *lh;
+    snapshot_t *snap;
     RETURN_ARG_UNLESS(list, 0);
     lh = mpr_list_header_by_self(list);
+    if ((snap = get_snapshot(lh)))
+        return snap->num;
     RETURN_ARG_UNLESS(lh->start && *lh->start, 0);
     if (QUERY_DYNAMIC == lh->query_type) {
         /* use a copy */
@@ -670,3 +942,50 @@ int mpr_list_get_size(mpr_list list)
     }
     return count;
 }
+
+mpr_list mpr_list_materialize(mpr_list list)
+{
+    mpr_list_header_t *lh;
+    mpr_obj *objs, *tmp;
+    const void **start;
+    int num = 0, size = 32;
+    char types[32];
+    mpr_list snap;
+
+    RETURN_ARG_UNLESS(list, 0);
+    lh = mpr_list_header_by_self(list);
+    RETURN_ARG_UNLESS(!get_snapshot(lh), list);
+    /* dynamic queries free themselves at the end of the walk */
+    start = (const void **)lh->start;
+
+    if (!(objs = (mpr_obj*)malloc(size * sizeof(mpr_obj)))) {
+        mpr_list_free(list);
+        return 0;
+    }
+    while (list) {
+        if (num == size) {
+            size *= 2;
+            if (!(tmp = (mpr_obj*)realloc(objs, size * sizeof(mpr_obj)))) {
+                mpr_list_free(list);
+                free(objs);
+                return 0;
+            }
+            objs = tmp;
+        }
+        objs[num++] = (mpr_obj)*list;
+        list = mpr_list_get_next(list);
+    }
+    if (!num || !(tmp = (mpr_obj*)realloc(objs, num * 2 * sizeof(mpr_obj)))) {
+        free(objs);
+        return 0;
+    }
+    objs = tmp;
+    memcpy(&objs[num], objs, num * sizeof(mpr_obj));
+    qsort(&objs[num], num, sizeof(mpr_obj), cmp_snapshot_ptr);
+
+    snprintf(types, 32, "iiv%dv%d", num, num);
+    snap = mpr_list_new_chained_query(start, (void*)next_snapshot, (void*)cmp_snapshot, types, 0,
+                                      num, objs, &objs[num]);
+    free(objs);
+    return mpr_list_start(snap);
+}
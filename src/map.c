@@ -69,10 +69,10 @@ static int _cmp_qry_scopes(const void *ctx, mpr_dev d)
 void mpr_map_init(mpr_map m)
 {
     int i, is_local = 0;
-    mpr_tbl t = m->obj.props.synced = mpr_tbl_new();
+    mpr_tbl t = m->obj.props.synced = mpr_tbl_new(m->obj.graph->strings);
     mpr_list q = mpr_list_new_query((const void**)&m->obj.graph->devs,
                                     (void*)_cmp_qry_scopes, "v", &m);
-    m->obj.props.staged = mpr_tbl_new();
+    m->obj.props.staged = mpr_tbl_new(m->obj.graph->strings);
 
     /* these properties need to be added in alphabetical order */
     mpr_tbl_link(t, PROP(DATA), 1, MPR_PTR, &m->obj.data,
@@ -81,6 +81,7 @@ void mpr_map_init(mpr_map m)
     mpr_tbl_link(t, PROP(ID), 1, MPR_INT64, &m->obj.id, NON_MODIFIABLE | LOCAL_ACCESS_ONLY);
     mpr_tbl_link(t, PROP(MUTED), 1, MPR_BOOL, &m->muted, MODIFIABLE);
     mpr_tbl_link(t, PROP(NUM_SIGS_IN), 1, MPR_INT32, &m->num_src, NON_MODIFIABLE);
+    mpr_tbl_link(t, PROP(PACKED), 1, MPR_BOOL, &m->packed, MODIFIABLE);
     mpr_tbl_link(t, PROP(PROCESS_LOC), 1, MPR_INT32, &m->process_loc, MODIFIABLE);
     mpr_tbl_link(t, PROP(PROTOCOL), 1, MPR_INT32, &m->protocol, REMOTE_MODIFY);
     mpr_tbl_link(t, PROP(SCOPE), 1, MPR_LIST, q, NON_MODIFIABLE | PROP_OWNED);
@@ -161,12 +162,13 @@ mpr_map mpr_map_new(int num_src, mpr_sig *src, int num_dst, mpr_sig *dst)
         is_local = 1;
 
     m = (mpr_map)mpr_list_add_item((void**)&g->maps,
-                                   is_local ? sizeof(mpr_local_map_t) : sizeof(mpr_map_t));
+                                   is_local ? sizeof(mpr_local_map_t) : sizeof(mpr_map_t),
+                                   g->slab);
     m->obj.type = MPR_MAP;
     m->obj.graph = g;
     m->num_src = num_src;
     m->is_local = 0;
-    m->src = (mpr_slot*)malloc(sizeof(mpr_slot) * num_src);
+    m->src = (mpr_slot*)calloc(num_src, sizeof(mpr_slot));
     for (i = 0; i < num_src; i++) {
         if (src[order[i]]->dev->obj.graph == g)
             o = (mpr_obj)src[order[i]];
@@ -178,10 +180,13 @@ mpr_map mpr_map_new(int num_src, mpr_sig *src, int num_dst, mpr_sig *dst)
                 ((mpr_sig)o)->dir = src[order[i]]->dir;
                 ((mpr_sig)o)->len = src[order[i]]->len;
                 ((mpr_sig)o)->type = src[order[i]]->type;
+                mpr_graph_index_obj(g, o);
             }
             dev = ((mpr_sig)o)->dev;
-            if (!dev->obj.id)
+            if (!dev->obj.id) {
                 dev->obj.id = src[order[i]]->dev->obj.id;
+                mpr_graph_index_obj(g, (mpr_obj)dev);
+            }
         }
         m->src[i] = mpr_slot_new(m, (mpr_sig)o, is_local, 1);
         m->src[i]->id = i;
@@ -194,6 +199,7 @@ mpr_map mpr_map_new(int num_src, mpr_sig *src, int num_dst, mpr_sig *dst)
         m->obj.id = mpr_dev_generate_unique_id((*dst)->dev);
 
     mpr_map_init(m);
+    mpr_graph_index_obj(g, (mpr_obj)m);
     m->protocol = MPR_PROTO_UDP;
     ++g->staged_maps;
     return m;
@@ -440,25 +446,57 @@ static int _update_scope(mpr_map m, mpr_msg_atom a)
  * 4) when it comes to "to release" idmap, send release and decref LID
  */
 
+/* only called for outgoing maps */
+void mpr_map_eval(mpr_local_map m, mpr_expr_stack stk, mpr_time time)
+{
+    int i, status, len = m->dst->sig->len;
+    mpr_value *src_vals;
+
+    src_vals = alloca(m->num_src * sizeof(mpr_value));
+    for (i = 0; i < m->num_src; i++)
+        src_vals[i] = &m->src[i]->val;
+
+    memset(m->eval.status, 0, m->num_inst);
+    for (i = 0; i < m->num_inst; i++) {
+        /* Check if this instance has been updated */
+        if (!get_bitflag(m->updated_inst, i))
+            continue;
+        /* TODO: Check if this instance has enough history to process the expression */
+        status = mpr_expr_eval(stk, m->expr, src_vals, &m->vars, &m->dst->val, &time,
+                               m->eval.types + i * len, i);
+        m->eval.status[i] = status;
+        if ((status & EXPR_EVAL_DONE) && !m->use_inst)
+            break;
+    }
+    /* instances updated from now on will be evaluated the next time the map is sent */
+    clear_bitflags(m->updated_inst, m->num_inst);
+    m->updated = 0;
+    m->eval.done = 1;
+}
+
 /* only called for outgoing maps */
 void mpr_map_send(mpr_local_map m, mpr_time time)
 {
     int i, j, status, map_manages_inst = 0;
-    lo_message msg;
     mpr_local_dev dev;
     uint8_t bundle_idx;
     mpr_local_slot src_slot, dst_slot;
     mpr_local_sig src_sig;
     struct _mpr_sig_idmap *idmaps;
     mpr_id_map idmap = 0;
-    mpr_value *src_vals;
-    char *types;
+    mpr_type *types;
 
-    RETURN_UNLESS(m->updated && m->expr && MPR_DIR_OUT == m->src[0]->dir && !m->muted);
+    RETURN_UNLESS((m->updated || m->eval.done) && m->expr && MPR_DIR_OUT == m->src[0]->dir
+                  && !m->muted);
 
-    dev = m->rtr->dev;
+    dev = m->dev;
     bundle_idx = dev->bundle_idx % NUM_BUNDLES;
 
+    /* maps may already have been evaluated by the device's worker threads */
+    if (!m->eval.done)
+        mpr_map_eval(m, dev->expr_stack, time);
+    m->eval.done = 0;
+
     /* temporary solution: use most multitudinous source signal for idmap
      * permanent solution: move idmaps to map? */
     src_slot = m->src[0];
@@ -468,10 +506,6 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
     }
     src_sig = (mpr_local_sig)src_slot->sig;
     idmaps = src_sig->idmaps;
-
-    src_vals = alloca(m->num_src * sizeof(mpr_value));
-    for (i = 0; i < m->num_src; i++)
-        src_vals[i] = &m->src[i]->val;
     dst_slot = m->dst;
 
     if (m->use_inst && !src_sig->use_inst) {
@@ -479,17 +513,10 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
         idmap = m->idmap;
     }
 
-    types = alloca(dst_slot->sig->len * sizeof(char));
-
     for (i = 0; i < m->num_inst; i++) {
-        /* Check if this instance has been updated */
-        if (!get_bitflag(m->updated_inst, i))
-            continue;
-        /* TODO: Check if this instance has enough history to process the expression */
-        status = mpr_expr_eval(dev->expr_stack, m->expr, src_vals, &m->vars,
-                               &dst_slot->val, &time, types, i);
-        if (!status)
+        if (!(status = m->eval.status[i]))
             continue;
+        types = m->eval.types + i * dst_slot->sig->len;
 
         if (src_sig->use_inst && !map_manages_inst) {
             /* finding idmaps here will be a bit inefficient for now */
@@ -508,8 +535,8 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
 
         /* send instance release if dst is instanced and either src or map is also instanced. */
         if (idmap && status & EXPR_RELEASE_BEFORE_UPDATE && m->use_inst) {
-            msg = mpr_map_build_msg(m, 0, 0, 0, idmap);
-            mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg, time, m->protocol, bundle_idx);
+            mpr_map_add_msg(m, 0, dst_slot->link, mpr_map_get_dst_path(m), 0, 0, idmap, time,
+                            bundle_idx);
             if (map_manages_inst) {
                 mpr_dev_LID_decref(dev, 0, idmap);
                 idmap = m->idmap = 0;
@@ -522,25 +549,19 @@ void mpr_map_send(mpr_local_map m, mpr_time time)
                 /* create an id_map and store it in the map */
                 idmap = m->idmap = mpr_dev_add_idmap(dev, 0, 0, 0);
             }
-            msg = mpr_map_build_msg(m, src_slot, result, types, idmap);
-            mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg,
-                             *(mpr_time*)mpr_value_get_time(&dst_slot->val, i),
-                             m->protocol, bundle_idx);
+            mpr_map_add_update(m, src_slot, result, types, idmap,
+                               *(mpr_time*)mpr_value_get_time(&dst_slot->val, i), bundle_idx);
         }
         /* send instance release if dst is instanced and either src or map is also instanced. */
         if (idmap && status & EXPR_RELEASE_AFTER_UPDATE && m->use_inst) {
-            msg = mpr_map_build_msg(m, 0, 0, 0, idmap);
-            mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg, time, m->protocol, bundle_idx);
+            mpr_map_add_msg(m, 0, dst_slot->link, mpr_map_get_dst_path(m), 0, 0, idmap, time,
+                            bundle_idx);
             if (map_manages_inst) {
                 mpr_dev_LID_decref(dev, 0, idmap);
                 idmap = m->idmap = 0;
             }
         }
-        if ((status & EXPR_EVAL_DONE) && !m->use_inst)
-            break;
     }
-    clear_bitflags(m->updated_inst, m->num_inst);
-    m->updated = 0;
 }
 
 /* only called for incoming maps */
@@ -588,7 +609,7 @@ void mpr_map_receive(mpr_local_map m, mpr_time time)
 
         if (!get_bitflag(m->updated_inst, i))
             continue;
-        status = mpr_expr_eval(m->rtr->dev->expr_stack, m->expr, src_vals,
+        status = mpr_expr_eval(m->dev->expr_stack, m->expr, src_vals,
                                &m->vars, &dst_slot->val, &time, types, i);
         if (!status)
             continue;
@@ -666,18 +687,394 @@ void mpr_map_receive(mpr_local_map m, mpr_time time)
     m->updated = 0;
 }
 
+/* Write vector elements to a buffer in network byte order. */
+static void _write_vals(char *dst, const void *src, int len, mpr_type type)
+{
+    int i;
+    if (MPR_DBL == type) {
+        uint64_t u;
+        for (i = 0; i < len; i++) {
+            memcpy(&u, (char*)src + i * sizeof(uint64_t), sizeof(uint64_t));
+            u = lo_htoo64(u);
+            memcpy(dst + i * sizeof(uint64_t), &u, sizeof(uint64_t));
+        }
+    }
+    else {
+        uint32_t u;
+        for (i = 0; i < len; i++) {
+            memcpy(&u, (char*)src + i * sizeof(uint32_t), sizeof(uint32_t));
+            u = lo_htoo32(u);
+            memcpy(dst + i * sizeof(uint32_t), &u, sizeof(uint32_t));
+        }
+    }
+}
+
+/* Add a vector value as a single blob in network byte order. If any elements are missing a
+ * second blob is added containing a bitmask of the elements that have values. */
+static void _add_packed_vec(lo_message msg, int len, mpr_type type, const void *val,
+                            const mpr_type *types)
+{
+    int i, size = mpr_type_get_size(type), partial = 0;
+    char *data = alloca(len * size), *mask = alloca(len / 8 + 1);
+    lo_blob b;
+
+    memset(mask, 0, len / 8 + 1);
+    for (i = 0; i < len; i++) {
+        if (MPR_NULL == types[i]) {
+            memset(data + i * size, 0, size);
+            partial = 1;
+            continue;
+        }
+        set_bitflag(mask, i);
+        _write_vals(data + i * size, (char*)val + i * size, 1, type);
+    }
+    b = lo_blob_new(len * size, data);
+    lo_message_add_blob(msg, b);
+    lo_blob_free(b);
+    if (partial) {
+        b = lo_blob_new(len / 8 + 1, mask);
+        lo_message_add_blob(msg, b);
+        lo_blob_free(b);
+    }
+}
+
+#define PAD4(X) (((X) + 3) & ~3)
+
+/* Get the vector length and type carried by value messages for a map slot. */
+static void _get_vec_info(mpr_local_map m, mpr_local_slot slot, int *len, mpr_type *type)
+{
+    if (MPR_LOC_SRC == m->process_loc) {
+        *len = m->dst->sig->len;
+        *type = m->dst->sig->type;
+    }
+    else if (slot) {
+        *len = slot->sig->len;
+        *type = slot->sig->type;
+    }
+    else {
+        *len = 0;
+        *type = 0;
+    }
+}
+
+/* (Re)build the pre-serialized value update message for a slot. The image is built once with
+ * zeroed arguments and the offsets of the value, instance id and slot id are recorded so that
+ * they can be patched in place. */
+static int _build_tmpl(mpr_local_map m, mpr_local_slot slot, int len, mpr_type type,
+                       int packed, int has_inst)
+{
+    mpr_msg_tmpl tmpl = &slot->tmpl;
+    const char *path = mpr_map_get_dst_path(m);
+    int i, size = mpr_type_get_size(type), off;
+    size_t msg_len;
+    char *zeros;
+    NEW_LO_MSG(msg, return 1);
+
+    FUNC_IF(free, tmpl->data);
+    memset(tmpl, 0, sizeof(mpr_msg_tmpl_t));
+
+    zeros = alloca(len * size);
+    memset(zeros, 0, len * size);
+    if (packed) {
+        lo_blob b = lo_blob_new(len * size, zeros);
+        lo_message_add_blob(msg, b);
+        lo_blob_free(b);
+    }
+    else {
+        for (i = 0; i < len; i++) {
+            switch (type) {
+            case MPR_INT32: lo_message_add_int32(msg, 0);   break;
+            case MPR_FLT:   lo_message_add_float(msg, 0);   break;
+            case MPR_DBL:   lo_message_add_double(msg, 0);  break;
+            default:                                        break;
+            }
+        }
+    }
+    if (has_inst) {
+        lo_message_add_string(msg, "@in");
+        lo_message_add_int64(msg, 0);
+    }
+    lo_message_add_string(msg, "@sl");
+    lo_message_add_int32(msg, 0);
+
+    /* header: padded path and type string including the leading comma */
+    off = PAD4(strlen(path) + 1) + PAD4(strlen(lo_message_get_types(msg)) + 2);
+    tmpl->val_offset = off + (packed ? 4 : 0);
+    off += packed ? 4 + PAD4(len * size) : len * size;
+    if (has_inst) {
+        tmpl->inst_offset = off + 4;
+        off += 12;
+    }
+    tmpl->slot_offset = off + 4;
+    off += 8;
+
+    msg_len = lo_message_length(msg, path);
+    if (off != (int)msg_len) {
+        trace("unexpected template length %d (expected %d)\n", (int)msg_len, off);
+        lo_message_free(msg);
+        return 1;
+    }
+    tmpl->data = lo_message_serialise(msg, path, NULL, &msg_len);
+    lo_message_free(msg);
+    RETURN_ARG_UNLESS(tmpl->data, 1);
+    tmpl->path = path;
+    tmpl->len = (int)msg_len;
+    tmpl->vec_len = len;
+    tmpl->type = type;
+    tmpl->packed = packed;
+    return 0;
+}
+
+/* Rebuild the slot's pre-serialized message if it does not match the current map properties. */
+static int _check_tmpl(mpr_local_map m, mpr_local_slot slot, int len, mpr_type type, int packed,
+                       int has_inst)
+{
+    mpr_msg_tmpl tmpl = &slot->tmpl;
+    if (   tmpl->data && tmpl->path == mpr_map_get_dst_path(m) && tmpl->vec_len == len
+        && tmpl->type == type && tmpl->packed == packed && !tmpl->inst_offset == !has_inst)
+        return 0;
+    return _build_tmpl(m, slot, len, type, packed, has_inst);
+}
+
+/* Peers that predate packed vectors cannot unpack them, so a remote destination must first echo
+ * the property in /mapped. */
+static int _is_packed(mpr_local_map m, int len)
+{
+    return m->packed && len > 1 && (m->dst->rsig || m->packed_ok);
+}
+
+/*! Queue a value update for a map. If the destination link accepts serialized messages and the
+ *  value is complete, the slot's pre-serialized message is patched in place; otherwise this
+ *  falls back to mpr_map_build_msg(). */
+void mpr_map_add_update(mpr_local_map m, mpr_local_slot slot, const void *val,
+                        mpr_type *types, mpr_id_map idmap, mpr_time t, int idx)
+{
+    mpr_link link = m->dst->link;
+    mpr_msg_tmpl tmpl = &slot->tmpl;
+    int i, len, packed, has_inst = m->use_inst && idmap;
+    mpr_type type;
+    char *dst;
+
+    _get_vec_info(m, slot, &len, &type);
+    packed = _is_packed(m, len);
+
+    if (   (MPR_PROTO_UDP != m->protocol && MPR_PROTO_SHM != m->protocol)
+        || !link || !link->addr.udp_sa || mpr_link_get_is_in_process(link))
+        goto fallback;
+    for (i = 0; i < len; i++) {
+        if (types[i] != type)
+            goto fallback;
+    }
+    if (_check_tmpl(m, slot, len, type, packed, has_inst))
+        goto fallback;
+    if (!(dst = mpr_link_reserve_msg(link, m->protocol, tmpl->len, t, idx)))
+        goto fallback;
+
+    memcpy(dst, tmpl->data, tmpl->len);
+    _write_vals(dst + tmpl->val_offset, val, len, type);
+    if (has_inst) {
+        uint64_t u = lo_htoo64(idmap->GID);
+        memcpy(dst + tmpl->inst_offset, &u, sizeof(uint64_t));
+    }
+    {
+        uint32_t u = lo_htoo32((uint32_t)slot->id);
+        memcpy(dst + tmpl->slot_offset, &u, sizeof(uint32_t));
+    }
+    return;
+
+  fallback:
+    mpr_map_add_msg(m, slot, link, mpr_map_get_dst_path(m), val, types, idmap, t, idx);
+}
+
+/* Serialize a message equivalent to the one built by mpr_map_build_msg() directly into the link's
+ * bundle buffer. Returns non-zero if the link does not accept serialized messages. */
+static int _write_msg(mpr_local_map m, mpr_local_slot slot, mpr_link link, const char *path,
+                      const void *val, mpr_type *types, mpr_id_map idmap, mpr_time t, int idx)
+{
+    int i, len, size, num_types = 0, partial = 0, packed;
+    mpr_type type;
+    size_t msg_len, data_len = 0;
+    char *tt, *dst, *ptr;
+    uint32_t u;
+
+    _get_vec_info(m, slot, &len, &type);
+    size = mpr_type_get_size(type);
+    packed = val && types && _is_packed(m, len);
+
+    /* build the type string and measure the arguments */
+    tt = alloca(len + 8);
+    tt[num_types++] = ',';
+    if (packed) {
+        for (i = 0; i < len; i++)
+            partial |= (MPR_NULL == types[i]);
+        tt[num_types++] = 'b';
+        data_len += 4 + PAD4(len * size);
+        if (partial) {
+            tt[num_types++] = 'b';
+            data_len += 4 + PAD4(len / 8 + 1);
+        }
+    }
+    else if (val && types) {
+        for (i = 0; i < len; i++) {
+            switch (types[i]) {
+            case MPR_INT32: tt[num_types++] = 'i'; data_len += 4;  break;
+            case MPR_FLT:   tt[num_types++] = 'f'; data_len += 4;  break;
+            case MPR_DBL:   tt[num_types++] = 'd'; data_len += 8;  break;
+            case MPR_NULL:  tt[num_types++] = 'N';                 break;
+            default:                                               break;
+            }
+        }
+    }
+    else if (m->use_inst) {
+        for (i = 0; i < len; i++)
+            tt[num_types++] = 'N';
+    }
+    if (m->use_inst && idmap) {
+        tt[num_types++] = 's';
+        tt[num_types++] = 'h';
+        data_len += 12;
+    }
+    if (slot) {
+        tt[num_types++] = 's';
+        tt[num_types++] = 'i';
+        data_len += 8;
+    }
+    tt[num_types] = 0;
+
+    msg_len = PAD4(strlen(path) + 1) + PAD4(num_types + 1) + data_len;
+    RETURN_ARG_UNLESS(dst = mpr_link_reserve_msg(link, m->protocol, msg_len, t, idx), 1);
+    memset(dst, 0, msg_len);
+    strcpy(dst, path);
+    ptr = dst + PAD4(strlen(path) + 1);
+    strcpy(ptr, tt);
+    ptr += PAD4(num_types + 1);
+
+    if (packed) {
+        u = lo_htoo32((uint32_t)(len * size));
+        memcpy(ptr, &u, 4);
+        ptr += 4;
+        for (i = 0; i < len; i++) {
+            if (MPR_NULL != types[i])
+                _write_vals(ptr + i * size, (char*)val + i * size, 1, type);
+        }
+        ptr += PAD4(len * size);
+        if (partial) {
+            u = lo_htoo32((uint32_t)(len / 8 + 1));
+            memcpy(ptr, &u, 4);
+            ptr += 4;
+            for (i = 0; i < len; i++) {
+                if (MPR_NULL != types[i])
+                    set_bitflag(ptr, i);
+            }
+            ptr += PAD4(len / 8 + 1);
+        }
+    }
+    else if (val && types) {
+        for (i = 0; i < len; i++) {
+            switch (types[i]) {
+            case MPR_INT32:
+            case MPR_FLT:
+                _write_vals(ptr, (char*)val + i * 4, 1, types[i]);
+                ptr += 4;
+                break;
+            case MPR_DBL:
+                _write_vals(ptr, (char*)val + i * 8, 1, types[i]);
+                ptr += 8;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    if (m->use_inst && idmap) {
+        uint64_t u64 = lo_htoo64(idmap->GID);
+        memcpy(ptr, "@in", 4);
+        memcpy(ptr + 4, &u64, 8);
+        ptr += 12;
+    }
+    if (slot) {
+        memcpy(ptr, "@sl", 4);
+        u = lo_htoo32((uint32_t)slot->id);
+        memcpy(ptr + 4, &u, 4);
+    }
+    return 0;
+}
+
+void mpr_map_add_msg(mpr_local_map m, mpr_local_slot slot, mpr_link link, const char *path,
+                     const void *val, mpr_type *types, mpr_id_map idmap, mpr_time t, int idx)
+{
+    mpr_dev dst;
+    RETURN_UNLESS(link);
+    RETURN_UNLESS(_write_msg(m, slot, link, path, val, types, idmap, t, idx));
+    /* TCP and device-local messages are queued using liblo */
+    mpr_dev_rt_miss(m->dev);
+    /* messages are sent upstream to remote sources, otherwise to the destination */
+    dst = slot && MPR_DIR_IN == slot->dir ? slot->sig->dev : m->dst->sig->dev;
+    mpr_link_add_msg(link, dst, path, mpr_map_build_msg(m, slot, val, types, idmap), t,
+                     m->protocol, idx);
+}
+
+void mpr_map_build_tmpls(mpr_local_map m)
+{
+    int i, len;
+    mpr_type type;
+    RETURN_UNLESS(   (MPR_PROTO_UDP == m->protocol || MPR_PROTO_SHM == m->protocol)
+                  && MPR_DIR_OUT == m->src[0]->dir
+                  && !m->is_local_only);
+    for (i = 0; i < m->num_src; i++) {
+        if (!m->src[i]->sig->is_local)
+            continue;
+        _get_vec_info(m, m->src[i], &len, &type);
+        _check_tmpl(m, m->src[i], len, type, _is_packed(m, len), m->use_inst);
+    }
+}
+
+size_t mpr_map_get_max_msg_len(mpr_local_map m)
+{
+    int i, len = m->dst->sig->len, path_len = strlen(mpr_map_get_dst_path(m));
+    for (i = 0; i < m->num_src; i++) {
+        len = _max(m->src[i]->sig->len, len);
+        path_len = _max(strlen(m->src[i]->sig->path), path_len);
+    }
+    /* path, type string, values as doubles or a blob with bitmask, instance and slot ids, plus
+     * the bundle element size and a bundle header in case the message starts a new datagram */
+    return PAD4(path_len + 1) + PAD4(len + 8) + len * 8 + PAD4(len / 8 + 1) + 8 + 20 + 4 + 16;
+}
+
+/*! Use the alias advertised by the destination device for value messages. An alias of zero
+ *  reverts to the full signal path. */
+void mpr_map_set_alias(mpr_local_map m, int alias)
+{
+    char path[16] = "";
+    int i;
+    if (alias > 0)
+        snprintf(path, 16, "/@%d", alias);
+    RETURN_UNLESS(strcmp(path, m->alias_path));
+    strcpy(m->alias_path, path);
+    /* serialized messages refer to the previous path */
+    for (i = 0; i < m->num_src; i++)
+        m->src[i]->tmpl.path = 0;
+}
+
+const char *mpr_map_get_dst_path(mpr_local_map m)
+{
+    return m->alias_path[0] ? m->alias_path : m->dst->sig->path;
+}
+
 /*! Build a value update message for a given map. */
 lo_message mpr_map_build_msg(mpr_local_map m, mpr_local_slot slot, const void *val,
                              mpr_type *types, mpr_id_map idmap)
 {
-    int i, len = 0;
+    int i, len;
+    mpr_type type;
     NEW_LO_MSG(msg, return 0);
-    if (MPR_LOC_SRC == m->process_loc)
-        len = m->dst->sig->len;
-    else if (slot)
-        len = slot->sig->len;
+    _get_vec_info(m, slot, &len, &type);
 
-    if (val && types) {
+    if (val && types && _is_packed(m, len)) {
+        /* map is configured to carry vector values as a packed blob */
+        _add_packed_vec(msg, len, type, val, types);
+    }
+    else if (val && types) {
         /* value of vector elements can be <type> or NULL */
         for (i = 0; i < len; i++) {
             switch (types[i]) {
@@ -793,6 +1190,12 @@ void mpr_map_alloc_values(mpr_local_map m)
         m->updated_inst = realloc(m->updated_inst, num_inst / 8 + 1);
     else
         m->updated_inst = calloc(1, num_inst / 8 + 1);
+
+    /* allocate storage for evaluation results */
+    m->eval.status = realloc(m->eval.status, num_inst);
+    m->eval.types = realloc(m->eval.types, num_inst * m->dst->sig->len);
+
+    mpr_dev_rt_prealloc(m->dev);
 }
 
 /* Helper to replace a map's expression only if the given string
@@ -809,7 +1212,7 @@ static int _replace_expr_str(mpr_local_map m, const char *expr_str)
         src_types[i] = m->src[i]->sig->type;
         src_lens[i] = m->src[i]->sig->len;
     }
-    expr = mpr_expr_new_from_str(m->rtr->dev->expr_stack, expr_str, m->num_src, src_types,
+    expr = mpr_expr_new_from_str(m->dev->expr_stack, expr_str, m->num_src, src_types,
                                  src_lens, m->dst->sig->type, m->dst->sig->len);
     RETURN_ARG_UNLESS(expr, 1);
 
@@ -1144,7 +1547,7 @@ static int _set_expr(mpr_local_map m, const char *expr)
     RETURN_ARG_UNLESS(m->num_src > 0, 0);
 
     if (m->idmap)
-        mpr_dev_LID_decref(m->rtr->dev, 0, m->idmap);
+        mpr_dev_LID_decref(m->dev, 0, m->idmap);
 
     if (m->is_local_only)
         should_compile = 1;
@@ -1176,7 +1579,7 @@ static int _set_expr(mpr_local_map m, const char *expr)
         /* evaluate expression to intialise literals */
         mpr_time_set(&now, MPR_NOW);
         for (i = 0; i < m->num_inst; i++)
-            mpr_expr_eval(m->rtr->dev->expr_stack, m->expr, 0, &m->vars,
+            mpr_expr_eval(m->dev->expr_stack, m->expr, 0, &m->vars,
                           &m->dst->val, &now, types, i);
     }
     else {
@@ -1280,6 +1683,10 @@ int mpr_map_set_from_msg(mpr_map m, mpr_msg msg, int override)
                 m->src[i]->id = id;
             }
         }
+        /* check if the destination advertised an alias for its signal path */
+        a = mpr_msg_get_prop(msg, PROP(ALIAS));
+        if (a && m->is_local && MPR_INT32 == a->types[0])
+            mpr_map_set_alias((mpr_local_map)m, a->vals[0]->i32);
     }
 
     /* set destination slot properties */
@@ -1486,6 +1893,7 @@ int mpr_map_set_from_msg(mpr_map m, mpr_msg msg, int override)
                 }
             case PROP(ID):
             case PROP(MUTED):
+            case PROP(PACKED):
             case PROP(VERSION):
                 updated += mpr_tbl_set_from_atom(tbl, a, REMOTE_MODIFY);
                 break;
@@ -1494,10 +1902,28 @@ int mpr_map_set_from_msg(mpr_map m, mpr_msg msg, int override)
         }
     }
 done:
+    /* the id may have been set by the message */
+    mpr_graph_index_obj(m->obj.graph, (mpr_obj)m);
+    if (updated) {
+        mpr_graph_touch_obj(m->obj.graph, (mpr_obj)m);
+        /* subscribers catching up later must be sent the change */
+        if (m->is_local)
+            mpr_net_stamp_obj(&m->obj.graph->net, (mpr_obj)m);
+    }
     if (m->is_local && m->status < MPR_STATUS_READY) {
         /* check if mapping is now "ready" */
         _check_status((mpr_local_map)m);
     }
+    if (m->is_local && MPR_PROTO_SHM == m->protocol) {
+        /* rings are only created for links carrying shared memory maps */
+        mpr_local_map lm = (mpr_local_map)m;
+        if (lm->dst->rsig) {
+            for (i = 0; i < lm->num_src; i++)
+                mpr_link_use_shm(lm->src[i]->link);
+        }
+        else
+            mpr_link_use_shm(lm->dst->link);
+    }
     return updated;
 }
 
@@ -1557,6 +1983,8 @@ int mpr_map_send_state(mpr_map m, int slot, net_msg_t cmd)
         mpr_net_add_msg(&m->obj.graph->net, 0, cmd, msg);
         return i-1;
     }
+    if (m->is_local)
+        mpr_net_stamp_obj(&m->obj.graph->net, (mpr_obj)m);
 
     /* add other properties */
     staged = (MSG_MAP == cmd) || (MSG_MAP_MOD == cmd);
@@ -1572,6 +2000,11 @@ int mpr_map_send_state(mpr_map m, int slot, net_msg_t cmd)
                 break;
             lo_message_add_int32(msg, m->src[i]->id);
         }
+        /* advertise a short alias for the destination signal path */
+        if (m->dst->sig->is_local && ((mpr_local_sig)m->dst->sig)->alias) {
+            lo_message_add_string(msg, mpr_prop_as_str(PROP(ALIAS), 0));
+            lo_message_add_int32(msg, ((mpr_local_sig)m->dst->sig)->alias);
+        }
     }
 
     /* source properties */
@@ -81,6 +81,12 @@ void mpr_obj_increment_version(mpr_obj obj);
 
 void mpr_net_add_dev(mpr_net n, mpr_local_dev d);
 
+/*! Probe the bus for the name formed by the prefix and current ordinal of a device. */
+void mpr_net_probe_dev_name(mpr_net n, mpr_local_dev d);
+
+/*! Remove a local device from the network. Returns the number of local devices remaining. */
+int mpr_net_remove_dev(mpr_net n, mpr_local_dev d);
+
 void mpr_net_remove_dev_methods(mpr_net n, mpr_local_dev d);
 
 void mpr_net_poll(mpr_net n);
@@ -97,6 +103,46 @@ void mpr_net_add_msg(mpr_net n, const char *str, net_msg_t cmd, lo_message msg);
 
 void mpr_net_send(mpr_net n);
 
+/*! Send datagrams on a socket using as few system calls as possible: a single sendmmsg() per
+ *  batch where available, otherwise one sendto() per datagram. A datagram rejected by sendmmsg()
+ *  is retried once with sendto() and counted as dropped if that also fails. */
+int mpr_net_send_dgrams(mpr_send_stats stats, int fd, mpr_dgram q, int num);
+
+/*! Create a subscriber record, resolving its socket address so that admin bundles can be
+ *  serialized once for all subscribers. */
+mpr_subscriber mpr_net_new_subscriber(const char *host, const char *port);
+
+void mpr_net_free_subscriber(mpr_subscriber sub);
+
+/*! Stamp a local object with the next revision of the network, marking its state as changed for
+ *  subscribers catching up from an earlier revision. */
+void mpr_net_stamp_obj(mpr_net n, mpr_obj o);
+
+int mpr_net_recv_data(mpr_net n, mpr_local_dev d, int max_msgs, int max_usec);
+
+/*! Set whether the caller is about to block waiting for data, in which case devices on the same
+ *  host wake it up when they write to shared memory. Only the rings of links to device d are
+ *  considered, or those of all local devices if d is 0. Returns 1 if data is already waiting. */
+int mpr_net_set_shm_waiting(mpr_net n, mpr_local_dev d, int waiting);
+
+int mpr_net_get_fds(mpr_net n, int *fds, int num);
+
+/*! Returns bit flags (1 << SERVER_*) for the admin servers, and the data servers of device d if
+ *  it is not 0, whose sockets are listed in fds. */
+int mpr_net_get_ready_servers(mpr_net n, mpr_local_dev d, const int *fds, int num);
+
+int mpr_net_recv_admin(mpr_net n, int ready);
+
+/*! Returns the number of seconds until mpr_net_poll() next has work to do. Callers about to
+ *  block should first call mpr_net_set_shm_waiting(). */
+double mpr_net_get_next_wait(mpr_net n);
+
+/*! Returns the number of seconds until the next housekeeping task of mpr_net_poll() is due. */
+double mpr_net_get_next_timer(mpr_net n);
+
+/*! Returns non-zero if admin messages are waiting to be sent by mpr_net_poll(). */
+int mpr_net_has_queued_msgs(mpr_net n);
+
 void mpr_net_free_msgs(mpr_net n);
 
 void mpr_net_free(mpr_net n);
@@ -112,8 +158,14 @@ if (!VARNAME) {                                     \
 
 int mpr_dev_set_from_msg(mpr_dev dev, mpr_msg msg);
 
+/*! Add, renew or remove a subscription. If revs is not null it holds the last revisions of
+ *  signals and maps received by the subscriber from the revision clock identified by epoch, and
+ *  only the objects changed or removed since then are sent. */
 void mpr_dev_manage_subscriber(mpr_local_dev dev, lo_address address, int flags,
-                               int timeout_seconds, int revision);
+                               int timeout_seconds, int revision, int epoch, const int *revs);
+
+/*! Remember a removal announced to the subscribers of a device. */
+void mpr_dev_add_tombstone(mpr_local_dev dev, int type, net_msg_t cmd, lo_message msg);
 
 /*! Return the list of inter-device links associated with a given device.
  *  \param dev          Device record query.
@@ -131,12 +183,54 @@ mpr_sig mpr_dev_get_sig_by_name(mpr_dev dev, const char *sig_name);
 
 mpr_id mpr_dev_get_unused_sig_id(mpr_local_dev dev);
 
+/*! Add a signal to the chain and name index of its device. */
+void mpr_dev_add_sig(mpr_dev dev, mpr_sig sig);
+
+/*! Remove a signal from the chain and name index of its device. */
+void mpr_dev_remove_sig(mpr_dev dev, mpr_sig sig);
+
 int mpr_dev_add_link(mpr_dev dev, mpr_dev rem);
 void mpr_dev_remove_link(mpr_dev dev, mpr_dev rem);
 
 int mpr_dev_handler(const char *path, const char *types, lo_arg **argv, int argc,
                     lo_message msg, void *data);
 
+void mpr_dev_add_sig_alias(mpr_local_dev dev, mpr_local_sig sig);
+void mpr_dev_remove_sig_alias(mpr_local_dev dev, mpr_local_sig sig);
+mpr_local_sig mpr_dev_get_sig_by_alias(mpr_local_dev dev, const char *path);
+
+/*! Queue a signal update for the device I/O thread if called from another thread, or for the
+ *  next safe point if the update interrupted the device, e.g. from a POSIX signal handler.
+ *  \param sig          The local signal to update.
+ *  \param id           The instance id.
+ *  \param len          The value length, or 0 to release the instance.
+ *  \param type         The value type.
+ *  \param val          The value.
+ *  \return             Non-zero if the update was queued or dropped, zero if the caller should
+ *                      apply it directly. */
+int mpr_dev_queue_update(mpr_local_sig sig, mpr_id id, int len, mpr_type type, const void *val);
+
+/*! Make sure updates of values up to val_size bytes can be queued for the device. The queue
+ *  itself is only allocated or grown by mpr_dev_poll(), when the I/O thread starts, or when
+ *  real-time resources are preallocated, and never while updates may be pushed into it. */
+void mpr_dev_reserve_update_queue(mpr_local_dev dev, size_t val_size);
+
+/*! Mark whether the device update path is in use by the calling context, returning the previous
+ *  state. Updates made while it is in use are queued by mpr_dev_queue_update(). */
+MPR_INLINE static int mpr_dev_set_busy(mpr_local_dev dev, int busy)
+{
+    int prev = dev->busy;
+    dev->busy = busy;
+    return prev;
+}
+
+/*! Size the memory pools used by the signal update path for the device's current signals and
+ *  maps. Does nothing unless real-time mode is enabled. */
+void mpr_dev_rt_prealloc(mpr_local_dev dev);
+
+/*! Record that the signal update path had to allocate memory in real-time mode. */
+void mpr_dev_rt_miss(mpr_local_dev dev);
+
 int mpr_dev_bundle_start(lo_timetag t, void *data);
 
 MPR_INLINE static void mpr_dev_LID_incref(mpr_local_dev dev, mpr_id_map map)
@@ -161,6 +255,8 @@ void mpr_dev_add_sig_methods(mpr_local_dev dev, mpr_local_sig sig);
 
 void mpr_dev_remove_sig_methods(mpr_local_dev dev, mpr_local_sig sig);
 
+void mpr_dev_reserve_idmap(mpr_local_dev dev);
+
 mpr_id_map mpr_dev_add_idmap(mpr_local_dev dev, int group, mpr_id LID, mpr_id GID);
 
 mpr_id_map mpr_dev_get_idmap_by_LID(mpr_local_dev dev, int group, mpr_id LID);
@@ -184,6 +280,52 @@ mpr_link mpr_dev_get_link_by_remote(mpr_local_dev dev, mpr_dev remote);
  *  \return             Information about the object, or zero if not found. */
 mpr_obj mpr_graph_get_obj(mpr_graph g, mpr_type type, mpr_id id);
 
+/*! Add a device, signal or map to the indexes of its graph, or move it after its id has changed.
+ *  Must be called whenever the id of an object or the name of a device in the graph is set.
+ *  \param g            The graph containing the object.
+ *  \param o            The object to index. */
+void mpr_graph_index_obj(mpr_graph g, mpr_obj o);
+
+/*! Record that an indexed object was added, removed or modified so that property indexes replace
+ *  its entries when next queried.
+ *  \param g            The graph containing the object.
+ *  \param o            The object that changed. */
+void mpr_graph_touch_obj(mpr_graph g, mpr_obj o);
+
+/*! Check whether an object is still indexed by the graph without dereferencing it.
+ *  \param g            The graph to query.
+ *  \param type         The type of the object.
+ *  \param o            The object to find, which may already have been freed.
+ *  \param id           The id under which the object was indexed.
+ *  \return             1 if the object is in the graph, 0 otherwise. */
+int mpr_graph_has_obj(mpr_graph g, mpr_type type, mpr_obj o, mpr_id id);
+
+/*! Get the list head holding all objects of a given type.
+ *  \param g            The graph to query.
+ *  \param type         The object type.
+ *  \return             Pointer to the list head, or zero if the type is not valid. */
+void **mpr_graph_get_list_head(mpr_graph g, mpr_type type);
+
+/*! Find objects that may match a property filter using a property index of the graph.
+ *  \param g            The graph to query.
+ *  \param type         The type of objects to find.
+ *  \param p            Property of the filter.
+ *  \param key          Name of the property, or NULL.
+ *  \param len          Length of the filter value.
+ *  \param val_type     Type of the filter value.
+ *  \param val          The filter value.
+ *  \param op           Comparison operator of the filter.
+ *  \param objs         Set to a newly allocated array of candidate objects.
+ *  \param ids          Set to a newly allocated array of the ids indexing each candidate.
+ *  \return             The number of candidates, or -1 if no index can be used. */
+int mpr_graph_get_index_candidates(mpr_graph g, mpr_type type, mpr_prop p, const char *key,
+                                   int len, mpr_type val_type, const void *val, mpr_op op,
+                                   mpr_obj **objs, mpr_id **ids);
+
+/*! Free all property indexes of a graph.
+ *  \param g            The graph. */
+void mpr_graph_free_indexes(mpr_graph g);
+
 /*! Find information for a registered device.
  *  \param g            The graph to query.
  *  \param name         Name of the device to find in the graph.
@@ -199,6 +341,11 @@ mpr_map mpr_graph_get_map_by_names(mpr_graph g, int num_src, const char **srcs,
  *  \param e            The graph event type. */
 void mpr_graph_call_cbs(mpr_graph g, mpr_obj o, mpr_type t, mpr_graph_evt e);
 
+/*! Deliver the events collected since the last call to the batched graph callbacks, then free
+ *  the objects that were removed in the meantime.
+ *  \param g            The graph to flush. */
+void mpr_graph_call_batch_cbs(mpr_graph g);
+
 void mpr_graph_cleanup(mpr_graph g);
 
 /***** Router *****/
@@ -272,6 +419,9 @@ void mpr_sig_send_removed(mpr_local_sig sig);
  *                  strategy. */
 int mpr_sig_get_idmap_with_LID(mpr_local_sig sig, mpr_id LID, int flags, mpr_time t, int activate);
 
+/*! Grow the signal's array of instance id maps so that all instances can be active at once. */
+void mpr_sig_reserve_idmaps(mpr_local_sig sig);
+
 /*! Fetch a reserved (preallocated) signal instance using instance id map,
  *  activating it if necessary.
  *  \param s        The signal owning the desired instance.
@@ -300,11 +450,37 @@ mpr_list mpr_link_get_maps(mpr_link link);
 void mpr_link_remove_map(mpr_link link, mpr_local_map rem);
 
 void mpr_link_init(mpr_link link);
-void mpr_link_connect(mpr_link link, const char *host, int admin_port,
+void mpr_link_connect(mpr_link link, const char *host, const char *host_id, int admin_port,
                       int data_port);
 void mpr_link_free(mpr_link link);
 int mpr_link_process_bundles(mpr_link link, mpr_time t, int idx);
-void mpr_link_add_msg(mpr_link link, mpr_sig dst, lo_message msg, mpr_time t, mpr_proto proto, int idx);
+int mpr_link_send_dgrams(mpr_net net, mpr_local_dev dev);
+void mpr_link_add_msg(mpr_link link, mpr_dev dst, const char *path, lo_message msg, mpr_time t,
+                      mpr_proto proto, int idx);
+
+/*! Returns non-zero if both devices of the link are local, in which case its messages are
+ *  delivered by calling the signal handlers directly. */
+int mpr_link_get_is_in_process(mpr_link link);
+
+char *mpr_link_reserve_msg(mpr_link link, mpr_proto proto, size_t len, mpr_time t, int idx);
+
+/*! Grow the link's serialized bundle buffers to hold at least size bytes in num_msgs messages. */
+void mpr_link_reserve_bufs(mpr_link link, size_t size, int num_msgs);
+
+/*! Grow the queue of datagrams waiting to be sent to hold at least num entries. */
+void mpr_link_reserve_dgrams(mpr_net net, int num);
+
+/*! Open the shared memory ring created by the remote device if both devices are on the same host
+ *  and it has not been opened yet. */
+void mpr_link_open_shm(mpr_link link);
+
+/*! Create the ring for datagrams from the remote device if both devices are on the same host, and
+ *  open the one created by the remote device. Called when a map using shared memory is set up. */
+void mpr_link_use_shm(mpr_link link);
+
+/*! Dispatch the datagrams waiting in the link's incoming shared memory ring. Returns the number
+ *  of datagrams handled. */
+int mpr_link_recv_shm(mpr_link link);
 
 mpr_link mpr_graph_add_link(mpr_graph g, mpr_dev dev1, mpr_dev dev2);
 
@@ -314,6 +490,14 @@ int mpr_link_get_is_local(mpr_link link);
 
 void mpr_map_alloc_values(mpr_local_map map);
 
+/*! Evaluate the expression of an outgoing map for each updated instance, storing the results
+ *  for mpr_map_send(). Only state owned by the map is modified, so different maps may be
+ *  evaluated concurrently by threads using different expression stacks.
+ *  \param map          The mapping process to perform.
+ *  \param stk          The expression stack to use.
+ *  \param time         Timestamp for this update. */
+void mpr_map_eval(mpr_local_map map, mpr_expr_stack stk, mpr_time time);
+
 /*! Process the signal instance value according to mapping properties.
  *  The result of this operation should be sent to the destination.
  *  \param map          The mapping process to perform.
@@ -325,6 +509,33 @@ void mpr_map_receive(mpr_local_map map, mpr_time time);
 lo_message mpr_map_build_msg(mpr_local_map map, mpr_local_slot slot, const void *val,
                              mpr_type *types, mpr_id_map idmap);
 
+void mpr_map_set_alias(mpr_local_map map, int alias);
+
+const char *mpr_map_get_dst_path(mpr_local_map map);
+
+void mpr_map_add_update(mpr_local_map map, mpr_local_slot slot, const void *val,
+                        mpr_type *types, mpr_id_map idmap, mpr_time t, int idx);
+
+/*! Queue a value update or instance release for a map on the given link, serializing it
+ *  directly into the link's bundle buffer where possible.
+ *  \param map          The map.
+ *  \param slot         The slot to identify in the message, or NULL.
+ *  \param link         The link to send the message on.
+ *  \param path         The destination path.
+ *  \param val          The value, or NULL for an instance release.
+ *  \param types        The type of each vector element, or NULL for an instance release.
+ *  \param idmap        The instance id map, or NULL.
+ *  \param t            Time associated with the message.
+ *  \param idx          The bundle index. */
+void mpr_map_add_msg(mpr_local_map map, mpr_local_slot slot, mpr_link link, const char *path,
+                     const void *val, mpr_type *types, mpr_id_map idmap, mpr_time t, int idx);
+
+/*! Build the pre-serialized value update messages for a map's local sources in advance. */
+void mpr_map_build_tmpls(mpr_local_map map);
+
+/*! Return an upper bound on the bytes needed to bundle one message for a map. */
+size_t mpr_map_get_max_msg_len(mpr_local_map map);
+
 /*! Set a mapping's properties based on message parameters. */
 int mpr_map_set_from_msg(mpr_map map, mpr_msg msg, int override);
 
@@ -348,6 +559,10 @@ mpr_slot mpr_slot_new(mpr_map map, mpr_sig sig, unsigned char is_local, unsigned
 
 void mpr_slot_alloc_values(mpr_local_slot slot, int num_inst, int hist_size);
 
+/*! Remove a slot from the chain of slots of its signal, so that the signal no longer reports
+ *  its map. Called by mpr_slot_free(). */
+void mpr_slot_unlink(mpr_slot slot);
+
 void mpr_slot_free(mpr_slot slot);
 
 void mpr_slot_free_value(mpr_local_slot slot);
@@ -486,12 +701,18 @@ int mpr_expr_get_num_input_slots(mpr_expr expr);
 void mpr_expr_free(mpr_expr expr);
 
 mpr_expr_stack mpr_expr_stack_new();
+
+/*! Grow an expression stack to the size of another, so that it can evaluate the same
+ *  expressions. Expressions only size the stack they were parsed with. */
+void mpr_expr_stack_reserve(mpr_expr_stack stk, mpr_expr_stack ref);
+
 void mpr_expr_stack_free(mpr_expr_stack stk);
 
 /**** String tables ****/
 
-/*! Create a new string table. */
-mpr_tbl mpr_tbl_new(void);
+/*! Create a new string table.
+ * \param strings  Table used to intern the keys of extra properties, or zero to copy them. */
+mpr_tbl mpr_tbl_new(mpr_strtab strings);
 
 /*! Clear the contents of a string table.
  * \param tab Table to free. */
@@ -563,7 +784,9 @@ int match_pattern(const char* s, const char* p);
 
 void *mpr_list_from_data(const void *data);
 
-void *mpr_list_add_item(void **list, size_t size);
+/*! Allocate an item of size bytes from a memory pool and prepend it to a list. Queries on the
+ *  list allocate from the pool of its first item. */
+void *mpr_list_add_item(void **list, size_t size, mpr_slab slab);
 
 void mpr_list_remove_item(void **list, void *item);
 
@@ -572,8 +795,135 @@ void mpr_list_free_item(void *item);
 mpr_list mpr_list_new_query(const void **list, const void *func,
                             const mpr_type *types, ...);
 
+/*! Create a query over list that only tests the candidates returned by next, e.g. the objects
+ *  chained to a device or signal. Since unions and other queries derived from the result still
+ *  walk the whole list, func must match exactly the same items as it would without next.
+ *  \param list         The list to query.
+ *  \param next         Function returning the first candidate when passed a null item, or the
+ *                      candidate following the item otherwise. It receives the query arguments.
+ *  \param func         Function testing each candidate.
+ *  \param types        The types of the query arguments.
+ *  \return             The query, which must be started using mpr_list_start(). */
+mpr_list mpr_list_new_chained_query(const void **list, const void *next, const void *func,
+                                    const mpr_type *types, ...);
+
 mpr_list mpr_list_start(mpr_list list);
 
+/**** Memory pools ****/
+
+mpr_slab mpr_slab_new(void);
+
+/*! Free a pool along with any blocks still allocated from it. If blocks allocated with
+ *  mpr_slab_alloc_ref() are still in use the pool is freed when the last of them is released. */
+void mpr_slab_free(mpr_slab s);
+
+/*! Allocate a block from a pool, or using malloc() if s is zero or the block is too large. */
+void *mpr_slab_alloc(mpr_slab s, size_t size);
+
+/*! Allocate a block that keeps its pool alive until it is released, for blocks that may outlive
+ *  the owner of the pool. */
+void *mpr_slab_alloc_ref(mpr_slab s, size_t size);
+
+/*! Allocate a block from a pool and set it to zero. */
+void *mpr_slab_calloc(mpr_slab s, size_t size);
+
+/*! Return a block to the pool it was allocated from. */
+void mpr_slab_release(void *ptr);
+
+/*! Get the pool a block was allocated from. */
+mpr_slab mpr_slab_get_owner(const void *ptr);
+
+/**** Interned strings ****/
+
+mpr_strtab mpr_strtab_new(void);
+
+/*! Free a table along with any strings still interned in it. */
+void mpr_strtab_free(mpr_strtab t);
+
+/*! Get the shared copy of a string, adding it to the table if necessary. If t is zero a private
+ *  copy is returned instead. Either way the result must be released using mpr_strtab_release(). */
+const char *mpr_strtab_add(mpr_strtab t, const char *str);
+
+/*! Get the shared copy of a string without adding it, or zero if it is not in the table. */
+const char *mpr_strtab_find(mpr_strtab t, const char *str);
+
+/*! Release a string returned by mpr_strtab_add() for the same table. */
+void mpr_strtab_release(mpr_strtab t, const char *str);
+
+/**** Queues ****/
+
+/*! Create a lock-free queue holding up to capacity items (rounded up to a power of two). */
+mpr_ring mpr_ring_new(int capacity, size_t item_size);
+
+void mpr_ring_free(mpr_ring r);
+
+/*! Claim the next free item for writing; may be called from any thread. Returns 0 if the queue
+ *  is full. The item must be passed to mpr_ring_commit() once written. */
+void *mpr_ring_reserve(mpr_ring r);
+
+void mpr_ring_commit(mpr_ring r, void *item);
+
+/*! Copy an item into the queue. Returns 0 if the queue is full. */
+int mpr_ring_push(mpr_ring r, const void *item);
+
+/*! Get the oldest committed item, or 0 if the queue is empty. Consumer thread only. */
+void *mpr_ring_peek(mpr_ring r);
+
+/*! Release the item returned by mpr_ring_peek(). Consumer thread only. */
+void mpr_ring_release(mpr_ring r);
+
+int mpr_ring_get_num_dropped(mpr_ring r);
+
+/**** Shared memory ****/
+
+/*! Create the shared memory ring carrying datagrams from device src to device dst, replacing
+ *  any stale segment with the same name. Called by the receiving end; size must be a power of
+ *  two. Returns 0 if shared memory is not available. */
+mpr_shm mpr_shm_new(mpr_id dst, mpr_id src, size_t size);
+
+/*! Open the ring created by the receiving device dst for datagrams from device src. */
+mpr_shm mpr_shm_open(mpr_id dst, mpr_id src);
+
+/*! Unmap a ring, and remove the segment if it was created by this process. */
+void mpr_shm_free(mpr_shm shm);
+
+/*! Copy a datagram into the ring. Producer only.
+ *  \param shm         The ring.
+ *  \param data        The datagram.
+ *  \param len         The length of the datagram in bytes.
+ *  \return            -1 if the consumer has closed the ring, 0 if the ring is full, 2 if the
+ *                      datagram was written and the consumer must be woken up, or 1 otherwise. */
+int mpr_shm_write(mpr_shm shm, const void *data, size_t len);
+
+/*! Get the oldest datagram in the ring, or 0 if it is empty. The contents of the ring are
+ *  discarded if they are corrupt. Consumer only. */
+const void *mpr_shm_peek(mpr_shm shm, size_t *len);
+
+/*! Release the datagram returned by mpr_shm_peek(). Consumer only. */
+void mpr_shm_release(mpr_shm shm);
+
+/*! Set whether the consumer is about to block and must be woken by the producer. Returns 1 if
+ *  the ring is not empty, in which case the consumer should not block. */
+int mpr_shm_set_waiting(mpr_shm shm, int waiting);
+
+/*! Get a string identifying this host and boot, or 0 if it is unknown. */
+const char *mpr_shm_get_host_id(void);
+
+/**** Workers ****/
+
+/*! Start a pool of threads evaluating map expressions alongside the polling thread. */
+mpr_workers mpr_workers_new(int num_workers);
+
+void mpr_workers_free(mpr_workers w);
+
+/*! Add an updated map to be evaluated by the next call to mpr_workers_eval(). Returns 1 if
+ *  memory had to be allocated, -1 on error, or 0 otherwise. */
+int mpr_workers_add_map(mpr_workers w, mpr_local_map map);
+
+/*! Evaluate the added maps using the pool and the calling thread, which uses the expression
+ *  stack stk, and return once all have been evaluated. */
+void mpr_workers_eval(mpr_workers w, mpr_expr_stack stk, mpr_time time);
+
 /**** Time ****/
 
 /*! Get the current time. */
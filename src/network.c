@@ -1,5 +1,9 @@
 #include "config.h"
 
+#if (defined(HAVE_RECVMMSG) || defined(HAVE_SENDMMSG)) && !defined(_GNU_SOURCE)
+ #define _GNU_SOURCE /* for recvmmsg() and sendmmsg() */
+#endif
+
 #include <lo/lo.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -8,6 +12,10 @@
 #include <zlib.h>
 #include <math.h>
 
+#if defined(HAVE_RECVMMSG) || defined(HAVE_SENDMMSG)
+ #include <errno.h>
+#endif
+
 #ifdef HAVE_GETIFADDRS
  #include <ifaddrs.h>
  #include <net/if.h>
@@ -15,6 +23,8 @@
 
 #ifdef HAVE_ARPA_INET_H
  #include <arpa/inet.h>
+ #include <sys/socket.h>
+ #include <netdb.h>
 #else
  #ifdef HAVE_WINSOCK2_H
   #include <winsock2.h>
@@ -34,6 +44,8 @@ extern const char* prop_msg_strings[MPR_PROP_EXTRA+1];
 #define BUNDLE_DST_BUS          0
 
 #define MAX_BUNDLE_LEN 65535
+#define TCP_POLL_SEC 0.01
+#define FAST_ALLOC_SCALE 0.1
 #define FIND 0
 #define UPDATE 1
 #define ADD 2
@@ -295,25 +307,34 @@ static void seed_srand()
     srand(s);
 }
 
+/* Messages addressed to a device by name are handled with the device as user data. The other
+ * device handlers are shared by all local devices, so they are only added once. */
 static void mpr_net_add_dev_methods(mpr_net net, mpr_local_dev dev)
 {
     int i;
     char path[256];
     const char *dname = mpr_dev_get_name((mpr_dev)dev);
     for (i = 0; i < NUM_DEV_HANDLERS; i++) {
-        snprintf(path, 256, net_msg_strings[device_handlers[i].str_idx], dname);
+        const char *str = net_msg_strings[device_handlers[i].str_idx];
+        void *user = strstr(str, "%s") ? (void*)dev : (void*)net;
+        if (user == net && net->dev_methods_added)
+            continue;
+        snprintf(path, 256, str, dname);
         lo_server_add_method((net)->servers[SERVER_BUS], path, device_handlers[i].types,
-                             device_handlers[i].h, net);
+                             device_handlers[i].h, user);
         lo_server_add_method((net)->servers[SERVER_MESH], path, device_handlers[i].types,
-                             device_handlers[i].h, net);
+                             device_handlers[i].h, user);
     }
+    net->dev_methods_added = 1;
 }
 
 void mpr_net_remove_dev_methods(mpr_net net, mpr_local_dev dev)
 {
-    int i, j;
+    int i, j, last = net->num_devs <= 1;
     char path[256];
+    const char *dname = mpr_dev_get_name((mpr_dev)dev);
     for (i = 0; i < NUM_DEV_HANDLERS; i++) {
+        const char *str = net_msg_strings[device_handlers[i].str_idx];
         /* make sure method isn't also used by graph */
         int found = 0;
         for (j = 0; j < NUM_GRAPH_HANDLERS; j++) {
@@ -324,11 +345,20 @@ void mpr_net_remove_dev_methods(mpr_net net, mpr_local_dev dev)
         }
         if (found)
             continue;
-        snprintf(path, 256, net_msg_strings[device_handlers[i].str_idx],
-                 mpr_dev_get_name((mpr_dev)dev));
+        if (strstr(str, "%s")) {
+            if (!dname)
+                continue;
+        }
+        else if (!last) {
+            /* still used by other local devices */
+            continue;
+        }
+        snprintf(path, 256, str, dname);
         lo_server_del_method((net)->servers[SERVER_BUS], path, device_handlers[i].types);
         lo_server_del_method((net)->servers[SERVER_MESH], path, device_handlers[i].types);
     }
+    if (last)
+        net->dev_methods_added = 0;
 }
 
 void mpr_net_add_graph_methods(mpr_net net)
@@ -411,6 +441,8 @@ void mpr_net_init(mpr_net net, const char *iface, const char *group, int port)
 
     mpr_net_add_graph_methods(net);
 
+    /* devices are registered again on the new servers */
+    net->dev_methods_added = 0;
     for (i = 0; i < net->num_devs; i++)
         mpr_net_add_dev(net, net->devs[i]);
 }
@@ -420,12 +452,106 @@ const char *mpr_get_version()
     return PACKAGE_VERSION;
 }
 
+int mpr_net_send_dgrams(mpr_send_stats stats, int fd, mpr_dgram q, int num)
+{
+    int i = 0;
+#ifdef HAVE_SENDMMSG
+    static int have_sendmmsg = 1;
+    while (have_sendmmsg && i < num) {
+        struct mmsghdr hdrs[MAX_DGRAM_BATCH];
+        struct iovec iov[MAX_DGRAM_BATCH];
+        int j, n = num - i < MAX_DGRAM_BATCH ? num - i : MAX_DGRAM_BATCH;
+        memset(hdrs, 0, n * sizeof(struct mmsghdr));
+        for (j = 0; j < n; j++) {
+            iov[j].iov_base = q[i + j].data;
+            iov[j].iov_len = q[i + j].len;
+            hdrs[j].msg_hdr.msg_iov = &iov[j];
+            hdrs[j].msg_hdr.msg_iovlen = 1;
+            hdrs[j].msg_hdr.msg_name = q[i + j].addr;
+            hdrs[j].msg_hdr.msg_namelen = q[i + j].addr_len;
+        }
+        ++stats->num_calls;
+        if ((n = sendmmsg(fd, hdrs, n, 0)) > 0)
+            i += n;
+        else if (ENOSYS == errno) {
+            trace_net("sendmmsg() unavailable, falling back to sendto().\n");
+            have_sendmmsg = 0;
+        }
+        else {
+            /* retry the datagram that could not be sent once before dropping it */
+            ++stats->num_calls;
+            if (sendto(fd, q[i].data, q[i].len, 0, (struct sockaddr*)q[i].addr,
+                       q[i].addr_len) < 0)
+                ++stats->num_dropped;
+            ++i;
+        }
+    }
+#endif
+    for (; i < num; i++) {
+        ++stats->num_calls;
+        if (sendto(fd, q[i].data, q[i].len, 0, (struct sockaddr*)q[i].addr, q[i].addr_len) < 0)
+            ++stats->num_dropped;
+    }
+    return num;
+}
+
+mpr_subscriber mpr_net_new_subscriber(const char *host, const char *port)
+{
+    struct addrinfo hints, *res = 0;
+    mpr_subscriber sub = (mpr_subscriber)calloc(1, sizeof(struct _mpr_subscriber));
+    RETURN_ARG_UNLESS(sub, 0);
+    sub->addr = lo_address_new(host, port);
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    /* subscriber addresses are taken from incoming messages, so never block on a name lookup */
+    hints.ai_flags = AI_NUMERICHOST | AI_NUMERICSERV;
+    if (getaddrinfo(host, port, &hints, &res) || !res) {
+        trace_net("couldn't resolve address %s:%s, using liblo bundles.\n", host, port);
+        return sub;
+    }
+    if ((sub->sa = malloc(res->ai_addrlen))) {
+        memcpy(sub->sa, res->ai_addr, res->ai_addrlen);
+        sub->sa_len = (int)res->ai_addrlen;
+    }
+    freeaddrinfo(res);
+    return sub;
+}
+
+void mpr_net_free_subscriber(mpr_subscriber sub)
+{
+    FUNC_IF(lo_address_free, sub->addr);
+    FUNC_IF(free, sub->sa);
+    free(sub);
+}
+
+/* Serialize the current bundle into the reusable admin buffer. */
+static char *_serialise_bundle(mpr_net net, size_t len)
+{
+    if (len > net->admin_buf.size) {
+        char *data = (char*)realloc(net->admin_buf.data, len);
+        RETURN_ARG_UNLESS(data, 0);
+        net->admin_buf.data = data;
+        net->admin_buf.size = len;
+    }
+    lo_bundle_serialise(net->bundle, net->admin_buf.data, &len);
+    return net->admin_buf.data;
+}
+
 void mpr_net_send(mpr_net net)
 {
+    size_t len;
     RETURN_UNLESS(net->bundle);
+    len = lo_bundle_length(net->bundle);
 
     if (BUNDLE_DST_SUBSCRIBERS == net->addr.dst) {
+        /* The bundle is serialized once and the same bytes are sent to every subscriber, in
+         * batches of datagrams sent with a single system call where available. */
         mpr_subscriber *sub = &net->addr.dev->subscribers;
+        mpr_dgram_t q[MAX_DGRAM_BATCH];
+        int num = 0, fd = lo_server_get_socket_fd(net->servers[SERVER_MESH]);
+        char *data = 0;
         mpr_time t;
         if (*sub)
             mpr_time_set(&t, MPR_NOW);
@@ -439,19 +565,38 @@ void mpr_net_send(mpr_net net)
 #endif
                 mpr_subscriber temp = *sub;
                 *sub = temp->next;
-                FUNC_IF(lo_address_free, temp->addr);
-                free(temp);
+                mpr_net_free_subscriber(temp);
                 continue;
             }
-            if ((*sub)->flags & net->msg_type)
-                lo_send_bundle_from((*sub)->addr, net->servers[SERVER_MESH], net->bundle);
+            if ((*sub)->flags & net->msg_type) {
+                if ((*sub)->sa && (data || (data = _serialise_bundle(net, len)))) {
+                    q[num].data = data;
+                    q[num].len = len;
+                    q[num].addr = (*sub)->sa;
+                    q[num].addr_len = (*sub)->sa_len;
+                    q[num].buf = 0;
+                    if (++num == MAX_DGRAM_BATCH) {
+                        mpr_net_send_dgrams(&net->admin_stats, fd, q, num);
+                        num = 0;
+                    }
+                }
+                else
+                    lo_send_bundle_from((*sub)->addr, net->servers[SERVER_MESH], net->bundle);
+                net->admin_bytes += len;
+            }
             sub = &(*sub)->next;
         }
+        if (num)
+            mpr_net_send_dgrams(&net->admin_stats, fd, q, num);
     }
-    else if (BUNDLE_DST_BUS == net->addr.dst)
+    else if (BUNDLE_DST_BUS == net->addr.dst) {
         lo_send_bundle_from(net->addr.bus, net->servers[SERVER_MESH], net->bundle);
-    else
+        net->admin_bytes += len;
+    }
+    else {
         lo_send_bundle_from(net->addr.dst, net->servers[SERVER_MESH], net->bundle);
+        net->admin_bytes += len;
+    }
 
     lo_bundle_free_recursive(net->bundle);
     net->bundle = 0;
@@ -507,11 +652,249 @@ void mpr_net_add_msg(mpr_net net, const char *s, net_msg_t c, lo_message m)
         init_bundle(net);
     }
     lo_bundle_add_message(net->bundle, s, m);
+
+    /* remember removals so that they can be replayed to subscribers catching up later */
+    if (BUNDLE_DST_SUBSCRIBERS == net->addr.dst && (MSG_SIG_REM == c || MSG_UNMAPPED == c))
+        mpr_dev_add_tombstone(net->addr.dev, net->msg_type, c, m);
+}
+
+void mpr_net_stamp_obj(mpr_net net, mpr_obj o)
+{
+    if (!net->revs.paused)
+        o->rev = ++net->revs.rev;
+}
+
+#ifdef HAVE_RECVMMSG
+/* Receive up to max datagrams from the UDP data server with a single recvmmsg() call and dispatch
+ * them to the device handlers. Returns the number of datagrams received, or -1 if recvmmsg() is
+ * not supported by the kernel. */
+static int recv_dgrams(mpr_net net, lo_server server, int fd, int max)
+{
+    struct mmsghdr hdrs[RECV_BATCH];
+    struct iovec iov[RECV_BATCH];
+    int i, n;
+    if (!net->recv.ring) {
+        /* pages are only committed once they are written by the kernel */
+        net->recv.ring = (char*)malloc(RECV_BATCH * RECV_SLOT_LEN);
+        RETURN_ARG_UNLESS(net->recv.ring, -1);
+    }
+    if (max > RECV_BATCH)
+        max = RECV_BATCH;
+    memset(hdrs, 0, max * sizeof(struct mmsghdr));
+    for (i = 0; i < max; i++) {
+        iov[i].iov_base = net->recv.ring + i * RECV_SLOT_LEN;
+        iov[i].iov_len = RECV_SLOT_LEN;
+        hdrs[i].msg_hdr.msg_iov = &iov[i];
+        hdrs[i].msg_hdr.msg_iovlen = 1;
+    }
+    ++net->recv.num_calls;
+    n = recvmmsg(fd, hdrs, max, MSG_DONTWAIT, NULL);
+    if (n < 0)
+        return ENOSYS == errno ? -1 : 0;
+    for (i = 0; i < n; i++) {
+        if (hdrs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+            trace_net("dropping truncated datagram.\n");
+            continue;
+        }
+        lo_server_dispatch_data(server, iov[i].iov_base, hdrs[i].msg_len);
+    }
+    return n;
+}
+#endif
+
+/* Dispatch the datagrams waiting in the shared memory rings of links from devices on this host to
+ * the local device dev. */
+static int recv_shm(mpr_net net, mpr_local_dev dev)
+{
+    int count = 0;
+    mpr_list links = mpr_list_from_data(net->graph->links);
+    while (links) {
+        mpr_link link = (mpr_link)*links;
+        links = mpr_list_get_next(links);
+        if (link->devs[LOCAL_DEV] == (mpr_dev)dev)
+            count += mpr_link_recv_shm(link);
+    }
+    return count;
+}
+
+int mpr_net_set_shm_waiting(mpr_net net, mpr_local_dev dev, int waiting)
+{
+    int pending = 0;
+    mpr_list links = mpr_list_from_data(net->graph->links);
+    while (links) {
+        mpr_link link = (mpr_link)*links;
+        links = mpr_list_get_next(links);
+        if (link->shm.rx && (!dev || link->devs[LOCAL_DEV] == (mpr_dev)dev))
+            pending |= mpr_shm_set_waiting(link->shm.rx, waiting);
+    }
+    return pending;
+}
+
+/* Drain and dispatch datagrams waiting in shared memory and on the data servers of a device until
+ * both servers are empty or the budget is exhausted. A max_msgs or max_usec of 0 means no limit.
+ * Returns the number of datagrams and TCP messages handled. */
+int mpr_net_recv_data(mpr_net net, mpr_local_dev dev, int max_msgs, int max_usec)
+{
+    int count, n;
+    double deadline = max_usec > 0 ? mpr_get_current_time() + max_usec * 0.000001 : 0;
+    lo_server udp = dev->servers[SERVER_UDP], tcp = dev->servers[SERVER_TCP];
+#ifdef HAVE_RECVMMSG
+    static int have_recvmmsg = 1;
+    int fd;
+#endif
+    RETURN_ARG_UNLESS(udp && tcp, 0);
+#ifdef HAVE_RECVMMSG
+    fd = lo_server_get_socket_fd(udp);
+#endif
+
+    count = recv_shm(net, dev);
+    while (!max_msgs || count < max_msgs) {
+        n = 0;
+#ifdef HAVE_RECVMMSG
+        if (   have_recvmmsg
+            && (n = recv_dgrams(net, udp, fd, max_msgs ? max_msgs - count : RECV_BATCH)) < 0) {
+            trace_net("recvmmsg() unavailable, falling back to recvfrom().\n");
+            have_recvmmsg = n = 0;
+        }
+        if (!have_recvmmsg)
+#endif
+            n = lo_server_recv_noblock(udp, 0) > 0;
+        n += lo_server_recv_noblock(tcp, 0) > 0;
+        if (!n)
+            break;
+        count += n;
+        if (deadline && mpr_get_current_time() >= deadline)
+            break;
+    }
+    return count;
+}
+
+/* Copy the socket file descriptors of the admin servers and of the data servers of each local
+ * device into fds, up to num entries. Returns the total number of descriptors. */
+int mpr_net_get_fds(mpr_net net, int *fds, int num)
+{
+    int i, j, count = 0;
+    for (i = -1; i < net->num_devs; i++) {
+        lo_server *servers = i < 0 ? net->servers : net->devs[i]->servers;
+        for (j = i < 0 ? SERVER_BUS : SERVER_UDP; j <= (i < 0 ? SERVER_MESH : SERVER_TCP); j++) {
+            if (!servers[j])
+                continue;
+            if (fds && count < num)
+                fds[count] = lo_server_get_socket_fd(servers[j]);
+            ++count;
+        }
+    }
+    return count;
+}
+
+/* Returns bit flags (1 << SERVER_*) for the admin servers, and for the data servers of device dev
+ * if it is not 0, whose sockets are listed in fds. */
+int mpr_net_get_ready_servers(mpr_net net, mpr_local_dev dev, const int *fds, int num)
+{
+    int i, j, ready = 0;
+    for (i = 0; i < (dev ? 4 : 2); i++) {
+        int fd;
+        lo_server server = i < SERVER_DEVICE ? net->servers[i] : dev->servers[i];
+        if (!server)
+            continue;
+        fd = lo_server_get_socket_fd(server);
+        for (j = 0; j < num; j++) {
+            if (fds[j] == fd) {
+                ready |= 1 << i;
+                break;
+            }
+        }
+    }
+    return ready;
+}
+
+/* Receive all messages waiting on the admin servers flagged in ready. Returns the number of
+ * servers that had messages, as counted by mpr_dev_poll(). */
+int mpr_net_recv_admin(mpr_net net, int ready)
+{
+    int i, count = 0;
+    for (i = SERVER_BUS; i <= SERVER_MESH; i++) {
+        if (!(ready & (1 << i)) || !net->servers[i])
+            continue;
+        if (lo_server_recv_noblock(net->servers[i], 0) > 0) {
+            ++count;
+            while (lo_server_recv_noblock(net->servers[i], 0) > 0) {}
+        }
+    }
+    return count;
+}
+
+/* Returns the number of seconds after its last probe at which the allocation of a resource next
+ * progresses: probing again while offline, moving past collisions, or locking the value. */
+static double get_alloc_interval(mpr_allocated a)
+{
+    double interval = !a->online ? 5.0 : a->collision_count > 0 ? 0.5 : 2.0;
+    return a->fast ? interval * FAST_ALLOC_SCALE : interval;
+}
+
+/* Returns the number of seconds until mpr_net_poll() next has housekeeping to do: allocating
+ * device names, pinging subscribers and the bus, or expiring staged maps. */
+double mpr_net_get_next_timer(mpr_net net)
+{
+    int i, registered = 0;
+    double now, current, wait;
+    mpr_time t;
+
+    mpr_time_set(&t, MPR_NOW);
+    now = mpr_time_as_dbl(t);
+    current = mpr_get_current_time();
+    /* an hour stands in for no pending deadline */
+    wait = 3600;
+
+    for (i = 0; i < net->num_devs; i++) {
+        mpr_allocated a = &net->devs[i]->ordinal_allocator;
+        double next;
+        if (net->devs[i]->registered) {
+            ++registered;
+            continue;
+        }
+        RETURN_ARG_UNLESS(!a->locked, 0);
+        next = a->count_time + get_alloc_interval(a) - current;
+        if (next < wait)
+            wait = next;
+    }
+    /* pings and the expiry of staged maps wait until a local device is registered */
+    if ((registered || !net->num_devs) && net->next_sub_ping + 1 - now < wait)
+        wait = net->next_sub_ping + 1 - now;
+    if (registered && net->next_bus_ping - now < wait)
+        wait = net->next_bus_ping - now;
+    return wait > 0 ? wait : 0;
+}
+
+/* Returns the number of seconds until mpr_net_poll() next has work to do: flushing queued
+ * messages or housekeeping, or until TCP sockets must be polled by an external event loop. */
+double mpr_net_get_next_wait(mpr_net net)
+{
+    double wait;
+    mpr_list maps;
+
+    RETURN_ARG_UNLESS(!mpr_net_has_queued_msgs(net), 0);
+    wait = mpr_net_get_next_timer(net);
+
+    /* liblo does not expose the sockets accepted by the TCP server, so data arriving on them
+     * must be polled for while any local maps use TCP */
+    maps = mpr_list_from_data(net->graph->maps);
+    while (maps && wait > TCP_POLL_SEC) {
+        mpr_map m = (mpr_map)*maps;
+        if (m->is_local && MPR_PROTO_TCP == m->protocol)
+            wait = TCP_POLL_SEC;
+        maps = mpr_list_get_next(maps);
+    }
+    return wait;
+}
+
+int mpr_net_has_queued_msgs(mpr_net net)
+{
+    return net->bundle && lo_bundle_count(net->bundle);
 }
 
 void mpr_net_free_msgs(mpr_net net)
 {
-    FUNC_IF(free, net->devs);
     FUNC_IF(lo_bundle_free_recursive, net->bundle);
     net->bundle = 0;
 }
@@ -522,8 +905,12 @@ void mpr_net_free(mpr_net net)
 {
     /* send out any cached messages */
     mpr_net_send(net);
+    FUNC_IF(free, net->devs);
     FUNC_IF(free, net->iface.name);
     FUNC_IF(free, net->multicast.group);
+    FUNC_IF(free, net->dgrams.queue);
+    FUNC_IF(free, net->recv.ring);
+    FUNC_IF(free, net->admin_buf.data);
     FUNC_IF(lo_server_free, net->servers[SERVER_BUS]);
     FUNC_IF(lo_server_free, net->servers[SERVER_MESH]);
     FUNC_IF(lo_address_free, net->addr.bus);
@@ -531,7 +918,7 @@ void mpr_net_free(mpr_net net)
 }
 
 /*! Probe the network to see if a device's proposed name.ordinal is available. */
-static void mpr_net_probe_dev_name(mpr_net net, mpr_local_dev dev)
+void mpr_net_probe_dev_name(mpr_net net, mpr_local_dev dev)
 {
     int i;
     char name[256];
@@ -542,6 +929,17 @@ static void mpr_net_probe_dev_name(mpr_net net, mpr_local_dev dev)
     for (i = 0; i < 8; i++)
         dev->ordinal_allocator.hints[i] = 0;
 
+    /* Local devices share the random id used to resolve collisions, so they must not probe the
+     * same name. */
+    for (i = 0; i < net->num_devs; i++) {
+        mpr_local_dev other = net->devs[i];
+        if (   other != dev && other->ordinal_allocator.val == dev->ordinal_allocator.val
+            && !strcmp(other->prefix, dev->prefix)) {
+            ++dev->ordinal_allocator.val;
+            i = -1;
+        }
+    }
+
     /* Note: mpr_dev_get_name() would refuse here since the ordinal is not
      * yet locked, so we have to build it manually at this point. */
     snprintf(name, 256, "%s.%d", dev->prefix, dev->ordinal_allocator.val);
@@ -549,6 +947,7 @@ static void mpr_net_probe_dev_name(mpr_net net, mpr_local_dev dev)
 
     /* Calculate an id from the name and store it in id.val */
     dev->obj.id = (mpr_id) crc32(0L, (const Bytef *)name, strlen(name)) << 32;
+    mpr_graph_index_obj(net->graph, (mpr_obj)dev);
 
     /* For the same reason, we can't use mpr_net_send() here. */
     lo_send(net->addr.bus, net_msg_strings[MSG_NAME_PROBE], "si", name, net->random_id);
@@ -577,22 +976,53 @@ void mpr_net_add_dev(mpr_net net, mpr_local_dev dev)
         ++net->num_devs;
     }
 
-    /* Seed the random number generator. */
-    seed_srand();
+    /* The device polls the admin servers along with its own data servers. */
+    dev->servers[SERVER_BUS] = net->servers[SERVER_BUS];
+    dev->servers[SERVER_MESH] = net->servers[SERVER_MESH];
+
+    /* The random id and allocation methods are shared by all local devices, so changing them
+     * while other devices are probing their names would cause spurious collisions. */
+    if (dev == net->devs[0]) {
+        /* Seed the random number generator. */
+        seed_srand();
+
+        /* Choose a random ID for allocation speedup */
+        net->random_id = rand();
 
-    /* Choose a random ID for allocation speedup */
-    net->random_id = rand();
+        /* Identify the revision clock, so that subscribers of a previous instance are sent the
+         * full state again. */
+        net->revs.epoch = rand();
 
-    /* Add allocation methods for bus communications. Further methods are added
-     * when the device is registered. */
-    lo_server_add_method(net->servers[SERVER_BUS], net_msg_strings[MSG_NAME_PROBE], "si",
-                         handler_name_probe, net);
-    lo_server_add_method(net->servers[SERVER_BUS], net_msg_strings[MSG_NAME_REG], NULL, handler_name, net);
+        /* Add allocation methods for bus communications. Further methods are added when the
+         * device is registered. */
+        lo_server_add_method(net->servers[SERVER_BUS], net_msg_strings[MSG_NAME_PROBE], "si",
+                             handler_name_probe, net);
+        lo_server_add_method(net->servers[SERVER_BUS], net_msg_strings[MSG_NAME_REG], NULL,
+                             handler_name, net);
+    }
 
     /* Probe potential name. */
     mpr_net_probe_dev_name(net, dev);
 }
 
+/*! Remove a device from this network. Returns the number of remaining local devices. */
+int mpr_net_remove_dev(mpr_net net, mpr_local_dev dev)
+{
+    int i;
+    for (i = 0; i < net->num_devs; i++) {
+        if (net->devs[i] == dev)
+            break;
+    }
+    RETURN_ARG_UNLESS(i < net->num_devs, net->num_devs);
+    for (++i; i < net->num_devs; i++)
+        net->devs[i - 1] = net->devs[i];
+    if (!--net->num_devs) {
+        free(net->devs);
+        net->devs = 0;
+    }
+    return net->num_devs;
+}
+
 static void _send_device_sync(mpr_net net, mpr_local_dev dev)
 {
     NEW_LO_MSG(msg, return);
@@ -672,6 +1102,8 @@ static void mpr_net_maybe_send_ping(mpr_net net, int force)
                 continue;
             }
         }
+        if (num_maps)
+            mpr_link_open_shm(lnk);
         if (num_maps && mpr_obj_get_prop_as_str(&lnk->devs[REMOTE_DEV]->obj, MPR_PROP_HOST, 0)) {
             /* Only send pings if this link has associated maps, ensuring empty
              * links are removed after the ping timeout. */
@@ -742,26 +1174,27 @@ void mpr_net_poll(mpr_net net)
 static int check_collisions(mpr_net net, mpr_allocated resource)
 {
     int i;
-    double current_time, timediff;
+    double current_time, timediff, interval;
     RETURN_ARG_UNLESS(!resource->locked, 0);
     current_time = mpr_get_current_time();
     timediff = current_time - resource->count_time;
+    interval = get_alloc_interval(resource);
 
     if (!resource->online) {
-        if (timediff >= 5.0) {
+        if (timediff >= interval) {
             /* reprobe with the same value */
             resource->count_time = current_time;
             return 1;
         }
         return 0;
     }
-    else if (timediff >= 2.0 && resource->collision_count < 1) {
+    else if (timediff >= interval && resource->collision_count < 1) {
         resource->locked = 1;
         if (resource->on_lock)
             resource->on_lock(resource);
         return 2;
     }
-    else if (timediff >= 0.5 && resource->collision_count > 0) {
+    else if (timediff >= interval && resource->collision_count > 0) {
         for (i = 0; i < 8; i++) {
             if (!resource->hints[i])
                 break;
@@ -807,7 +1240,7 @@ static int handler_dev(const char *path, const char *types, lo_arg **av, int ac,
     mpr_msg props = 0;
     mpr_msg_atom atom;
     mpr_list links = 0, cpy;
-    const char *name, *host, *admin_port;
+    const char *name, *host, *host_id = 0, *admin_port;
     lo_address a;
     mpr_rtr_sig rs;
 
@@ -881,26 +1314,29 @@ static int handler_dev(const char *path, const char *types, lo_arg **av, int ac,
         goto done;
     }
     data_port = (atom->vals[0])->i;
+    atom = mpr_msg_get_prop(props, MPR_PROP_HOST_ID);
+    if (atom && atom->len == 1 && mpr_type_get_is_str(atom->types[0]))
+        host_id = &(atom->vals[0])->s;
 
+    /* several local devices may be linked to the remote device */
     cpy = mpr_list_get_cpy(links);
     found = 0;
     while (cpy) {
         mpr_link link = (mpr_link)*cpy;
         cpy = mpr_list_get_next(cpy);
         if (mpr_link_get_is_local(link)) {
+            dev = (mpr_local_dev)link->devs[LOCAL_DEV];
             trace_dev(dev, "establishing link to %s.\n", name)
-            mpr_link_connect(link, host, atoi(admin_port), data_port);
+            mpr_link_connect(link, host, host_id, atoi(admin_port), data_port);
             found = 1;
-            break;
+
+            /* links property has been updated, inform subscribers */
+            inform_device_subscribers(net, dev);
         }
     }
     if (!found)
         goto done;
 
-    /* links property has been updated, inform subscribers */
-    if (found)
-        inform_device_subscribers(net, dev);
-
     /* check if we have maps waiting for this link */
     trace_dev(dev, "checking for waiting maps.\n");
     rs = net->rtr->sigs;
@@ -958,8 +1394,8 @@ done:
 static int handler_dev_mod(const char *path, const char *types, lo_arg **av,
                            int ac, lo_message msg, void *user)
 {
-    mpr_net net = (mpr_net)user;
-    mpr_local_dev dev = net->devs ? net->devs[0] : 0;
+    mpr_local_dev dev = (mpr_local_dev)user;
+    mpr_net net = &dev->obj.graph->net;
     mpr_msg props;
 
     RETURN_ARG_UNLESS(dev && mpr_dev_get_is_ready((mpr_dev)dev)
@@ -983,20 +1419,30 @@ static int handler_logout(const char *path, const char *types, lo_arg **av,
     mpr_local_dev dev;
     mpr_dev remote;
     mpr_link lnk;
-    int diff, ordinal;
-    char *s, *name;
+    int i, diff, ordinal;
+    char *s, *name, prefix[256];
 
     RETURN_ARG_UNLESS(ac && MPR_STR == types[0], 0);
     net = (mpr_net)user;
-    dev = net->devs ? net->devs[0] : 0;
     gph = net->graph;
 
     name = &av[0]->s;
     remote = mpr_graph_get_dev_by_name(gph, name);
 
-    if (!dev)
+    if (!net->num_devs)
         {trace_net("received /logout '%s'\n", name);}
-    else if (dev->ordinal_allocator.locked) {
+
+    /* Parse the ordinal from name in the format: <name>.<n> */
+    s = name;
+    while (*s != '.' && *s++) {}
+    ordinal = atoi(++s);
+    snprintf(prefix, 256, "%s", name);
+    strtok(prefix, ".");
+
+    for (i = 0; i < net->num_devs; i++) {
+        dev = net->devs[i];
+        if (!dev->ordinal_allocator.locked)
+            continue;
         trace_dev(dev, "received /logout '%s'\n", name);
         /* Check if we have any links to this device, if so remove them */
         lnk = remote ? mpr_dev_get_link_by_remote(dev, remote) : 0;
@@ -1007,14 +1453,7 @@ static int handler_logout(const char *path, const char *types, lo_arg **av,
             mpr_graph_remove_link(gph, lnk, MPR_OBJ_REM);
         }
 
-        /* Parse the ordinal from name in the format: <name>.<n> */
-        s = name;
-        while (*s != '.' && *s++) {}
-        ordinal = atoi(++s);
-
-        strtok(name, ".");
-        ++name;
-        if (0 == strcmp(name, dev->prefix)) {
+        if (prefix[0] && 0 == strcmp(prefix + 1, dev->prefix)) {
             /* If device name matches and ordinal is within my block, free it */
             diff = ordinal - dev->ordinal_allocator.val - 1;
             if (diff >= 0 && diff < 8)
@@ -1032,9 +1471,8 @@ static int handler_logout(const char *path, const char *types, lo_arg **av,
 static int handler_subscribe(const char *path, const char *types, lo_arg **av,
                              int ac, lo_message msg, void *user)
 {
-    mpr_net net = (mpr_net)user;
-    mpr_local_dev dev = net->devs ? net->devs[0] : 0;
-    int i, version = -1, flags = 0, timeout_seconds = 0;
+    mpr_local_dev dev = (mpr_local_dev)user;
+    int i, version = -1, flags = 0, timeout_seconds = 0, epoch = 0, revs[2], *revs_ptr = 0;
 
 #ifdef DEBUG
     trace_dev(dev, "received /subscribe ");
@@ -1069,6 +1507,17 @@ static int handler_subscribe(const char *path, const char *types, lo_arg **av,
             if (i < ac && MPR_INT32 == types[i])
                 version = av[i]->i;
         }
+        else if (0 == strcmp(&av[i]->s, "@revisions")) {
+            /* next arguments are the revision clock and the last revisions of signals and maps
+             * recorded by subscriber */
+            if (i + 3 < ac && 0 == strncmp(&types[i + 1], "iii", 3)) {
+                epoch = av[i + 1]->i;
+                revs[0] = av[i + 2]->i;
+                revs[1] = av[i + 3]->i;
+                revs_ptr = revs;
+            }
+            i += 3;
+        }
         else if (0 == strcmp(&av[i]->s, "@lease")) {
             /* next argument is lease timeout in seconds */
             ++i;
@@ -1084,7 +1533,7 @@ static int handler_subscribe(const char *path, const char *types, lo_arg **av,
     }
 
     /* add or renew subscription */
-    mpr_dev_manage_subscriber(dev, addr, flags, timeout_seconds, version);
+    mpr_dev_manage_subscriber(dev, addr, flags, timeout_seconds, version, epoch, revs_ptr);
     return 0;
 }
 
@@ -1150,12 +1599,44 @@ static int prefix_cmp(const char *str1, const char *str2, const char **rest)
     return result;
 }
 
+/* Find the registered local device named in the prefix of a full signal name. Also returns the
+ * signal in sig_ptr if it exists. */
+static mpr_local_dev find_local_dev(mpr_net net, const char *full_name, mpr_sig *sig_ptr)
+{
+    int i;
+    const char *sig_name;
+    mpr_sig sig;
+    for (i = 0; i < net->num_devs; i++) {
+        mpr_local_dev dev = net->devs[i];
+        if (!dev->registered || prefix_cmp(full_name, mpr_dev_get_name((mpr_dev)dev), &sig_name))
+            continue;
+        RETURN_ARG_UNLESS(sig = mpr_dev_get_sig_by_name((mpr_dev)dev, sig_name), 0);
+        if (sig_ptr)
+            *sig_ptr = sig;
+        return dev;
+    }
+    return 0;
+}
+
+/* Returns the local device at the destination of a map, or else at one of its sources. */
+static mpr_local_dev get_map_dev(mpr_map map)
+{
+    int i;
+    if (map->dst->sig->is_local)
+        return (mpr_local_dev)map->dst->sig->dev;
+    for (i = 0; i < map->num_src; i++) {
+        if (map->src[i]->sig->is_local)
+            return (mpr_local_dev)map->src[i]->sig->dev;
+    }
+    return 0;
+}
+
 /*! Handle remote requests to add, modify, or remove metadata to a signal. */
 static int handler_sig_mod(const char *path, const char *types, lo_arg **av,
                            int ac, lo_message msg, void *user)
 {
-    mpr_net net = (mpr_net)user;
-    mpr_local_dev dev = net->devs ? net->devs[0] : 0;
+    mpr_local_dev dev = (mpr_local_dev)user;
+    mpr_net net = &dev->obj.graph->net;
     mpr_sig sig;
     mpr_msg props;
     RETURN_ARG_UNLESS(dev && mpr_dev_get_is_ready((mpr_dev)dev) && ac > 1 && MPR_STR == types[0], 0);
@@ -1211,13 +1692,13 @@ static int handler_name(const char *path, const char *types, lo_arg **av,
 {
     mpr_net net;
     mpr_local_dev dev;
-    int ordinal, diff, temp_id = -1, hint = 0;
+    mpr_id id;
+    int i, ordinal, diff, temp_id = -1, hint = 0;
     char *name;
 
     RETURN_ARG_UNLESS(ac && MPR_STR == types[0], 0);
     net = (mpr_net)user;
-    dev = net->devs ? net->devs[0] : 0;
-    RETURN_ARG_UNLESS(dev, 0);
+    RETURN_ARG_UNLESS(net->num_devs, 0);
     name = &av[0]->s;
     if (ac > 1) {
         if (MPR_INT32 == types[1])
@@ -1228,32 +1709,33 @@ static int handler_name(const char *path, const char *types, lo_arg **av,
 
 #ifdef DEBUG
     if (hint)
-        {trace_dev(dev, "received name %s %i %i\n", name, temp_id, hint);}
+        {trace_net("received name %s %i %i\n", name, temp_id, hint);}
     else
-        {trace_dev(dev, "received name %s\n", name);}
+        {trace_net("received name %s\n", name);}
 #endif
 
-    if (dev->ordinal_allocator.locked) {
-        ordinal = extract_ordinal(name);
-        RETURN_ARG_UNLESS(ordinal >= 0, 0);
+    /* the ordinal is stripped from the name after computing the id */
+    id = (mpr_id) crc32(0L, (const Bytef *)name, strlen(name)) << 32;
+    ordinal = extract_ordinal(name);
 
-        /* If device name matches */
-        if (0 == strcmp(name, dev->prefix)) {
-            /* if id is locked and registered id is within my block, store it */
-            diff = ordinal - dev->ordinal_allocator.val - 1;
-            if (diff >= 0 && diff < 8)
-                dev->ordinal_allocator.hints[diff] = -1;
-            if (hint) {
-                /* if suggested id is within my block, store timestamp */
-                diff = hint - dev->ordinal_allocator.val - 1;
+    for (i = 0; i < net->num_devs; i++) {
+        dev = net->devs[i];
+        if (dev->ordinal_allocator.locked) {
+            /* If device name matches */
+            if (ordinal >= 0 && 0 == strcmp(name, dev->prefix)) {
+                /* if id is locked and registered id is within my block, store it */
+                diff = ordinal - dev->ordinal_allocator.val - 1;
                 if (diff >= 0 && diff < 8)
-                    dev->ordinal_allocator.hints[diff] = mpr_get_current_time();
+                    dev->ordinal_allocator.hints[diff] = -1;
+                if (hint) {
+                    /* if suggested id is within my block, store timestamp */
+                    diff = hint - dev->ordinal_allocator.val - 1;
+                    if (diff >= 0 && diff < 8)
+                        dev->ordinal_allocator.hints[diff] = mpr_get_current_time();
+                }
             }
         }
-    }
-    else {
-        mpr_id id = (mpr_id) crc32(0L, (const Bytef *)name, strlen(name)) << 32;
-        if (id == dev->obj.id) {
+        else if (id == dev->obj.id) {
             if (temp_id < net->random_id) {
                 /* Count ordinal collisions. */
                 ++dev->ordinal_allocator.collision_count;
@@ -1273,19 +1755,25 @@ static int handler_name_probe(const char *path, const char *types, lo_arg **av,
                               int ac, lo_message msg, void *user)
 {
     mpr_net net = (mpr_net)user;
-    mpr_local_dev dev = net->devs ? net->devs[0] : 0;
+    mpr_local_dev dev = 0;
     mpr_id id;
     char *name;
     int i, temp_id;
 
-    RETURN_ARG_UNLESS(dev, 0);
+    RETURN_ARG_UNLESS(net->num_devs, 0);
     name = &av[0]->s;
     temp_id = av[1]->i;
 
-    trace_dev(dev, "received name probe %s %i \n", name, temp_id);
+    trace_net("received name probe %s %i \n", name, temp_id);
 
     id = (mpr_id) crc32(0L, (const Bytef *)name, strlen(name)) << 32;
-    if (id == dev->obj.id) {
+    for (i = 0; i < net->num_devs; i++) {
+        if (id == net->devs[i]->obj.id) {
+            dev = net->devs[i];
+            break;
+        }
+    }
+    if (dev) {
         double current_time = mpr_get_current_time();
         if (dev->ordinal_allocator.locked || temp_id > net->random_id) {
             for (i = 0; i < 8; i++) {
@@ -1392,17 +1880,20 @@ static int parse_sig_names(const char *types, lo_arg **av, int ac, int *src_idx,
 
 #define MPR_MAP_ERROR (mpr_map)-1
 
+/* Also returns the local device in charge of the map in dev_ptr, if any. */
 static mpr_map find_map(mpr_net net, const char *types, int ac, lo_arg **av,
-                        mpr_loc loc, mpr_sig *sig_ptr, int flags)
+                        mpr_loc loc, mpr_sig *sig_ptr, mpr_local_dev *dev_ptr, int flags)
 {
-    mpr_local_dev dev = net->devs ? net->devs[0] : 0;
+    mpr_local_dev dev = 0;
     int i, is_loc = 0, src_idx, dst_idx, prop_idx, num_src;
     mpr_sig sig = 0;
     mpr_map map;
     mpr_id id = 0;
-    const char *sig_name, *src_names[MAX_NUM_MAP_SRC], *dst_name;
+    const char *src_names[MAX_NUM_MAP_SRC], *dst_name;
 
-    RETURN_ARG_UNLESS(dev || !loc, MPR_MAP_ERROR);
+    if (dev_ptr)
+        *dev_ptr = 0;
+    RETURN_ARG_UNLESS(net->num_devs || !loc, MPR_MAP_ERROR);
     num_src = parse_sig_names(types, av, ac, &src_idx, &dst_idx, &prop_idx);
     RETURN_ARG_UNLESS(num_src, MPR_MAP_ERROR);
     RETURN_ARG_UNLESS(is_alphabetical(num_src, &av[src_idx]), MPR_MAP_ERROR);
@@ -1435,6 +1926,8 @@ static mpr_map find_map(mpr_net net, const char *types, int ac, lo_arg **av,
                     src_names[i] = &av[src_idx+i]->s;
                 map = mpr_graph_add_map(net->graph, id, num_src, src_names, &av[dst_idx]->s);
             }
+            if (dev_ptr && map)
+                *dev_ptr = get_map_dev(map);
             return map;
         }
         else if (!flags)
@@ -1449,8 +1942,7 @@ static mpr_map find_map(mpr_net net, const char *types, int ac, lo_arg **av,
 
     if (MPR_LOC_DST & loc) {
         /* check if we are the destination */
-        if (   !prefix_cmp(&av[dst_idx]->s, mpr_dev_get_name((mpr_dev)dev), &sig_name)
-            && (sig = mpr_dev_get_sig_by_name((mpr_dev)dev, sig_name)))
+        if ((dev = find_local_dev(net, dst_name, &sig)))
             is_loc = 1;
         else
             RETURN_ARG_UNLESS(MPR_LOC_DST != loc, MPR_MAP_ERROR);
@@ -1458,9 +1950,12 @@ static mpr_map find_map(mpr_net net, const char *types, int ac, lo_arg **av,
     if (!sig && MPR_LOC_SRC & loc) {
         /* check if we are a source – all sources must match! */
         for (i = 0; i < num_src; i++) {
-            if (   !prefix_cmp(src_names[i], mpr_dev_get_name((mpr_dev)dev), &sig_name)
-                && (sig = mpr_dev_get_sig_by_name((mpr_dev)dev, sig_name)))
+            mpr_local_dev src_dev = find_local_dev(net, src_names[i], &sig);
+            if (src_dev) {
                 is_loc = 1;
+                if (!dev)
+                    dev = src_dev;
+            }
             else
                 RETURN_ARG_UNLESS(MPR_LOC_SRC != loc, MPR_MAP_ERROR);
         }
@@ -1484,6 +1979,8 @@ static mpr_map find_map(mpr_net net, const char *types, int ac, lo_arg **av,
     }
     if (sig_ptr)
         *sig_ptr = sig;
+    if (dev_ptr && map)
+        *dev_ptr = get_map_dev(map);
     return map;
 }
 
@@ -1495,20 +1992,20 @@ static int handler_map(const char *path, const char *types, lo_arg **av, int ac,
                        lo_message msg, void *user)
 {
     mpr_net net = (mpr_net)user;
-    mpr_local_dev dev = net->devs ? net->devs[0] : 0;
+    mpr_local_dev dev;
     mpr_sig sig = 0;
     mpr_local_map map;
     mpr_msg props;
     int i;
 
-    RETURN_ARG_UNLESS(dev, 0);
+    RETURN_ARG_UNLESS(net->num_devs, 0);
 #ifdef DEBUG
-    trace_dev(dev, "received /map ");
+    trace_net("received /map ");
     lo_message_pp(msg);
 #endif
 
-    map = (mpr_local_map)find_map(net, types, ac, av, MPR_LOC_DST, &sig, ADD | UPDATE);
-    RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != (mpr_map)map, 0);
+    map = (mpr_local_map)find_map(net, types, ac, av, MPR_LOC_DST, &sig, &dev, ADD | UPDATE);
+    RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != (mpr_map)map && dev, 0);
     if (map->status >= MPR_STATUS_ACTIVE) {
         /* Forward to handler_map_mod() and stop. */
         handler_map_mod(path, types, av, ac, msg, user);
@@ -1538,6 +2035,8 @@ static int handler_map(const char *path, const char *types, lo_arg **av, int ac,
             mpr_net_use_subscribers(net, dev, MPR_MAP);
             mpr_map_send_state((mpr_map)map, -1, MSG_MAPPED);
         }
+        else
+            mpr_net_stamp_obj(net, (mpr_obj)map);
         return 0;
     }
 
@@ -1572,11 +2071,12 @@ static int handler_map_to(const char *path, const char *types, lo_arg **av,
 {
     mpr_net net = (mpr_net)user;
 #ifdef DEBUG
-    trace_dev(net->devs[0], "received /map_to ");
+    trace_net("received /map_to ");
     lo_message_pp(msg);
 #endif
 
-    mpr_local_map map = (mpr_local_map)find_map(net, types, ac, av, MPR_LOC_ANY, 0, ADD | UPDATE);
+    mpr_local_map map = (mpr_local_map)find_map(net, types, ac, av, MPR_LOC_ANY, 0, 0,
+                                                ADD | UPDATE);
     RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != (mpr_map)map, 0);
     mpr_rtr_add_map(net->rtr, map);
 
@@ -1617,20 +2117,20 @@ static int handler_mapped(const char *path, const char *types, lo_arg **av,
 {
     mpr_net net = (mpr_net)user;
     mpr_graph graph = net->graph;
-    mpr_local_dev dev = net->devs ? net->devs[0] : 0;
+    mpr_local_dev dev = 0;
     mpr_map map;
     mpr_msg props;
     int i, rc = 0, updated;
 
 #ifdef DEBUG
-    if (dev)
-        { trace_dev(dev, "received /mapped "); }
+    if (net->num_devs)
+        { trace_net("received /mapped "); }
     else
         { trace_graph("received /mapped "); }
     lo_message_pp(msg);
 #endif
 
-    map = find_map(net, types, ac, av, 0, 0, UPDATE);
+    map = find_map(net, types, ac, av, 0, 0, &dev, UPDATE);
     RETURN_ARG_UNLESS(MPR_MAP_ERROR != map, 0);
     if (!map) {
         int store = 0, i = 0;
@@ -1646,7 +2146,7 @@ static int handler_mapped(const char *path, const char *types, lo_arg **av,
             }
         }
         if (store) {
-            map = find_map(net, types, ac, av, 0, 0, ADD);
+            map = find_map(net, types, ac, av, 0, 0, &dev, ADD);
             rc = 1;
         }
         RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != map, 0);
@@ -1657,6 +2157,13 @@ static int handler_mapped(const char *path, const char *types, lo_arg **av,
     }
     props = mpr_msg_parse_props(ac, types, av);
 
+    if (map->is_local && MPR_DIR_OUT == map->dst->dir) {
+        /* the destination echoes @packed once it is able to unpack vectors */
+        mpr_msg_atom a = mpr_msg_get_prop(props, PROP(PACKED));
+        if (a)
+            ((mpr_local_map)map)->packed_ok = 'T' == a->types[0];
+    }
+
     /* TODO: if this endpoint is map admin, do not allow overwriting props */
     updated = mpr_map_set_from_msg(map, props, 0);
     mpr_msg_free(props);
@@ -1730,14 +2237,13 @@ static int handler_map_mod(const char *path, const char *types, lo_arg **av,
 
     RETURN_ARG_UNLESS(ac >= 4, 0);
     net = (mpr_net)user;
-    dev = net->devs ? net->devs[0] : 0;
-    RETURN_ARG_UNLESS(dev, 0);
+    RETURN_ARG_UNLESS(net->num_devs, 0);
 #ifdef DEBUG
-    trace_dev(dev, "received /map/modify ");
+    trace_net("received /map/modify ");
     lo_message_pp(msg);
 #endif
-    map = (mpr_local_map)find_map(net, types, ac, av, MPR_LOC_ANY, 0, FIND);
-    RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != (mpr_map)map, 0);
+    map = (mpr_local_map)find_map(net, types, ac, av, MPR_LOC_ANY, 0, &dev, FIND);
+    RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != (mpr_map)map && dev, 0);
     RETURN_ARG_UNLESS(map->status >= MPR_STATUS_ACTIVE, 0);
 
     props = mpr_msg_parse_props(ac, types, av);
@@ -1808,17 +2314,17 @@ static int handler_unmap(const char *path, const char *types, lo_arg **av,
                          int ac, lo_message msg, void *user)
 {
     mpr_net net = (mpr_net)user;
-    mpr_local_dev dev = net->devs ? net->devs[0] : 0;
+    mpr_local_dev dev;
     mpr_local_map map;
     int i;
 
-    RETURN_ARG_UNLESS(dev, 0);
+    RETURN_ARG_UNLESS(net->num_devs, 0);
 #ifdef DEBUG
-    trace_dev(dev, "received /unmap");
+    trace_net("received /unmap");
     lo_message_pp(msg);
 #endif
-    map = (mpr_local_map)find_map(net, types, ac, av, MPR_LOC_ANY, 0, FIND);
-    RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != (mpr_map)map, 0);
+    map = (mpr_local_map)find_map(net, types, ac, av, MPR_LOC_ANY, 0, &dev, FIND);
+    RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != (mpr_map)map && dev, 0);
 
     /* inform remote peer(s) */
     if (!map->dst->is_local || !map->dst->rsig) {
@@ -1850,13 +2356,14 @@ static int handler_unmap(const char *path, const char *types, lo_arg **av,
         }
         else
             mpr_sig_send_state(map->dst->sig, MSG_SIG);
-
-        trace_dev(dev, "informing subscribers (UNMAPPED)\n")
-        mpr_net_use_subscribers(net, dev,
-                                map->dst->is_local && map->dst->rsig ? MPR_MAP_IN : MPR_MAP_OUT);
-        mpr_map_send_state((mpr_map)map, -1, MSG_UNMAPPED);
     }
 
+    /* always announced, since the removal is also replayed to subscribers catching up later */
+    trace_dev(dev, "informing subscribers (UNMAPPED)\n")
+    mpr_net_use_subscribers(net, dev,
+                            map->dst->is_local && map->dst->rsig ? MPR_MAP_IN : MPR_MAP_OUT);
+    mpr_map_send_state((mpr_map)map, -1, MSG_UNMAPPED);
+
     /* The mapping is removed. */
     mpr_rtr_remove_map(net->rtr, map);
     mpr_graph_remove_map(net->graph, (mpr_map)map, MPR_OBJ_REM);
@@ -1877,7 +2384,7 @@ static int handler_unmapped(const char *path, const char *types, lo_arg **av,
         { trace_graph("received /unmapped"); }
     lo_message_pp(msg);
 #endif
-    mpr_map map = find_map(net, types, ac, av, 0, 0, FIND);
+    mpr_map map = find_map(net, types, ac, av, 0, 0, 0, FIND);
     RETURN_ARG_UNLESS(map && MPR_MAP_ERROR != map, 0);
     mpr_graph_remove_map(net->graph, map, MPR_OBJ_REM);
     return 0;
@@ -1887,21 +2394,28 @@ static int handler_ping(const char *path, const char *types, lo_arg **av,
                         int ac, lo_message msg, void *user)
 {
     mpr_net net = (mpr_net)user;
-    mpr_local_dev dev = net->devs[0];
     mpr_dev remote;
-    mpr_link lnk;
+    mpr_list links;
     mpr_time now;
     lo_timetag then;
 
-    RETURN_ARG_UNLESS(dev, 0);
+    RETURN_ARG_UNLESS(net->num_devs, 0);
     mpr_time_set(&now, MPR_NOW);
     then = lo_message_get_timestamp(msg);
 
     remote = (mpr_dev)mpr_graph_get_obj(net->graph, MPR_DEV, av[0]->h);
-    lnk = remote ? mpr_dev_get_link_by_remote(dev, remote) : 0;
-    if (lnk) {
+    RETURN_ARG_UNLESS(remote, 0);
+
+    /* The admin port is shared by all local devices, so update each of their links to the
+     * remote device. */
+    links = mpr_list_from_data(net->graph->links);
+    while (links) {
+        mpr_link lnk = (mpr_link)*links;
         mpr_sync_clock clk = &lnk->clock;
-        trace_dev(dev, "ping received from linked device '%s'\n", lnk->devs[REMOTE_DEV]->name);
+        links = mpr_list_get_next(links);
+        if (lnk->devs[REMOTE_DEV] != remote || !lnk->devs[LOCAL_DEV]->is_local)
+            continue;
+        trace_dev(lnk->devs[LOCAL_DEV], "ping received from linked device '%s'\n", lnk->devs[REMOTE_DEV]->name);
         if (av[2]->i == clk->sent.msg_id) {
             /* total elapsed time since ping sent */
             double elapsed = mpr_time_get_diff(now, clk->sent.time);
@@ -1911,7 +2425,7 @@ static int handler_ping(const char *path, const char *types, lo_arg **av,
             double offset = mpr_time_get_diff(now, then) - latency;
 
             if (latency < 0) {
-                trace_dev(dev, "error: latency %f cannot be < 0.\n", latency);
+                trace_dev(lnk->devs[LOCAL_DEV], "error: latency %f cannot be < 0.\n", latency);
                 latency = 0;
             }
 
@@ -1956,6 +2470,18 @@ static int handler_sync(const char *path, const char *types, lo_arg **av,
         trace_graph("updating sync record for device '%s'\n", dev->name);
         mpr_time_set(&dev->synced, MPR_NOW);
 
+        if (ac >= 5 && dev->subscribed && 0 == strncmp(&types[2], "iii", 3)) {
+            /* the device has brought us up to date with its revision clock */
+            if (dev->sync_epoch != av[2]->i) {
+                dev->sync_epoch = av[2]->i;
+                dev->sync_revs[0] = dev->sync_revs[1] = -1;
+            }
+            if (av[3]->i >= 0)
+                dev->sync_revs[0] = av[3]->i;
+            if (av[4]->i >= 0)
+                dev->sync_revs[1] = av[4]->i;
+        }
+
         if (!dev->subscribed && graph->autosub) {
             trace_graph("autosubscribing to device '%s'.\n", &av[0]->s);
             mpr_graph_subscribe(graph, dev, graph->autosub, -1);
@@ -1967,6 +2493,7 @@ static int handler_sync(const char *path, const char *types, lo_arg **av,
         temp.name = &av[0]->s;
         temp.obj.version = -1;
         temp.is_local = 0;
+        temp.sync_revs[0] = temp.sync_revs[1] = -1;
         trace_net("requesting metadata for device '%s'.\n", &av[0]->s);
         mpr_graph_subscribe(graph, &temp, MPR_DEV, 0);
     }
@@ -142,8 +142,12 @@ mpr_prop mpr_obj_set_prop(mpr_obj o, mpr_prop p, const char *s, int len,
     if (!publish)
         flags |= LOCAL_ACCESS_ONLY;
     updated = mpr_tbl_set(local ? o->props.synced : o->props.staged, p, s, len, type, val, flags);
-    if (updated)
+    if (updated) {
         mpr_obj_increment_version(o);
+        if (MPR_PROP_ID == MASK_PROP_BITFLAGS(p))
+            mpr_graph_index_obj(o->graph, o);
+        mpr_graph_touch_obj(o->graph, o);
+    }
     return updated;
 }
 
@@ -160,8 +164,10 @@ int mpr_obj_remove_prop(mpr_obj o, mpr_prop p, const char *s)
         updated = mpr_tbl_remove(o->props.synced, p, s, LOCAL_MODIFY);
     else if (MPR_PROP_EXTRA == p)
         updated = mpr_tbl_set(o->props.staged, p | PROP_REMOVE, s, 0, 0, 0, REMOTE_MODIFY);
-    if (updated)
+    if (updated) {
         mpr_obj_increment_version(o);
+        mpr_graph_touch_obj(o->graph, o);
+    }
     return 0;
 }
 
@@ -66,6 +66,9 @@ const static_prop_t static_props[] = {
     { "@version",       1, MPR_INT32, MPR_INT32 }, /* MPR_PROP_VERSION */
     { "@extra",         0, 'a', 'a' }, /* MPR_PROP_EXTRA (special case, does not
                                            * represent a specific property name) */
+    { "@packed",        1, MPR_BOOL,  MPR_BOOL },  /* MPR_PROP_PACKED */
+    { "@alias",         1, MPR_INT32, MPR_INT32 }, /* MPR_PROP_ALIAS */
+    { "@host_id",       1, MPR_STR,   MPR_STR },   /* MPR_PROP_HOST_ID */
 };
 
 const char* mpr_loc_strings[] =
@@ -81,6 +84,7 @@ const char* mpr_protocol_strings[] =
     NULL,           /* MPR_PROTO_UNDEFINED */
     "osc.udp",      /* MPR_PROTO_UDP */
     "osc.tcp",      /* MPR_PROTO_TCP */
+    "osc.shm",      /* MPR_PROTO_SHM */
 };
 
 const char *mpr_steal_strings[] =
@@ -219,7 +223,7 @@ mpr_msg mpr_msg_parse_props(int argc, const mpr_type *types, lo_arg **argv)
             }
         }
         /* check type against static props */
-        else if (MASK_PROP_BITFLAGS(a->prop) < MPR_PROP_EXTRA) {
+        else if (MASK_PROP_BITFLAGS(a->prop) != MPR_PROP_EXTRA) {
             static_prop_t prop;
             prop = static_props[PROP_TO_INDEX(a->prop)];
             if (prop.len) {
@@ -366,34 +370,85 @@ const char *mpr_prop_as_str(mpr_prop p, int skip_slash)
 {
     const char *s;
     p = MASK_PROP_BITFLAGS(p);
-    die_unless(p > MPR_PROP_UNKNOWN && p <= MPR_PROP_EXTRA,
+    die_unless(p > MPR_PROP_UNKNOWN && p <= PROP_LAST,
                "called mpr_prop_as_str() with bad index %d.\n", p);
     s = static_props[PROP_TO_INDEX(p)].key;
     return skip_slash ? s + 1 : s;
 }
 
-mpr_prop mpr_prop_from_str(const char *string)
+/* Property names are looked up for every key of every parsed message, so we use a perfect hash
+ * of the standard names and their long-form aliases. The table is built on first use by trying
+ * seeds until none of the names collide, and a single string comparison confirms each match. */
+#define PROP_HASH_SIZE 256
+
+static struct {
+    uint32_t seed;
+    uint8_t idx[PROP_HASH_SIZE];    /* index of static property + 1, or 0 if empty */
+    const char *keys[PROP_HASH_SIZE];
+    char ready;
+    char lock;
+} prop_hash = { 0 };
+
+static const struct {
+    const char *key;
+    mpr_prop prop;
+} prop_aliases[] = {
+    { "expression", MPR_PROP_EXPR },
+    { "maximum",    MPR_PROP_MAX },
+    { "minimum",    MPR_PROP_MIN },
+};
+
+#define NUM_PROP_ALIASES (sizeof(prop_aliases) / sizeof(prop_aliases[0]))
+
+static uint32_t _hash_prop_str(const char *str, uint32_t seed)
 {
-    /* property keys are stored alphabetically so we can use a binary search */
-    int beg = PROP_TO_INDEX(MPR_PROP_UNKNOWN) + 1;
-    int end = PROP_TO_INDEX(MPR_PROP_EXTRA) - 1;
-    int mid = (beg + end) * 0.5, cmp;
-    while (beg <= end) {
-        cmp = strcmp(string, static_props[mid].key + 1);
-        if (cmp > 0)
-            beg = mid + 1;
-        else if (cmp == 0)
-            return INDEX_TO_PROP(mid);
-        else
-            end = mid - 1;
-        mid = (beg + end) * 0.5;
+    uint32_t h = 2166136261u ^ seed;
+    while (*str) {
+        h ^= (unsigned char)*str++;
+        h *= 16777619u;
+    }
+    return (h ^ (h >> 15)) & (PROP_HASH_SIZE - 1);
+}
+
+static int _insert_prop_hash(const char *key, int idx)
+{
+    uint32_t h = _hash_prop_str(key, prop_hash.seed);
+    RETURN_ARG_UNLESS(!prop_hash.idx[h], 1);
+    prop_hash.idx[h] = idx + 1;
+    prop_hash.keys[h] = key;
+    return 0;
+}
+
+static void _build_prop_hash(void)
+{
+    int i, collided;
+    while (__atomic_test_and_set(&prop_hash.lock, __ATOMIC_ACQUIRE)) ;
+    if (!prop_hash.ready) {
+        do {
+            memset(prop_hash.idx, 0, sizeof(prop_hash.idx));
+            for (i = PROP_TO_INDEX(MPR_PROP_UNKNOWN) + 1, collided = 0;
+                 i <= PROP_TO_INDEX(PROP_LAST) && !collided; i++) {
+                /* skip the leading '@' */
+                if (INDEX_TO_PROP(i) != MPR_PROP_EXTRA)
+                    collided = _insert_prop_hash(static_props[i].key + 1, i);
+            }
+            for (i = 0; i < NUM_PROP_ALIASES && !collided; i++)
+                collided = _insert_prop_hash(prop_aliases[i].key,
+                                             PROP_TO_INDEX(prop_aliases[i].prop));
+        } while (collided && ++prop_hash.seed);
+        __atomic_store_n(&prop_hash.ready, 1, __ATOMIC_RELEASE);
     }
-    if (strcmp(string, "expression")==0)
-        return MPR_PROP_EXPR;
-    if (strcmp(string, "maximum")==0)
-        return MPR_PROP_MAX;
-    if (strcmp(string, "minimum")==0)
-        return MPR_PROP_MIN;
+    __atomic_clear(&prop_hash.lock, __ATOMIC_RELEASE);
+}
+
+mpr_prop mpr_prop_from_str(const char *string)
+{
+    uint32_t h;
+    if (!__atomic_load_n(&prop_hash.ready, __ATOMIC_ACQUIRE))
+        _build_prop_hash();
+    h = _hash_prop_str(string, prop_hash.seed);
+    if (prop_hash.idx[h] && !strcmp(string, prop_hash.keys[h]))
+        return INDEX_TO_PROP((prop_hash.idx[h] - 1));
     return MPR_PROP_EXTRA;
 }
 
@@ -0,0 +1,112 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "mapper_internal.h"
+#include "types_internal.h"
+#include <mapper/mapper.h>
+
+/* Bounded multi-producer, single-consumer queue of fixed-size items. Each slot carries a
+ * sequence number which tells producers whether the slot is free and the consumer whether it
+ * has been committed, so neither side takes a lock or makes a system call. Producers claim slots
+ * with a compare-and-swap on the head index that can only fail when another producer claims the
+ * same slot concurrently, so a single producer is wait-free. */
+
+#define LOAD(p)         __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define STORE(p, v)     __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define CAS(p, e, v)    __atomic_compare_exchange_n(p, e, v, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+
+typedef struct _mpr_ring_slot {
+    uint32_t seq;
+    uint32_t pos;
+} mpr_ring_slot_t, *mpr_ring_slot;
+
+#define SLOT(r, pos) ((mpr_ring_slot)((r)->data + ((pos) & (r)->mask) * (r)->slot_size))
+
+/* slot payloads are aligned for any value type */
+#define HEADER_SIZE 8
+
+mpr_ring mpr_ring_new(int capacity, size_t item_size)
+{
+    uint32_t i, size = 1;
+    mpr_ring r;
+    RETURN_ARG_UNLESS(capacity > 0 && item_size > 0, 0);
+    while (size < (uint32_t)capacity)
+        size <<= 1;
+    r = (mpr_ring)calloc(1, sizeof(mpr_ring_t));
+    RETURN_ARG_UNLESS(r, 0);
+    r->slot_size = HEADER_SIZE + ((item_size + 7) & ~(size_t)7);
+    r->item_size = item_size;
+    r->mask = size - 1;
+    if (!(r->data = (char*)calloc(size, r->slot_size))) {
+        free(r);
+        return 0;
+    }
+    for (i = 0; i < size; i++)
+        SLOT(r, i)->seq = i;
+    return r;
+}
+
+void mpr_ring_free(mpr_ring r)
+{
+    RETURN_UNLESS(r);
+    FUNC_IF(free, r->data);
+    free(r);
+}
+
+void *mpr_ring_reserve(mpr_ring r)
+{
+    uint32_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    while (1) {
+        mpr_ring_slot s = SLOT(r, pos);
+        int32_t diff = (int32_t)(LOAD(&s->seq) - pos);
+        if (0 == diff) {
+            if (CAS(&r->head, &pos, pos + 1)) {
+                s->pos = pos;
+                return (char*)s + HEADER_SIZE;
+            }
+        }
+        else if (diff < 0) {
+            /* full: the consumer has not released this slot yet */
+            __atomic_add_fetch(&r->num_dropped, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+        else
+            pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    }
+}
+
+void mpr_ring_commit(mpr_ring r, void *item)
+{
+    mpr_ring_slot s = (mpr_ring_slot)((char*)item - HEADER_SIZE);
+    STORE(&s->seq, s->pos + 1);
+}
+
+int mpr_ring_push(mpr_ring r, const void *item)
+{
+    void *dst = mpr_ring_reserve(r);
+    RETURN_ARG_UNLESS(dst, 0);
+    memcpy(dst, item, r->item_size);
+    mpr_ring_commit(r, dst);
+    return 1;
+}
+
+void *mpr_ring_peek(mpr_ring r)
+{
+    mpr_ring_slot s = SLOT(r, r->tail);
+    RETURN_ARG_UNLESS(LOAD(&s->seq) == r->tail + 1, 0);
+    return (char*)s + HEADER_SIZE;
+}
+
+void mpr_ring_release(mpr_ring r)
+{
+    mpr_ring_slot s = SLOT(r, r->tail);
+    STORE(&s->seq, r->tail + r->mask + 1);
+    ++r->tail;
+}
+
+int mpr_ring_get_num_dropped(mpr_ring r)
+{
+    return __atomic_load_n(&r->num_dropped, __ATOMIC_RELAXED);
+}
@@ -53,14 +53,13 @@ void mpr_rtr_num_inst_changed(mpr_rtr rtr, mpr_local_sig sig, int size)
 
 static void _update_map_count(mpr_rtr rtr)
 {
-    /* find associated rtr_sig */
-    mpr_rtr_sig rs = rtr->sigs;
-    int i, dev_maps_in = 0, dev_maps_out = 0;
-    mpr_local_dev dev = 0;
-    while (rs) {
+    /* the router is shared by the local devices, so count the maps of each of them */
+    mpr_rtr_sig rs;
+    int i;
+    for (rs = rtr->sigs; rs; rs = rs->next)
+        rs->sig->dev->num_maps_in = rs->sig->dev->num_maps_out = 0;
+    for (rs = rtr->sigs; rs; rs = rs->next) {
         int sig_maps_in = 0, sig_maps_out = 0;
-        if (!dev)
-            dev = rs->sig->dev;
         for (i = 0; i < rs->num_slots; i++) {
             if (!rs->slots[i] || rs->slots[i]->map->status < MPR_STATUS_ACTIVE)
                 continue;
@@ -69,20 +68,20 @@ static void _update_map_count(mpr_rtr rtr)
             else if (MPR_DIR_OUT == rs->slots[i]->dir)
                 ++sig_maps_out;
         }
+        if (rs->sig->num_maps_in != sig_maps_in || rs->sig->num_maps_out != sig_maps_out) {
+            /* the signal state has changed even if there are no subscribers to inform */
+            mpr_net_stamp_obj(&rs->sig->obj.graph->net, (mpr_obj)rs->sig);
+        }
         rs->sig->num_maps_in = sig_maps_in;
         rs->sig->num_maps_out = sig_maps_out;
-        dev_maps_in += sig_maps_in;
-        dev_maps_out += sig_maps_out;
-        rs = rs->next;
+        rs->sig->dev->num_maps_in += sig_maps_in;
+        rs->sig->dev->num_maps_out += sig_maps_out;
     }
-    dev->num_maps_in = dev_maps_in;
-    dev->num_maps_out = dev_maps_out;
 }
 
 void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const void *val, mpr_time t)
 {
     mpr_id_map idmap;
-    lo_message msg;
     mpr_rtr_sig rs;
     mpr_local_map map;
     int i, j, inst_idx;
@@ -90,7 +89,7 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const vo
 
     /* abort if signal is already being processed - might be a local loop */
     if (sig->locked) {
-        trace_dev(rtr->dev, "Mapping loop detected on signal %s! (1)\n", sig->name);
+        trace_dev(sig->dev, "Mapping loop detected on signal %s! (1)\n", sig->name);
         return;
     }
     idmap = sig->idmaps[idmap_idx].map;
@@ -100,9 +99,9 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const vo
     RETURN_UNLESS(rs);
 
     inst_idx = sig->idmaps[idmap_idx].inst->idx;
-    bundle_idx = rtr->dev->bundle_idx % NUM_BUNDLES;
+    bundle_idx = sig->dev->bundle_idx % NUM_BUNDLES;
     /* TODO: remove duplicate flag set */
-    rtr->dev->sending = 1; /* mark as updated */
+    sig->dev->sending = 1; /* mark as updated */
     lock = &sig->locked;
     *lock = 1;
 
@@ -138,10 +137,9 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const vo
                 if (sig->idmaps[idmap_idx].status & RELEASED_REMOTELY)
                     continue;
 
-                if (slot->dir == MPR_DIR_IN) {
-                    msg = mpr_map_build_msg(map, slot, 0, 0, idmap);
-                    mpr_link_add_msg(slot->link, slot->sig, msg, t, map->protocol, bundle_idx);
-                }
+                if (slot->dir == MPR_DIR_IN)
+                    mpr_map_add_msg(map, slot, slot->link, slot->sig->path, 0, 0, idmap, t,
+                                    bundle_idx);
             }
 
             if (!map->use_inst)
@@ -151,14 +149,9 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const vo
             mpr_value_reset_inst(&dst_slot->val, inst_idx);
 
             /* send release to downstream */
-            if (slot->dir == MPR_DIR_OUT) {
-                msg = 0;
-                if (in_scope) {
-                    msg = mpr_map_build_msg(map, slot, 0, 0, idmap);
-                    mpr_link_add_msg(dst_slot->link, dst_slot->sig, msg, t, map->protocol,
-                                     bundle_idx);
-                }
-            }
+            if (slot->dir == MPR_DIR_OUT && in_scope)
+                mpr_map_add_msg(map, slot, dst_slot->link, mpr_map_get_dst_path(map), 0, 0, idmap,
+                                t, bundle_idx);
         }
         *lock = 0;
         return;
@@ -192,8 +185,7 @@ void mpr_rtr_process_sig(mpr_rtr rtr, mpr_local_sig sig, int idmap_idx, const vo
             /* bypass map processing and bundle value without type coercion */
             char *types = alloca(sig->len * sizeof(char));
             memset(types, sig->type, sig->len);
-            msg = mpr_map_build_msg(map, slot, val, types, sig->use_inst ? idmap : 0);
-            mpr_link_add_msg(map->dst->link, map->dst->sig, msg, t, map->protocol, bundle_idx);
+            mpr_map_add_update(map, slot, val, types, sig->use_inst ? idmap : 0, t, bundle_idx);
             continue;
         }
 
@@ -304,8 +296,12 @@ static void _add_local_slot(mpr_rtr rtr, mpr_local_slot slot, int is_src, int *m
         if (slot->sig->use_inst)
             *use_inst = 1;
     }
-    if (!slot->sig->is_local || (is_src && slot->map->dst->sig->is_local))
-        slot->link = mpr_link_new(rtr->dev, slot->sig->dev);
+    if (!slot->sig->is_local)
+        slot->link = mpr_link_new(slot->map->dev, slot->sig->dev);
+    else if (is_src && slot->map->dst->sig->is_local) {
+        /* the source and destination may belong to different local devices */
+        slot->link = mpr_link_new((mpr_local_dev)slot->map->dst->sig->dev, slot->sig->dev);
+    }
 
     /* set some sensible defaults */
     slot->causes_update = 1;
@@ -323,6 +319,13 @@ void mpr_rtr_add_map(mpr_rtr rtr, mpr_local_map map)
     map->rtr = rtr;
     map->is_local = 1;
 
+    /* outgoing maps are evaluated by the device of their first source, others by the device of
+     * their destination */
+    if (map->src[0]->sig->is_local)
+        map->dev = (mpr_local_dev)map->src[0]->sig->dev;
+    else
+        map->dev = (mpr_local_dev)map->dst->sig->dev;
+
     /* TODO: configure number of instances available for each slot */
     map->num_inst = 0;
 
@@ -336,13 +339,17 @@ void mpr_rtr_add_map(mpr_rtr rtr, mpr_local_map map)
     map->protocol = use_inst ? MPR_PROTO_TCP : MPR_PROTO_UDP;
 
     /* assign a unique id to this map if we are the destination */
-    if (local_dst)
-        map->obj.id = _get_unused_map_id(rtr->dev, rtr);
+    if (local_dst) {
+        map->obj.id = _get_unused_map_id((mpr_local_dev)map->dst->sig->dev, rtr);
+        mpr_graph_index_obj(map->obj.graph, (mpr_obj)map);
+    }
 
     /* assign indices to source slots */
     if (local_dst) {
         for (i = 0; i < map->num_src; i++)
             map->src[i]->id = map->dst->rsig->id_counter++;
+        /* local sources can use the alias of our destination signal */
+        mpr_map_set_alias(map, ((mpr_local_sig)map->dst->sig)->alias);
     }
     else {
         /* may be overwritten later by message */
@@ -466,7 +473,7 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_local_map map)
                             lo_message_get_argc(msg), msg, (void*)map->dst->sig);
         }
         else
-            mpr_dev_LID_decref(rtr->dev, 0, map->idmap);
+            mpr_dev_LID_decref(map->dev, 0, map->idmap);
     }
 
     /* remove map and slots from rtr_sig lists if necessary */
@@ -481,19 +488,19 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_local_map map)
             if (!maps[i].map)
                 continue;
             if (maps[i].status & RELEASED_LOCALLY) {
-                mpr_dev_GID_decref(rtr->dev, sig->group, maps[i].map);
+                mpr_dev_GID_decref(sig->dev, sig->group, maps[i].map);
                 maps[i].map = 0;
             }
             else {
                 maps[i].status |= RELEASED_REMOTELY;
-                mpr_dev_GID_decref(rtr->dev, sig->group, maps[i].map);
+                mpr_dev_GID_decref(sig->dev, sig->group, maps[i].map);
                 if (sig->use_inst) {
                     int evt = (  MPR_SIG_REL_UPSTRM & sig->event_flags
                                ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE);
                     mpr_sig_call_handler(sig, evt, maps[i].map->LID, 0, 0, &t, 0);
                 }
                 else {
-                    mpr_dev_LID_decref(rtr->dev, sig->group, maps[i].map);
+                    mpr_dev_LID_decref(sig->dev, sig->group, maps[i].map);
                     maps[i].map = 0;
                     maps[i].inst->active = 0;
                     maps[i].inst = 0;
@@ -530,7 +537,8 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_local_map map)
 
     /* one more case: if map is local only need to decrement num_maps in local map */
     if (map->is_local_only) {
-        mpr_link link = mpr_dev_get_link_by_remote(rtr->dev, (mpr_dev)rtr->dev);
+        mpr_link link = mpr_dev_get_link_by_remote((mpr_local_dev)map->dst->sig->dev,
+                                                   map->src[0]->sig->dev);
         if (link)
             --link->num_maps[0];
     }
@@ -546,6 +554,8 @@ int mpr_rtr_remove_map(mpr_rtr rtr, mpr_local_map map)
     }
 
     FUNC_IF(free, map->updated_inst);
+    FUNC_IF(free, map->eval.status);
+    FUNC_IF(free, map->eval.types);
     FUNC_IF(mpr_expr_free, map->expr);
     _update_map_count(rtr);
     return 0;
@@ -0,0 +1,239 @@
+#include "config.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef HAVE_SHM_OPEN
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+#include "mapper_internal.h"
+#include "types_internal.h"
+#include <mapper/mapper.h>
+
+/* Single-producer, single-consumer ring of datagrams in a POSIX shared memory segment, used to
+ * carry map updates between devices on the same host without a round trip through the network
+ * stack. The segment is created by the receiving end of a link and opened by the sending end.
+ * Each datagram is stored contiguously as a 32-bit length followed by the payload, padded to 8
+ * bytes; a datagram that would straddle the end of the ring is preceded by a wrap marker. Both
+ * ends only exchange the head and tail counters, so neither takes a lock. */
+
+#define SHM_MAGIC       0x6d707273  /* "mprs" */
+#define SHM_WRAP        0xFFFFFFFF
+#define SHM_ALIGN(n)    (((n) + 7) & ~(size_t)7)
+
+/*! Layout of the start of a shared segment. The counters are kept on separate cache lines. */
+typedef struct _mpr_shm_hdr {
+    uint32_t magic;
+    uint32_t size;                  /*!< Capacity of the ring in bytes. */
+    uint32_t closed;                /*!< Set by the consumer when it goes away. */
+    uint32_t waiting;               /*!< Set while the consumer may block and must be woken. */
+    char pad1[48];
+    uint64_t head;                  /*!< Number of bytes written by the producer. */
+    char pad2[56];
+    uint64_t tail;                  /*!< Number of bytes released by the consumer. */
+    char pad3[56];
+} mpr_shm_hdr_t;
+
+#ifdef HAVE_SHM_OPEN
+
+/* Write a 64-bit id as 13 base-32 digits. */
+static char *_encode_id(char *str, mpr_id id)
+{
+    int i;
+    for (i = 12; i >= 0; i--, id >>= 5)
+        str[i] = "0123456789abcdefghijklmnopqrstuv"[id & 31];
+    return str + 13;
+}
+
+/* Segment names are limited to 31 characters on some systems, so the full device ids are
+ * written in base 32 rather than in hexadecimal. */
+static void _get_name(char *name, mpr_id dst, mpr_id src)
+{
+    char *str = name;
+    memcpy(str, "/mpr", 4);
+    str = _encode_id(str + 4, dst);
+    str = _encode_id(str, src);
+    *str = 0;
+}
+
+static mpr_shm _map(int fd, size_t len)
+{
+    mpr_shm shm;
+    void *ptr = mmap(0, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    RETURN_ARG_UNLESS(MAP_FAILED != ptr, 0);
+    shm = (mpr_shm)calloc(1, sizeof(mpr_shm_t));
+    if (!shm) {
+        munmap(ptr, len);
+        return 0;
+    }
+    shm->hdr = (mpr_shm_hdr_t*)ptr;
+    shm->data = (char*)ptr + sizeof(mpr_shm_hdr_t);
+    shm->len = len;
+    return shm;
+}
+
+mpr_shm mpr_shm_new(mpr_id dst, mpr_id src, size_t size)
+{
+    char name[32];
+    int fd;
+    mpr_shm shm;
+    size_t len = sizeof(mpr_shm_hdr_t) + size;
+    RETURN_ARG_UNLESS(size && !(size & (size - 1)), 0);
+    _get_name(name, dst, src);
+
+    /* replace any segment left behind by a previous instance of this device */
+    shm_unlink(name);
+    fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    RETURN_ARG_UNLESS(fd >= 0, 0);
+    if (ftruncate(fd, len) || !(shm = _map(fd, len))) {
+        shm_unlink(name);
+        return 0;
+    }
+    shm->hdr->size = size;
+    shm->hdr->waiting = 1;
+    shm->name = strdup(name);
+    __atomic_store_n(&shm->hdr->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    return shm;
+}
+
+mpr_shm mpr_shm_open(mpr_id dst, mpr_id src)
+{
+    char name[32];
+    int fd;
+    struct stat st;
+    mpr_shm shm;
+    _get_name(name, dst, src);
+    fd = shm_open(name, O_RDWR, 0);
+    RETURN_ARG_UNLESS(fd >= 0, 0);
+    if (fstat(fd, &st) || st.st_size <= (off_t)sizeof(mpr_shm_hdr_t)) {
+        close(fd);
+        return 0;
+    }
+    RETURN_ARG_UNLESS(shm = _map(fd, st.st_size), 0);
+    if (   SHM_MAGIC != __atomic_load_n(&shm->hdr->magic, __ATOMIC_ACQUIRE)
+        || shm->hdr->size != shm->len - sizeof(mpr_shm_hdr_t) || shm->hdr->closed) {
+        mpr_shm_free(shm);
+        return 0;
+    }
+    return shm;
+}
+
+void mpr_shm_free(mpr_shm shm)
+{
+    RETURN_UNLESS(shm);
+    if (shm->name) {
+        /* tell the producer to stop writing to this segment */
+        __atomic_store_n(&shm->hdr->closed, 1, __ATOMIC_RELEASE);
+        shm_unlink(shm->name);
+        free(shm->name);
+    }
+    munmap(shm->hdr, shm->len);
+    free(shm);
+}
+
+int mpr_shm_write(mpr_shm shm, const void *data, size_t len)
+{
+    mpr_shm_hdr_t *hdr = shm->hdr;
+    uint64_t head = hdr->head, tail = __atomic_load_n(&hdr->tail, __ATOMIC_ACQUIRE);
+    size_t off = head & (hdr->size - 1), needed = 8 + SHM_ALIGN(len), skip = 0;
+    RETURN_ARG_UNLESS(!__atomic_load_n(&hdr->closed, __ATOMIC_ACQUIRE), -1);
+    if (off + needed > hdr->size)
+        skip = hdr->size - off;
+    RETURN_ARG_UNLESS(needed + skip <= hdr->size - (head - tail), 0);
+    if (skip) {
+        *(uint32_t*)(shm->data + off) = SHM_WRAP;
+        head += skip;
+        off = 0;
+    }
+    *(uint32_t*)(shm->data + off) = (uint32_t)len;
+    memcpy(shm->data + off + 8, data, len);
+    /* publish before checking whether the consumer is waiting for it */
+    __atomic_store_n(&hdr->head, head + needed, __ATOMIC_SEQ_CST);
+    return __atomic_exchange_n(&hdr->waiting, 0, __ATOMIC_SEQ_CST) ? 2 : 1;
+}
+
+const void *mpr_shm_peek(mpr_shm shm, size_t *len)
+{
+    mpr_shm_hdr_t *hdr = shm->hdr;
+    /* the producer is another process, so only trust the size of our own mapping */
+    uint64_t size = shm->len - sizeof(mpr_shm_hdr_t);
+    uint64_t tail = hdr->tail, head = __atomic_load_n(&hdr->head, __ATOMIC_ACQUIRE);
+    while (tail != head) {
+        size_t off = tail & (size - 1);
+        uint32_t item_len;
+        if (head - tail > size)
+            break;
+        item_len = *(uint32_t*)(shm->data + off);
+        if (SHM_WRAP == item_len) {
+            tail += size - off;
+            continue;
+        }
+        if (item_len > size - off - 8 || 8 + SHM_ALIGN(item_len) > head - tail)
+            break;
+        *len = item_len;
+        shm->next = tail + 8 + SHM_ALIGN(item_len);
+        return shm->data + off + 8;
+    }
+    if (tail != head) {
+        trace("error: corrupt shared memory ring, discarding its contents.\n");
+        __atomic_store_n(&hdr->tail, head, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+void mpr_shm_release(mpr_shm shm)
+{
+    __atomic_store_n(&shm->hdr->tail, shm->next, __ATOMIC_RELEASE);
+}
+
+int mpr_shm_set_waiting(mpr_shm shm, int waiting)
+{
+    mpr_shm_hdr_t *hdr = shm->hdr;
+    __atomic_store_n(&hdr->waiting, waiting ? 1 : 0, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&hdr->head, __ATOMIC_SEQ_CST) != hdr->tail;
+}
+
+const char *mpr_shm_get_host_id(void)
+{
+    static char host_id[64] = {0};
+    FILE *f;
+    if (host_id[0])
+        return host_id;
+    /* the boot id distinguishes hosts as well as reboots of the same host */
+    if ((f = fopen("/proc/sys/kernel/random/boot_id", "r"))) {
+        if (!fgets(host_id, 64, f))
+            host_id[0] = 0;
+        fclose(f);
+        host_id[strcspn(host_id, "\r\n")] = 0;
+    }
+    if (!host_id[0] && gethostname(host_id, 63))
+        host_id[0] = 0;
+    return host_id[0] ? host_id : 0;
+}
+
+#else /* HAVE_SHM_OPEN */
+
+mpr_shm mpr_shm_new(mpr_id dst, mpr_id src, size_t size) { return 0; }
+
+mpr_shm mpr_shm_open(mpr_id dst, mpr_id src) { return 0; }
+
+void mpr_shm_free(mpr_shm shm) {}
+
+int mpr_shm_write(mpr_shm shm, const void *data, size_t len) { return -1; }
+
+const void *mpr_shm_peek(mpr_shm shm, size_t *len) { return 0; }
+
+void mpr_shm_release(mpr_shm shm) {}
+
+int mpr_shm_set_waiting(mpr_shm shm, int waiting) { return 0; }
+
+const char *mpr_shm_get_host_id(void) { return 0; }
+
+#endif /* HAVE_SHM_OPEN */
@@ -53,7 +53,8 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
     if ((lsig = (mpr_local_sig)mpr_dev_get_sig_by_name(dev, name)))
         return (mpr_sig)lsig;
 
-    lsig = (mpr_local_sig)mpr_list_add_item((void**)&g->sigs, sizeof(mpr_local_sig_t));
+    lsig = (mpr_local_sig)mpr_list_add_item((void**)&g->sigs, sizeof(mpr_local_sig_t),
+                                            g->slab);
     lsig->dev = (mpr_local_dev)dev;
     lsig->obj.id = mpr_dev_get_unused_sig_id((mpr_local_dev)dev);
     lsig->obj.graph = g;
@@ -62,6 +63,8 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
     lsig->event_flags = events;
     lsig->is_local = 1;
     mpr_sig_init((mpr_sig)lsig, dir, name, len, type, unit, min, max, num_inst);
+    mpr_graph_index_obj(g, (mpr_obj)lsig);
+    mpr_dev_add_sig(dev, (mpr_sig)lsig);
 
     if (dir == MPR_DIR_IN)
         ++dev->num_inputs;
@@ -70,6 +73,8 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
 
     mpr_obj_increment_version((mpr_obj)dev);
 
+    mpr_dev_reserve_update_queue((mpr_local_dev)dev, mpr_sig_get_vector_bytes((mpr_sig)lsig));
+    mpr_dev_add_sig_alias((mpr_local_dev)dev, lsig);
     mpr_dev_add_sig_methods((mpr_local_dev)dev, lsig);
     if (((mpr_local_dev)dev)->registered) {
         /* Notify subscribers */
@@ -77,6 +82,7 @@ mpr_sig mpr_sig_new(mpr_dev dev, mpr_dir dir, const char *name, int len,
                                 ((dir == MPR_DIR_IN) ? MPR_SIG_IN : MPR_SIG_OUT));
         mpr_sig_send_state((mpr_sig)lsig, MSG_SIG);
     }
+    mpr_dev_rt_prealloc((mpr_local_dev)dev);
     return (mpr_sig)lsig;
 }
 
@@ -85,12 +91,16 @@ void mpr_sig_init(mpr_sig sig, mpr_dir dir, const char *name, int len, mpr_type
 {
     int i, str_len, loc_mod, rem_mod;
     mpr_tbl tbl;
+    char *path;
     RETURN_UNLESS(name);
 
     name = skip_slash(name);
     str_len = strlen(name)+2;
-    sig->path = malloc(str_len);
-    snprintf(sig->path, str_len, "/%s", name);
+    path = malloc(str_len);
+    snprintf(path, str_len, "/%s", name);
+    /* signals on different devices often share names, so paths are interned by the graph */
+    sig->path = (char*)mpr_strtab_add(sig->obj.graph->strings, path);
+    free(path);
     sig->name = (char*)sig->path+1;
     sig->len = len;
     sig->type = type;
@@ -120,10 +130,10 @@ void mpr_sig_init(mpr_sig sig, mpr_dir dir, const char *name, int len, mpr_type
         lsig->idmaps = calloc(1, sizeof(struct _mpr_sig_idmap));
     }
     else
-        sig->obj.props.staged = mpr_tbl_new();
+        sig->obj.props.staged = mpr_tbl_new(sig->obj.graph->strings);
 
     sig->obj.type = MPR_SIG;
-    sig->obj.props.synced = mpr_tbl_new();
+    sig->obj.props.synced = mpr_tbl_new(sig->obj.graph->strings);
 
     tbl = sig->obj.props.synced;
     loc_mod = sig->is_local ? MODIFIABLE : NON_MODIFIABLE;
@@ -197,6 +207,7 @@ void mpr_sig_free(mpr_sig sig)
 
     /* release associated OSC methods */
     mpr_dev_remove_sig_methods(ldev, lsig);
+    mpr_dev_remove_sig_alias(ldev, lsig);
     net = &sig->obj.graph->net;
     rtr = net->rtr;
     rs = rtr->sigs;
@@ -250,7 +261,7 @@ void mpr_sig_free_internal(mpr_sig sig)
     FUNC_IF(mpr_tbl_free, sig->obj.props.staged);
     FUNC_IF(free, sig->max);
     FUNC_IF(free, sig->min);
-    FUNC_IF(free, sig->path);
+    mpr_strtab_release(sig->obj.graph->strings, sig->path);
     FUNC_IF(free, sig->unit);
 }
 
@@ -268,12 +279,28 @@ void mpr_sig_call_handler(mpr_local_sig lsig, int evt, mpr_id inst, int len,
         return;
     mpr_sig_update_timing_stats(lsig, diff);
     h = (mpr_sig_handler*)lsig->handler;
-    if (h && (evt & lsig->event_flags))
+    if (h && (evt & lsig->event_flags)) {
+        /* updates made by the handler are applied immediately */
+        int busy = mpr_dev_set_busy(lsig->dev, 0);
         h((mpr_sig)lsig, evt, lsig->use_inst ? inst : 0, len, lsig->type, val, *time);
+        mpr_dev_set_busy(lsig->dev, busy);
+    }
 }
 
 /**** Instances ****/
 
+/* Call the handler for an instance event. Upstream releases are reported as updates if the
+ * handler has not asked for them. Signal updates made by the handler are applied immediately
+ * rather than being deferred. */
+static void _inst_event(mpr_local_sig lsig, mpr_sig_handler *h, int evt, mpr_id id, mpr_time t)
+{
+    int busy = mpr_dev_set_busy(lsig->dev, 0);
+    if (MPR_SIG_REL_UPSTRM == evt && !(lsig->event_flags & MPR_SIG_REL_UPSTRM))
+        evt = MPR_SIG_UPDATE;
+    h((mpr_sig)lsig, evt, id, 0, lsig->type, NULL, t);
+    mpr_dev_set_busy(lsig->dev, busy);
+}
+
 static void _init_inst(mpr_sig_inst si)
 {
     si->has_val = 0;
@@ -394,28 +421,26 @@ int mpr_sig_get_idmap_with_LID(mpr_local_sig lsig, mpr_id LID, int flags, mpr_ti
         _init_inst(si);
         i = _add_idmap(lsig, si, map);
         if (h && (lsig->event_flags & MPR_SIG_INST_NEW))
-            h((mpr_sig)lsig, MPR_SIG_INST_NEW, LID, 0, lsig->type, NULL, t);
+            _inst_event(lsig, h, MPR_SIG_INST_NEW, LID, t);
         return i;
     }
 
     RETURN_ARG_UNLESS(h, -1);
     if (lsig->event_flags & MPR_SIG_INST_OFLW) {
         /* call instance event handler */
-        h((mpr_sig)lsig, MPR_SIG_INST_OFLW, 0, 0, lsig->type, NULL, t);
+        _inst_event(lsig, h, MPR_SIG_INST_OFLW, 0, t);
     }
     else if (lsig->steal_mode == MPR_STEAL_OLDEST) {
         i = _oldest_inst(lsig);
         if (i < 0)
             return -1;
-        h((mpr_sig)lsig, MPR_SIG_REL_UPSTRM & lsig->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE,
-          lsig->idmaps[i].map->LID, 0, lsig->type, 0, t);
+        _inst_event(lsig, h, MPR_SIG_REL_UPSTRM, lsig->idmaps[i].map->LID, t);
     }
     else if (lsig->steal_mode == MPR_STEAL_NEWEST) {
         i = _newest_inst(lsig);
         if (i < 0)
             return -1;
-        h((mpr_sig)lsig, MPR_SIG_REL_UPSTRM & lsig->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE,
-          lsig->idmaps[i].map->LID, 0, lsig->type, 0, t);
+        _inst_event(lsig, h, MPR_SIG_REL_UPSTRM, lsig->idmaps[i].map->LID, t);
     }
     else
         return -1;
@@ -432,7 +457,7 @@ int mpr_sig_get_idmap_with_LID(mpr_local_sig lsig, mpr_id LID, int flags, mpr_ti
         _init_inst(si);
         i = _add_idmap(lsig, si, map);
         if (h && (lsig->event_flags & MPR_SIG_INST_NEW))
-            h((mpr_sig)lsig, MPR_SIG_INST_NEW, LID, 0, lsig->type, NULL, t);
+            _inst_event(lsig, h, MPR_SIG_INST_NEW, LID, t);
         return i;
     }
     return -1;
@@ -469,7 +494,7 @@ int mpr_sig_get_idmap_with_GID(mpr_local_sig lsig, mpr_id GID, int flags, mpr_ti
             _init_inst(si);
             i = _add_idmap(lsig, si, map);
             if (h && (lsig->event_flags & MPR_SIG_INST_NEW))
-                h((mpr_sig)lsig, MPR_SIG_INST_NEW, si->id, 0, lsig->type, NULL, t);
+                _inst_event(lsig, h, MPR_SIG_INST_NEW, si->id, t);
             return i;
         }
     }
@@ -481,7 +506,7 @@ int mpr_sig_get_idmap_with_GID(mpr_local_sig lsig, mpr_id GID, int flags, mpr_ti
             mpr_dev_LID_incref((mpr_local_dev)lsig->dev, map);
             mpr_dev_GID_incref((mpr_local_dev)lsig->dev, map);
             if (h && (lsig->event_flags & MPR_SIG_INST_NEW))
-                h((mpr_sig)lsig, MPR_SIG_INST_NEW, si->id, 0, lsig->type, NULL, t);
+                _inst_event(lsig, h, MPR_SIG_INST_NEW, si->id, t);
             return i;
         }
     }
@@ -497,21 +522,19 @@ int mpr_sig_get_idmap_with_GID(mpr_local_sig lsig, mpr_id GID, int flags, mpr_ti
     /* try releasing instance in use */
     if (lsig->event_flags & MPR_SIG_INST_OFLW) {
         /* call instance event handler */
-        h((mpr_sig)lsig, MPR_SIG_INST_OFLW, 0, 0, lsig->type, NULL, t);
+        _inst_event(lsig, h, MPR_SIG_INST_OFLW, 0, t);
     }
     else if (lsig->steal_mode == MPR_STEAL_OLDEST) {
         i = _oldest_inst(lsig);
         if (i < 0)
             return -1;
-        h((mpr_sig)lsig, MPR_SIG_REL_UPSTRM & lsig->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE,
-          lsig->idmaps[i].map->LID, 0, lsig->type, 0, t);
+        _inst_event(lsig, h, MPR_SIG_REL_UPSTRM, lsig->idmaps[i].map->LID, t);
     }
     else if (lsig->steal_mode == MPR_STEAL_NEWEST) {
         i = _newest_inst(lsig);
         if (i < 0)
             return -1;
-        h((mpr_sig)lsig, MPR_SIG_REL_UPSTRM & lsig->event_flags ? MPR_SIG_REL_UPSTRM : MPR_SIG_UPDATE,
-          lsig->idmaps[i].map->LID, 0, lsig->type, 0, t);
+        _inst_event(lsig, h, MPR_SIG_REL_UPSTRM, lsig->idmaps[i].map->LID, t);
     }
     else
         return -1;
@@ -525,7 +548,7 @@ int mpr_sig_get_idmap_with_GID(mpr_local_sig lsig, mpr_id GID, int flags, mpr_ti
             _init_inst(si);
             i = _add_idmap(lsig, si, map);
             if (h && (lsig->event_flags & MPR_SIG_INST_NEW))
-                h((mpr_sig)lsig, MPR_SIG_INST_NEW, si->id, 0, lsig->type, NULL, t);
+                _inst_event(lsig, h, MPR_SIG_INST_NEW, si->id, t);
             return i;
         }
     }
@@ -539,7 +562,7 @@ int mpr_sig_get_idmap_with_GID(mpr_local_sig lsig, mpr_id GID, int flags, mpr_ti
         mpr_dev_LID_incref((mpr_local_dev)lsig->dev, map);
         mpr_dev_GID_incref((mpr_local_dev)lsig->dev, map);
         if (h && (lsig->event_flags & MPR_SIG_INST_NEW))
-            h((mpr_sig)lsig, MPR_SIG_INST_NEW, si->id, 0, lsig->type, NULL, t);
+            _inst_event(lsig, h, MPR_SIG_INST_NEW, si->id, t);
         return i;
     }
     return -1;
@@ -615,6 +638,7 @@ int mpr_sig_reserve_inst(mpr_sig sig, int num, mpr_id *ids, void **data)
     sig->use_inst = 1;
     if (highest != -1)
         mpr_rtr_num_inst_changed(lsig->obj.graph->net.rtr, lsig, highest + 1);
+    mpr_dev_rt_prealloc(lsig->dev);
 
     if (old_num > 0 && (lsig->num_inst / 8) == (old_num / 8))
         return count;
@@ -657,12 +681,40 @@ void mpr_sig_update_timing_stats(mpr_local_sig lsig, float diff)
     }
 }
 
-void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val)
+/* Apply a validated signal update and pass it to the router. */
+static void _set_value(mpr_local_sig lsig, mpr_id id, mpr_type type, const void *val)
 {
     mpr_time time;
     int idmap_idx;
-    mpr_local_sig lsig = (mpr_local_sig)sig;
     mpr_sig_inst si;
+
+    time = mpr_dev_get_time((mpr_dev)lsig->dev);
+    idmap_idx = mpr_sig_get_idmap_with_LID(lsig, id, 0, time, 1);
+    RETURN_UNLESS(idmap_idx >= 0);
+    si = lsig->idmaps[idmap_idx].inst;
+
+    /* update time */
+    mpr_sig_update_timing_stats(lsig, si->has_val ? mpr_time_get_diff(time, si->time) : 0);
+    memcpy(&si->time, &time, sizeof(mpr_time));
+
+    /* update value */
+    if (type != lsig->type)
+        set_coerced_val(lsig->len, type, val, lsig->len, lsig->type, si->val);
+    else
+        memcpy(si->val, (void*)val, mpr_sig_get_vector_bytes((mpr_sig)lsig));
+    si->has_val = 1;
+
+    /* mark instance as updated */
+    set_bitflag(lsig->updated_inst, si->idx);
+    ((mpr_local_dev)lsig->dev)->sending = lsig->updated = 1;
+
+    mpr_rtr_process_sig(lsig->obj.graph->net.rtr, lsig, idmap_idx, si->has_val ? si->val : 0, si->time);
+}
+
+void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const void *val)
+{
+    int busy;
+    mpr_local_sig lsig = (mpr_local_sig)sig;
     RETURN_UNLESS(sig && sig->is_local);
     if (!len || !val) {
         mpr_sig_release_inst(sig, id);
@@ -693,36 +745,23 @@ void mpr_sig_set_value(mpr_sig sig, mpr_id id, int len, mpr_type type, const voi
                 RETURN_UNLESS(((double*)val)[i] == ((double*)val)[i]);
         }
     }
-    time = mpr_dev_get_time(sig->dev);
-    idmap_idx = mpr_sig_get_idmap_with_LID(lsig, id, 0, time, 1);
-    RETURN_UNLESS(idmap_idx >= 0);
-    si = lsig->idmaps[idmap_idx].inst;
-
-    /* update time */
-    mpr_sig_update_timing_stats(lsig, si->has_val ? mpr_time_get_diff(time, si->time) : 0);
-    memcpy(&si->time, &time, sizeof(mpr_time));
-
-    /* update value */
-    if (type != lsig->type)
-        set_coerced_val(lsig->len, type, val, lsig->len, lsig->type, si->val);
-    else
-        memcpy(si->val, (void*)val, mpr_sig_get_vector_bytes(sig));
-    si->has_val = 1;
-
-    /* mark instance as updated */
-    set_bitflag(lsig->updated_inst, si->idx);
-    ((mpr_local_dev)lsig->dev)->sending = lsig->updated = 1;
-
-    mpr_rtr_process_sig(lsig->obj.graph->net.rtr, lsig, idmap_idx, si->has_val ? si->val : 0, si->time);
+    /* hand the update to the device I/O thread, or defer it if it interrupted the device */
+    RETURN_UNLESS(!mpr_dev_queue_update(lsig, id, len, type, val));
+    busy = mpr_dev_set_busy(lsig->dev, 1);
+    _set_value(lsig, id, type, val);
+    mpr_dev_set_busy(lsig->dev, busy);
 }
 
 void mpr_sig_release_inst(mpr_sig sig, mpr_id id)
 {
-    int idmap_idx;
+    int idmap_idx, busy;
     RETURN_UNLESS(sig && sig->is_local && sig->use_inst);
+    RETURN_UNLESS(!mpr_dev_queue_update((mpr_local_sig)sig, id, 0, 0, 0));
+    busy = mpr_dev_set_busy(((mpr_local_sig)sig)->dev, 1);
     idmap_idx = mpr_sig_get_idmap_with_LID((mpr_local_sig)sig, id, RELEASED_REMOTELY, MPR_NOW, 0);
     if (idmap_idx >= 0)
         mpr_sig_release_inst_internal((mpr_local_sig)sig, idmap_idx);
+    mpr_dev_set_busy(((mpr_local_sig)sig)->dev, busy);
 }
 
 void mpr_sig_release_inst_internal(mpr_local_sig lsig, int idmap_idx)
@@ -933,12 +972,35 @@ static int cmp_qry_sig_maps(const void *context_data, mpr_map map)
     return 0;
 }
 
+/* A signal may be both a source and the destination of a map, so maps are only returned at the
+ * first of their slots that refers to the signal. */
+static mpr_slot _get_sig_slot(mpr_map map, mpr_sig sig)
+{
+    int i;
+    for (i = 0; i < map->num_src; i++) {
+        if (map->src[i] && map->src[i]->sig == sig)
+            return map->src[i];
+    }
+    return map->dst;
+}
+
+static mpr_map next_sig_map(const void *context_data, mpr_map map)
+{
+    mpr_sig sig = *(mpr_sig*)context_data;
+    mpr_slot slot = map ? _get_sig_slot(map, sig)->sig_next : sig->slots;
+    for (; slot; slot = slot->sig_next) {
+        if (slot == _get_sig_slot(slot->map, sig))
+            return slot->map;
+    }
+    return 0;
+}
+
 mpr_list mpr_sig_get_maps(mpr_sig sig, mpr_dir dir)
 {
     mpr_list q;
-    RETURN_ARG_UNLESS(sig && sig->obj.graph->maps, 0);
-    q = mpr_list_new_query((const void**)&sig->obj.graph->maps, (void*)cmp_qry_sig_maps,
-                           "vi", &sig, dir);
+    RETURN_ARG_UNLESS(sig && sig->slots, 0);
+    q = mpr_list_new_chained_query((const void**)&sig->obj.graph->maps, (void*)next_sig_map,
+                                   (void*)cmp_qry_sig_maps, "vi", &sig, dir);
     return mpr_list_start(q);
 }
 
@@ -960,6 +1022,7 @@ static int _add_idmap(mpr_local_sig lsig, mpr_sig_inst si, mpr_id_map map)
         lsig->idmap_len = lsig->idmap_len ? lsig->idmap_len * 2 : 1;
         lsig->idmaps = realloc(lsig->idmaps, (lsig->idmap_len * sizeof(struct _mpr_sig_idmap)));
         memset(lsig->idmaps + i, 0, ((lsig->idmap_len - i) * sizeof(struct _mpr_sig_idmap)));
+        mpr_dev_rt_miss(lsig->dev);
     }
     lsig->idmaps[i].map = map;
     lsig->idmaps[i].inst = si;
@@ -967,6 +1030,19 @@ static int _add_idmap(mpr_local_sig lsig, mpr_sig_inst si, mpr_id_map map)
     return i;
 }
 
+void mpr_sig_reserve_idmaps(mpr_local_sig lsig)
+{
+    int len = lsig->idmap_len;
+    RETURN_UNLESS(lsig->idmaps);
+    while (len < lsig->num_inst && len < MAX_INSTANCES)
+        len *= 2;
+    RETURN_UNLESS(len > lsig->idmap_len);
+    lsig->idmaps = realloc(lsig->idmaps, len * sizeof(struct _mpr_sig_idmap));
+    memset(lsig->idmaps + lsig->idmap_len, 0,
+           (len - lsig->idmap_len) * sizeof(struct _mpr_sig_idmap));
+    lsig->idmap_len = len;
+}
+
 void mpr_sig_send_state(mpr_sig sig, net_msg_t cmd)
 {
     char str[BUFFSIZE];
@@ -987,6 +1063,8 @@ void mpr_sig_send_state(mpr_sig sig, net_msg_t cmd)
         mpr_net_send(&sig->obj.graph->net);
     }
     else {
+        if (sig->is_local)
+            mpr_net_stamp_obj(&sig->obj.graph->net, (mpr_obj)sig);
         mpr_sig_full_name(sig, str, BUFFSIZE);
         lo_message_add_string(msg, str);
 
@@ -1035,6 +1113,7 @@ int mpr_sig_set_from_msg(mpr_sig sig, mpr_msg msg)
                 if (a->types[0] == 'h') {
                     if (sig->obj.id != (a->vals[0])->i64) {
                         sig->obj.id = (a->vals[0])->i64;
+                        mpr_graph_index_obj(sig->obj.graph, (mpr_obj)sig);
                         ++updated;
                     }
                 }
@@ -1060,5 +1139,11 @@ int mpr_sig_set_from_msg(mpr_sig sig, mpr_msg msg)
                 break;
         }
     }
+    if (updated) {
+        mpr_graph_touch_obj(sig->obj.graph, (mpr_obj)sig);
+        /* subscribers catching up later must be sent the change */
+        if (sig->is_local)
+            mpr_net_stamp_obj(&sig->obj.graph->net, (mpr_obj)sig);
+    }
     return updated;
 }
@@ -0,0 +1,185 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#include "mapper_internal.h"
+#include "types_internal.h"
+#include <mapper/mapper.h>
+
+/* Pools of fixed-size blocks carved from larger slabs, backing the list items of graph objects
+ * and the headers and contexts of list queries. Each size class keeps a free list of released
+ * blocks, so that objects and queries that are created and freed repeatedly reuse the same
+ * memory instead of calling malloc() and free() each time. Every block is prefixed by the pool
+ * and class it came from, so it can be released without knowing its size. Query blocks may be
+ * released after the graph is freed, so they hold a reference that keeps their pool alive. */
+
+#define SLAB_BYTES      16384   /* bytes to reserve at once for each size class */
+#define SLAB_MIN_BLOCKS 4
+#define SLAB_MAX_BLOCK  4096    /* larger blocks are allocated individually */
+#define ALIGN(s)        (((s) + 15) & ~(size_t)15)
+
+/* block prefix, padded to keep the payload aligned */
+typedef struct _mpr_slab_block {
+    union {
+        struct _mpr_slab_block *next;   /* next free block of the same class */
+        mpr_slab slab;                  /* owner of a block in use */
+    } u;
+    int cls;                            /* size class, or -1 if allocated individually */
+    int ref;                            /* 1 if the block keeps its pool alive */
+} mpr_slab_block_t, *mpr_slab_block;
+
+typedef struct _mpr_slab_chunk {
+    struct _mpr_slab_chunk *next;
+    char pad[8];
+} mpr_slab_chunk_t, *mpr_slab_chunk;
+
+#define LOCK(s)     while (__atomic_test_and_set(&(s)->lock, __ATOMIC_ACQUIRE)) ;
+#define UNLOCK(s)   __atomic_clear(&(s)->lock, __ATOMIC_RELEASE);
+
+mpr_slab mpr_slab_new(void)
+{
+    return (mpr_slab)calloc(1, sizeof(mpr_slab_t));
+}
+
+static void _free_slab(mpr_slab s)
+{
+    while (s->chunks) {
+        mpr_slab_chunk c = s->chunks;
+        s->chunks = c->next;
+        free(c);
+    }
+    free(s);
+}
+
+void mpr_slab_free(mpr_slab s)
+{
+    int num_refs;
+    RETURN_UNLESS(s);
+    LOCK(s);
+    s->orphaned = 1;
+    num_refs = s->num_refs;
+    UNLOCK(s);
+    /* otherwise the last block holding a reference will free the pool */
+    if (!num_refs)
+        _free_slab(s);
+}
+
+/* Find the size class for blocks of size bytes, adding it if necessary. Returns -1 if the block
+ * is too large or if there are too many classes already. */
+static int _get_class(mpr_slab s, size_t size)
+{
+    int i;
+    for (i = 0; i < s->num_classes; i++) {
+        if (s->classes[i].size == size)
+            return i;
+    }
+    RETURN_ARG_UNLESS(size <= SLAB_MAX_BLOCK && s->num_classes < SLAB_MAX_CLASSES, -1);
+    s->classes[i].size = size;
+    s->classes[i].free = 0;
+    ++s->num_classes;
+    return i;
+}
+
+/* Reserve a new slab of blocks for a size class. */
+static int _add_slab(mpr_slab s, int cls)
+{
+    int i, num = SLAB_BYTES / (s->classes[cls].size + sizeof(mpr_slab_block_t));
+    size_t block_size = s->classes[cls].size + sizeof(mpr_slab_block_t);
+    mpr_slab_chunk c;
+    char *data;
+    if (num < SLAB_MIN_BLOCKS)
+        num = SLAB_MIN_BLOCKS;
+    c = (mpr_slab_chunk)malloc(sizeof(mpr_slab_chunk_t) + num * block_size);
+    RETURN_ARG_UNLESS(c, 1);
+    c->next = s->chunks;
+    s->chunks = c;
+    data = (char*)(c + 1);
+    for (i = num - 1; i >= 0; i--) {
+        mpr_slab_block b = (mpr_slab_block)(data + i * block_size);
+        b->cls = cls;
+        b->u.next = s->classes[cls].free;
+        s->classes[cls].free = b;
+    }
+    s->num_reserved += num;
+    return 0;
+}
+
+static void *_alloc(mpr_slab s, size_t size, int ref)
+{
+    mpr_slab_block b = 0;
+    int cls = -1;
+    if (s) {
+        LOCK(s);
+        ++s->num_allocs;
+        s->num_refs += ref;
+        cls = _get_class(s, ALIGN(size));
+        if (cls >= 0 && (s->classes[cls].free || !_add_slab(s, cls))) {
+            b = s->classes[cls].free;
+            s->classes[cls].free = b->u.next;
+            ++s->num_in_use;
+        }
+        else {
+            cls = -1;
+            ++s->num_misses;
+        }
+        UNLOCK(s);
+    }
+    if (!b) {
+        RETURN_ARG_UNLESS(b = (mpr_slab_block)malloc(sizeof(mpr_slab_block_t) + size), 0);
+        b->cls = -1;
+    }
+    b->u.slab = s;
+    b->ref = s ? ref : 0;
+    return b + 1;
+}
+
+void *mpr_slab_alloc(mpr_slab s, size_t size)
+{
+    return _alloc(s, size, 0);
+}
+
+void *mpr_slab_alloc_ref(mpr_slab s, size_t size)
+{
+    return _alloc(s, size, 1);
+}
+
+void *mpr_slab_calloc(mpr_slab s, size_t size)
+{
+    void *ptr = mpr_slab_alloc(s, size);
+    if (ptr)
+        memset(ptr, 0, size);
+    return ptr;
+}
+
+void mpr_slab_release(void *ptr)
+{
+    mpr_slab_block b;
+    mpr_slab s;
+    int free_slab = 0;
+    RETURN_UNLESS(ptr);
+    b = (mpr_slab_block)ptr - 1;
+    s = b->u.slab;
+    if (b->cls < 0 && !b->ref) {
+        free(b);
+        return;
+    }
+    LOCK(s);
+    if (b->ref)
+        free_slab = !--s->num_refs && s->orphaned;
+    if (b->cls >= 0) {
+        b->u.next = s->classes[b->cls].free;
+        s->classes[b->cls].free = b;
+        --s->num_in_use;
+    }
+    else
+        free(b);
+    UNLOCK(s);
+    if (free_slab)
+        _free_slab(s);
+}
+
+mpr_slab mpr_slab_get_owner(const void *ptr)
+{
+    return ptr ? ((mpr_slab_block)ptr - 1)->u.slab : 0;
+}
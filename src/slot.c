@@ -18,6 +18,8 @@ mpr_slot mpr_slot_new(mpr_map map, mpr_sig sig, unsigned char is_local, unsigned
     slot->is_local = is_local;
     slot->dir = (is_src == sig->is_local) ? MPR_DIR_OUT : MPR_DIR_IN;
     slot->causes_update = 1; /* default */
+    slot->sig_next = sig->slots;
+    sig->slots = slot;
     return slot;
 }
 
@@ -26,8 +28,20 @@ static int slot_mask(mpr_slot slot)
     return slot == slot->map->dst ? DST_SLOT_PROP : SRC_SLOT_PROP(slot->id);
 }
 
+void mpr_slot_unlink(mpr_slot slot)
+{
+    mpr_slot *p = &slot->sig->slots;
+    while (*p && *p != slot)
+        p = &(*p)->sig_next;
+    if (*p)
+        *p = slot->sig_next;
+}
+
 void mpr_slot_free(mpr_slot slot)
 {
+    mpr_slot_unlink(slot);
+    if (slot->is_local)
+        FUNC_IF(free, ((mpr_local_slot)slot)->tmpl.data);
     free(slot);
 }
 
@@ -0,0 +1,154 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <zlib.h>
+
+#include "mapper_internal.h"
+#include "types_internal.h"
+#include <mapper/mapper.h>
+
+/* Reference-counted strings shared by the objects of a graph. Signals on different devices often
+ * share the same names, and extra properties usually share the same keys, so each distinct string
+ * is stored once. Since a table never holds two copies of the same string, strings interned in
+ * the same table are equal if and only if their pointers are equal. */
+
+#define STRTAB_MIN_SIZE 64
+
+typedef struct _mpr_str {
+    struct _mpr_str *next;          /* next string in the same bucket */
+    uint32_t hash;
+    int refcount;
+    char str[1]; /* stub */
+} mpr_str_t, *mpr_str;
+
+#define LOCK(t)     while (__atomic_test_and_set(&(t)->lock, __ATOMIC_ACQUIRE)) ;
+#define UNLOCK(t)   __atomic_clear(&(t)->lock, __ATOMIC_RELEASE);
+
+static mpr_str _str_by_ptr(const char *str)
+{
+    return (mpr_str)(str - offsetof(mpr_str_t, str));
+}
+
+static uint32_t _hash_str(const char *str)
+{
+    return crc32(0L, (const Bytef *)str, strlen(str));
+}
+
+mpr_strtab mpr_strtab_new(void)
+{
+    mpr_strtab t = (mpr_strtab)calloc(1, sizeof(mpr_strtab_t));
+    RETURN_ARG_UNLESS(t, 0);
+    t->buckets = (mpr_str*)calloc(STRTAB_MIN_SIZE, sizeof(mpr_str));
+    if (!t->buckets) {
+        free(t);
+        return 0;
+    }
+    t->size = STRTAB_MIN_SIZE;
+    return t;
+}
+
+void mpr_strtab_free(mpr_strtab t)
+{
+    int i;
+    RETURN_UNLESS(t);
+    if (t->count)
+        trace("freeing string table with %d strings still in use\n", t->count);
+    for (i = 0; i < t->size; i++) {
+        while (t->buckets[i]) {
+            mpr_str s = t->buckets[i];
+            t->buckets[i] = s->next;
+            free(s);
+        }
+    }
+    free(t->buckets);
+    free(t);
+}
+
+static void _resize(mpr_strtab t, int size)
+{
+    int i;
+    mpr_str *buckets = (mpr_str*)calloc(size, sizeof(mpr_str));
+    RETURN_UNLESS(buckets);
+    for (i = 0; i < t->size; i++) {
+        while (t->buckets[i]) {
+            mpr_str s = t->buckets[i];
+            t->buckets[i] = s->next;
+            s->next = buckets[s->hash & (size - 1)];
+            buckets[s->hash & (size - 1)] = s;
+        }
+    }
+    free(t->buckets);
+    t->buckets = buckets;
+    t->size = size;
+}
+
+static mpr_str _find(mpr_strtab t, const char *str, uint32_t hash)
+{
+    mpr_str s = t->buckets[hash & (t->size - 1)];
+    while (s && (s->hash != hash || strcmp(s->str, str)))
+        s = s->next;
+    return s;
+}
+
+const char *mpr_strtab_add(mpr_strtab t, const char *str)
+{
+    uint32_t hash;
+    size_t len;
+    mpr_str s;
+    RETURN_ARG_UNLESS(str, 0);
+    RETURN_ARG_UNLESS(t, strdup(str));
+    hash = _hash_str(str);
+    len = strlen(str);
+    LOCK(t);
+    if ((s = _find(t, str, hash))) {
+        ++s->refcount;
+        t->bytes_saved += len + 1;
+    }
+    else if ((s = (mpr_str)malloc(offsetof(mpr_str_t, str) + len + 1))) {
+        memcpy(s->str, str, len + 1);
+        s->hash = hash;
+        s->refcount = 1;
+        s->next = t->buckets[hash & (t->size - 1)];
+        t->buckets[hash & (t->size - 1)] = s;
+        t->bytes += len + 1;
+        if (++t->count > t->size)
+            _resize(t, t->size * 2);
+    }
+    UNLOCK(t);
+    return s ? s->str : 0;
+}
+
+const char *mpr_strtab_find(mpr_strtab t, const char *str)
+{
+    mpr_str s;
+    RETURN_ARG_UNLESS(t && str, 0);
+    LOCK(t);
+    s = _find(t, str, _hash_str(str));
+    UNLOCK(t);
+    return s ? s->str : 0;
+}
+
+void mpr_strtab_release(mpr_strtab t, const char *str)
+{
+    mpr_str s, *p;
+    RETURN_UNLESS(str);
+    if (!t) {
+        free((char*)str);
+        return;
+    }
+    s = _str_by_ptr(str);
+    LOCK(t);
+    if (--s->refcount > 0) {
+        t->bytes_saved -= strlen(str) + 1;
+        UNLOCK(t);
+        return;
+    }
+    for (p = &t->buckets[s->hash & (t->size - 1)]; *p && *p != s; p = &(*p)->next) ;
+    if (*p)
+        *p = s->next;
+    t->bytes -= strlen(str) + 1;
+    --t->count;
+    UNLOCK(t);
+    free(s);
+}
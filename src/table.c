@@ -27,13 +27,45 @@ static int compare_rec(const void *l, const void *r)
     return idx_l - idx_r;
 }
 
-mpr_tbl mpr_tbl_new()
+/* Rebuild the direct lookup slots of the standard properties, which precede the extras. */
+static void _index_recs(mpr_tbl t)
 {
+    int i, idx;
+    memset(t->slots, 0, sizeof(t->slots));
+    for (i = 0; i < t->count; i++) {
+        idx = PROP_TO_INDEX(t->rec[i].prop);
+        if (INDEX_TO_PROP(idx) == MPR_PROP_EXTRA)
+            break;
+        if (idx < NUM_TBL_SLOTS)
+            t->slots[idx] = i + 1;
+    }
+    t->num_std = i;
+}
+
+/* Called after appending a record: sort only if it did not land in order. */
+static void _sort_recs(mpr_tbl t)
+{
+    int idx;
+    mpr_tbl_record rec = &t->rec[t->count - 1];
+    if (t->count > 1 && compare_rec(rec - 1, rec) > 0) {
+        qsort(t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
+        _index_recs(t);
+        return;
+    }
+    idx = PROP_TO_INDEX(rec->prop);
+    if (INDEX_TO_PROP(idx) == MPR_PROP_EXTRA)
+        return;
+    if (idx < NUM_TBL_SLOTS)
+        t->slots[idx] = t->count;
+    t->num_std = t->count;
+}
+
+mpr_tbl mpr_tbl_new(mpr_strtab strings)
+{
+    /* records are allocated with the first property */
     mpr_tbl t = (mpr_tbl)calloc(1, sizeof(mpr_tbl_t));
     RETURN_ARG_UNLESS(t, 0);
-    t->count = 0;
-    t->alloced = 1;
-    t->rec = (mpr_tbl_record)calloc(1, sizeof(mpr_tbl_record_t));
+    t->strings = strings;
     return t;
 }
 
@@ -45,7 +77,7 @@ void mpr_tbl_clear(mpr_tbl t)
         if (!(rec->flags & PROP_OWNED))
             continue;
         if (rec->key)
-            free((char*)rec->key);
+            mpr_strtab_release(t->strings, rec->key);
         if (free_vals && rec->val) {
             void *val = (rec->flags & INDIRECT) ? *rec->val : rec->val;
             if (val) {
@@ -64,9 +96,10 @@ void mpr_tbl_clear(mpr_tbl t)
                 *rec->val = 0;
         }
     }
-    t->count = 0;
-    t->rec = realloc(t->rec, sizeof(mpr_tbl_record_t));
-    t->alloced = 1;
+    free(t->rec);
+    t->rec = 0;
+    t->count = t->alloced = t->num_std = 0;
+    memset(t->slots, 0, sizeof(t->slots));
 }
 
 void mpr_tbl_free(mpr_tbl t)
@@ -82,14 +115,14 @@ static mpr_tbl_record mpr_tbl_add(mpr_tbl t, mpr_prop prop, const char *key,
     mpr_tbl_record rec;
     t->count += 1;
     if (t->count > t->alloced) {
-        while (t->count > t->alloced)
-            t->alloced *= 2;
+        /* most objects have only a few dozen properties, so grow in small steps */
+        t->alloced += t->alloced < 16 ? 4 : t->alloced / 4;
         t->rec = realloc(t->rec, t->alloced * sizeof(mpr_tbl_record_t));
     }
     rec = &t->rec[t->count-1];
     if (MPR_PROP_EXTRA == prop)
         flags |= MODIFIABLE;
-    rec->key = key ? strdup(key) : 0;
+    rec->key = key ? mpr_strtab_add(t->strings, key) : 0;
     rec->prop = prop;
     rec->len = len;
     rec->type = type;
@@ -116,12 +149,18 @@ int mpr_tbl_get_size(mpr_tbl t)
 mpr_tbl_record mpr_tbl_get(mpr_tbl t, mpr_prop prop, const char *key)
 {
     mpr_tbl_record_t tmp;
-    mpr_tbl_record rec = 0;
+    int idx = PROP_TO_INDEX(prop);
     RETURN_ARG_UNLESS(key || (MPR_PROP_UNKNOWN != prop && MPR_PROP_EXTRA != prop), 0);
+    if (INDEX_TO_PROP(idx) != MPR_PROP_EXTRA) {
+        /* standard properties are indexed directly */
+        RETURN_ARG_UNLESS(idx < NUM_TBL_SLOTS && t->slots[idx], 0);
+        return &t->rec[t->slots[idx] - 1];
+    }
+    RETURN_ARG_UNLESS(t->count > t->num_std, 0);
     tmp.prop = prop;
     tmp.key = key;
-    rec = bsearch(&tmp, t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
-    return rec;
+    return bsearch(&tmp, t->rec + t->num_std, t->count - t->num_std, sizeof(mpr_tbl_record_t),
+                   compare_rec);
 }
 
 mpr_prop mpr_tbl_get_prop_by_key(mpr_tbl t, const char *key, int *len, mpr_type *type,
@@ -237,7 +276,7 @@ int mpr_tbl_remove(mpr_tbl t, mpr_prop prop, const char *key, int flags)
 
 void mpr_tbl_clear_empty(mpr_tbl t)
 {
-    int i, j;
+    int i, j, removed = 0;
     mpr_tbl_record rec;
     for (i = 0; i < t->count; i++) {
         rec = &t->rec[i];
@@ -246,11 +285,14 @@ void mpr_tbl_clear_empty(mpr_tbl t)
         rec->prop &= ~PROP_REMOVE;
         if (MASK_PROP_BITFLAGS(rec->prop) != MPR_PROP_EXTRA)
             continue;
-        free((char*)rec->key);
+        mpr_strtab_release(t->strings, rec->key);
         for (j = rec - t->rec + 1; j < t->count; j++)
             t->rec[j-1] = t->rec[j];
         --t->count;
+        removed = 1;
     }
+    if (removed)
+        _index_recs(t);
 }
 
 /* For unknown reasons, strcpy crashes here with -O2, so we'll use memcpy
@@ -357,7 +399,7 @@ int set_internal(mpr_tbl t, mpr_prop prop, const char *key, int len,
             update_elements(rec, len, type, val);
         else
             rec->prop |= PROP_REMOVE;
-        qsort(t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
+        _sort_recs(t);
         updated = t->dirty = 1;
     }
     return updated;
@@ -377,6 +419,7 @@ void mpr_tbl_link(mpr_tbl t, mpr_prop prop, int len, mpr_type type, void *val,
                   int flags)
 {
     mpr_tbl_add(t, prop, NULL, len, type, val, flags);
+    _sort_recs(t);
 }
 
 static int update_elements_osc(mpr_tbl_record rec, unsigned int len,
@@ -457,7 +500,7 @@ int mpr_tbl_set_from_atom(mpr_tbl t, mpr_msg_atom atom, int flags)
         rec = mpr_tbl_add(t, atom->prop, atom->key, 0, atom->types[0], 0, flags | PROP_OWNED);
         rec->val = 0;
         update_elements_osc(rec, atom->len, atom->types, atom->vals);
-        qsort(t->rec, t->count, sizeof(mpr_tbl_record_t), compare_rec);
+        _sort_recs(t);
         updated = t->dirty = 1;
     }
     return updated;
@@ -506,7 +549,7 @@ static void mpr_record_add_to_msg(mpr_tbl_record rec, lo_message msg)
         len = strlen(temp);
     }
 
-    if (masked < 0 || masked > MPR_PROP_EXTRA) {
+    if (masked < 0 || masked > PROP_LAST) {
         trace("skipping malformed property.\n");
         goto done;
     }
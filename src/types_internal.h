@@ -70,11 +70,21 @@ typedef struct {
     char flags;
 } mpr_tbl_record_t, *mpr_tbl_record;
 
-/*! Used to hold look-up tables. */
+/*! The last standard property. Properties added since MPR_PROP_EXTRA are numbered after it so
+ *  that the values of earlier properties do not change. */
+#define PROP_LAST MPR_PROP_HOST_ID
+#define NUM_TBL_SLOTS ((PROP_LAST >> 8) + 1)
+
+/*! Used to hold look-up tables. Records of standard properties are kept first in the order of
+ *  their symbolic identifiers and are found directly through slots, followed by the records of
+ *  extra properties sorted by key. */
 typedef struct _mpr_tbl {
     mpr_tbl_record rec;
+    struct _mpr_strtab *strings;    /*!< Table interning the keys, or null to copy them. */
     int count;
     int alloced;
+    uint8_t num_std;                /*!< Number of records of standard properties. */
+    uint8_t slots[NUM_TBL_SLOTS];   /*!< Position + 1 of the record of each standard property. */
     char dirty;
 } mpr_tbl_t, *mpr_tbl;
 
@@ -83,6 +93,69 @@ typedef struct _mpr_dict {
     struct _mpr_tbl *staged;
 } mpr_dict_t, *mpr_dict;
 
+/**** Memory pools ****/
+
+#define SLAB_MAX_CLASSES 32
+
+/*! Pools of fixed-size blocks for list items and queries, segregated by block size. */
+typedef struct _mpr_slab {
+    struct _mpr_slab_chunk *chunks; /*!< Slabs reserved for all size classes. */
+    struct {
+        size_t size;
+        struct _mpr_slab_block *free;
+    } classes[SLAB_MAX_CLASSES];
+    int num_classes;
+    int num_allocs;                 /*!< Number of blocks allocated since the pool was created. */
+    int num_in_use;                 /*!< Number of pooled blocks currently allocated. */
+    int num_reserved;               /*!< Number of blocks in all slabs. */
+    int num_misses;                 /*!< Number of blocks too large for the pool. */
+    int num_refs;                   /*!< Number of blocks keeping the pool alive. */
+    char orphaned;                  /*!< 1 if the owner has freed the pool. */
+    char lock;
+} mpr_slab_t, *mpr_slab;
+
+/**** Interned strings ****/
+
+/*! Reference-counted strings shared by the objects of a graph, so that identical names and
+ *  property keys are stored once and can be compared by pointer. */
+typedef struct _mpr_strtab {
+    struct _mpr_str **buckets;
+    int size;                       /*!< Number of buckets, always a power of two. */
+    int count;                      /*!< Number of distinct strings. */
+    size_t bytes;                   /*!< Bytes used by the distinct strings. */
+    size_t bytes_saved;             /*!< Bytes that duplicate strings would have used. */
+    char lock;
+} mpr_strtab_t, *mpr_strtab;
+
+/**** Queues ****/
+
+/*! A bounded lock-free queue of fixed-size items with any number of producers and a single
+ *  consumer. The producer and consumer indexes are kept on separate cache lines. */
+typedef struct _mpr_ring {
+    char *data;
+    size_t slot_size;
+    size_t item_size;
+    uint32_t mask;
+    uint32_t num_dropped;           /*!< Number of items rejected because the queue was full. */
+    char pad1[64];
+    uint32_t head;                  /*!< Next position to be claimed by a producer. */
+    char pad2[64];
+    uint32_t tail;                  /*!< Next position to be read by the consumer. */
+} mpr_ring_t, *mpr_ring;
+
+/*! A ring of datagrams in a shared memory segment, carrying map updates between devices on
+ *  the same host. */
+typedef struct _mpr_shm {
+    struct _mpr_shm_hdr *hdr;       /*!< Start of the shared mapping. */
+    char *data;                     /*!< Start of the ring. */
+    size_t len;                     /*!< Size of the mapping. */
+    uint64_t next;                  /*!< Consumer position after the item being read. */
+    char *name;                     /*!< Segment name, only set by the consumer. */
+} mpr_shm_t, *mpr_shm;
+
+/*! A pool of threads evaluating map expressions. */
+typedef struct _mpr_workers *mpr_workers;
+
 /**** Graph ****/
 
 /*! A list of function and context pointers. */
@@ -108,11 +181,35 @@ typedef struct _mpr_subscription {
 #define SERVER_UDP      2
 #define SERVER_TCP      3
 
+#define DEFAULT_MTU         1472    /* UDP payload for a 1500 byte Ethernet MTU. */
+#define MAX_UDP_DGRAM_LEN   65507
+
+/*! A serialized datagram queued for sending. */
+typedef struct _mpr_dgram {
+    char *data;
+    size_t len;
+    void *addr;                     /*!< Destination socket address. */
+    int addr_len;
+    struct _mpr_buffer *buf;        /*!< Link buffer to reset once sent. */
+} mpr_dgram_t, *mpr_dgram;
+
+/*! Counters of the datagrams sent by mpr_net_send_dgrams(). */
+typedef struct _mpr_send_stats {
+    int num_calls;                  /*!< Number of send system calls made. */
+    int num_dropped;                /*!< Number of datagrams that could not be sent. */
+} mpr_send_stats_t, *mpr_send_stats;
+
+#define MAX_DGRAM_BATCH 64          /* Maximum number of datagrams per sendmmsg() call. */
+#define RECV_BATCH      16          /* Maximum number of datagrams per recvmmsg() call. */
+#define RECV_SLOT_LEN   65536       /* Size of each slot in the receive ring. */
+#define SHM_RING_SIZE   262144      /* Capacity of each shared memory ring. */
+#define SHM_MAX_DGRAM   16384       /* Maximum size of datagrams sent through shared memory. */
+
 /*! A structure that keeps information about network communications. */
 typedef struct _mpr_net {
     struct _mpr_graph *graph;
 
-    lo_server servers[4];
+    lo_server servers[2];           /*!< Admin servers shared by all local devices. */
 
     struct {
         lo_address bus;             /*!< LibLo address for the multicast bus. */
@@ -136,14 +233,41 @@ typedef struct _mpr_net {
 
     struct _mpr_rtr *rtr;
 
+    struct {
+        mpr_dgram queue;            /*!< Data datagrams waiting to be sent. */
+        int num;
+        int size;
+        mpr_send_stats_t stats;
+    } dgrams;
+
+    struct {
+        char *ring;                 /*!< Reusable buffers for batched datagram receives. */
+        int num_calls;              /*!< Number of receive system calls made. */
+    } recv;
+
+    struct {
+        char *data;                 /*!< Reusable buffer for serializing admin bundles. */
+        size_t size;
+    } admin_buf;
+
+    struct {
+        int epoch;                  /*!< Random id of the revision clock of local objects. */
+        int rev;                    /*!< Last revision stamped on a local object. */
+        int paused;                 /*!< Non-zero while bringing a subscriber up to date. */
+    } revs;
+
+    size_t admin_bytes;             /*!< Number of bytes of admin messages sent. */
+    mpr_send_stats_t admin_stats;   /*!< Datagrams sent to subscribers. */
     int random_id;                  /*!< Random id for allocation speedup. */
     int msgs_recvd;                 /*!< 1 if messages have been received on the
                                      *   multicast bus/mesh. */
     int msg_type;
     int num_devs;
+    int mtu;                        /*!< Maximum size of data datagrams, or 0 for default. */
     uint32_t next_bus_ping;
     uint32_t next_sub_ping;
     uint8_t graph_methods_added;
+    uint8_t dev_methods_added;
 } mpr_net_t, *mpr_net;
 
 /**** Messages ****/
@@ -193,6 +317,7 @@ typedef struct _mpr_allocated_t {
     uint8_t locked;             /*!< Whether or not the value has been locked (allocated). */
     uint8_t online;             /*!< Whether or not we are connected to the
                                  *   distributed allocation network. */
+    uint8_t fast;               /*!< Whether to shorten the allocation intervals. */
 } mpr_allocated_t, *mpr_allocated;
 
 /*! Clock and timing information. */
@@ -214,10 +339,24 @@ typedef struct _mpr_sync_clock_t {
 typedef struct _mpr_subscriber {
     struct _mpr_subscriber *next;
     lo_address addr;
+    void *sa;                       /*!< Resolved socket address, or 0 to send using liblo. */
+    int sa_len;
     uint32_t lease_exp;
     int flags;
 } *mpr_subscriber;
 
+/*! A removal announced to subscribers, kept so that it can be replayed to subscribers catching
+ *  up from an earlier revision. */
+typedef struct _mpr_tombstone {
+    struct _mpr_tombstone *next;
+    lo_message msg;
+    int rev;
+    int type;                       /*!< Subscription flag of the removed object. */
+    net_msg_t cmd;
+} *mpr_tombstone;
+
+#define MAX_TOMBSTONES 256          /* Maximum number of removals kept per device. */
+
 #define TIMEOUT_SEC 10              /* timeout after 10 seconds without ping */
 
 /**** Object ****/
@@ -229,9 +368,59 @@ typedef struct _mpr_obj
     void *data;                     /*!< User context pointer. */
     struct _mpr_dict props;         /*!< Properties associated with this signal. */
     int version;                    /*!< Version number. */
+    int batch_pos;                  /*!< Position + 1 of the object's pending batched event. */
     mpr_type type;                  /*!< Object type. */
+    uint8_t is_indexed;             /*!< Whether the object is in the id index of its graph. */
+    int rev;                        /*!< Revision at which a local object was last announced. */
+    mpr_id idx_id;                  /*!< The id under which the object is indexed. */
+    struct _mpr_obj *idx_next;      /*!< The next object in the same bucket of the index. */
 } mpr_obj_t, *mpr_obj;
 
+/*! Hash index of the devices, signals or maps of a graph by id. Objects are chained through their
+ *  idx_next field, so that indexing does not allocate once the buckets are large enough. */
+typedef struct _mpr_obj_idx {
+    mpr_obj *buckets;
+    int size;                       /*!< Number of buckets, zero or a power of two. */
+    int count;                      /*!< Number of indexed objects. */
+} mpr_obj_idx_t, *mpr_obj_idx;
+
+/*! Secondary index of the devices, signals or maps of a graph on the value of a property, see
+ *  mpr_graph_add_index(). Objects of its type that change are recorded, and their entries are
+ *  replaced when the index is next queried. */
+typedef struct _mpr_prop_idx {
+    struct _mpr_prop_idx *next;
+    struct _mpr_prop_idx_entry *entries;
+    struct _mpr_prop_idx_change *changes;
+    char *key;                      /*!< Name of the property if prop is MPR_PROP_UNKNOWN. */
+    int *buckets;                   /*!< First entry of each hash bucket, or -1. */
+    mpr_prop prop;
+    int num_entries;
+    int num_buckets;                /*!< Zero for ordered indexes. */
+    int num_changes;                /*!< Number of objects changed since the last query. */
+    int changes_size;
+    mpr_type type;                  /*!< Type of the indexed objects. */
+    uint8_t ordered;                /*!< 1 if entries are sorted by value, 0 if hashed. */
+    uint8_t built;
+    uint8_t has_nan;                /*!< 1 if any indexed value is NaN. */
+} mpr_prop_idx_t, *mpr_prop_idx;
+
+/*! A coalesced graph event waiting to be delivered to batched callbacks. */
+typedef struct _mpr_graph_batch_evt {
+    mpr_obj obj;                    /*!< The object, or null if the event was dropped. */
+    mpr_type type;
+    mpr_graph_evt evt;
+} mpr_graph_batch_evt_t, *mpr_graph_batch_evt;
+
+/*! Graph events collected during a poll for delivery to batched callbacks. */
+typedef struct _mpr_graph_batch {
+    mpr_graph_batch_evt evts;
+    int num_evts;
+    int size_evts;
+    mpr_obj *removed;               /*!< Removed objects to free once the batch is delivered. */
+    int num_removed;
+    int size_removed;
+} mpr_graph_batch_t, *mpr_graph_batch;
+
 typedef struct _mpr_graph {
     mpr_obj_t obj;                  /* always first */
     mpr_net_t net;
@@ -239,7 +428,14 @@ typedef struct _mpr_graph {
     mpr_list sigs;                  /*!< List of signals. */
     mpr_list maps;                  /*!< List of maps. */
     mpr_list links;                 /*!< List of links. */
+    mpr_obj_idx_t idx[3];           /*!< Indexes of devices, signals and maps by id. */
+    mpr_obj_idx_t dev_names;        /*!< Index of devices by name. */
+    mpr_prop_idx prop_idx;          /*!< Indexes of objects by property value. */
+    mpr_slab slab;                  /*!< Pool backing objects and queries. */
+    mpr_strtab strings;             /*!< Interned signal paths and property keys. */
     fptr_list callbacks;            /*!< List of object record callbacks. */
+    fptr_list batch_callbacks;      /*!< List of callbacks receiving batches of events. */
+    mpr_graph_batch_t batch;        /*!< Events pending for the batched callbacks. */
 
     /*! Linked-list of autorenewing device subscriptions. */
     mpr_subscription subscriptions;
@@ -332,6 +528,10 @@ typedef struct _mpr_sig_idmap
     int num_maps_out;           /* TODO: use dynamic query instead? */                  \
     mpr_steal_type steal_mode;  /*!< Type of voice stealing to perform. */              \
     mpr_type type;              /*!< The type of this signal. */                        \
+    struct _mpr_slot *slots;    /*!< Chain of the map slots referring to this signal. */\
+    struct _mpr_sig *dev_next;  /*!< Next signal of the same device. */                 \
+    struct _mpr_sig *name_next; /*!< Next signal in the same device name bucket. */     \
+    uint32_t name_hash;         /*!< Hash under which the name is indexed. */           \
     int is_local;
 
 /*! A record that describes properties of a signal. */
@@ -359,18 +559,38 @@ typedef struct _mpr_local_sig
                                      *  instance event handler. */
 
     mpr_sig_group group;            /* TODO: replace with hierarchical instancing */
+    int alias;                      /*!< Integer alias for incoming data messages. */
     uint8_t locked;
     uint8_t updated;                /* TODO: fold into updated_inst bitflags. */
 } mpr_local_sig_t, *mpr_local_sig;
 
 /**** Router ****/
 
+/*! A reusable buffer holding one or more serialized OSC bundles, each of which will be sent as
+ *  a separate datagram. */
+typedef struct _mpr_buffer {
+    char *data;
+    size_t len;                     /*!< Number of bytes in use. */
+    size_t size;                    /*!< Number of bytes allocated. */
+    size_t start;                   /*!< Offset of the bundle currently being filled. */
+    size_t *ends;                   /*!< End offsets of completed bundles. */
+    int num_dgrams;                 /*!< Number of completed bundles. */
+    int max_dgrams;
+    int num_msgs;
+} mpr_buffer_t, *mpr_buffer;
+
+/*! Links between two local devices are not sent over the network: the udp bundle then holds
+ *  messages for the local device of the link and the tcp bundle those for the remote device. */
 typedef struct _mpr_bundle {
-    lo_bundle udp;
-    lo_bundle tcp;
+    lo_bundle udp;                  /*!< UDP messages, or messages for the LOCAL_DEV end of
+                                     *   an in-process link. */
+    lo_bundle tcp;                  /*!< TCP messages, or messages for the REMOTE_DEV end of
+                                     *   an in-process link. */
+    mpr_buffer_t buf;               /*!< Serialized UDP messages, reused between polls. */
+    mpr_buffer_t shm;               /*!< Serialized messages for shared memory maps. */
 } mpr_bundle_t, *mpr_bundle;
 
-#define NUM_BUNDLES 1
+#define NUM_BUNDLES 2
 #define LOCAL_DEV   0
 #define REMOTE_DEV  1
 
@@ -383,8 +603,16 @@ typedef struct _mpr_link {
         lo_address admin;               /*!< Network address of remote endpoint */
         lo_address udp;                 /*!< Network address of remote endpoint */
         lo_address tcp;                 /*!< Network address of remote endpoint */
+        void *udp_sa;                   /*!< Resolved socket address for raw UDP sends. */
+        int udp_sa_len;
     } addr;
 
+    struct {
+        mpr_shm rx;                     /*!< Datagrams from the remote device, if on this host. */
+        mpr_shm tx;                     /*!< Datagrams to the remote device, if on this host. */
+        int same_host;
+    } shm;
+
     mpr_bundle_t bundles[NUM_BUNDLES];  /*!< Circular buffer to handle interrupts during poll() */
 
     mpr_sync_clock_t clock;
@@ -395,6 +623,20 @@ typedef struct _mpr_link {
 #define MAX_NUM_MAP_SRC     8       /* arbitrary */
 #define MAX_NUM_MAP_DST     8       /* arbitrary */
 
+/*! A pre-serialized OSC message image for value updates. The value, instance id and slot id
+ *  are patched in place before each send. */
+typedef struct _mpr_msg_tmpl {
+    char *data;
+    const char *path;               /*!< Destination path the image was built for. */
+    int len;                        /*!< Length of the image in bytes. */
+    int val_offset;
+    int inst_offset;                /*!< Offset of the instance id, or 0 if not included. */
+    int slot_offset;
+    int vec_len;
+    mpr_type type;
+    char packed;
+} mpr_msg_tmpl_t, *mpr_msg_tmpl;
+
 #define MPR_SLOT_STRUCT_ITEMS                                                   \
     mpr_sig sig;                    /*!< Pointer to parent signal */            \
     mpr_link link;                                                              \
@@ -403,6 +645,7 @@ typedef struct _mpr_link {
     char dir;                       /*!< DI_INCOMING or DI_OUTGOING */          \
     char causes_update;             /*!< 1 if causes update, 0 otherwise. */    \
     char is_local;                                                              \
+    struct _mpr_slot *sig_next;     /*!< Next slot of the same signal. */       \
 
 typedef struct _mpr_slot {
     MPR_SLOT_STRUCT_ITEMS
@@ -416,6 +659,7 @@ typedef struct _mpr_local_slot {
     /* each slot can point to local signal or a remote link structure */
     struct _mpr_rtr_sig *rsig;      /*!< Parent signal if local */
     mpr_value_t val;                /*!< Value histories for each signal instance. */
+    mpr_msg_tmpl_t tmpl;            /*!< Serialized value update sent by this slot. */
     char status;
 } mpr_local_slot_t, *mpr_local_slot;
 
@@ -425,6 +669,7 @@ typedef struct _mpr_local_slot {
     char *expr_str;                                                             \
     struct _mpr_id_map *idmap;      /*!< Associated mpr_id_map. */              \
     int muted;                      /*!< 1 to mute mapping, 0 to unmute */      \
+    int packed;                     /*!< 1 to send vectors as packed blobs. */  \
     int num_scopes;                                                             \
     int num_src;                                                                \
     mpr_loc process_loc;                                                        \
@@ -447,14 +692,23 @@ typedef struct _mpr_local_map {
     mpr_local_slot dst;
 
     struct _mpr_rtr *rtr;
+    struct _mpr_local_dev *dev;     /*!< The local device evaluating this map. */
 
     mpr_expr expr;                  /*!< The mapping expression. */
     char *updated_inst;             /*!< Bitflags to indicate updated instances. */
+    struct {
+        uint8_t *status;            /*!< Evaluation status of each instance. */
+        mpr_type *types;            /*!< Result types of each instance. */
+        uint8_t done;               /*!< Non-zero if evaluated but not yet sent. */
+    } eval;
     mpr_value_t *vars;              /*!< User variables values. */
     const char **var_names;         /*!< User variables names. */
     int num_vars;                   /*!< Number of user variables. */
     int num_inst;                   /*!< Number of local instances. */
 
+    char alias_path[16];            /*!< Aliased destination path, or empty if none. */
+    char packed_ok;                 /*!< 1 if a remote destination can unpack vectors. */
+
     uint8_t is_local_only;
     uint8_t one_src;
     uint8_t updated;
@@ -477,7 +731,6 @@ typedef struct _mpr_rtr_sig {
 
 /*! The router structure. */
 typedef struct _mpr_rtr {
-    struct _mpr_local_dev *dev;     /*!< The device associated with this link. */
     mpr_rtr_sig sigs;               /*!< The list of mappings for each signal. */
 } mpr_rtr_t, *mpr_rtr;
 
@@ -508,11 +761,18 @@ typedef struct _mpr_id_map {
     int num_linked;     /*!< Number of linked devices. */               \
     int status;                                                         \
     uint8_t subscribed;                                                 \
+    uint8_t is_name_indexed;                                            \
+    uint32_t name_hash; /*!< Hash under which the name is indexed. */   \
+    mpr_dev name_next;  /*!< Next device in the same name bucket. */    \
+    mpr_sig sigs;       /*!< Chain of the signals of this device. */    \
+    mpr_obj_idx_t sig_names; /*!< Index of the signals by name. */      \
     int is_local;
 
 /*! A record that keeps information about a device. */
 struct _mpr_dev {
     MPR_DEV_STRUCT_ITEMS
+    int sync_epoch;     /*!< Revision clock of the device when last brought up to date. */
+    int sync_revs[2];   /*!< Last revision received for signals and maps, or -1. */
 };
 
 struct _mpr_local_dev {
@@ -525,13 +785,53 @@ struct _mpr_local_dev {
 
     mpr_subscriber subscribers;         /*!< Linked-list of subscribed peers. */
 
+    struct {
+        mpr_tombstone head;             /*!< Oldest removal announced to subscribers. */
+        mpr_tombstone tail;             /*!< Newest removal announced to subscribers. */
+        int num;
+        int floor;                      /*!< Revision of the last removal forgotten. Subscribers
+                                         *   up to date with an earlier revision are sent the
+                                         *   full state again. */
+    } tombstones;
+
+    lo_server servers[4];               /*!< The admin servers of the network, followed by the
+                                         *   UDP and TCP data servers of this device. */
+
     struct {
         struct _mpr_id_map **active;    /*!< The list of active instance id maps. */
         struct _mpr_id_map *reserve;    /*!< The list of reserve instance id maps. */
+        int num;                        /*!< Number of id maps allocated. */
     } idmaps;
 
     mpr_expr_stack expr_stack;
 
+    struct _mpr_local_sig **sig_aliases;    /*!< Local signals indexed by alias-1. */
+    int num_sig_aliases;
+
+    struct {
+        int msgs;                       /*!< Maximum datagrams to drain per poll, or 0. */
+        int usec;                       /*!< Maximum time to spend draining per poll, or 0. */
+    } poll_budget;
+
+    struct _mpr_dev_thread *thread;     /*!< I/O thread started by mpr_dev_start_polling(). */
+    struct _mpr_dev_thread *thread_mem; /*!< State of the I/O thread, reused until the device is
+                                         *   freed so that it outlives detached threads. */
+    mpr_workers workers;                /*!< Threads evaluating outgoing maps, or 0. */
+
+    struct {
+        mpr_ring queue;                 /*!< Signal updates deferred by other threads or by
+                                         *   interrupts, applied by mpr_dev_poll(). */
+        size_t val_size;                /*!< Maximum value size of queued updates. */
+        size_t max_val_size;            /*!< Largest value size of the device's signals. */
+        int num_dropped;                /*!< Updates dropped for lack of a large enough queue. */
+    } updates;
+    volatile int busy;                  /*!< Non-zero while the update path is in use. */
+
+    struct {
+        int enabled;                    /*!< Non-zero to preallocate for the update path. */
+        int num_misses;                 /*!< Number of times a preallocated pool was exhausted. */
+    } rt;
+
     mpr_time time;
     int num_sig_groups;
     uint8_t time_is_stale;
@@ -0,0 +1,221 @@
+#include "config.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef HAVE_PTHREAD
+ #include <pthread.h>
+#endif
+
+#include "mapper_internal.h"
+#include "types_internal.h"
+#include <mapper/mapper.h>
+
+/* Pool of threads evaluating the expressions of updated outgoing maps. The maps to evaluate are
+ * split into one contiguous range per participant, including the polling thread. Each participant
+ * takes maps from the front of its own range and, once it is exhausted, steals maps from the
+ * ranges of the others. Evaluating a map only touches state owned by that map, so the only shared
+ * state is the position in each range. Results are stored in the maps and sent afterwards by the
+ * polling thread in the usual order, so the resulting bundles do not depend on scheduling. */
+
+#define FETCH_ADD(p, v) __atomic_fetch_add(p, v, __ATOMIC_ACQ_REL)
+
+/* do not wake the workers for fewer maps per participant than this */
+#define MIN_MAPS_PER_WORKER 4
+
+#ifdef HAVE_PTHREAD
+
+/*! A range of maps to evaluate, kept on its own cache line. */
+typedef struct _mpr_worker_range {
+    uint32_t next;
+    uint32_t end;
+    char pad[56];
+} mpr_worker_range_t;
+
+typedef struct _mpr_worker {
+    struct _mpr_workers *pool;
+    mpr_expr_stack stk;
+    pthread_t tid;
+    int idx;
+} mpr_worker_t, *mpr_worker;
+
+struct _mpr_workers {
+    mpr_worker_range_t *ranges;     /*!< One range per worker, then one for the caller. */
+    mpr_worker_t *workers;
+    mpr_local_map *maps;            /*!< Maps to evaluate in the current round. */
+    int num_maps;
+    int size;                       /*!< Allocated length of maps. */
+    int num_workers;
+    mpr_time time;
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned int round;             /*!< Incremented to start a round of evaluation. */
+    int num_busy;                   /*!< Number of workers still evaluating this round. */
+    int running;
+};
+
+/* Evaluate maps from the range at index idx, then from the other ranges. */
+static void _eval_maps(mpr_workers w, int idx, mpr_expr_stack stk)
+{
+    int i, num_ranges = w->num_workers + 1;
+    for (i = 0; i < num_ranges; i++) {
+        mpr_worker_range_t *r = &w->ranges[(idx + i) % num_ranges];
+        uint32_t pos;
+        while ((pos = FETCH_ADD(&r->next, 1)) < r->end)
+            mpr_map_eval(w->maps[pos], stk, w->time);
+    }
+}
+
+static void *_worker_thread(void *data)
+{
+    mpr_worker worker = (mpr_worker)data;
+    mpr_workers w = worker->pool;
+    unsigned int round = 0;
+
+    pthread_mutex_lock(&w->lock);
+    while (1) {
+        while (w->running && w->round == round)
+            pthread_cond_wait(&w->start, &w->lock);
+        if (!w->running)
+            break;
+        round = w->round;
+        pthread_mutex_unlock(&w->lock);
+
+        _eval_maps(w, worker->idx, worker->stk);
+
+        pthread_mutex_lock(&w->lock);
+        if (!--w->num_busy)
+            pthread_cond_signal(&w->done);
+    }
+    pthread_mutex_unlock(&w->lock);
+    return 0;
+}
+
+static void _stop_workers(mpr_workers w, int num_started)
+{
+    int i;
+    pthread_mutex_lock(&w->lock);
+    w->running = 0;
+    pthread_cond_broadcast(&w->start);
+    pthread_mutex_unlock(&w->lock);
+    for (i = 0; i < num_started; i++)
+        pthread_join(w->workers[i].tid, 0);
+}
+
+mpr_workers mpr_workers_new(int num_workers)
+{
+    int i;
+    mpr_workers w;
+    RETURN_ARG_UNLESS(num_workers > 0, 0);
+    w = (mpr_workers)calloc(1, sizeof(struct _mpr_workers));
+    RETURN_ARG_UNLESS(w, 0);
+    w->ranges = (mpr_worker_range_t*)calloc(num_workers + 1, sizeof(mpr_worker_range_t));
+    w->workers = (mpr_worker_t*)calloc(num_workers, sizeof(mpr_worker_t));
+    pthread_mutex_init(&w->lock, 0);
+    pthread_cond_init(&w->start, 0);
+    pthread_cond_init(&w->done, 0);
+    w->running = 1;
+    if (!w->ranges || !w->workers) {
+        mpr_workers_free(w);
+        return 0;
+    }
+
+    for (i = 0; i < num_workers; i++) {
+        mpr_worker worker = &w->workers[i];
+        worker->pool = w;
+        worker->idx = i;
+        worker->stk = mpr_expr_stack_new();
+        if (pthread_create(&worker->tid, 0, _worker_thread, worker)) {
+            trace("error: could not start map evaluation thread.\n");
+            mpr_expr_stack_free(worker->stk);
+            mpr_workers_free(w);
+            return 0;
+        }
+        /* only started workers are stopped by mpr_workers_free() */
+        w->num_workers = i + 1;
+    }
+    return w;
+}
+
+void mpr_workers_free(mpr_workers w)
+{
+    int i;
+    RETURN_UNLESS(w);
+    _stop_workers(w, w->num_workers);
+    for (i = 0; i < w->num_workers; i++)
+        mpr_expr_stack_free(w->workers[i].stk);
+    pthread_mutex_destroy(&w->lock);
+    pthread_cond_destroy(&w->start);
+    pthread_cond_destroy(&w->done);
+    FUNC_IF(free, w->maps);
+    FUNC_IF(free, w->workers);
+    FUNC_IF(free, w->ranges);
+    free(w);
+}
+
+int mpr_workers_add_map(mpr_workers w, mpr_local_map map)
+{
+    int miss = 0;
+    if (w->num_maps >= w->size) {
+        int size = w->size ? w->size * 2 : 64;
+        mpr_local_map *maps = realloc(w->maps, size * sizeof(mpr_local_map));
+        RETURN_ARG_UNLESS(maps, -1);
+        w->maps = maps;
+        w->size = size;
+        miss = 1;
+    }
+    w->maps[w->num_maps++] = map;
+    return miss;
+}
+
+void mpr_workers_eval(mpr_workers w, mpr_expr_stack stk, mpr_time time)
+{
+    int i, num_ranges = w->num_workers + 1, num_maps = w->num_maps;
+    RETURN_UNLESS(num_maps);
+    w->num_maps = 0;
+    if (num_maps < num_ranges * MIN_MAPS_PER_WORKER) {
+        /* not worth waking the workers */
+        for (i = 0; i < num_maps; i++)
+            mpr_map_eval(w->maps[i], stk, time);
+        return;
+    }
+
+    /* expressions size the stack of the polling thread when they are parsed */
+    for (i = 0; i < w->num_workers; i++)
+        mpr_expr_stack_reserve(w->workers[i].stk, stk);
+    for (i = 0; i < num_ranges; i++) {
+        w->ranges[i].next = num_maps * i / num_ranges;
+        w->ranges[i].end = num_maps * (i + 1) / num_ranges;
+    }
+    w->time = time;
+
+    pthread_mutex_lock(&w->lock);
+    w->num_busy = w->num_workers;
+    ++w->round;
+    pthread_cond_broadcast(&w->start);
+    pthread_mutex_unlock(&w->lock);
+
+    /* the polling thread evaluates maps too, starting with the last range */
+    _eval_maps(w, w->num_workers, stk);
+
+    pthread_mutex_lock(&w->lock);
+    while (w->num_busy)
+        pthread_cond_wait(&w->done, &w->lock);
+    pthread_mutex_unlock(&w->lock);
+}
+
+#else /* HAVE_PTHREAD */
+
+mpr_workers mpr_workers_new(int num_workers) { return 0; }
+
+void mpr_workers_free(mpr_workers w) {}
+
+int mpr_workers_add_map(mpr_workers w, mpr_local_map map) { return -1; }
+
+void mpr_workers_eval(mpr_workers w, mpr_expr_stack stk, mpr_time time) {}
+
+#endif /* HAVE_PTHREAD */
@@ -870,11 +870,13 @@ static named_prop get_obj_prop_by_idx(mpr_obj obj, int idx) {
 
 /*! Symbolic representation of recognized properties. */
 %constant int PROP_UNKNOWN              = MPR_PROP_UNKNOWN;
+%constant int PROP_ALIAS                = MPR_PROP_ALIAS;
 %constant int PROP_CALIB                = MPR_PROP_CALIB;
 %constant int PROP_DEV                  = MPR_PROP_DEV;
 %constant int PROP_DIR                  = MPR_PROP_DIR;
 %constant int PROP_EXPR                 = MPR_PROP_EXPR;
 %constant int PROP_HOST                 = MPR_PROP_HOST;
+%constant int PROP_HOST_ID              = MPR_PROP_HOST_ID;
 %constant int PROP_ID                   = MPR_PROP_ID;
 %constant int PROP_INST                 = MPR_PROP_INST;
 %constant int PROP_IS_LOCAL             = MPR_PROP_IS_LOCAL;
@@ -893,6 +895,7 @@ static named_prop get_obj_prop_by_idx(mpr_obj obj, int idx) {
 %constant int PROP_NUM_SIGS_IN          = MPR_PROP_NUM_SIGS_IN;
 %constant int PROP_NUM_SIGS_OUT         = MPR_PROP_NUM_SIGS_OUT;
 %constant int PROP_ORDINAL              = MPR_PROP_ORDINAL;
+%constant int PROP_PACKED               = MPR_PROP_PACKED;
 %constant int PROP_PERIOD               = MPR_PROP_PERIOD;
 %constant int PROP_PORT                 = MPR_PROP_PORT;
 %constant int PROP_PROCESS_LOC          = MPR_PROP_PROCESS_LOC;
@@ -931,6 +934,7 @@ static named_prop get_obj_prop_by_idx(mpr_obj obj, int idx) {
 %constant int PROTO_UNDEFINED           = MPR_PROTO_UNDEFINED;
 %constant int PROTO_UDP                 = MPR_PROTO_UDP;
 %constant int PROTO_TCP                 = MPR_PROTO_TCP;
+%constant int PROTO_SHM                 = MPR_PROTO_SHM;
 
 /*! The set of possible directions for a signal. */
 %constant int DIR_UNDEFINED             = MPR_DIR_UNDEFINED;
@@ -1049,9 +1053,12 @@ typedef struct _device_list {
         return $self;
     }
     int length() {
+        // materialize the list so that repeated length and index lookups are cheap
+        $self->list = mpr_list_materialize($self->list);
         return mpr_list_get_size($self->list);
     }
     device *__getitem__(int index) {
+        $self->list = mpr_list_materialize($self->list);
         // python lists allow negative indexes
         if (index < 0)
             index += mpr_list_get_size($self->list);
@@ -1138,6 +1145,35 @@ typedef struct _device_list {
         PyEval_RestoreThread(_save);
         return rc;
     }
+    device *start_polling(int block_ms=1) {
+        mpr_dev_start_polling((mpr_dev)$self, block_ms);
+        return $self;
+    }
+    device *stop_polling() {
+        _save = PyEval_SaveThread();
+        mpr_dev_stop_polling((mpr_dev)$self);
+        PyEval_RestoreThread(_save);
+        return $self;
+    }
+    device *set_num_workers(int num_workers) {
+        mpr_dev_set_num_workers((mpr_dev)$self, num_workers);
+        return $self;
+    }
+    device *set_fast_registration(int ordinal=0) {
+        mpr_dev_set_fast_registration((mpr_dev)$self, ordinal);
+        return $self;
+    }
+    device *set_poll_budget(int max_msgs, int max_usec) {
+        mpr_dev_set_poll_budget((mpr_dev)$self, max_msgs, max_usec);
+        return $self;
+    }
+    device *set_realtime(booltype enable=1) {
+        mpr_dev_set_realtime((mpr_dev)$self, enable);
+        return $self;
+    }
+    int get_num_pool_misses() {
+        return mpr_dev_get_num_pool_misses((mpr_dev)$self);
+    }
 
     // queue management
     time *get_time() {
@@ -1318,9 +1354,12 @@ typedef struct _signal_list {
         return $self;
     }
     int length() {
+        // materialize the list so that repeated length and index lookups are cheap
+        $self->list = mpr_list_materialize($self->list);
         return mpr_list_get_size($self->list);
     }
     signal *__getitem__(int index) {
+        $self->list = mpr_list_materialize($self->list);
         // python lists allow negative indexes
         if (index < 0)
             index += mpr_list_get_size($self->list);
@@ -1586,9 +1625,12 @@ typedef struct _map_list {
         return $self;
     }
     int length() {
+        // materialize the list so that repeated length and index lookups are cheap
+        $self->list = mpr_list_materialize($self->list);
         return mpr_list_get_size($self->list);
     }
     map *__getitem__(int index) {
+        $self->list = mpr_list_materialize($self->list);
         // python lists allow negative indexes
         if (index < 0)
             index += mpr_list_get_size($self->list);
@@ -1753,6 +1795,13 @@ typedef struct _map_list {
         mpr_graph_set_address((mpr_graph)$self, group, port);
         return $self;
     }
+    int get_mtu() {
+        return mpr_graph_get_mtu((mpr_graph)$self);
+    }
+    graph *set_mtu(int mtu) {
+        mpr_graph_set_mtu((mpr_graph)$self, mtu);
+        return $self;
+    }
     int poll(int timeout=0) {
         _save = PyEval_SaveThread();
         int rc = mpr_graph_poll((mpr_graph)$self, timeout);
@@ -1797,9 +1846,32 @@ typedef struct _map_list {
         ret->list = mpr_graph_get_objs((mpr_graph)$self, MPR_MAP);
         return ret;
     }
+    PyObject *get_pool_stats() {
+        int in_use, reserved, misses;
+        int allocs = mpr_graph_get_pool_stats((mpr_graph)$self, &in_use, &reserved, &misses);
+        return Py_BuildValue("{s:i,s:i,s:i,s:i}", "allocs", allocs, "in_use", in_use,
+                             "reserved", reserved, "misses", misses);
+    }
+    graph *add_index(int type, const char *key, booltype ordered=0) {
+        mpr_graph_add_index((mpr_graph)$self, type, MPR_PROP_UNKNOWN, key, ordered);
+        return $self;
+    }
+    graph *add_index(int type, int prop, booltype ordered=0) {
+        mpr_graph_add_index((mpr_graph)$self, type, prop, NULL, ordered);
+        return $self;
+    }
+    graph *remove_index(int type, const char *key) {
+        mpr_graph_remove_index((mpr_graph)$self, type, MPR_PROP_UNKNOWN, key);
+        return $self;
+    }
+    graph *remove_index(int type, int prop) {
+        mpr_graph_remove_index((mpr_graph)$self, type, prop, NULL);
+        return $self;
+    }
     %pythoncode {
         interface = property(get_interface, set_interface)
         address = property(get_address, set_address)
+        mtu = property(get_mtu, set_mtu)
         def __nonzero__(self):
             return False if self.this is None else True
     }
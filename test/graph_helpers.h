@@ -0,0 +1,80 @@
+#ifndef __MPR_TEST_GRAPH_HELPERS_H__
+#define __MPR_TEST_GRAPH_HELPERS_H__
+
+/* Helpers for tests that populate a graph directly with remote devices and signals, as if they
+ * had been announced by peers on the network. */
+
+#include <stdio.h>
+#include <lo/lo_lowlevel.h>
+#include "../src/mapper_internal.h"
+
+/* Callback adding test-specific properties for signal sig_idx of device dev_idx. */
+typedef void graph_sig_props_fn(lo_message lom, int dev_idx, int sig_idx);
+
+/* Returns a new property message for an input or output signal, or 0 on error. */
+MPR_INLINE static lo_message graph_sig_msg(int output)
+{
+    lo_message lom = lo_message_new();
+    if (!lom)
+        return 0;
+    lo_message_add_string(lom, "@direction");
+    lo_message_add_string(lom, output ? "output" : "input");
+    return lom;
+}
+
+/* Add or update a signal record using the properties in lom, which is freed. Returns non-zero on
+ * error. */
+MPR_INLINE static int graph_add_sig(mpr_graph g, const char *dev_name, const char *sig_name,
+                                    lo_message lom)
+{
+    mpr_msg props;
+    if (!lom)
+        return 1;
+    props = mpr_msg_parse_props(lo_message_get_argc(lom), lo_message_get_types(lom),
+                                lo_message_get_argv(lom));
+    if (props) {
+        mpr_graph_add_sig(g, sig_name, dev_name, props);
+        mpr_msg_free(props);
+    }
+    lo_message_free(lom);
+    return !props;
+}
+
+/* Add num_devs devices named "<prefix>.1" onwards, each with sigs_per_dev signals alternating
+ * between inputs "in<n>" and outputs "out<n>". Returns non-zero on error. */
+MPR_INLINE static int graph_add_devs(mpr_graph g, const char *prefix, int num_devs,
+                                     int sigs_per_dev, graph_sig_props_fn *props)
+{
+    int i, j;
+    char dev_name[32], sig_name[32];
+    lo_message lom;
+    for (i = 0; i < num_devs; i++) {
+        snprintf(dev_name, 32, "%s.%d", prefix, i + 1);
+        if (!mpr_graph_add_dev(g, dev_name, 0))
+            return 1;
+        for (j = 0; j < sigs_per_dev; j++) {
+            snprintf(sig_name, 32, "%s%d", j % 2 ? "out" : "in", j);
+            if (!(lom = graph_sig_msg(j % 2)))
+                return 1;
+            if (props)
+                props(lom, i, j);
+            if (graph_add_sig(g, dev_name, sig_name, lom))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/* Remove every stride-th device added by graph_add_devs() along with its signals. */
+MPR_INLINE static void graph_remove_devs(mpr_graph g, const char *prefix, int num_devs,
+                                         int stride)
+{
+    int i;
+    char dev_name[32];
+    for (i = 0; i < num_devs; i += stride) {
+        snprintf(dev_name, 32, "%s.%d", prefix, i + 1);
+        mpr_graph_remove_dev(g, mpr_graph_get_dev_by_name(g, dev_name), MPR_OBJ_REM, 1);
+    }
+}
+
+#endif /* __MPR_TEST_GRAPH_HELPERS_H__ */
@@ -0,0 +1,309 @@
+#ifdef __linux__
+#define _GNU_SOURCE /* for sendmmsg() */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#include <lo/lo_lowlevel.h>
+#include "../src/mapper_internal.h"
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int num_graphs = 32;
+int iterations = 50;
+
+mpr_dev dev = 0;
+mpr_sig outsig = 0;
+mpr_graph *graphs = 0;
+
+/* statistics collected by the syscall shim */
+int *graph_ports = 0;
+int disable_sendmmsg = 0;
+int num_calls = 0;
+int num_dgrams = 0;
+
+#define NUM_MODES 2
+const char *mode_names[] = {"batched", "per-datagram"};
+double latency[NUM_MODES];
+float calls_per_push[NUM_MODES];
+
+static int is_graph_addr(const struct sockaddr *addr)
+{
+    int i, port;
+    if (!graph_ports || !addr || AF_INET != addr->sa_family)
+        return 0;
+    port = ntohs(((const struct sockaddr_in*)addr)->sin_port);
+    for (i = 0; i < num_graphs; i++) {
+        if (graph_ports[i] == port)
+            return 1;
+    }
+    return 0;
+}
+
+#if defined(SYS_sendto) && defined(SYS_sendmmsg)
+/* Interpose the socket send functions to count system calls carrying admin messages to the
+ * subscribed graphs. */
+ssize_t sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr,
+               socklen_t addr_len)
+{
+    if (is_graph_addr(addr)) {
+        ++num_calls;
+        ++num_dgrams;
+    }
+    return syscall(SYS_sendto, fd, buf, len, flags, addr, addr_len);
+}
+
+int sendmmsg(int fd, struct mmsghdr *msgs, unsigned int len, int flags)
+{
+    int ret;
+    if (disable_sendmmsg) {
+        /* simulate a kernel without sendmmsg() */
+        errno = ENOSYS;
+        return -1;
+    }
+    ret = syscall(SYS_sendmmsg, fd, msgs, len, flags);
+    if (len && is_graph_addr((const struct sockaddr*)msgs[0].msg_hdr.msg_name)) {
+        ++num_calls;
+        num_dgrams += ret > 0 ? ret : 0;
+    }
+    return ret;
+}
+#define HAVE_SYSCALL_SHIM 1
+#else
+#define HAVE_SYSCALL_SHIM 0
+#endif
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int setup()
+{
+    int i;
+    dev = mpr_dev_new("testadminfanout", 0);
+    if (!dev)
+        return 1;
+    outsig = mpr_sig_new(dev, MPR_DIR_OUT, "outsig", 1, MPR_FLT, NULL, NULL, NULL, NULL, NULL, 0);
+    if (!outsig)
+        return 1;
+    graphs = calloc(1, num_graphs * sizeof(mpr_graph));
+    for (i = 0; i < num_graphs; i++) {
+        if (!(graphs[i] = mpr_graph_new(0)))
+            return 1;
+    }
+    eprintf("device and %d graphs created.\n", num_graphs);
+    return 0;
+}
+
+void cleanup()
+{
+    int i;
+    eprintf("Freeing device and graphs.. ");
+    fflush(stdout);
+    if (dev)
+        mpr_dev_free(dev);
+    if (graphs) {
+        for (i = 0; i < num_graphs; i++) {
+            if (graphs[i])
+                mpr_graph_free(graphs[i]);
+        }
+        free(graphs);
+    }
+    free(graph_ports);
+    eprintf("ok\n");
+}
+
+void poll_all(int block_ms)
+{
+    int i;
+    mpr_dev_poll(dev, block_ms);
+    for (i = 0; i < num_graphs; i++)
+        mpr_graph_poll(graphs[i], 0);
+}
+
+static int count_subscribers()
+{
+    int count = 0;
+    mpr_subscriber sub = ((mpr_local_dev)dev)->subscribers;
+    for (; sub; sub = sub->next)
+        ++count;
+    return count;
+}
+
+/* Wait for every graph to discover the device and subscribe to its signals. */
+int subscribe_all()
+{
+    int i, subscribed = 0;
+    const char *name;
+    double then = current_time();
+    while (!done && !mpr_dev_get_is_ready(dev) && current_time() - then < 20)
+        poll_all(25);
+    name = mpr_dev_get_name(dev);
+    while (!done && subscribed < num_graphs && current_time() - then < 20) {
+        poll_all(10);
+        for (i = 0, subscribed = 0; i < num_graphs; i++) {
+            mpr_dev rdev = mpr_graph_get_dev_by_name(graphs[i], name);
+            if (rdev && !rdev->subscribed)
+                mpr_graph_subscribe(graphs[i], rdev, MPR_SIG, -1);
+            subscribed += rdev ? rdev->subscribed : 0;
+        }
+    }
+    while (!done && count_subscribers() < num_graphs && current_time() - then < 20)
+        poll_all(10);
+    if (count_subscribers() < num_graphs)
+        return 1;
+
+    graph_ports = malloc(num_graphs * sizeof(int));
+    for (i = 0; i < num_graphs; i++)
+        graph_ports[i] = lo_server_get_port(graphs[i]->net.servers[SERVER_MESH]);
+    return 0;
+}
+
+/* Returns the number of graphs up to date with the last change. */
+int count_updated(int val)
+{
+    int i, count = 0;
+    for (i = 0; i < num_graphs; i++) {
+        mpr_dev rdev = mpr_graph_get_dev_by_name(graphs[i], mpr_dev_get_name(dev));
+        mpr_sig rsig = rdev ? mpr_dev_get_sig_by_name(rdev, "outsig") : 0;
+        if (rsig && val == mpr_obj_get_prop_as_int32((mpr_obj)rsig, MPR_PROP_UNKNOWN, "counter"))
+            ++count;
+    }
+    return count;
+}
+
+int run_mode(int mode)
+{
+    int i, updated;
+    double then, elapsed = 0;
+
+    disable_sendmmsg = mode;
+    num_calls = num_dgrams = 0;
+
+    for (i = 0; i < iterations && !done; i++) {
+        mpr_obj_set_prop((mpr_obj)outsig, MPR_PROP_UNKNOWN, "counter", 1, MPR_INT32, &i, 1);
+        mpr_obj_push((mpr_obj)outsig);
+        then = current_time();
+        mpr_dev_poll(dev, 0);
+        elapsed += current_time() - then;
+        poll_all(0);
+        if (period > 1)
+            usleep(period * 1000);
+    }
+    /* collect any remaining messages */
+    for (i = 0; i < 10; i++)
+        poll_all(10);
+
+    latency[mode] = elapsed / iterations;
+    calls_per_push[mode] = (float)num_calls / iterations;
+    updated = count_updated(iterations - 1);
+    eprintf("mode '%s': %d of %d graphs up to date, %d send calls for %d datagrams\n",
+            mode_names[mode], updated, num_graphs, num_calls, num_dgrams);
+    return updated != num_graphs;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testadminfanout.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--num_graphs number of subscribed graphs (default 32)\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        num_graphs = 8;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--num_graphs")==0 && argc>i+1) {
+                            i++;
+                            num_graphs = atoi(argv[i]);
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup()) {
+        eprintf("Error initializing device and graphs.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (subscribe_all()) {
+        eprintf("Error waiting for subscriptions.\n");
+        result = 1;
+        goto done;
+    }
+
+    /* the fallback mode permanently disables sendmmsg() so it must run last */
+    for (i = 0; i < NUM_MODES && !result && !done; i++)
+        result = run_mode(i);
+
+    if (!result && HAVE_SYSCALL_SHIM && calls_per_push[0] >= calls_per_push[1]) {
+        eprintf("Error: batched sending did not reduce the number of system calls.\n");
+        result = 1;
+    }
+
+    if (!result) {
+        for (i = 0; i < NUM_MODES; i++)
+            printf("%-14s %d subscribers: %.1f send calls and %.2f us per push\n",
+                   mode_names[i], num_graphs, calls_per_push[i], latency[i] * 1000000);
+    }
+
+  done:
+    cleanup();
+    if (!verbose)
+        printf("..................................................");
+    printf("Test %s\x1B[0m.\n", result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
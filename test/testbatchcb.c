@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/time.h>
+#include <lo/lo_lowlevel.h>
+#include "../src/mapper_internal.h"
+#include "graph_helpers.h"
+
+int verbose = 1;
+int num_devs = 20;
+int sigs_per_dev = 100;
+
+int num_batches = 0;
+int num_batched[4];
+int num_single = 0;
+int bad_batch = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void on_batch(mpr_graph g, int num, const mpr_obj *objs, const mpr_graph_evt *evts,
+                     const void *data)
+{
+    int i;
+    ++num_batches;
+    for (i = 0; i < num; i++) {
+        /* removed objects must still be readable */
+        if (!mpr_obj_get_prop_as_str(objs[i], MPR_PROP_NAME, NULL))
+            bad_batch = 1;
+        if (evts[i] < 0 || evts[i] > MPR_OBJ_EXP)
+            bad_batch = 1;
+        else
+            ++num_batched[evts[i]];
+    }
+}
+
+static void on_single(mpr_graph g, mpr_obj obj, mpr_graph_evt evt, const void *data)
+{
+    ++num_single;
+}
+
+static int set_sig(mpr_graph g, const char *dev_name, int idx, const char *unit)
+{
+    char name[32];
+    lo_message lom = graph_sig_msg(idx % 2);
+    if (!lom)
+        return 1;
+    snprintf(name, 32, "sig%d", idx);
+    lo_message_add_string(lom, "@unit");
+    lo_message_add_string(lom, unit);
+    return graph_add_sig(g, dev_name, name, lom);
+}
+
+static int set_sigs(mpr_graph g, int num, const char *unit)
+{
+    int i, j;
+    char dev_name[32];
+    for (i = 0; i < num; i++) {
+        snprintf(dev_name, 32, "testbatchcb.%d", i + 1);
+        for (j = 0; j < sigs_per_dev; j++) {
+            if (set_sig(g, dev_name, j, unit))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+static void reset_counts()
+{
+    num_batches = num_single = 0;
+    memset(num_batched, 0, sizeof(num_batched));
+}
+
+static int check_counts(const char *step, int new, int mod, int rem, int single)
+{
+    eprintf("%s: %d batch(es), %d/%d/%d new/modified/removed, %d single callbacks\n", step,
+            num_batches, num_batched[MPR_OBJ_NEW], num_batched[MPR_OBJ_MOD],
+            num_batched[MPR_OBJ_REM], num_single);
+    if (bad_batch || num_batches != 1 || num_batched[MPR_OBJ_NEW] != new
+        || num_batched[MPR_OBJ_MOD] != mod || num_batched[MPR_OBJ_REM] != rem
+        || num_single != single) {
+        eprintf("Error: expected a single batch with %d/%d/%d new/modified/removed and %d "
+                "single callbacks.\n", new, mod, rem, single);
+        return 1;
+    }
+    reset_counts();
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    double then;
+    mpr_graph graph;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        eprintf("testbatchcb.c: possible arguments "
+                                "-f fast (execute quickly), "
+                                "-q quiet (suppress output), "
+                                "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        num_devs = 5;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    graph = mpr_graph_new(0);
+    mpr_graph_add_cb(graph, on_single, MPR_DEV | MPR_SIG, 0);
+    mpr_graph_add_batch_cb(graph, on_batch, MPR_DEV | MPR_SIG, 0);
+
+    /* new signals that are modified again before the poll are only reported as new */
+    then = current_time();
+    if (set_sigs(graph, num_devs, "m") || set_sigs(graph, num_devs, "cm")) {
+        eprintf("Error building graph.\n");
+        result = 1;
+        goto done;
+    }
+    mpr_graph_poll(graph, 0);
+    eprintf("added %d devices and %d signals in %.3f seconds\n", num_devs,
+            num_devs * sigs_per_dev, current_time() - then);
+    if ((result = check_counts("add", num_devs * (sigs_per_dev + 1), 0, 0,
+                               num_devs * (sigs_per_dev * 2 + 1))))
+        goto done;
+
+    /* repeated modifications are coalesced */
+    for (i = 0; i < 3; i++)
+        set_sigs(graph, 1, i % 2 ? "mm" : "km");
+    mpr_graph_poll(graph, 0);
+    if ((result = check_counts("modify", 0, sigs_per_dev, 0, sigs_per_dev * 3)))
+        goto done;
+
+    /* objects added and removed before the poll are not reported */
+    set_sig(graph, "testbatchcb.1", sigs_per_dev, "m");
+    mpr_graph_remove_sig(graph, mpr_dev_get_sig_by_name(mpr_graph_get_dev_by_name(graph,
+                         "testbatchcb.1"), "sig0"), MPR_OBJ_REM);
+    mpr_graph_remove_sig(graph, mpr_dev_get_sig_by_name(mpr_graph_get_dev_by_name(graph,
+                         "testbatchcb.1"), "sig100"), MPR_OBJ_REM);
+    mpr_graph_poll(graph, 0);
+    if ((result = check_counts("remove", 0, 0, 1, 3)))
+        goto done;
+
+    /* removed objects are kept until the batch has been delivered */
+    set_sigs(graph, 1, "m");
+    mpr_graph_remove_dev(graph, mpr_graph_get_dev_by_name(graph, "testbatchcb.1"), MPR_OBJ_REM, 0);
+    mpr_graph_poll(graph, 0);
+    if ((result = check_counts("remove device", 0, 0, sigs_per_dev, sigs_per_dev * 2 + 1)))
+        goto done;
+
+    /* graphs driven by an external event loop also deliver batches */
+    for (i = 0; i < sigs_per_dev; i++)
+        set_sig(graph, "testbatchcb.2", i, "pm");
+    mpr_graph_process_ready(graph, NULL, 0);
+    if ((result = check_counts("process ready", 0, sigs_per_dev, 0, sigs_per_dev)))
+        goto done;
+
+    /* nothing is delivered without changes */
+    mpr_graph_poll(graph, 0);
+    if (num_batches || num_single) {
+        eprintf("Error: empty batch delivered.\n");
+        result = 1;
+        goto done;
+    }
+
+    /* nor once the callback has been removed */
+    mpr_graph_remove_batch_cb(graph, on_batch, 0);
+    set_sigs(graph, 1, "m");
+    mpr_graph_poll(graph, 0);
+    if (num_batches || num_single != sigs_per_dev + 1) {
+        eprintf("Error: batch delivered after removing callback.\n");
+        result = 1;
+        goto done;
+    }
+
+done:
+    mpr_graph_free(graph);
+    if (!verbose)
+        printf("..................................................");
+    printf("Test %s\x1B[0m.\n", result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
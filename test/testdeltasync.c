@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <lo/lo_lowlevel.h>
+#include "../src/mapper_internal.h"
+
+#define MAX_SIGS 2000
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int num_sigs = MAX_SIGS;
+
+mpr_dev dev = 0;
+mpr_graph graph = 0;
+mpr_sig sigs[MAX_SIGS];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void poll_all()
+{
+    mpr_dev_poll(dev, period);
+    mpr_graph_poll(graph, 0);
+}
+
+static int setup_dev()
+{
+    int i;
+    char name[32];
+    dev = mpr_dev_new("testdeltasync", 0);
+    if (!dev)
+        return 1;
+    for (i = 0; i < num_sigs; i++) {
+        snprintf(name, 32, "%s%d", i % 2 ? "out" : "in", i);
+        sigs[i] = mpr_sig_new(dev, i % 2 ? MPR_DIR_OUT : MPR_DIR_IN, name, 1, MPR_FLT,
+                              "m", NULL, NULL, NULL, NULL, 0);
+        if (!sigs[i])
+            return 1;
+    }
+    eprintf("Device created with %d signals.\n", num_sigs);
+    return 0;
+}
+
+/* Returns the remote record of the device once it is known to the graph. */
+static mpr_dev wait_ready()
+{
+    mpr_dev rdev = 0;
+    double then = current_time();
+    while (!done && !rdev) {
+        poll_all();
+        if (mpr_dev_get_is_ready(dev))
+            rdev = mpr_graph_get_dev_by_name(graph, mpr_dev_get_name(dev));
+        if (current_time() - then > 20)
+            break;
+    }
+    return rdev;
+}
+
+/* Subscribe to the device and wait until the graph is up to date with num signals. Returns the
+ * number of admin bytes sent by the device, or 0 on timeout. */
+static size_t subscribe(mpr_dev rdev, int num)
+{
+    mpr_net net = &mpr_obj_get_graph((mpr_obj)dev)->net;
+    size_t bytes = net->admin_bytes;
+    int rev = rdev->sync_revs[0];
+    double then = current_time();
+    mpr_graph_subscribe(graph, rdev, MPR_OBJ, -1);
+    while (!done && current_time() - then < 20) {
+        poll_all();
+        if (   rdev->sync_revs[0] > rev
+            && num == mpr_list_get_size(mpr_dev_get_sigs(rdev, MPR_DIR_ANY)))
+            return net->admin_bytes - bytes;
+    }
+    eprintf("Error: timed out waiting for subscription.\n");
+    return 0;
+}
+
+static void unsubscribe(mpr_dev rdev)
+{
+    double then = current_time();
+    mpr_graph_unsubscribe(graph, rdev);
+    while (!done && ((mpr_local_dev)dev)->subscribers && current_time() - then < 20)
+        poll_all();
+}
+
+static mpr_sig get_remote_sig(mpr_dev rdev, int idx)
+{
+    return mpr_dev_get_sig_by_name(rdev, mpr_obj_get_prop_as_str((mpr_obj)sigs[idx],
+                                                                 MPR_PROP_NAME, NULL));
+}
+
+/* Modify a signal through the graph, as a session manager would, and wait for the device to
+ * apply the change. */
+static int modify_remotely(mpr_dev rdev, int idx, int val)
+{
+    mpr_sig rsig = get_remote_sig(rdev, idx);
+    double then = current_time();
+    if (!rsig)
+        return 1;
+    mpr_obj_set_prop((mpr_obj)rsig, MPR_PROP_UNKNOWN, "remote", 1, MPR_INT32, &val, 1);
+    mpr_obj_push((mpr_obj)rsig);
+    while (!done && current_time() - then < 20) {
+        poll_all();
+        if (val == mpr_obj_get_prop_as_int32((mpr_obj)sigs[idx], MPR_PROP_UNKNOWN, "remote"))
+            return 0;
+    }
+    eprintf("Error: timed out waiting for remote modification.\n");
+    return 1;
+}
+
+static int check_graph(mpr_dev rdev, int val)
+{
+    mpr_sig s0 = get_remote_sig(rdev, 0), s2 = get_remote_sig(rdev, 2);
+    if (!s0 || val != mpr_obj_get_prop_as_int32((mpr_obj)s0, MPR_PROP_UNKNOWN, "delta")) {
+        eprintf("Error: modified signal was not updated.\n");
+        return 1;
+    }
+    if (!s2 || val != mpr_obj_get_prop_as_int32((mpr_obj)s2, MPR_PROP_UNKNOWN, "remote")) {
+        eprintf("Error: remotely modified signal was not updated.\n");
+        return 1;
+    }
+    if (mpr_dev_get_sig_by_name(rdev, "out1")) {
+        eprintf("Error: removed signal is still in the graph.\n");
+        return 1;
+    }
+    return 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, val = 42;
+    size_t full_bytes, delta_bytes;
+    mpr_dev rdev;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testdeltasync.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        num_sigs = 200;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    graph = mpr_graph_new(0);
+    if (!graph || setup_dev()) {
+        eprintf("Error initializing device.\n");
+        result = 1;
+        goto done;
+    }
+    if (!(rdev = wait_ready())) {
+        eprintf("Error: device was not found by the graph.\n");
+        result = 1;
+        goto done;
+    }
+
+    /* the first subscription must send the full state */
+    if (!(full_bytes = subscribe(rdev, num_sigs))) {
+        result = 1;
+        goto done;
+    }
+    eprintf("subscribing sent %lu admin bytes\n", (unsigned long)full_bytes);
+
+    /* change one signal and remove another while the graph is not subscribed */
+    unsubscribe(rdev);
+    mpr_obj_set_prop((mpr_obj)sigs[0], MPR_PROP_UNKNOWN, "delta", 1, MPR_INT32, &val, 1);
+    mpr_obj_push((mpr_obj)sigs[0]);
+    mpr_sig_free(sigs[1]);
+    sigs[1] = 0;
+
+    /* signals modified by peers while there are no subscribers must also be resent */
+    if ((result = modify_remotely(rdev, 2, val)))
+        goto done;
+
+    /* resubscribing must only send the changes */
+    if (!(delta_bytes = subscribe(rdev, num_sigs - 1))) {
+        result = 1;
+        goto done;
+    }
+    eprintf("resubscribing sent %lu admin bytes (%.1f%%)\n", (unsigned long)delta_bytes,
+            100.0 * delta_bytes / full_bytes);
+    if ((result = check_graph(rdev, val)))
+        goto done;
+    if (delta_bytes * 4 > full_bytes) {
+        eprintf("Error: resubscribing sent too many bytes.\n");
+        result = 1;
+    }
+
+done:
+    if (dev)
+        mpr_dev_free(dev);
+    if (graph)
+        mpr_graph_free(graph);
+    if (!verbose)
+        printf("..................................................");
+    printf("Test %s\x1B[0m.\n", result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,283 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#endif
+
+#define MAX_FDS 8
+#define MAX_EVENTS 16
+
+int verbose = 1;
+int done = 0;
+int iterations = 100;
+int idle_sec = 3;
+
+mpr_dev devs[2] = {0, 0};
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+int epfd = -1;
+
+int received = 0;
+int wakeups = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value)
+        ++received;
+}
+
+int setup_devs(const char *iface)
+{
+    devs[0] = mpr_dev_new("testepoll-send", 0);
+    devs[1] = mpr_dev_new("testepoll-recv", 0);
+    if (!devs[0] || !devs[1])
+        goto error;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)devs[0]), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)devs[1]), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)devs[0])));
+
+    sendsig = mpr_sig_new(devs[0], MPR_DIR_OUT, "outsig", 1, MPR_FLT, NULL,
+                          NULL, NULL, NULL, NULL, 0);
+    recvsig = mpr_sig_new(devs[1], MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
+                          NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    if (!sendsig || !recvsig)
+        goto error;
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_devs()
+{
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (devs[0])
+        mpr_dev_free(devs[0]);
+    if (devs[1])
+        mpr_dev_free(devs[1]);
+    if (epfd >= 0)
+        close(epfd);
+    eprintf("ok\n");
+}
+
+#ifdef __linux__
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Register the sockets of both devices with a single epoll instance. */
+int setup_epoll()
+{
+    int i, j, num, fds[MAX_FDS];
+    struct epoll_event ev;
+    epfd = epoll_create1(0);
+    if (epfd < 0)
+        return 1;
+    for (i = 0; i < 2; i++) {
+        num = mpr_graph_get_fds(mpr_obj_get_graph((mpr_obj)devs[i]), fds, MAX_FDS);
+        if (num < 1 || num > MAX_FDS)
+            return 1;
+        for (j = 0; j < num; j++) {
+            ev.events = EPOLLIN;
+            ev.data.u64 = ((uint64_t)i << 32) | (uint32_t)fds[j];
+            if (epoll_ctl(epfd, EPOLL_CTL_ADD, fds[j], &ev))
+                return 1;
+        }
+        eprintf("device %d registered %d sockets.\n", i, num);
+    }
+    return 0;
+}
+
+/* Wait for events on all sockets and service the devices that are ready or due. */
+void run_loop(int max_ms)
+{
+    struct epoll_event events[MAX_EVENTS];
+    int i, n, timeout, ready[2][MAX_EVENTS], num_ready[2];
+
+    timeout = mpr_dev_get_poll_timeout(devs[0]);
+    i = mpr_dev_get_poll_timeout(devs[1]);
+    if (i < timeout)
+        timeout = i;
+    if (timeout > max_ms)
+        timeout = max_ms;
+
+    n = epoll_wait(epfd, events, MAX_EVENTS, timeout);
+    ++wakeups;
+    num_ready[0] = num_ready[1] = 0;
+    for (i = 0; i < n; i++) {
+        int dev = events[i].data.u64 >> 32;
+        ready[dev][num_ready[dev]++] = (int)(events[i].data.u64 & 0xFFFFFFFF);
+    }
+    for (i = 0; i < 2; i++) {
+        if (num_ready[i] || !mpr_dev_get_poll_timeout(devs[i]))
+            mpr_dev_process_ready(devs[i], ready[i], num_ready[i]);
+    }
+}
+
+int wait_ready()
+{
+    int i = 0;
+    while (!done && !(mpr_dev_get_is_ready(devs[0]) && mpr_dev_get_is_ready(devs[1]))) {
+        run_loop(100);
+        if (i++ > 1000)
+            return 1;
+    }
+    return 0;
+}
+
+int setup_map()
+{
+    int i = 0;
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        run_loop(100);
+        if (i++ > 1000)
+            return 1;
+    }
+    return 0;
+}
+
+int send_updates()
+{
+    int i, j;
+    float v;
+    for (i = 0; i < iterations && !done; i++) {
+        int expected = received + 1;
+        v = (float)i;
+        mpr_sig_set_value(sendsig, 0, 1, MPR_FLT, &v);
+        mpr_dev_update_maps(devs[0]);
+        for (j = 0; j < 100 && received < expected; j++)
+            run_loop(100);
+    }
+    eprintf("received %d of %d updates.\n", received, iterations);
+    return received != iterations;
+}
+
+int measure_idle()
+{
+    double then = current_time();
+    wakeups = 0;
+    while (!done && current_time() - then < idle_sec)
+        run_loop(1000);
+    eprintf("%d wakeups while idle for %d seconds.\n", wakeups, idle_sec);
+    /* polling both devices in 100ms slices would wake up 20 times per second */
+    return wakeups > idle_sec * 10;
+}
+
+#else
+int setup_epoll()
+{
+    eprintf("epoll is not available on this platform, skipping.\n");
+    return 0;
+}
+#endif
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testepoll.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        idle_sec = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface) || setup_epoll()) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+#ifdef __linux__
+    if (wait_ready()) {
+        eprintf("Error waiting for devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (setup_map()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (send_updates()) {
+        eprintf("Error receiving updates.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (measure_idle()) {
+        eprintf("Error: event loop woke up too often while idle.\n");
+        result = 1;
+    }
+#endif
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
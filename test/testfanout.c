@@ -0,0 +1,333 @@
+#ifdef __linux__
+#define _GNU_SOURCE /* for sendmmsg() */
+#endif
+
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int num_peers = 32;
+int iterations = 200;
+
+mpr_dev src = 0;
+mpr_dev *peers = 0;
+mpr_sig sendsig = 0;
+
+int received = 0;
+
+/* statistics collected by the syscall shim */
+int *peer_ports = 0;
+int disable_sendmmsg = 0;
+int num_calls = 0;
+int num_dgrams = 0;
+
+#define NUM_MODES 2
+const char *mode_names[] = {"batched", "per-datagram"};
+double latency[NUM_MODES];
+float calls_per_poll[NUM_MODES];
+
+static int is_peer_addr(const struct sockaddr *addr)
+{
+    int i, port;
+    if (!peer_ports || !addr || AF_INET != addr->sa_family)
+        return 0;
+    port = ntohs(((const struct sockaddr_in*)addr)->sin_port);
+    for (i = 0; i < num_peers; i++) {
+        if (peer_ports[i] == port)
+            return 1;
+    }
+    return 0;
+}
+
+#if defined(SYS_sendto) && defined(SYS_sendmmsg)
+/* Interpose the socket send functions to count system calls carrying data to the peers. */
+ssize_t sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr,
+               socklen_t addr_len)
+{
+    if (is_peer_addr(addr)) {
+        ++num_calls;
+        ++num_dgrams;
+    }
+    return syscall(SYS_sendto, fd, buf, len, flags, addr, addr_len);
+}
+
+int sendmmsg(int fd, struct mmsghdr *msgs, unsigned int len, int flags)
+{
+    int ret;
+    if (disable_sendmmsg) {
+        /* simulate a kernel without sendmmsg() */
+        errno = ENOSYS;
+        return -1;
+    }
+    ret = syscall(SYS_sendmmsg, fd, msgs, len, flags);
+    if (len && is_peer_addr((const struct sockaddr*)msgs[0].msg_hdr.msg_name)) {
+        ++num_calls;
+        num_dgrams += ret > 0 ? ret : 0;
+    }
+    return ret;
+}
+#define HAVE_SYSCALL_SHIM 1
+#else
+#define HAVE_SYSCALL_SHIM 0
+#endif
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value)
+        ++received;
+}
+
+int setup_devs(const char *iface)
+{
+    int i;
+    src = mpr_dev_new("testfanout-send", 0);
+    if (!src)
+        goto error;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+    eprintf("source created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_FLT, NULL,
+                          NULL, NULL, NULL, NULL, 0);
+    if (!sendsig)
+        goto error;
+
+    peers = calloc(1, num_peers * sizeof(mpr_dev));
+    for (i = 0; i < num_peers; i++) {
+        if (!(peers[i] = mpr_dev_new("testfanout-recv", 0)))
+            goto error;
+        if (iface)
+            mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)peers[i]), iface);
+        if (!mpr_sig_new(peers[i], MPR_DIR_IN, "insig", 1, MPR_FLT, NULL,
+                         NULL, NULL, NULL, handler, MPR_SIG_UPDATE))
+            goto error;
+    }
+    eprintf("%d destination devices created.\n", num_peers);
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_devs()
+{
+    int i;
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (peers) {
+        for (i = 0; i < num_peers; i++) {
+            if (peers[i])
+                mpr_dev_free(peers[i]);
+        }
+        free(peers);
+    }
+    if (src)
+        mpr_dev_free(src);
+    free(peer_ports);
+    eprintf("ok\n");
+}
+
+void poll_all(int block_ms)
+{
+    int i;
+    mpr_dev_poll(src, block_ms);
+    for (i = 0; i < num_peers; i++)
+        mpr_dev_poll(peers[i], 0);
+}
+
+int wait_ready()
+{
+    int i, ready = 0;
+    while (!done && !ready) {
+        poll_all(25);
+        ready = mpr_dev_get_is_ready(src);
+        for (i = 0; i < num_peers && ready; i++)
+            ready = mpr_dev_get_is_ready(peers[i]);
+    }
+    return !ready;
+}
+
+int setup_maps()
+{
+    int i, j = 0, ready = 0;
+    mpr_map *maps = calloc(1, num_peers * sizeof(mpr_map));
+    for (i = 0; i < num_peers; i++) {
+        mpr_list sigs = mpr_dev_get_sigs(peers[i], MPR_DIR_IN);
+        mpr_sig dst = (mpr_sig)*sigs;
+        mpr_list_free(sigs);
+        maps[i] = mpr_map_new(1, &sendsig, 1, &dst);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && !ready) {
+        poll_all(10);
+        for (i = 0, ready = 1; i < num_peers; i++) {
+            if (!mpr_map_get_is_ready(maps[i])) {
+                ready = 0;
+                break;
+            }
+        }
+        if (j++ > 1000)
+            break;
+    }
+    free(maps);
+
+    peer_ports = malloc(num_peers * sizeof(int));
+    for (i = 0; i < num_peers; i++)
+        peer_ports[i] = mpr_obj_get_prop_as_int32((mpr_obj)peers[i], MPR_PROP_PORT, NULL);
+    return !ready;
+}
+
+int run_mode(int mode)
+{
+    int i, expected = iterations * num_peers;
+    double then, elapsed = 0;
+    float v;
+
+    disable_sendmmsg = mode;
+    num_calls = num_dgrams = received = 0;
+
+    for (i = 0; i < iterations && !done; i++) {
+        v = (float)i;
+        mpr_sig_set_value(sendsig, 0, 1, MPR_FLT, &v);
+        then = current_time();
+        mpr_dev_poll(src, 0);
+        elapsed += current_time() - then;
+        poll_all(0);
+        if (period > 1)
+            usleep(period * 1000);
+    }
+    /* collect any remaining updates */
+    for (i = 0; i < 10; i++)
+        poll_all(10);
+
+    latency[mode] = elapsed / iterations;
+    calls_per_poll[mode] = (float)num_calls / iterations;
+    eprintf("mode '%s': received %d of %d updates, %d send calls for %d datagrams\n",
+            mode_names[mode], received, expected, num_calls, num_dgrams);
+    return received != expected;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testfanout.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--num_peers number of destination devices (default 32), "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--num_peers")==0 && argc>i+1) {
+                            i++;
+                            num_peers = atoi(argv[i]);
+                            j = 1;
+                        }
+                        else if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (wait_ready()) {
+        eprintf("Error waiting for devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (setup_maps()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    /* the fallback mode permanently disables sendmmsg() so it must run last */
+    for (i = 0; i < NUM_MODES && !result && !done; i++)
+        result = run_mode(i);
+
+    if (!result && HAVE_SYSCALL_SHIM && calls_per_poll[0] >= calls_per_poll[1]) {
+        eprintf("Error: batched sending did not reduce the number of system calls.\n");
+        result = 1;
+    }
+
+    if (!result) {
+        for (i = 0; i < NUM_MODES; i++)
+            printf("%-14s %d peers: %.1f send calls and %.2f us per poll\n", mode_names[i],
+                   num_peers, calls_per_poll[i], latency[i] * 1000000);
+    }
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
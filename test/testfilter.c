@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+#include <zlib.h>
+#include <lo/lo_lowlevel.h>
+#include "../src/mapper_internal.h"
+#include "graph_helpers.h"
+
+#define NUM_QUERIES 9
+
+int verbose = 1;
+int num_devs = 500;
+int sigs_per_dev = 80;
+int iterations = 10;
+
+/* number of results and sum of their ids for each query */
+int counts[NUM_QUERIES];
+mpr_id sums[NUM_QUERIES];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void add_props(lo_message lom, int dev_idx, int sig_idx)
+{
+    char name[32], group[16];
+    mpr_id id;
+    snprintf(name, 32, "testfilter.%d", dev_idx + 1);
+    id = (mpr_id)crc32(0L, (const Bytef *)name, strlen(name)) << 32;
+    lo_message_add_string(lom, "@id");
+    lo_message_add_int64(lom, id | (sig_idx + 1));
+    lo_message_add_string(lom, "@length");
+    lo_message_add_int32(lom, sig_idx % 8 + 1);
+    lo_message_add_string(lom, "@group");
+    snprintf(group, 16, "g%d", sig_idx % 10);
+    lo_message_add_string(lom, group);
+}
+
+static mpr_list filter(mpr_graph g, mpr_prop p, const char *key, mpr_type type, const void *val,
+                       mpr_op op)
+{
+    return mpr_list_filter(mpr_graph_get_objs(g, MPR_SIG), p, key, 1, type, val, op);
+}
+
+static mpr_list run_query(mpr_graph g, int i)
+{
+    int dir = MPR_DIR_OUT, len = 7, len2 = 2;
+    float nan_len = NAN;
+    switch (i) {
+        case 0:
+            return filter(g, MPR_PROP_NAME, NULL, MPR_STR, "in0", MPR_OP_EQ);
+        case 1:
+            return filter(g, MPR_PROP_UNKNOWN, "group", MPR_STR, "g3", MPR_OP_EQ);
+        case 2:
+            return filter(g, MPR_PROP_LEN, NULL, MPR_INT32, &len, MPR_OP_GTE);
+        case 3:
+            return filter(g, MPR_PROP_LEN, NULL, MPR_INT32, &len2, MPR_OP_LT);
+        case 4:
+            return filter(g, MPR_PROP_DIR, NULL, MPR_INT32, &dir, MPR_OP_EQ);
+        case 5:
+            /* wildcards cannot use the index */
+            return filter(g, MPR_PROP_NAME, NULL, MPR_STR, "out1*", MPR_OP_EQ);
+        case 6:
+            return mpr_list_get_union(filter(g, MPR_PROP_NAME, NULL, MPR_STR, "in0",
+                                             MPR_OP_EQ),
+                                      filter(g, MPR_PROP_NAME, NULL, MPR_STR, "out1",
+                                             MPR_OP_EQ));
+        case 7:
+            return mpr_list_get_isect(filter(g, MPR_PROP_DIR, NULL, MPR_INT32, &dir, MPR_OP_EQ),
+                                      filter(g, MPR_PROP_UNKNOWN, "group", MPR_STR, "g3",
+                                             MPR_OP_EQ));
+        default:
+            /* no signal has a NaN length, so this must return an empty list */
+            return filter(g, MPR_PROP_LEN, NULL, MPR_FLT, &nan_len, MPR_OP_EQ);
+    }
+}
+
+/* Run each query, checking that the results match those of previous runs if check is set.
+ * Returns the number of queries per second, or -1 if any results differ. */
+static double run_queries(mpr_graph g, int check)
+{
+    int i, j, count;
+    mpr_id sum;
+    double then = current_time();
+    for (i = 0; i < iterations; i++) {
+        for (j = 0; j < NUM_QUERIES; j++) {
+            mpr_list l = run_query(g, j);
+            count = 0;
+            sum = 0;
+            while (l) {
+                ++count;
+                sum += (*l)->id;
+                l = mpr_list_get_next(l);
+            }
+            if (check || i) {
+                if (count != counts[j] || sum != sums[j]) {
+                    eprintf("Error: query %d returned %d results, expected %d.\n", j, count,
+                            counts[j]);
+                    return -1;
+                }
+            }
+            else {
+                counts[j] = count;
+                sums[j] = sum;
+            }
+        }
+    }
+    return iterations * NUM_QUERIES / (current_time() - then);
+}
+
+static void add_indexes(mpr_graph g)
+{
+    mpr_graph_add_index(g, MPR_SIG, MPR_PROP_NAME, NULL, 0);
+    mpr_graph_add_index(g, MPR_SIG, MPR_PROP_UNKNOWN, "group", 0);
+    mpr_graph_add_index(g, MPR_SIG, MPR_PROP_LEN, NULL, 1);
+    mpr_graph_add_index(g, MPR_SIG, MPR_PROP_DIR, NULL, 0);
+}
+
+static int remove_indexes(mpr_graph g)
+{
+    return (  mpr_graph_remove_index(g, MPR_SIG, MPR_PROP_NAME, NULL)
+            + mpr_graph_remove_index(g, MPR_SIG, MPR_PROP_UNKNOWN, "group")
+            + mpr_graph_remove_index(g, MPR_SIG, MPR_PROP_LEN, NULL)
+            + mpr_graph_remove_index(g, MPR_SIG, MPR_PROP_DIR, NULL));
+}
+
+/* Move the signals of the first device to another group and length, and remove the second device,
+ * changing few enough objects for the indexes to be updated rather than rebuilt. */
+static int modify_graph(mpr_graph g)
+{
+    int i;
+    char name[32];
+    for (i = 0; i < sigs_per_dev; i++) {
+        lo_message lom = graph_sig_msg(i % 2);
+        if (!lom)
+            return 1;
+        snprintf(name, 32, "%s%d", i % 2 ? "out" : "in", i);
+        lo_message_add_string(lom, "@length");
+        lo_message_add_int32(lom, 8 - i % 8);
+        lo_message_add_string(lom, "@group");
+        lo_message_add_string(lom, "g3");
+        if (graph_add_sig(g, "testfilter.1", name, lom))
+            return 1;
+    }
+    mpr_graph_remove_dev(g, mpr_graph_get_dev_by_name(g, "testfilter.2"), MPR_OBJ_REM, 1);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    double then, indexed, scanned;
+    mpr_graph graph;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        eprintf("testfilter.c: possible arguments "
+                                "-f fast (execute quickly), "
+                                "-q quiet (suppress output), "
+                                "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        num_devs = 100;
+                        sigs_per_dev = 20;
+                        iterations = 2;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    graph = mpr_graph_new(0);
+
+    then = current_time();
+    if (graph_add_devs(graph, "testfilter", num_devs, sigs_per_dev, add_props)) {
+        eprintf("Error building graph.\n");
+        result = 1;
+        goto done;
+    }
+    eprintf("added %d devices and %d signals in %.3f seconds\n", num_devs,
+            num_devs * sigs_per_dev, current_time() - then);
+
+    if ((scanned = run_queries(graph, 0)) < 0) {
+        result = 1;
+        goto done;
+    }
+    if (counts[0] != num_devs || counts[6] != num_devs * 2 || counts[8]) {
+        eprintf("Error: unexpected number of results.\n");
+        result = 1;
+        goto done;
+    }
+
+    add_indexes(graph);
+    if ((indexed = run_queries(graph, 1)) < 0) {
+        eprintf("Error: indexed results differ.\n");
+        result = 1;
+        goto done;
+    }
+    eprintf("indexed: %.0f queries/s, scanned: %.0f queries/s, speedup %.1fx\n", indexed,
+            scanned, indexed / scanned);
+
+    /* indexes must be updated after a few signals are modified or removed */
+    if (   modify_graph(graph) || run_queries(graph, 0) < 0 || remove_indexes(graph)
+        || run_queries(graph, 1) < 0) {
+        eprintf("Error: indexed results differ after modifying signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    /* indexes must be rebuilt after removing every other device along with its signals */
+    add_indexes(graph);
+    if (run_queries(graph, 1) < 0) {
+        eprintf("Error: indexed results differ.\n");
+        result = 1;
+        goto done;
+    }
+    graph_remove_devs(graph, "testfilter", num_devs, 2);
+    if (run_queries(graph, 0) < 0 || remove_indexes(graph) || run_queries(graph, 1) < 0) {
+        eprintf("Error: indexed results differ after removing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+done:
+    mpr_graph_free(graph);
+    if (!verbose)
+        printf("..................................................");
+    printf("Test %s\x1B[0m.\n", result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,302 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/time.h>
+#include <zlib.h>
+#include <lo/lo_lowlevel.h>
+#include "../src/mapper_internal.h"
+#include "graph_helpers.h"
+
+int verbose = 1;
+int num_devs = 500;
+int sigs_per_dev = 80;
+int maps_per_dev = 4;
+int iterations = 20;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Look up an object by scanning the lists of the graph, as a baseline. */
+static mpr_obj scan_by_id(mpr_graph g, mpr_type type, mpr_id id)
+{
+    mpr_list l = mpr_graph_get_objs(g, type);
+    while (l) {
+        if ((*l)->id == id)
+            return *l;
+        l = mpr_list_get_next(l);
+    }
+    return 0;
+}
+
+static mpr_dev scan_by_name(mpr_graph g, const char *name)
+{
+    mpr_list l = mpr_graph_get_objs(g, MPR_DEV);
+    while (l) {
+        mpr_dev dev = (mpr_dev)*l;
+        if (dev->name && !strcmp(dev->name, name))
+            return dev;
+        l = mpr_list_get_next(l);
+    }
+    return 0;
+}
+
+static mpr_sig scan_sig_by_name(mpr_graph g, mpr_dev dev, const char *name)
+{
+    mpr_list l = mpr_graph_get_objs(g, MPR_SIG);
+    while (l) {
+        mpr_sig sig = (mpr_sig)*l;
+        if (sig->dev == dev && !strcmp(sig->name, name))
+            return sig;
+        l = mpr_list_get_next(l);
+    }
+    return 0;
+}
+
+static mpr_id dev_id(int i)
+{
+    char name[32];
+    snprintf(name, 32, "testgraphindex.%d", i + 1);
+    return (mpr_id)crc32(0L, (const Bytef *)name, strlen(name)) << 32;
+}
+
+static void add_props(lo_message lom, int dev_idx, int sig_idx)
+{
+    lo_message_add_string(lom, "@id");
+    lo_message_add_int64(lom, dev_id(dev_idx) | (sig_idx + 1));
+}
+
+static int build_graph(mpr_graph g)
+{
+    int i, j;
+    char src_name[64], dst_name[64];
+    const char *src = src_name;
+    if (graph_add_devs(g, "testgraphindex", num_devs, sigs_per_dev, add_props))
+        return 1;
+    /* map outputs of each device to inputs of the next one */
+    for (i = 0; i < num_devs; i++) {
+        for (j = 0; j < maps_per_dev; j++) {
+            snprintf(src_name, 64, "testgraphindex.%d/out%d", i + 1, j * 2 + 1);
+            snprintf(dst_name, 64, "testgraphindex.%d/in%d", (i + 1) % num_devs + 1, j * 2);
+            if (!mpr_graph_add_map(g, dev_id(i) | (0x10000 + j), 1, &src, dst_name))
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/* Look up every device by name and every signal and map by id, using the graph indexes if
+ * indexed is set and by scanning the graph lists otherwise. Returns the number of lookups per
+ * second, or -1 if any lookup failed. */
+static double run_lookups(mpr_graph g, int indexed)
+{
+    int i, j, k, count = 0;
+    char name[32], sig_name[32];
+    double then = current_time();
+    for (k = 0; k < iterations; k++) {
+        for (i = 0; i < num_devs; i++) {
+            mpr_dev dev;
+            snprintf(name, 32, "testgraphindex.%d", i + 1);
+            dev = indexed ? mpr_graph_get_dev_by_name(g, name) : scan_by_name(g, name);
+            if (!dev || dev->obj.id != dev_id(i) || strcmp(dev->name, name))
+                return -1;
+            for (j = 0; j < sigs_per_dev; j += sigs_per_dev / 4) {
+                mpr_id id = dev_id(i) | (j + 1);
+                mpr_obj o;
+                mpr_sig sig;
+                o = indexed ? mpr_graph_get_obj(g, MPR_SIG, id) : scan_by_id(g, MPR_SIG, id);
+                if (!o || o->id != id || ((mpr_sig)o)->dev != dev)
+                    return -1;
+                snprintf(sig_name, 32, "%s%d", j % 2 ? "out" : "in", j);
+                sig = (indexed ? mpr_dev_get_sig_by_name(dev, sig_name)
+                       : scan_sig_by_name(g, dev, sig_name));
+                if (sig != (mpr_sig)o)
+                    return -1;
+                count += 2;
+            }
+            for (j = 0; j < maps_per_dev; j++) {
+                mpr_id id = dev_id(i) | (0x10000 + j);
+                mpr_obj o;
+                o = indexed ? mpr_graph_get_obj(g, MPR_MAP, id) : scan_by_id(g, MPR_MAP, id);
+                if (!o || o->id != id)
+                    return -1;
+                ++count;
+            }
+            count += 1;
+        }
+        /* objects that are not in the graph */
+        snprintf(name, 32, "testgraphindex.%d", num_devs + 1);
+        if (indexed ? mpr_graph_get_dev_by_name(g, name) : scan_by_name(g, name))
+            return -1;
+        if (indexed ? mpr_graph_get_obj(g, MPR_SIG, 1) : scan_by_id(g, MPR_SIG, 1))
+            return -1;
+        count += 2;
+        /* scanning is slow enough to be measured over a single pass */
+        if (!indexed)
+            break;
+    }
+    return count / (current_time() - then);
+}
+
+static int count_list(mpr_list l)
+{
+    int count = 0;
+    while (l) {
+        ++count;
+        l = mpr_list_get_next(l);
+    }
+    return count;
+}
+
+/* Check the signals and maps returned for each remaining device and signal. */
+static int check_children(mpr_graph g, int step)
+{
+    int i, dir = MPR_DIR_OUT;
+    char name[32];
+    for (i = step - 1; i < num_devs; i += step) {
+        mpr_dev dev;
+        mpr_list l;
+        int num_maps = 0;
+        snprintf(name, 32, "testgraphindex.%d", i + 1);
+        if (!(dev = mpr_graph_get_dev_by_name(g, name)))
+            return 1;
+        if (count_list(mpr_dev_get_sigs(dev, MPR_DIR_ANY)) != sigs_per_dev)
+            return 1;
+        if (count_list(mpr_dev_get_sigs(dev, MPR_DIR_IN)) != sigs_per_dev / 2)
+            return 1;
+        l = mpr_list_filter(mpr_dev_get_sigs(dev, MPR_DIR_ANY), MPR_PROP_DIR, NULL, 1, MPR_INT32,
+                            &dir, MPR_OP_EQ);
+        if (count_list(l) != sigs_per_dev / 2)
+            return 1;
+        if (mpr_dev_get_sig_by_name(dev, "missing"))
+            return 1;
+
+        /* maps are removed along with either device, and the neighbours of the remaining
+         * devices have all been removed */
+        if (1 == step)
+            num_maps = maps_per_dev * 2;
+        if (count_list(mpr_dev_get_maps(dev, MPR_DIR_ANY)) != num_maps)
+            return 1;
+        l = mpr_dev_get_sigs(dev, MPR_DIR_ANY);
+        while (l) {
+            mpr_sig sig = (mpr_sig)*l;
+            int idx = atoi(sig->name + (MPR_DIR_OUT == sig->dir ? 3 : 2));
+            int expected = (1 == step && idx < maps_per_dev * 2) ? 1 : 0;
+            if (count_list(mpr_sig_get_maps(sig, MPR_DIR_ANY)) != expected) {
+                mpr_list_free(l);
+                return 1;
+            }
+            l = mpr_list_get_next(l);
+        }
+    }
+    return 0;
+}
+
+/* Remove half of the devices along with their signals and maps, and check that lookups no longer
+ * find them while the remaining objects are still found. */
+static int remove_devs(mpr_graph g)
+{
+    int i;
+    char name[32];
+    graph_remove_devs(g, "testgraphindex", num_devs, 2);
+    for (i = 0; i < num_devs; i++) {
+        mpr_dev dev;
+        snprintf(name, 32, "testgraphindex.%d", i + 1);
+        dev = mpr_graph_get_dev_by_name(g, name);
+        if ((i % 2) ? !dev : !!dev)
+            return 1;
+        if ((i % 2) ? !mpr_graph_get_obj(g, MPR_SIG, dev_id(i) | 1)
+                    : !!mpr_graph_get_obj(g, MPR_SIG, dev_id(i) | 1))
+            return 1;
+        if (!(i % 2) && mpr_graph_get_obj(g, MPR_MAP, dev_id(i) | 0x10000))
+            return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    double then, indexed, scanned;
+    mpr_graph graph;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        eprintf("testgraphindex.c: possible arguments "
+                                "-f fast (execute quickly), "
+                                "-q quiet (suppress output), "
+                                "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        num_devs = 100;
+                        sigs_per_dev = 20;
+                        iterations = 5;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    graph = mpr_graph_new(0);
+
+    then = current_time();
+    if (build_graph(graph)) {
+        eprintf("Error building graph.\n");
+        result = 1;
+        goto done;
+    }
+    eprintf("added %d devices, %d signals and %d maps in %.3f seconds\n", num_devs,
+            num_devs * sigs_per_dev, num_devs * maps_per_dev, current_time() - then);
+
+    if ((indexed = run_lookups(graph, 1)) < 0 || (scanned = run_lookups(graph, 0)) < 0) {
+        eprintf("Error: lookup returned the wrong object.\n");
+        result = 1;
+        goto done;
+    }
+    eprintf("indexed: %.0f lookups/s, scanned: %.0f lookups/s, speedup %.1fx\n", indexed,
+            scanned, indexed / scanned);
+
+    if (check_children(graph, 1)) {
+        eprintf("Error: wrong signals or maps returned for a device or signal.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (remove_devs(graph) || check_children(graph, 2)) {
+        eprintf("Error: lookup found a removed object or lost a remaining one.\n");
+        result = 1;
+        goto done;
+    }
+
+done:
+    mpr_graph_free(graph);
+    if (!verbose)
+        printf("..................................................");
+    printf("Test %s\x1B[0m.\n", result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,255 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#define MAX_ITERATIONS 200
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int iterations = MAX_ITERATIONS;
+int idle_sec = 3;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+
+/* time at which each value was sent, and the latency with which it was received */
+double sent_times[MAX_ITERATIONS];
+double latencies[MAX_ITERATIONS];
+int received = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Returns the CPU time used by the process in seconds. */
+static double cpu_time()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (  usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1000000.0
+            + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1000000.0);
+}
+
+/* Called by the I/O thread of the destination device. */
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int v;
+    if (!value)
+        return;
+    v = *(int*)value;
+    if (v < 0 || v >= iterations || latencies[v] >= 0)
+        return;
+    latencies[v] = current_time() - sent_times[v];
+    ++received;
+}
+
+int setup_devs(const char *iface)
+{
+    src = mpr_dev_new("testidle-send", 0);
+    dst = mpr_dev_new("testidle-recv", 0);
+    if (!src || !dst)
+        goto error;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                          NULL, NULL, NULL, NULL, 0);
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                          NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    if (!sendsig || !recvsig)
+        goto error;
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_devs()
+{
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    eprintf("ok\n");
+}
+
+void wait_ready()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+}
+
+int setup_map()
+{
+    int i = 0;
+    mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        if (i++ > 500)
+            return 1;
+    }
+    return 0;
+}
+
+/* Block both devices in their I/O threads and measure the CPU time they use. */
+double measure_idle()
+{
+    double then_cpu, then;
+    if (mpr_dev_start_polling(src, 1000) || mpr_dev_start_polling(dst, 1000))
+        return -1;
+    then = current_time();
+    then_cpu = cpu_time();
+    sleep(idle_sec);
+    return (cpu_time() - then_cpu) / (current_time() - then);
+}
+
+/* Send updates from the polling thread and measure how long the blocked I/O thread of the
+ * destination takes to handle them. */
+int measure_latency()
+{
+    int i;
+    double max = 0, total = 0;
+    mpr_dev_stop_polling(src);
+    for (i = 0; i < iterations; i++)
+        latencies[i] = -1;
+
+    for (i = 0; i < iterations && !done; i++) {
+        sent_times[i] = current_time();
+        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &i);
+        mpr_dev_update_maps(src);
+        usleep(period * 1000);
+    }
+    for (i = 0; i < 100 && received < iterations; i++)
+        usleep(10000);
+    mpr_dev_stop_polling(dst);
+
+    for (i = 0; i < iterations; i++) {
+        if (latencies[i] < 0)
+            continue;
+        total += latencies[i];
+        if (latencies[i] > max)
+            max = latencies[i];
+    }
+    eprintf("received %d of %d updates\n", received, iterations);
+    if (received)
+        eprintf("wake latency: mean %.3f ms, max %.3f ms\n", total * 1000 / received, max * 1000);
+    return received != iterations;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    double idle;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testidle.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        iterations = 50;
+                        idle_sec = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_ready();
+
+    if (setup_map()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    if ((idle = measure_idle()) < 0) {
+        eprintf("Error starting I/O threads.\n");
+        result = 1;
+        goto done;
+    }
+    eprintf("idle CPU: %.2f%% over %d seconds\n", idle * 100, idle_sec);
+    /* blocked devices should only wake up for housekeeping */
+    if (idle > 0.05) {
+        eprintf("Error: idle devices are busy.\n");
+        result = 1;
+    }
+
+    result |= measure_latency();
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -6,6 +6,9 @@
 #include <unistd.h>
 #include <signal.h>
 #include <string.h>
+#include <time.h>
+
+#define NUM_BURST 1000
 
 int verbose = 1;
 int terminate = 0;
@@ -23,9 +26,23 @@ int received = 0;
 
 float expected;
 
+/* statistics for the high-rate phase */
+int burst = 0;
+int burst_period = 500;
+double burst_sent_at[NUM_BURST];
+char burst_received[NUM_BURST];
+double latency_sum = 0, latency_max = 0;
+
 /* This flag controls termination of the main loop. */
 volatile sig_atomic_t keep_going = 1;
 
+static double current_time()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
 static void eprintf(const char *format, ...)
 {
     va_list args;
@@ -74,7 +91,18 @@ void cleanup_src()
 void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
              mpr_type type, const void *value, mpr_time t)
 {
-    if (value) {
+    if (value && burst) {
+        int v = (int)(*(float*)value);
+        if (v >= 0 && v < NUM_BURST && !burst_received[v]) {
+            double latency = current_time() - burst_sent_at[v];
+            latency_sum += latency;
+            if (latency > latency_max)
+                latency_max = latency;
+            burst_received[v] = 1;
+            ++received;
+        }
+    }
+    else if (value) {
         eprintf("handler: Got %f\n", (*(float*)value));
         if (fabs(*(float*)value - expected) < 0.0001)
             received++;
@@ -121,11 +149,14 @@ void cleanup_dst()
 
 int setup_maps()
 {
+    int loc = MPR_LOC_DST;
     mpr_map map = mpr_map_new(1, &sendsig, 1, &recvsig);
 
     char expr[128];
     snprintf(expr, 128, "y=x");
     mpr_obj_set_prop(map, MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
+    /* evaluate at the destination so that every update is sent rather than the latest one */
+    mpr_obj_set_prop(map, MPR_PROP_PROCESS_LOC, NULL, 1, MPR_INT32, &loc, 1);
     mpr_obj_push(map);
 
     /* Wait until mapping has been established */
@@ -166,6 +197,19 @@ void interrupt (int sig)
         keep_going = 0;
 }
 
+/* Update the signal at a high rate without printing, recording the time of each update. */
+void burst_interrupt (int sig)
+{
+    if (sent < NUM_BURST && !done) {
+        burst_sent_at[sent] = current_time();
+        mpr_sig_set_value(sendsig, 0, 1, MPR_INT32, &sent);
+        ++sent;
+        mpr_dev_update_maps(src);
+    }
+    else
+        keep_going = 0;
+}
+
 void loop (void)
 {
     while (keep_going) {
@@ -264,6 +308,31 @@ int main (int argc, char **argv)
         result = 1;
     }
 
+    if (!terminate || !autoconnect || done || result)
+        goto done;
+
+    /* Update the signal from a high-rate timer interrupting the poll loop. Updates made while
+     * the source device is busy are deferred, so none should be lost. */
+    eprintf("Sending %d updates at %d us intervals...\n", NUM_BURST, burst_period);
+    sent = received = 0;
+    burst = 1;
+    keep_going = 1;
+    signal(SIGALRM, burst_interrupt);
+    ualarm(burst_period, burst_period);
+    loop();
+    ualarm(0, 0);
+    for (i = 0; i < 10 && received < sent; i++)
+        mpr_dev_poll(dst, 10);
+
+    if (!verbose)
+        printf("\n");
+    eprintf("Received %d of %d updates, average latency %.3f ms, maximum %.3f ms.\n",
+            received, sent, received ? latency_sum / received * 1000 : 0, latency_max * 1000);
+    if (sent != NUM_BURST || received != sent || !burst_received[NUM_BURST - 1]) {
+        eprintf("Error: %d updates were lost.\n", sent - received);
+        result = 1;
+    }
+
   done:
     cleanup_dst();
     cleanup_src();
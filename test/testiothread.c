@@ -0,0 +1,255 @@
+#include <mapper/mapper.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#define NUM_THREADS 4
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int iterations = 100;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsigs[NUM_THREADS];
+mpr_sig recvsigs[NUM_THREADS];
+
+/* per-signal statistics collected by the handler */
+int received[NUM_THREADS];
+int last_value[NUM_THREADS];
+int out_of_order = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i, v;
+    if (!value)
+        return;
+    v = *(int*)value;
+    for (i = 0; i < NUM_THREADS; i++) {
+        if (sig != recvsigs[i])
+            continue;
+        if (v <= last_value[i]) {
+            eprintf("handler: signal %d got %d after %d\n", i, v, last_value[i]);
+            ++out_of_order;
+        }
+        last_value[i] = v;
+        ++received[i];
+    }
+}
+
+int setup_devs(const char *iface)
+{
+    int i;
+    char name[32];
+    src = mpr_dev_new("testiothread-send", 0);
+    dst = mpr_dev_new("testiothread-recv", 0);
+    if (!src || !dst)
+        goto error;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_INT32, NULL,
+                                  NULL, NULL, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_INT32, NULL,
+                                  NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+        if (!sendsigs[i] || !recvsigs[i])
+            goto error;
+        last_value[i] = -1;
+    }
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_devs()
+{
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    eprintf("ok\n");
+}
+
+int setup_maps()
+{
+    int i, j = 0, ready = 0;
+    mpr_map maps[NUM_THREADS];
+    for (i = 0; i < NUM_THREADS; i++) {
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && !ready) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        for (i = 0, ready = 1; i < NUM_THREADS; i++) {
+            if (!mpr_map_get_is_ready(maps[i])) {
+                ready = 0;
+                break;
+            }
+        }
+        if (j++ > 500)
+            break;
+    }
+    return !ready;
+}
+
+void wait_ready()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+}
+
+/* Application thread: updates its signal without polling or locking. */
+void *update_thread(void *context)
+{
+    int i, idx = (int)(long)context;
+    for (i = 0; i < iterations && !done; i++) {
+        mpr_sig_set_value(sendsigs[idx], 0, 1, MPR_INT32, &i);
+        usleep(period * 1000);
+    }
+    return 0;
+}
+
+int run()
+{
+    int i, j;
+    pthread_t threads[NUM_THREADS];
+
+    if (mpr_dev_start_polling(src, 1)) {
+        eprintf("Error starting I/O thread.\n");
+        return 1;
+    }
+    /* the device must not be polled by other threads while its I/O thread runs */
+    if (mpr_dev_poll(src, 0)) {
+        eprintf("Error: device was polled outside of its I/O thread.\n");
+        return 1;
+    }
+    /* nor share its graph with another local device */
+    if (mpr_dev_new("testiothread-shared", mpr_obj_get_graph((mpr_obj)src))) {
+        eprintf("Error: device added to a graph polled by an I/O thread.\n");
+        return 1;
+    }
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        if (pthread_create(&threads[i], 0, update_thread, (void*)(long)i)) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+    for (j = 0; j < iterations * period / 10 + 10 && !done; j++)
+        mpr_dev_poll(dst, 10);
+    for (i = 0; i < NUM_THREADS; i++)
+        pthread_join(threads[i], 0);
+
+    mpr_dev_stop_polling(src);
+    for (j = 0; j < 10; j++)
+        mpr_dev_poll(dst, 10);
+
+    for (i = 0; i < NUM_THREADS; i++) {
+        eprintf("signal %d: received %d updates, last value %d\n", i, received[i],
+                last_value[i]);
+        /* consecutive updates may be coalesced, but the final value must arrive */
+        if (last_value[i] != iterations - 1)
+            return 1;
+    }
+    return out_of_order != 0;
+}
+
+void ctrlc(int signal)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testiothread.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_ready();
+
+    if (setup_maps()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = run();
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
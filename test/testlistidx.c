@@ -0,0 +1,197 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/time.h>
+#include <lo/lo_lowlevel.h>
+#include "../src/mapper_internal.h"
+#include "graph_helpers.h"
+
+int verbose = 1;
+int num_devs = 100;
+int sigs_per_dev = 500;
+int lookups = 200;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static mpr_list get_sigs(mpr_graph g, int dir)
+{
+    return mpr_list_filter(mpr_graph_get_objs(g, MPR_SIG), MPR_PROP_DIR, NULL, 1, MPR_INT32, &dir,
+                           MPR_OP_EQ);
+}
+
+/* Look up evenly spaced items of a list by index, the way the language bindings do, checking
+ * them against the objects found by walking the list. Returns the number of lookups per second,
+ * or -1 if any lookup returned the wrong object. */
+static double run_lookups(mpr_list l, mpr_obj *objs, int num)
+{
+    int i, idx, step = num / lookups ? num / lookups : 1;
+    double then = current_time();
+    if (mpr_list_get_size(l) != num)
+        return -1;
+    for (i = 0, idx = 0; i < lookups; i++, idx = (idx + step) % num) {
+        if (mpr_list_get_idx(l, idx) != objs[idx])
+            return -1;
+    }
+    return lookups / (current_time() - then);
+}
+
+static int check_snapshot(mpr_graph g, mpr_list snap, mpr_obj *objs, int num)
+{
+    int count = 0;
+    mpr_list l, cpy;
+
+    /* indexed access must not change the position of the list */
+    if (mpr_list_get_idx(snap, num) || mpr_list_get_idx(snap, num - 1) != objs[num - 1]
+        || *snap != objs[0]) {
+        eprintf("Error: indexed access moved the list.\n");
+        return 1;
+    }
+
+    /* snapshots can be combined with other queries */
+    l = mpr_list_get_isect(mpr_list_get_cpy(snap), get_sigs(g, MPR_DIR_OUT));
+    count = mpr_list_get_size(l);
+    mpr_list_free(l);
+    if (count != num) {
+        eprintf("Error: intersection returned %d items, expected %d.\n", count, num);
+        return 1;
+    }
+    l = mpr_list_get_union(get_sigs(g, MPR_DIR_IN), mpr_list_get_cpy(snap));
+    count = mpr_list_get_size(l);
+    mpr_list_free(l);
+    if (count != num_devs * sigs_per_dev) {
+        eprintf("Error: union returned %d items, expected %d.\n", count,
+                num_devs * sigs_per_dev);
+        return 1;
+    }
+    l = mpr_list_get_diff(get_sigs(g, MPR_DIR_OUT), mpr_list_get_cpy(snap));
+    if (l) {
+        eprintf("Error: difference returned %d items, expected 0.\n", mpr_list_get_size(l));
+        mpr_list_free(l);
+        return 1;
+    }
+
+    /* iterating a copy must return the same objects in the same order */
+    count = 0;
+    cpy = mpr_list_get_cpy(snap);
+    while (cpy) {
+        if (count >= num || *cpy != objs[count]) {
+            eprintf("Error: snapshot iteration differs at item %d.\n", count);
+            mpr_list_free(cpy);
+            return 1;
+        }
+        ++count;
+        cpy = mpr_list_get_next(cpy);
+    }
+    return count != num;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, num = 0, result = 0;
+    double then, walked, materialized;
+    mpr_graph graph;
+    mpr_obj *objs = 0;
+    mpr_list l, snap = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        eprintf("testlistidx.c: possible arguments "
+                                "-f fast (execute quickly), "
+                                "-q quiet (suppress output), "
+                                "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        num_devs = 20;
+                        lookups = 100;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    graph = mpr_graph_new(0);
+
+    if (graph_add_devs(graph, "testlistidx", num_devs, sigs_per_dev, NULL)) {
+        eprintf("Error building graph.\n");
+        result = 1;
+        goto done;
+    }
+
+    /* record the objects of the query in order */
+    objs = (mpr_obj*)malloc(num_devs * sigs_per_dev * sizeof(mpr_obj));
+    l = get_sigs(graph, MPR_DIR_OUT);
+    while (l) {
+        objs[num++] = *l;
+        l = mpr_list_get_next(l);
+    }
+    if (num != num_devs * sigs_per_dev / 2) {
+        eprintf("Error: query returned %d signals, expected %d.\n", num,
+                num_devs * sigs_per_dev / 2);
+        result = 1;
+        goto done;
+    }
+
+    l = get_sigs(graph, MPR_DIR_OUT);
+    walked = run_lookups(l, objs, num);
+    mpr_list_free(l);
+    if (walked < 0) {
+        eprintf("Error: lookup returned the wrong object.\n");
+        result = 1;
+        goto done;
+    }
+
+    then = current_time();
+    snap = mpr_list_materialize(get_sigs(graph, MPR_DIR_OUT));
+    eprintf("materialized %d of %d signals in %.3f seconds\n", num, num_devs * sigs_per_dev,
+            current_time() - then);
+    if ((materialized = run_lookups(snap, objs, num)) < 0) {
+        eprintf("Error: materialized lookup returned the wrong object.\n");
+        result = 1;
+        goto done;
+    }
+    eprintf("materialized: %.0f lookups/s, walked: %.0f lookups/s, speedup %.1fx\n",
+            materialized, walked, materialized / walked);
+
+    if (mpr_list_materialize(snap) != snap) {
+        eprintf("Error: snapshot was materialized again.\n");
+        result = 1;
+        goto done;
+    }
+    result = check_snapshot(graph, snap, objs, num);
+
+done:
+    mpr_list_free(snap);
+    free(objs);
+    mpr_graph_free(graph);
+    if (!verbose)
+        printf("..................................................");
+    printf("Test %s\x1B[0m.\n", result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,267 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+#define MAX_DEVS 200
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int iterations = 100;
+int num_devs = MAX_DEVS;
+
+mpr_graph graph = 0;
+mpr_dev devs[MAX_DEVS];
+mpr_sig outsigs[MAX_DEVS];
+mpr_sig insigs[MAX_DEVS];
+
+int received = 0;
+int last_value = -1;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Returns the number of open sockets, or -1 if it cannot be determined. */
+static int count_sockets()
+{
+#ifdef __linux__
+    int count = 0;
+    char path[64], target[64];
+    struct dirent *entry;
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir)
+        return -1;
+    while ((entry = readdir(dir))) {
+        ssize_t len;
+        snprintf(path, 64, "/proc/self/fd/%s", entry->d_name);
+        len = readlink(path, target, 63);
+        if (len > 0) {
+            target[len] = 0;
+            if (0 == strncmp(target, "socket:", 7))
+                ++count;
+        }
+    }
+    closedir(dir);
+    return count;
+#else
+    return -1;
+#endif
+}
+
+/* Returns the resident memory of the process in kilobytes, or -1 if it cannot be determined. */
+static long get_resident_kb()
+{
+#ifdef __linux__
+    long size, resident = -1;
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return -1;
+    if (2 != fscanf(f, "%ld %ld", &size, &resident))
+        resident = -1;
+    fclose(f);
+    return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+#else
+    return -1;
+#endif
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value) {
+        ++received;
+        last_value = *(int*)value;
+    }
+}
+
+int setup_devs(const char *iface)
+{
+    int i;
+    for (i = 0; i < num_devs; i++) {
+        /* all devices share the graph and network context of the first one */
+        devs[i] = mpr_dev_new("testmanydevs", graph);
+        if (!devs[i])
+            return 1;
+        if (!i) {
+            graph = mpr_obj_get_graph((mpr_obj)devs[0]);
+            if (iface)
+                mpr_graph_set_interface(graph, iface);
+        }
+        outsigs[i] = mpr_sig_new(devs[i], MPR_DIR_OUT, "outsig", 1, MPR_INT32, NULL,
+                                 NULL, NULL, NULL, NULL, 0);
+        insigs[i] = mpr_sig_new(devs[i], MPR_DIR_IN, "insig", 1, MPR_INT32, NULL,
+                                NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+        if (!outsigs[i] || !insigs[i])
+            return 1;
+    }
+    eprintf("%d devices created using interface %s.\n", num_devs, mpr_graph_get_interface(graph));
+    return 0;
+}
+
+void cleanup_devs()
+{
+    int i;
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    /* the shared graph is freed along with the last device */
+    for (i = num_devs - 1; i >= 0; i--) {
+        if (devs[i])
+            mpr_dev_free(devs[i]);
+    }
+    eprintf("ok\n");
+}
+
+/* Returns the number of seconds taken for all devices to be ready, or -1 on timeout. */
+double wait_ready()
+{
+    int i, ready = 0;
+    double then = current_time();
+    while (!done && !ready) {
+        mpr_dev_poll(devs[0], period);
+        for (i = 1, ready = mpr_dev_get_is_ready(devs[0]); i < num_devs; i++) {
+            mpr_dev_poll(devs[i], 0);
+            ready &= mpr_dev_get_is_ready(devs[i]);
+        }
+        if (current_time() - then > 60)
+            return -1;
+    }
+    return current_time() - then;
+}
+
+/* Map a signal between two devices sharing the graph and check that updates are delivered. */
+int run_map()
+{
+    int i, j;
+    mpr_map map = mpr_map_new(1, &outsigs[0], 1, &insigs[1]);
+    mpr_obj_push((mpr_obj)map);
+    for (i = 0; i < 500 && !done && !mpr_map_get_is_ready(map); i++) {
+        mpr_dev_poll(devs[0], period);
+        mpr_dev_poll(devs[1], 0);
+    }
+    if (!mpr_map_get_is_ready(map)) {
+        eprintf("Error: map between local devices was not established.\n");
+        return 1;
+    }
+
+    received = 0;
+    for (i = 0; i < iterations && !done; i++) {
+        mpr_sig_set_value(outsigs[0], 0, 1, MPR_INT32, &i);
+        mpr_dev_update_maps(devs[0]);
+        for (j = 0; j < 100 && received <= i; j++) {
+            mpr_dev_poll(devs[1], 0);
+            mpr_dev_poll(devs[0], 0);
+        }
+    }
+    eprintf("received %d of %d updates between local devices.\n", received, iterations);
+    return received != iterations || last_value != iterations - 1;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, sockets;
+    long mem_before, mem_after;
+    double elapsed;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testmanydevs.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        iterations = 20;
+                        num_devs = 50;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    mem_before = get_resident_kb();
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    if ((elapsed = wait_ready()) < 0) {
+        eprintf("Error: devices were not ready after 60 seconds.\n");
+        result = 1;
+        goto done;
+    }
+    mem_after = get_resident_kb();
+    eprintf("%d devices ready after %.2f seconds.\n", num_devs, elapsed);
+    if (mem_before >= 0 && mem_after >= 0)
+        eprintf("resident memory: %ld kB, %.1f kB per device.\n", mem_after,
+                (double)(mem_after - mem_before) / num_devs);
+
+    /* each device has its own UDP and TCP data servers, but the admin servers are shared */
+    if ((sockets = count_sockets()) >= 0) {
+        eprintf("%d sockets open for %d devices.\n", sockets, num_devs);
+        if (sockets > num_devs * 2 + 8) {
+            eprintf("Error: admin sockets are not shared between devices.\n");
+            result = 1;
+            goto done;
+        }
+    }
+
+    result = run_map();
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,333 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define FRAG_PAYLOAD 1480 /* IP fragment payload for a 1500 byte Ethernet MTU */
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int num_sigs = 64;
+int vec_len = 16;
+int iterations = 200;
+float loss = 0.05;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig *sendsigs = 0;
+mpr_sig *recvsigs = 0;
+
+int received = 0;
+
+/* statistics collected by the drop shim */
+int drop_port = 0;
+float drop_prob = 0;
+int dgrams_sent = 0;
+int dgrams_dropped = 0;
+int max_dgram_len = 0;
+
+#define NUM_MODES 3
+const char *mode_names[] = {"split, no loss", "unsplit, lossy", "split, lossy"};
+float loss_rates[NUM_MODES];
+int dgrams[NUM_MODES];
+int max_lens[NUM_MODES];
+
+#ifdef SYS_sendto
+/* Userland drop shim: interposes sendto() and discards datagrams addressed to the destination
+ * device's data port as if each IP fragment was independently lost with probability
+ * 'drop_prob'. Other traffic is passed through unchanged. */
+ssize_t sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr,
+               socklen_t addr_len)
+{
+    if (   drop_port && addr && AF_INET == addr->sa_family
+        && ntohs(((const struct sockaddr_in*)addr)->sin_port) == drop_port) {
+        int i, frags = (len + FRAG_PAYLOAD - 1) / FRAG_PAYLOAD;
+        ++dgrams_sent;
+        if (len > max_dgram_len)
+            max_dgram_len = len;
+        for (i = 0; i < frags; i++) {
+            if (rand() < drop_prob * RAND_MAX) {
+                ++dgrams_dropped;
+                return len;
+            }
+        }
+    }
+    return syscall(SYS_sendto, fd, buf, len, flags, addr, addr_len);
+}
+#define HAVE_DROP_SHIM 1
+#else
+#define HAVE_DROP_SHIM 0
+#endif
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+int setup_src(const char *iface)
+{
+    int i;
+    char name[32];
+    src = mpr_dev_new("testmtu-send", 0);
+    if (!src)
+        goto error;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+    eprintf("source created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    sendsigs = calloc(1, num_sigs * sizeof(mpr_sig));
+    for (i = 0; i < num_sigs; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, vec_len, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, NULL, 0);
+        if (!sendsigs[i])
+            goto error;
+    }
+    eprintf("%d output signals registered.\n", num_sigs);
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_src()
+{
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+    free(sendsigs);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value && length == vec_len)
+        ++received;
+}
+
+int setup_dst(const char *iface)
+{
+    int i;
+    char name[32];
+    dst = mpr_dev_new("testmtu-recv", 0);
+    if (!dst)
+        goto error;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    eprintf("destination created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)dst)));
+
+    recvsigs = calloc(1, num_sigs * sizeof(mpr_sig));
+    for (i = 0; i < num_sigs; i++) {
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, vec_len, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+        if (!recvsigs[i])
+            goto error;
+    }
+    eprintf("%d input signals registered.\n", num_sigs);
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_dst()
+{
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+    free(recvsigs);
+}
+
+void wait_ready()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+}
+
+int setup_maps()
+{
+    int i, j = 0, ready = 0;
+    mpr_map *maps = calloc(1, num_sigs * sizeof(mpr_map));
+    for (i = 0; i < num_sigs; i++) {
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && !ready) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        for (i = 0, ready = 1; i < num_sigs; i++) {
+            if (!mpr_map_get_is_ready(maps[i])) {
+                ready = 0;
+                break;
+            }
+        }
+        if (j++ > 500)
+            break;
+    }
+    free(maps);
+    return !ready;
+}
+
+void run_mode(int mode)
+{
+    int i, j, expected = iterations * num_sigs;
+    float *v = malloc(vec_len * sizeof(float));
+
+    mpr_graph_set_mtu(mpr_obj_get_graph((mpr_obj)src), 1 == mode ? 65507 : 0);
+    drop_prob = mode ? loss : 0;
+    dgrams_sent = dgrams_dropped = max_dgram_len = received = 0;
+
+    for (i = 0; i < iterations && !done; i++) {
+        for (j = 0; j < vec_len; j++)
+            v[j] = (float)(i + j);
+        for (j = 0; j < num_sigs; j++)
+            mpr_sig_set_value(sendsigs[j], 0, vec_len, MPR_FLT, v);
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, period);
+    }
+    /* collect any remaining updates */
+    mpr_dev_poll(dst, 100);
+    free(v);
+
+    loss_rates[mode] = 1.f - (float)received / expected;
+    dgrams[mode] = dgrams_sent;
+    max_lens[mode] = max_dgram_len;
+    eprintf("mode '%s': received %d of %d updates in %d datagrams (%d dropped)\n",
+            mode_names[mode], received, expected, dgrams_sent, dgrams_dropped);
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testmtu.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--num_sigs number of mapped signals (default 64), "
+                               "--loss fragment loss probability (default 0.05), "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--num_sigs")==0 && argc>i+1) {
+                            i++;
+                            num_sigs = atoi(argv[i]);
+                            j = 1;
+                        }
+                        else if (strcmp(argv[i], "--loss")==0 && argc>i+1) {
+                            i++;
+                            loss = atof(argv[i]);
+                            j = 1;
+                        }
+                        else if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+    srand(1);
+
+    if (setup_dst(iface)) {
+        eprintf("Error initializing destination.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (setup_src(iface)) {
+        eprintf("Error initializing source.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_ready();
+
+    if (setup_maps()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    drop_port = mpr_obj_get_prop_as_int32((mpr_obj)dst, MPR_PROP_PORT, NULL);
+
+    for (i = 0; i < NUM_MODES && !done; i++)
+        run_mode(i);
+
+    /* all updates should arrive without loss */
+    if (loss_rates[0] > 0) {
+        eprintf("Error: %f of updates lost without packet loss.\n", loss_rates[0]);
+        result = 1;
+    }
+    /* if the drop shim is active, splitting should reduce the loss rate */
+    if (HAVE_DROP_SHIM && loss > 0 && loss_rates[2] >= loss_rates[1]) {
+        eprintf("Error: splitting bundles did not reduce the loss rate.\n");
+        result = 1;
+    }
+
+    if (!result && HAVE_DROP_SHIM) {
+        for (i = 0; i < NUM_MODES; i++)
+            printf("%-16s %6d datagrams, max %5d bytes, update loss %.1f%%\n", mode_names[i],
+                   dgrams[i], max_lens[i], loss_rates[i] * 100);
+    }
+
+  done:
+    cleanup_dst();
+    cleanup_src();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,325 @@
+#include "../src/mapper_internal.h"
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <lo/lo.h>
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int vec_len = 16;
+int iterations = 2000;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig = 0;
+mpr_sig recvsig = 0;
+mpr_map map = 0;
+
+int sent = 0;
+int received = 0;
+
+float *expected;
+
+#define NUM_MODES 3
+const char *mode_names[] = {"per-element", "packed", "packed (partial)"};
+double times[NUM_MODES];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int setup_src(const char *iface)
+{
+    src = mpr_dev_new("testpacked-send", 0);
+    if (!src)
+        goto error;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+    eprintf("source created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    sendsig = mpr_sig_new(src, MPR_DIR_OUT, "outsig", vec_len, MPR_FLT, NULL,
+                          NULL, NULL, NULL, NULL, 0);
+    if (!sendsig)
+        goto error;
+    eprintf("Output signal 'outsig' registered.\n");
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_src()
+{
+    if (src) {
+        eprintf("Freeing source.. ");
+        fflush(stdout);
+        mpr_dev_free(src);
+        eprintf("ok\n");
+    }
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    int i;
+    const float *f = (const float*)value;
+    if (!value || length != vec_len)
+        return;
+    for (i = 0; i < length; i++) {
+        if (f[i] != expected[i]) {
+            eprintf("handler: element %d got %f, expected %f\n", i, f[i], expected[i]);
+            return;
+        }
+    }
+    ++received;
+}
+
+int setup_dst(const char *iface)
+{
+    dst = mpr_dev_new("testpacked-recv", 0);
+    if (!dst)
+        goto error;
+    if (iface)
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    eprintf("destination created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)dst)));
+
+    recvsig = mpr_sig_new(dst, MPR_DIR_IN, "insig", vec_len, MPR_FLT, NULL,
+                          NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    if (!recvsig)
+        goto error;
+    eprintf("Input signal 'insig' registered.\n");
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_dst()
+{
+    if (dst) {
+        eprintf("Freeing destination.. ");
+        fflush(stdout);
+        mpr_dev_free(dst);
+        eprintf("ok\n");
+    }
+}
+
+void wait_ready()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+}
+
+int setup_map()
+{
+    int i = 0;
+    map = mpr_map_new(1, &sendsig, 1, &recvsig);
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXPR, NULL, 1, MPR_STR, "y=x", 1);
+    mpr_obj_push((mpr_obj)map);
+    while (!done && !mpr_map_get_is_ready(map)) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        if (i++ > 100)
+            return 1;
+    }
+    return 0;
+}
+
+/* Wait until the source-side copy of the map reflects the requested configuration. */
+int configure_map(int packed, const char *expr)
+{
+    int i = 0;
+    mpr_list maps;
+    mpr_map src_map;
+
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_PACKED, NULL, 1, MPR_BOOL, &packed, 1);
+    mpr_obj_set_prop((mpr_obj)map, MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
+    mpr_obj_push((mpr_obj)map);
+
+    maps = mpr_sig_get_maps(sendsig, MPR_DIR_OUT);
+    src_map = maps ? (mpr_map)*maps : 0;
+    mpr_list_free(maps);
+    if (!src_map)
+        return 1;
+    while (!done) {
+        const char *e = mpr_obj_get_prop_as_str((mpr_obj)src_map, MPR_PROP_EXPR, NULL);
+        if (   packed == mpr_obj_get_prop_as_int32((mpr_obj)src_map, MPR_PROP_PACKED, NULL)
+            && e && !strcmp(e, expr))
+            return 0;
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        if (i++ > 100)
+            return 1;
+    }
+    return 1;
+}
+
+/* Compare the size of a serialized update message using both encodings. */
+void print_msg_sizes()
+{
+    int i;
+    float *v = calloc(1, vec_len * sizeof(float));
+    lo_message m1 = lo_message_new(), m2 = lo_message_new();
+    lo_blob b = lo_blob_new(vec_len * sizeof(float), v);
+    for (i = 0; i < vec_len; i++)
+        lo_message_add_float(m1, v[i]);
+    lo_message_add_string(m1, "@sl");
+    lo_message_add_int32(m1, 0);
+    lo_message_add_blob(m2, b);
+    lo_message_add_string(m2, "@sl");
+    lo_message_add_int32(m2, 0);
+    printf("message size for vector length %d: per-element %d bytes, packed %d bytes\n", vec_len,
+           (int)lo_message_length(m1, "/outsig"), (int)lo_message_length(m2, "/outsig"));
+    lo_blob_free(b);
+    lo_message_free(m1);
+    lo_message_free(m2);
+    free(v);
+}
+
+int run_mode(int mode)
+{
+    int i, j;
+    float *v = malloc(vec_len * sizeof(float));
+    const char *expr = mode < 2 ? "y=x" : "y[0]=x[0]";
+    if (configure_map(mode > 0, expr)) {
+        eprintf("Error configuring map for mode '%s'.\n", mode_names[mode]);
+        free(v);
+        return 1;
+    }
+
+    sent = received = 0;
+    times[mode] = current_time();
+    for (i = 0; i < iterations && !done; i++) {
+        for (j = 0; j < vec_len; j++) {
+            v[j] = (float)(i + j);
+            if (mode < 2 || 0 == j)
+                expected[j] = v[j];
+        }
+        mpr_sig_set_value(sendsig, 0, vec_len, MPR_FLT, v);
+        ++sent;
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, period);
+    }
+    times[mode] = current_time() - times[mode];
+    free(v);
+
+    eprintf("mode '%s': sent %d, received %d in %f seconds\n", mode_names[mode], sent,
+            received, times[mode]);
+    return sent != received;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testpacked.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--vec_len vector length (default 16), "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--vec_len")==0 && argc>i+1) {
+                            i++;
+                            vec_len = atoi(argv[i]);
+                            j = 1;
+                        }
+                        else if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    expected = malloc(vec_len * sizeof(float));
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_dst(iface)) {
+        eprintf("Error initializing destination.\n");
+        result = 1;
+        goto done;
+    }
+
+    if (setup_src(iface)) {
+        eprintf("Error initializing source.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_ready();
+
+    if (setup_map()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    for (i = 0; i < NUM_MODES && !result && !done; i++)
+        result = run_mode(i);
+
+    if (!result) {
+        print_msg_sizes();
+        for (i = 0; i < NUM_MODES; i++)
+            printf("%-18s %d updates in %f seconds\n", mode_names[i], iterations, times[i]);
+    }
+
+  done:
+    cleanup_dst();
+    cleanup_src();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    free(expected);
+    return result;
+}
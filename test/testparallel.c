@@ -0,0 +1,268 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#define MAX_MAPS    256
+#define VEC_LEN     32
+#define NUM_CONFIGS 5
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int iterations = 50;
+int num_maps = MAX_MAPS;
+int num_configs = NUM_CONFIGS;
+
+/* number of cores used to evaluate maps in each configuration */
+const int cores[NUM_CONFIGS] = {1, 2, 4, 8, 16};
+
+const char *expr = "y=sin(x)*cos(x*0.5)+sqrt(abs(x))*atan2(x,2)+tanh(pow(x,2)/(1+x*x))";
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsigs[MAX_MAPS];
+mpr_sig recvsigs[MAX_MAPS];
+
+/* last values received by each signal, and those received without worker threads */
+float received_vals[MAX_MAPS][VEC_LEN];
+float serial_vals[MAX_MAPS][VEC_LEN];
+int received = 0;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    const char *name = mpr_obj_get_prop_as_str((mpr_obj)sig, MPR_PROP_NAME, NULL);
+    int idx = atoi(name + 5);
+    if (!value || idx < 0 || idx >= num_maps)
+        return;
+    memcpy(received_vals[idx], value, sizeof(float) * VEC_LEN);
+    ++received;
+}
+
+int setup_devs(const char *iface)
+{
+    int i;
+    char name[32];
+    src = mpr_dev_new("testparallel-send", 0);
+    dst = mpr_dev_new("testparallel-recv", 0);
+    if (!src || !dst)
+        goto error;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    for (i = 0; i < num_maps; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, VEC_LEN, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, VEC_LEN, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+        if (!sendsigs[i] || !recvsigs[i])
+            goto error;
+    }
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_devs()
+{
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    eprintf("ok\n");
+}
+
+void wait_ready()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+}
+
+int setup_maps()
+{
+    int i, j = 0, ready = 0;
+    mpr_map *maps = (mpr_map*)calloc(num_maps, sizeof(mpr_map));
+    for (i = 0; i < num_maps; i++) {
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_set_prop((mpr_obj)maps[i], MPR_PROP_EXPR, NULL, 1, MPR_STR, expr, 1);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && !ready) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        for (i = 0, ready = 1; i < num_maps; i++) {
+            if (!mpr_map_get_is_ready(maps[i])) {
+                ready = 0;
+                break;
+            }
+        }
+        if (j++ > 1000)
+            break;
+    }
+    free(maps);
+    return !ready;
+}
+
+/* Update every signal, then time evaluating and sending all of the maps. */
+double run_config(int config)
+{
+    int i, j, k;
+    float v[VEC_LEN];
+    double then, total = 0;
+
+    if (mpr_dev_set_num_workers(src, cores[config] - 1))
+        return -1;
+
+    for (i = 0; i < iterations && !done; i++) {
+        for (j = 0; j < num_maps; j++) {
+            for (k = 0; k < VEC_LEN; k++)
+                v[k] = (i * num_maps + j) * 0.01f + k;
+            mpr_sig_set_value(sendsigs[j], 0, VEC_LEN, MPR_FLT, v);
+        }
+        received = 0;
+        then = current_time();
+        mpr_dev_update_maps(src);
+        total += current_time() - then;
+        for (j = 0; j < 100 && received < num_maps; j++)
+            mpr_dev_poll(dst, period);
+        if (received < num_maps) {
+            eprintf("Error: received %d of %d updates.\n", received, num_maps);
+            return -1;
+        }
+    }
+    return total;
+}
+
+int run()
+{
+    int i;
+    double elapsed, serial = 0;
+
+    eprintf("evaluating %d maps of length %d over %d iterations\n", num_maps, VEC_LEN,
+            iterations);
+    for (i = 0; i < num_configs && !done; i++) {
+        if ((elapsed = run_config(i)) < 0) {
+            eprintf("Error: could not run with %d cores.\n", cores[i]);
+            return 1;
+        }
+        if (!i) {
+            serial = elapsed;
+            memcpy(serial_vals, received_vals, sizeof(serial_vals));
+        }
+        else if (memcmp(serial_vals, received_vals, sizeof(serial_vals))) {
+            eprintf("Error: results with %d cores differ from those with 1 core.\n", cores[i]);
+            return 1;
+        }
+        eprintf("%2d cores: %8.0f maps/s, speedup %.2fx\n", cores[i],
+                num_maps * iterations / elapsed, serial / elapsed);
+    }
+    eprintf("%ld cores available.\n", sysconf(_SC_NPROCESSORS_ONLN));
+    mpr_dev_set_num_workers(src, 0);
+    return 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testparallel.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        iterations = 10;
+                        num_maps = 64;
+                        num_configs = 3;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_ready();
+
+    if (setup_maps()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = run();
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
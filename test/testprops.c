@@ -984,6 +984,20 @@ int main(int argc, char **argv)
     else
         eprintf("OK\n");
 
+    /* Test that every property of the signal can be retrieved by index and by key. */
+    length = mpr_obj_get_num_props(sig, 0);
+    eprintf("Test 38: retrieving %d signal properties by key... ", length);
+    for (i = 0; i < length; i++) {
+        const char *key;
+        mpr_prop prop = mpr_obj_get_prop_by_idx(sig, i, &key, NULL, NULL, NULL, NULL);
+        if (!key || mpr_obj_get_prop_by_key(sig, key, NULL, NULL, NULL, NULL) != prop) {
+            eprintf("ERROR (property %d '%s')\n", i, key);
+            result = 1;
+            goto cleanup;
+        }
+    }
+    eprintf("OK\n");
+
   cleanup:
     if (dev) mpr_dev_free(dev);
     if (!verbose)
@@ -0,0 +1,291 @@
+#ifdef __linux__
+#define _GNU_SOURCE /* for recvmmsg() */
+#endif
+
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int num_sigs = 64;
+int iterations = 50;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig *sendsigs = 0;
+mpr_sig *recvsigs = 0;
+
+int received = 0;
+
+/* statistics collected by the syscall shim */
+int num_calls = 0;
+int num_dgrams = 0;
+
+#define NUM_MODES 2
+const char *mode_names[] = {"unlimited", "budgeted"};
+int budgets[NUM_MODES] = {0, 16};
+float polls_per_burst[NUM_MODES];
+float calls_per_burst[NUM_MODES];
+
+#if defined(SYS_recvmmsg)
+/* Interpose recvmmsg() to count the system calls used for receiving data. */
+int recvmmsg(int fd, struct mmsghdr *msgs, unsigned int len, int flags, struct timespec *timeout)
+{
+    int ret = syscall(SYS_recvmmsg, fd, msgs, len, flags, timeout);
+    if (ret > 0) {
+        ++num_calls;
+        num_dgrams += ret;
+    }
+    return ret;
+}
+#define HAVE_SYSCALL_SHIM 1
+#else
+#define HAVE_SYSCALL_SHIM 0
+#endif
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value)
+        ++received;
+}
+
+int setup_devs(const char *iface)
+{
+    int i;
+    char name[32];
+    src = mpr_dev_new("testrecvburst-send", 0);
+    dst = mpr_dev_new("testrecvburst-recv", 0);
+    if (!src || !dst)
+        goto error;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    /* send each update as a separate datagram */
+    mpr_graph_set_mtu(mpr_obj_get_graph((mpr_obj)src), 1);
+
+    sendsigs = calloc(1, num_sigs * sizeof(mpr_sig));
+    recvsigs = calloc(1, num_sigs * sizeof(mpr_sig));
+    for (i = 0; i < num_sigs; i++) {
+        snprintf(name, 32, "outsig%d", i);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, NULL, 0);
+        snprintf(name, 32, "insig%d", i);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_FLT, NULL,
+                                  NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+        if (!sendsigs[i] || !recvsigs[i])
+            goto error;
+    }
+    eprintf("%d signals registered on each device.\n", num_sigs);
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_devs()
+{
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    free(sendsigs);
+    free(recvsigs);
+    eprintf("ok\n");
+}
+
+void wait_ready()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+}
+
+int setup_maps()
+{
+    int i, j = 0, ready = 0;
+    mpr_map *maps = calloc(1, num_sigs * sizeof(mpr_map));
+    for (i = 0; i < num_sigs; i++) {
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && !ready) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        for (i = 0, ready = 1; i < num_sigs; i++) {
+            if (!mpr_map_get_is_ready(maps[i])) {
+                ready = 0;
+                break;
+            }
+        }
+        if (j++ > 500)
+            break;
+    }
+    free(maps);
+    return !ready;
+}
+
+int run_mode(int mode)
+{
+    int i, j, polls = 0, max_per_poll = 0, expected = iterations * num_sigs;
+    float v;
+
+    mpr_dev_set_poll_budget(dst, budgets[mode], 0);
+    num_calls = num_dgrams = received = 0;
+
+    for (i = 0; i < iterations && !done; i++) {
+        int before = received;
+        v = (float)i;
+        for (j = 0; j < num_sigs; j++)
+            mpr_sig_set_value(sendsigs[j], 0, 1, MPR_FLT, &v);
+        mpr_dev_poll(src, 0);
+        usleep(period * 1000);
+
+        /* count the non-blocking polls needed to handle the burst */
+        for (j = 0; j < num_sigs && received - before < num_sigs; j++) {
+            int count = received;
+            mpr_dev_poll(dst, 0);
+            ++polls;
+            if (received - count > max_per_poll)
+                max_per_poll = received - count;
+        }
+    }
+
+    polls_per_burst[mode] = (float)polls / iterations;
+    calls_per_burst[mode] = (float)num_calls / iterations;
+    eprintf("mode '%s': received %d of %d updates in %d polls (max %d per poll), %d recvmmsg "
+            "calls for %d datagrams\n", mode_names[mode], received, expected, polls, max_per_poll,
+            num_calls, num_dgrams);
+
+    if (received != expected)
+        return 1;
+    /* one extra update may be handled before draining begins */
+    if (budgets[mode] && max_per_poll > budgets[mode] + 1) {
+        eprintf("Error: poll handled %d updates with a budget of %d.\n", max_per_poll,
+                budgets[mode]);
+        return 1;
+    }
+    return 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testrecvburst.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--num_sigs number of mapped signals (default 64), "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--num_sigs")==0 && argc>i+1) {
+                            i++;
+                            num_sigs = atoi(argv[i]);
+                            j = 1;
+                        }
+                        else if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_ready();
+
+    if (setup_maps()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    for (i = 0; i < NUM_MODES && !result && !done; i++)
+        result = run_mode(i);
+
+    /* without a budget each burst should be drained by a single poll */
+    if (!result && polls_per_burst[0] > 1.5) {
+        eprintf("Error: unlimited budget needed %.1f polls per burst.\n", polls_per_burst[0]);
+        result = 1;
+    }
+    /* if recvmmsg() is in use, each call should carry several datagrams */
+    if (!result && HAVE_SYSCALL_SHIM && calls_per_burst[0] >= num_sigs) {
+        eprintf("Error: batched receiving did not reduce the number of system calls.\n");
+        result = 1;
+    }
+
+    if (!result) {
+        for (i = 0; i < NUM_MODES; i++)
+            printf("%-10s %d updates per burst: %.1f polls and %.1f recvmmsg calls per burst\n",
+                   mode_names[i], num_sigs, polls_per_burst[i], calls_per_burst[i]);
+    }
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,277 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+
+#define NUM_INST 4
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int iterations = 100;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+mpr_sig sendsig_inst = 0;
+mpr_sig sendsig_vec = 0;
+mpr_sig recvsig_inst = 0;
+mpr_sig recvsig_vec = 0;
+
+int received = 0;
+
+/* statistics collected by the allocator shim */
+int counting = 0;
+int num_allocs = 0;
+
+#if defined(__GLIBC__)
+/* Interpose the allocator to count heap allocations made while updating signals. */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t num, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    if (counting)
+        ++num_allocs;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t num, size_t size)
+{
+    if (counting)
+        ++num_allocs;
+    return __libc_calloc(num, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (counting)
+        ++num_allocs;
+    return __libc_realloc(ptr, size);
+}
+#define HAVE_ALLOC_SHIM 1
+#else
+#define HAVE_ALLOC_SHIM 0
+#endif
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value)
+        ++received;
+}
+
+int setup_devs(const char *iface)
+{
+    int num_inst = NUM_INST;
+    src = mpr_dev_new("testrtalloc-send", 0);
+    dst = mpr_dev_new("testrtalloc-recv", 0);
+    if (!src || !dst)
+        goto error;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    mpr_dev_set_realtime(src, 1);
+
+    sendsig_inst = mpr_sig_new(src, MPR_DIR_OUT, "outsig_inst", 3, MPR_FLT, NULL,
+                               NULL, NULL, &num_inst, NULL, 0);
+    sendsig_vec = mpr_sig_new(src, MPR_DIR_OUT, "outsig_vec", 4, MPR_INT32, NULL,
+                              NULL, NULL, NULL, NULL, 0);
+    recvsig_inst = mpr_sig_new(dst, MPR_DIR_IN, "insig_inst", 3, MPR_FLT, NULL,
+                               NULL, NULL, &num_inst, handler, MPR_SIG_UPDATE);
+    recvsig_vec = mpr_sig_new(dst, MPR_DIR_IN, "insig_vec", 4, MPR_INT32, NULL,
+                              NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+    if (!sendsig_inst || !sendsig_vec || !recvsig_inst || !recvsig_vec)
+        goto error;
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_devs()
+{
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    eprintf("ok\n");
+}
+
+void wait_ready()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+}
+
+int setup_maps()
+{
+    int i = 0, loc = MPR_LOC_DST;
+    mpr_map maps[2];
+
+    /* instanced map processed at the source */
+    maps[0] = mpr_map_new(1, &sendsig_inst, 1, &recvsig_inst);
+    mpr_obj_set_prop((mpr_obj)maps[0], MPR_PROP_EXPR, NULL, 1, MPR_STR, "y=x*2", 1);
+    mpr_obj_push((mpr_obj)maps[0]);
+
+    /* vector map processed at the destination */
+    maps[1] = mpr_map_new(1, &sendsig_vec, 1, &recvsig_vec);
+    mpr_obj_set_prop((mpr_obj)maps[1], MPR_PROP_PROCESS_LOC, NULL, 1, MPR_INT32, &loc, 1);
+    mpr_obj_push((mpr_obj)maps[1]);
+
+    while (!done && !(mpr_map_get_is_ready(maps[0]) && mpr_map_get_is_ready(maps[1]))) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        if (i++ > 500)
+            return 1;
+    }
+    return 0;
+}
+
+/* Update every instance, release one of them and send the resulting messages. */
+void update(int i)
+{
+    int j, v[4];
+    float f[3];
+    for (j = 0; j < NUM_INST; j++) {
+        f[0] = f[1] = f[2] = (float)(i + j);
+        mpr_sig_set_value(sendsig_inst, j, 3, MPR_FLT, f);
+    }
+    v[0] = v[1] = v[2] = v[3] = i;
+    mpr_sig_set_value(sendsig_vec, 0, 4, MPR_INT32, v);
+    mpr_sig_release_inst(sendsig_inst, i % NUM_INST);
+    mpr_dev_update_maps(src);
+}
+
+int run()
+{
+    int i;
+
+    /* use every instance once before measuring */
+    for (i = 0; i < NUM_INST && !done; i++) {
+        update(i);
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, period);
+    }
+    received = 0;
+
+    for (i = 0; i < iterations && !done; i++) {
+        counting = 1;
+        update(i);
+        counting = 0;
+        /* receiving and housekeeping are not on the update path */
+        mpr_dev_poll(src, 0);
+        mpr_dev_poll(dst, period);
+    }
+    mpr_dev_poll(dst, 100);
+
+    eprintf("received %d updates, %d allocations and %d pool misses during %d iterations\n",
+            received, num_allocs, mpr_dev_get_num_pool_misses(src), iterations);
+
+    if (!received) {
+        eprintf("Error: no updates were received.\n");
+        return 1;
+    }
+    if (mpr_dev_get_num_pool_misses(src)) {
+        eprintf("Error: preallocated pools were exhausted.\n");
+        return 1;
+    }
+    if (!HAVE_ALLOC_SHIM)
+        eprintf("allocator shim is not available on this platform.\n");
+    else if (num_allocs) {
+        eprintf("Error: signal updates allocated memory.\n");
+        return 1;
+    }
+    return 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testrtalloc.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_ready();
+
+    if (setup_maps()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = run();
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
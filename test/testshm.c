@@ -0,0 +1,303 @@
+#ifdef __linux__
+#define _GNU_SOURCE /* for sendmmsg() */
+#endif
+
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int iterations = 1000;
+
+mpr_dev src = 0;
+mpr_dev dst = 0;
+
+#define NUM_MODES 2
+const char *mode_names[] = {"udp", "shm"};
+mpr_proto mode_protos[] = {MPR_PROTO_UDP, MPR_PROTO_SHM};
+mpr_sig sendsigs[NUM_MODES];
+mpr_sig recvsigs[NUM_MODES];
+
+int received = 0;
+int last_value = -1;
+
+/* statistics collected by the syscall shim */
+int dst_port = 0;
+int num_dgrams = 0;
+
+#if defined(SYS_sendto) && defined(SYS_sendmmsg)
+static int is_dst_addr(const struct sockaddr *addr)
+{
+    return (   dst_port && addr && AF_INET == addr->sa_family
+            && dst_port == ntohs(((const struct sockaddr_in*)addr)->sin_port));
+}
+
+/* Interpose the socket send functions to count datagrams sent to the destination device. */
+ssize_t sendto(int fd, const void *buf, size_t len, int flags, const struct sockaddr *addr,
+               socklen_t addr_len)
+{
+    if (is_dst_addr(addr))
+        ++num_dgrams;
+    return syscall(SYS_sendto, fd, buf, len, flags, addr, addr_len);
+}
+
+int sendmmsg(int fd, struct mmsghdr *msgs, unsigned int len, int flags)
+{
+    int ret = syscall(SYS_sendmmsg, fd, msgs, len, flags);
+    if (len && ret > 0 && is_dst_addr((const struct sockaddr*)msgs[0].msg_hdr.msg_name))
+        num_dgrams += ret;
+    return ret;
+}
+#define HAVE_SYSCALL_SHIM 1
+#else
+#define HAVE_SYSCALL_SHIM 0
+#endif
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+void handler(mpr_sig sig, mpr_sig_evt event, mpr_id instance, int length,
+             mpr_type type, const void *value, mpr_time t)
+{
+    if (value) {
+        ++received;
+        last_value = *(int*)value;
+    }
+}
+
+int setup_devs(const char *iface)
+{
+    int i;
+    char name[32];
+    src = mpr_dev_new("testshm-send", 0);
+    dst = mpr_dev_new("testshm-recv", 0);
+    if (!src || !dst)
+        goto error;
+    if (iface) {
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)src), iface);
+        mpr_graph_set_interface(mpr_obj_get_graph((mpr_obj)dst), iface);
+    }
+    eprintf("devices created using interface %s.\n",
+            mpr_graph_get_interface(mpr_obj_get_graph((mpr_obj)src)));
+
+    for (i = 0; i < NUM_MODES; i++) {
+        snprintf(name, 32, "outsig_%s", mode_names[i]);
+        sendsigs[i] = mpr_sig_new(src, MPR_DIR_OUT, name, 1, MPR_INT32, NULL,
+                                  NULL, NULL, NULL, NULL, 0);
+        snprintf(name, 32, "insig_%s", mode_names[i]);
+        recvsigs[i] = mpr_sig_new(dst, MPR_DIR_IN, name, 1, MPR_INT32, NULL,
+                                  NULL, NULL, NULL, handler, MPR_SIG_UPDATE);
+        if (!sendsigs[i] || !recvsigs[i])
+            goto error;
+    }
+    return 0;
+
+  error:
+    return 1;
+}
+
+void cleanup_devs()
+{
+    eprintf("Freeing devices.. ");
+    fflush(stdout);
+    if (src)
+        mpr_dev_free(src);
+    if (dst)
+        mpr_dev_free(dst);
+    eprintf("ok\n");
+}
+
+void wait_ready()
+{
+    while (!done && !(mpr_dev_get_is_ready(src) && mpr_dev_get_is_ready(dst))) {
+        mpr_dev_poll(src, 25);
+        mpr_dev_poll(dst, 25);
+    }
+}
+
+int setup_maps()
+{
+    int i, j = 0, ready = 0;
+    double then;
+    mpr_map maps[NUM_MODES];
+    for (i = 0; i < NUM_MODES; i++) {
+        maps[i] = mpr_map_new(1, &sendsigs[i], 1, &recvsigs[i]);
+        mpr_obj_set_prop((mpr_obj)maps[i], MPR_PROP_PROTOCOL, NULL, 1, MPR_INT32,
+                         &mode_protos[i], 1);
+        mpr_obj_push((mpr_obj)maps[i]);
+    }
+    while (!done && !ready) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+        for (i = 0, ready = 1; i < NUM_MODES; i++)
+            ready &= mpr_map_get_is_ready(maps[i]);
+        if (j++ > 500)
+            return 1;
+    }
+    /* the shared memory ring may only be opened when the link is next pinged */
+    then = current_time();
+    while (!done && current_time() - then < 1.5) {
+        mpr_dev_poll(src, 10);
+        mpr_dev_poll(dst, 10);
+    }
+    dst_port = mpr_obj_get_prop_as_int32((mpr_obj)dst, MPR_PROP_PORT, NULL);
+    return 0;
+}
+
+/* Send updates one at a time and wait for each to arrive, then send them back to back and wait
+ * for all of them. */
+int run_mode(int mode, double *latency, double *rate, int *dgrams)
+{
+    int i, j, expected;
+    double then, total = 0;
+
+    received = num_dgrams = 0;
+    for (i = 0; i < iterations && !done; i++) {
+        then = current_time();
+        mpr_sig_set_value(sendsigs[mode], 0, 1, MPR_INT32, &i);
+        mpr_dev_update_maps(src);
+        for (j = 0; j < 10000 && received <= i; j++)
+            mpr_dev_poll(dst, 0);
+        total += current_time() - then;
+    }
+    *latency = total / iterations;
+
+    expected = received + iterations;
+    then = current_time();
+    for (i = 0; i < iterations && !done; i++) {
+        mpr_sig_set_value(sendsigs[mode], 0, 1, MPR_INT32, &i);
+        mpr_dev_update_maps(src);
+        if (i % 10 == 9)
+            mpr_dev_poll(dst, 0);
+    }
+    for (j = 0; j < 100 && received < expected; j++)
+        mpr_dev_poll(dst, period);
+    *rate = iterations / (current_time() - then);
+    *dgrams = num_dgrams;
+
+    eprintf("%s: received %d of %d updates in %d datagrams, latency %.1f us, %.0f updates/s\n",
+            mode_names[mode], received, iterations * 2, num_dgrams, *latency * 1000000, *rate);
+    return received != iterations * 2 || last_value != iterations - 1;
+}
+
+int run()
+{
+    int i, dgrams[NUM_MODES];
+    double latency[NUM_MODES], rate[NUM_MODES];
+    const char *host_id = mpr_obj_get_prop_as_str((mpr_obj)src, MPR_PROP_HOST_ID, NULL);
+
+    for (i = 0; i < NUM_MODES; i++) {
+        if (run_mode(i, &latency[i], &rate[i], &dgrams[i])) {
+            eprintf("Error: updates were lost using %s.\n", mode_names[i]);
+            return 1;
+        }
+    }
+    if (!host_id) {
+        eprintf("shared memory is not available on this platform.\n");
+        return 0;
+    }
+    eprintf("shared memory latency is %.2fx and throughput %.2fx that of UDP loopback.\n",
+            latency[1] / latency[0], rate[1] / rate[0]);
+    if (HAVE_SYSCALL_SHIM && dgrams[1] * 10 > dgrams[0]) {
+        eprintf("Error: shared memory maps were sent using UDP.\n");
+        return 1;
+    }
+    return 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("testshm.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        iterations = 200;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    if (setup_devs(iface)) {
+        eprintf("Error initializing devices.\n");
+        result = 1;
+        goto done;
+    }
+
+    wait_ready();
+
+    if (setup_maps()) {
+        eprintf("Error connecting signals.\n");
+        result = 1;
+        goto done;
+    }
+
+    result = run();
+
+  done:
+    cleanup_devs();
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
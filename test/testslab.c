@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/time.h>
+#include <lo/lo_lowlevel.h>
+#include "../src/mapper_internal.h"
+#include "graph_helpers.h"
+
+int verbose = 1;
+int num_devs = 100;
+int sigs_per_dev = 40;
+int rounds = 50;
+int iterations = 20;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+/* Repeatedly add and remove devices along with their signals, checking that the pool reuses the
+ * memory released by each round. Returns the number of objects added and removed per second, or
+ * -1 on error. */
+static double churn(mpr_graph g)
+{
+    int i, in_use, reserved, base_in_use, base_reserved = 0;
+    double then = current_time();
+    mpr_graph_get_pool_stats(g, &base_in_use, NULL, NULL);
+    for (i = 0; i < rounds; i++) {
+        if (graph_add_devs(g, "testslab.churn", num_devs, sigs_per_dev, NULL))
+            return -1;
+        graph_remove_devs(g, "testslab.churn", num_devs, 1);
+        mpr_graph_get_pool_stats(g, &in_use, &reserved, NULL);
+        if (in_use != base_in_use) {
+            eprintf("Error: %d blocks still in use after round %d.\n", in_use - base_in_use, i);
+            return -1;
+        }
+        if (!i)
+            base_reserved = reserved;
+        else if (reserved != base_reserved) {
+            eprintf("Error: pool grew from %d to %d blocks in round %d.\n", base_reserved,
+                    reserved, i);
+            return -1;
+        }
+    }
+    return rounds * num_devs * (sigs_per_dev + 1) * 2 / (current_time() - then);
+}
+
+/* Query the signals of every device and filter the signals of the graph. Returns the number of
+ * queries per second, or -1 if any query returned the wrong number of items. */
+static double run_queries(mpr_graph g)
+{
+    int i, count = 0, dir = MPR_DIR_OUT;
+    double then = current_time();
+    for (i = 0; i < iterations; i++) {
+        mpr_list devs = mpr_graph_get_objs(g, MPR_DEV);
+        mpr_list l;
+        while (devs) {
+            l = mpr_dev_get_sigs((mpr_dev)*devs, MPR_DIR_IN);
+            if (mpr_list_get_size(l) != sigs_per_dev / 2)
+                return -1;
+            mpr_list_free(l);
+            devs = mpr_list_get_next(devs);
+            ++count;
+        }
+        l = mpr_list_filter(mpr_graph_get_objs(g, MPR_SIG), MPR_PROP_DIR, NULL, 1, MPR_INT32,
+                            &dir, MPR_OP_EQ);
+        if (mpr_list_get_size(l) != num_devs * sigs_per_dev / 2)
+            return -1;
+        mpr_list_free(l);
+        ++count;
+    }
+    return count / (current_time() - then);
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, allocs, in_use, base_in_use, reserved, misses, dir = MPR_DIR_IN;
+    double rate;
+    mpr_graph graph;
+    mpr_list kept;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        eprintf("testslab.c: possible arguments "
+                                "-f fast (execute quickly), "
+                                "-q quiet (suppress output), "
+                                "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        num_devs = 20;
+                        rounds = 5;
+                        iterations = 5;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    graph = mpr_graph_new(0);
+
+    if (graph_add_devs(graph, "testslab", num_devs, sigs_per_dev, NULL)) {
+        eprintf("Error building graph.\n");
+        result = 1;
+        goto done;
+    }
+
+    mpr_graph_get_pool_stats(graph, &base_in_use, NULL, NULL);
+    if ((rate = run_queries(graph)) < 0) {
+        eprintf("Error: query returned the wrong number of objects.\n");
+        result = 1;
+        goto done;
+    }
+    eprintf("query iteration: %.0f queries/s\n", rate);
+    mpr_graph_get_pool_stats(graph, &in_use, NULL, NULL);
+    if (in_use != base_in_use) {
+        eprintf("Error: %d query blocks were not released.\n", in_use - base_in_use);
+        result = 1;
+        goto done;
+    }
+
+    if ((rate = churn(graph)) < 0) {
+        result = 1;
+        goto done;
+    }
+    eprintf("graph churn: %.0f objects/s\n", rate);
+
+    allocs = mpr_graph_get_pool_stats(graph, &in_use, &reserved, &misses);
+    eprintf("pool: %d allocations, %d blocks in use, %d reserved, %d misses\n", allocs, in_use,
+            reserved, misses);
+
+    /* queries may be freed after their graph, e.g. by language bindings */
+    kept = mpr_list_filter(mpr_graph_get_objs(graph, MPR_SIG), MPR_PROP_DIR, NULL, 1, MPR_INT32,
+                           &dir, MPR_OP_EQ);
+    mpr_graph_free(graph);
+    graph = 0;
+    mpr_list_free(kept);
+
+done:
+    if (graph)
+        mpr_graph_free(graph);
+    if (!verbose)
+        printf("..................................................");
+    printf("Test %s\x1B[0m.\n", result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
@@ -0,0 +1,164 @@
+#include <mapper/mapper.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <math.h>
+#include <unistd.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#define MAX_DEVS    100
+#define NUM_COUNTS  3
+
+int verbose = 1;
+int done = 0;
+int period = 10;
+int num_counts = NUM_COUNTS;
+
+/* number of devices started together in each configuration */
+const int counts[NUM_COUNTS] = {1, 10, 100};
+
+mpr_dev devs[MAX_DEVS];
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+void free_devs(int num)
+{
+    int i;
+    /* the shared graph is freed along with the last device */
+    for (i = num - 1; i >= 0; i--) {
+        if (devs[i])
+            mpr_dev_free(devs[i]);
+        devs[i] = 0;
+    }
+}
+
+/* Start num devices sharing a graph and return the number of seconds until all of them are
+ * ready, or -1 on error. */
+double start_devs(int num, int fast, const char *iface)
+{
+    int i, ready = 0;
+    double then = current_time();
+    mpr_graph graph = 0;
+
+    for (i = 0; i < num; i++) {
+        if (!(devs[i] = mpr_dev_new("teststartup", graph)))
+            return -1;
+        if (!i) {
+            graph = mpr_obj_get_graph((mpr_obj)devs[0]);
+            if (iface)
+                mpr_graph_set_interface(graph, iface);
+        }
+        /* a single device claims the ordinal of a previous instance */
+        if (fast && mpr_dev_set_fast_registration(devs[i], 1 == num ? 3 : 0))
+            return -1;
+    }
+    while (!done && !ready) {
+        mpr_dev_poll(devs[0], period);
+        for (i = 1, ready = mpr_dev_get_is_ready(devs[0]); i < num; i++) {
+            mpr_dev_poll(devs[i], 0);
+            ready &= mpr_dev_get_is_ready(devs[i]);
+        }
+        if (current_time() - then > 30)
+            return -1;
+    }
+    if (1 == num && verbose) {
+        const char *name = mpr_obj_get_prop_as_str((mpr_obj)devs[0], MPR_PROP_NAME, NULL);
+        eprintf("  registered as '%s'\n", name);
+    }
+    return done ? -1 : current_time() - then;
+}
+
+int run(const char *iface)
+{
+    int i, fast;
+    double elapsed[2];
+
+    for (i = 0; i < num_counts && !done; i++) {
+        for (fast = 0; fast < 2; fast++) {
+            elapsed[fast] = start_devs(counts[i], fast, iface);
+            free_devs(counts[i]);
+            if (elapsed[fast] < 0) {
+                eprintf("Error: %d devices were not ready.\n", counts[i]);
+                return 1;
+            }
+        }
+        eprintf("%3d devices ready after %6.3f s, %6.3f s with fast registration\n", counts[i],
+                elapsed[0], elapsed[1]);
+        if (elapsed[1] * 2 > elapsed[0]) {
+            eprintf("Error: fast registration did not shorten startup.\n");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void ctrlc(int sig)
+{
+    done = 1;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0;
+    char *iface = 0;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        printf("teststartup.c: possible arguments "
+                               "-f fast (execute quickly), "
+                               "-q quiet (suppress output), "
+                               "-h help, "
+                               "--iface network interface\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        period = 1;
+                        num_counts = 2;
+                        break;
+                    case '-':
+                        if (strcmp(argv[i], "--iface")==0 && argc>i+1) {
+                            i++;
+                            iface = argv[i];
+                            j = 1;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    signal(SIGINT, ctrlc);
+
+    result = run(iface);
+
+    printf("...................Test %s\x1B[0m.\n",
+           result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}
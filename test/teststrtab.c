@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/time.h>
+#include <lo/lo_lowlevel.h>
+#include "../src/mapper_internal.h"
+#include "graph_helpers.h"
+
+int verbose = 1;
+int num_devs = 500;
+int sigs_per_dev = 80;
+
+static void eprintf(const char *format, ...)
+{
+    va_list args;
+    if (!verbose)
+        return;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+}
+
+static double current_time()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (double) tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void add_props(lo_message lom, int dev_idx, int sig_idx)
+{
+    char group[16];
+    lo_message_add_string(lom, "@group");
+    snprintf(group, 16, "g%d", sig_idx % 10);
+    lo_message_add_string(lom, group);
+    lo_message_add_string(lom, "@sensor_type");
+    lo_message_add_string(lom, "accelerometer");
+}
+
+/* Check that signals with the same name on different devices share the same path. */
+static int check_shared(mpr_graph g)
+{
+    mpr_dev d1 = mpr_graph_get_dev_by_name(g, "teststrtab.1");
+    mpr_dev d2 = mpr_graph_get_dev_by_name(g, "teststrtab.2");
+    mpr_sig s1 = mpr_dev_get_sig_by_name(d1, "in0");
+    mpr_sig s2 = mpr_dev_get_sig_by_name(d2, "in0");
+    mpr_tbl_record r1, r2;
+    if (!s1 || !s2 || s1 == s2 || s1->path != s2->path) {
+        eprintf("Error: signal paths are not shared.\n");
+        return 1;
+    }
+    if (s1->path != mpr_strtab_find(g->strings, "/in0") || mpr_strtab_find(g->strings, "/nope")) {
+        eprintf("Error: unexpected result from mpr_strtab_find().\n");
+        return 1;
+    }
+    r1 = mpr_tbl_get(s1->obj.props.synced, MPR_PROP_EXTRA, "group");
+    r2 = mpr_tbl_get(s2->obj.props.synced, MPR_PROP_EXTRA, "group");
+    if (!r1 || !r2 || r1->key != r2->key) {
+        eprintf("Error: property keys are not shared.\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int i, j, result = 0, base_count;
+    double then;
+    mpr_graph graph;
+    mpr_strtab strings;
+
+    /* process flags for -q quiet, -f fast, -h help */
+    for (i = 1; i < argc; i++) {
+        if (argv[i] && argv[i][0] == '-') {
+            int len = strlen(argv[i]);
+            for (j = 1; j < len; j++) {
+                switch (argv[i][j]) {
+                    case 'h':
+                        eprintf("teststrtab.c: possible arguments "
+                                "-f fast (execute quickly), "
+                                "-q quiet (suppress output), "
+                                "-h help\n");
+                        return 1;
+                        break;
+                    case 'q':
+                        verbose = 0;
+                        break;
+                    case 'f':
+                        num_devs = 50;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    graph = mpr_graph_new(0);
+    strings = graph->strings;
+    base_count = strings->count;
+
+    then = current_time();
+    if (graph_add_devs(graph, "teststrtab", num_devs, sigs_per_dev, add_props)) {
+        eprintf("Error building graph.\n");
+        result = 1;
+        goto done;
+    }
+    eprintf("added %d devices and %d signals in %.3f seconds\n", num_devs,
+            num_devs * sigs_per_dev, current_time() - then);
+    eprintf("interned %d strings using %lu bytes, saving %lu bytes (%.1f%%)\n", strings->count,
+            (unsigned long)strings->bytes, (unsigned long)strings->bytes_saved,
+            100.0 * strings->bytes_saved / (strings->bytes + strings->bytes_saved));
+
+    if ((result = check_shared(graph)))
+        goto done;
+    if (strings->count > base_count + sigs_per_dev + 2) {
+        eprintf("Error: %d strings interned, expected at most %d.\n", strings->count,
+                base_count + sigs_per_dev + 2);
+        result = 1;
+        goto done;
+    }
+
+    /* every string must be released along with the objects using it */
+    graph_remove_devs(graph, "teststrtab", num_devs, 1);
+    if (strings->count != base_count || strings->bytes_saved) {
+        eprintf("Error: %d strings still interned after removing devices.\n",
+                strings->count - base_count);
+        result = 1;
+        goto done;
+    }
+
+done:
+    mpr_graph_free(graph);
+    if (!verbose)
+        printf("..................................................");
+    printf("Test %s\x1B[0m.\n", result ? "\x1B[31mFAILED" : "\x1B[32mPASSED");
+    return result;
+}